@@ -90,6 +90,7 @@ class Compactor::Internal : public Xapian::Internal::intrusive_base {
     int compact_to_stub;
     size_t block_size;
     compaction_level compaction;
+    unsigned spelling_deletions;
 
     Xapian::docid tot_off;
     Xapian::docid last_docid;
@@ -104,8 +105,8 @@ class Compactor::Internal : public Xapian::Internal::intrusive_base {
   public:
     Internal()
 	: renumber(true), multipass(false),
-	  block_size(8192), compaction(FULL), tot_off(0),
-	  last_docid(0), backend(UNKNOWN)
+	  block_size(8192), compaction(FULL), spelling_deletions(0),
+	  tot_off(0), last_docid(0), backend(UNKNOWN)
     {
     }
 
@@ -144,6 +145,14 @@ Compactor::set_compaction_level(compaction_level compaction)
     internal->compaction = compaction;
 }
 
+void
+Compactor::set_spelling_deletions(unsigned deletions)
+{
+    if (deletions > 3)
+	throw Xapian::InvalidArgumentError("Spelling deletions must be at most 3");
+    internal->spelling_deletions = deletions;
+}
+
 void
 Compactor::set_destdir(const string & destdir)
 {
@@ -458,7 +467,7 @@ Compactor::Internal::compact(Xapian::Compactor & compactor)
     } else if (backend == BRASS) {
 #ifdef XAPIAN_HAS_BRASS_BACKEND
 	compact_brass(compactor, destdir.c_str(), sources, offset, block_size,
-		      compaction, multipass, last_docid);
+		      compaction, multipass, last_docid, spelling_deletions);
 #else
 	throw Xapian::FeatureUnavailableError("Brass backend disabled at build time");
 #endif
@@ -8,9 +8,14 @@
  *  and David Roach, Acxiom Corporation
  *
  *  http://berghel.net/publications/asm/asm.php
+ *
+ *  EditDistanceCalculator uses the bit-parallel algorithm described in:
+ *
+ *  "A Bit-Vector Algorithm for Computing Levenshtein and Damerau Edit
+ *  Distances" by Heikki Hyyrö, Nordic Journal of Computing 10 (2003)
  */
 /* Copyright (C) 2003 Richard Boulton
- * Copyright (C) 2007,2008,2009 Olly Betts
+ * Copyright (C) 2007,2008,2009,2012 Olly Betts
  *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -35,6 +40,7 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <cstring>
 
 using namespace std;
 
@@ -213,3 +219,67 @@ edit_distance_unsigned(const unsigned * ptr1, int len1,
 {
     return seqcmp_editdist<unsigned>(ptr1, len1, ptr2, len2, max_distance);
 }
+
+EditDistanceCalculator::EditDistanceCalculator(const unsigned * ptr, int len)
+    : target(ptr), target_len(len)
+{
+    if (len > MAX_BITPARALLEL) return;
+
+    memset(table, 0, sizeof(table));
+    for (int i = 0; i != len; ++i) {
+	unsigned ch = ptr[i];
+	unsigned j = ch % TABLE_SIZE;
+	// There are at most MAX_BITPARALLEL different characters, so the table
+	// can't fill up.
+	while (table[j].mask && table[j].ch != ch) j = (j + 1) % TABLE_SIZE;
+	table[j].ch = ch;
+	table[j].mask |= bitmask(1) << i;
+    }
+}
+
+int
+EditDistanceCalculator::operator()(const unsigned * ptr, int len,
+				   int max_distance) const
+{
+    if (target_len > MAX_BITPARALLEL)
+	return edit_distance_unsigned(target, target_len, ptr, len,
+				      max_distance);
+
+    // The length difference is a lower bound on the edit distance.
+    if (abs(len - target_len) > max_distance) return abs(len - target_len);
+
+    if (target_len == 0) return len;
+
+    // We track the last row of the edit distance matrix, which starts as
+    // the distance from the target to the empty sequence.  VP and VN are the
+    // positive and negative vertical deltas in the current column, and D0 is
+    // the diagonal zero deltas.
+    const bitmask top = bitmask(1) << (target_len - 1);
+    bitmask VP = ~bitmask(0);
+    bitmask VN = 0;
+    bitmask D0 = 0;
+    bitmask prev_mask = 0;
+    int dist = target_len;
+    for (int j = 0; j != len; ++j) {
+	bitmask mask = get_mask(ptr[j]);
+	// Transpositions of adjacent characters.
+	bitmask TR = (((~D0) & mask) << 1) & prev_mask;
+	D0 = (((mask & VP) + VP) ^ VP) | mask | VN | TR;
+	bitmask HP = VN | ~(D0 | VP);
+	bitmask HN = VP & D0;
+	if (HP & top) {
+	    ++dist;
+	} else if (HN & top) {
+	    --dist;
+	}
+	// Each remaining character can reduce the distance by at most 1.
+	if (dist - (len - j - 1) > max_distance) return dist - (len - j - 1);
+	HP = (HP << 1) | 1;
+	HN <<= 1;
+	VP = HN | ~(D0 | HP);
+	VN = HP & D0;
+	prev_mask = mask;
+    }
+
+    return dist;
+}
@@ -93,6 +93,19 @@ LeafPostList::get_termfreq_est_using_stats(
 	RETURN(TermFreqs(stats.collection_size, stats.rset_size));
     }
     map<string, TermFreqs>::const_iterator i = stats.termfreqs.find(term);
+    if (i == stats.termfreqs.end() && subdb_size) {
+	// A term OP_WILDCARD or OP_FUZZY expanded to when the match ran, so
+	// scale this subdatabase's term frequency up to the whole collection
+	// (which gives the exact value if there's only one subdatabase).  We
+	// don't know how many relevant documents the term indexes.
+	Xapian::doccount tf = get_termfreq();
+	if (stats.collection_size != subdb_size) {
+	    double est = double(tf) * stats.collection_size / subdb_size;
+	    tf = static_cast<Xapian::doccount>(est + 0.5);
+	    if (tf > stats.collection_size) tf = stats.collection_size;
+	}
+	RETURN(TermFreqs(tf, 0));
+    }
     Assert(i != stats.termfreqs.end());
     RETURN(i->second);
 }
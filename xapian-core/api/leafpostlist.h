@@ -50,9 +50,16 @@ class LeafPostList : public PostList {
     /// The term name for this postlist (empty for an alldocs postlist).
     std::string term;
 
+    /** Number of documents in the subdatabase for an expanded term.
+     *
+     *  Non-zero if set_expanded() has been called, in which case @a term
+     *  may not be in the collated statistics.
+     */
+    Xapian::doccount subdb_size;
+
     /// Only constructable as a base class for derived classes.
     LeafPostList(const std::string & term_)
-	: weight(0), need_doclength(false), term(term_) { }
+	: weight(0), need_doclength(false), term(term_), subdb_size(0) { }
 
   public:
     ~LeafPostList();
@@ -68,6 +75,20 @@ class LeafPostList : public PostList {
      */
     void set_termweight(const Xapian::Weight * weight_);
 
+    /** Mark this as a term which OP_WILDCARD or OP_FUZZY expanded to.
+     *
+     *  Such terms are found when the match runs, so aren't in the collated
+     *  statistics unless they also appear in the query in their own right.
+     *  If they aren't, get_termfreq_est_using_stats() estimates the term
+     *  frequency across the whole collection by scaling up the term
+     *  frequency in this subdatabase.
+     *
+     *  @param subdb_size_	The number of documents in this subdatabase.
+     */
+    void set_expanded(Xapian::doccount subdb_size_) {
+	subdb_size = subdb_size_;
+    }
+
     /** Return the exact term frequency.
      *
      *  Leaf postlists have an exact termfreq, which get_termfreq_min(),
@@ -542,10 +542,17 @@ Database::get_spelling_suggestion(const string &word,
     LOGCALL(API, string, "Database::get_spelling_suggestion", word | max_edit_distance);
     if (word.size() <= 1) return string();
     AutoPtr<TermList> merger;
+    // If any of the candidate lists comes from a deletion index, we can't use
+    // the trigram scores to skip candidates.
+    bool exhaustive = false;
     for (size_t i = 0; i < internal.size(); ++i) {
-	TermList * tl = internal[i]->open_spelling_termlist(word);
+	bool tl_exhaustive = false;
+	TermList * tl = internal[i]->open_spelling_termlist(word,
+							    max_edit_distance,
+							    tl_exhaustive);
 	LOGLINE(SPELLING, "Sub db " << i << " tl = " << (void*)tl);
 	if (tl) {
+	    if (tl_exhaustive) exhaustive = true;
 	    if (merger.get()) {
 		merger.reset(new OrTermList(merger.release(), tl));
 	    } else {
@@ -569,6 +576,8 @@ Database::get_spelling_suggestion(const string &word,
     }
 #endif
 
+    EditDistanceCalculator edcalc(&utf32_word[0], int(utf32_word.size()));
+
     vector<unsigned> utf32_term;
 
     Xapian::termcount best = 1;
@@ -586,7 +595,7 @@ Database::get_spelling_suggestion(const string &word,
 	Xapian::termcount score = merger->get_wdf();
 
 	LOGLINE(SPELLING, "Term \"" << term << "\" ngram score " << score);
-	if (score + TRIGRAM_SCORE_THRESHOLD >= best) {
+	if (exhaustive || score + TRIGRAM_SCORE_THRESHOLD >= best) {
 	    if (score > best) best = score;
 
 	    // There's no point considering a word where the difference
@@ -615,11 +624,8 @@ Database::get_spelling_suggestion(const string &word,
 		continue;
 	    }
 
-	    int edist = edit_distance_unsigned(&utf32_term[0],
-					       int(utf32_term.size()),
-					       &utf32_word[0],
-					       int(utf32_word.size()),
-					       edist_best);
+	    int edist = edcalc(&utf32_term[0], int(utf32_term.size()),
+			       edist_best);
 	    LOGLINE(SPELLING, "Edit distance " << edist);
 
 	    if (edist <= edist_best) {
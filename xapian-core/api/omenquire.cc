@@ -41,6 +41,10 @@
 #include "matcher/multimatch.h"
 #include "omassert.h"
 #include "api/omenquireinternal.h"
+#include "api/queryinternal.h"
+#include "pack.h"
+#include "realtime.h"
+#include "serialise-double.h"
 #include "str.h"
 #include "weight/weightinternal.h"
 
@@ -58,6 +62,8 @@ namespace Xapian {
 
 MatchDecider::~MatchDecider() { }
 
+MatchVisitor::~MatchVisitor() { }
+
 // Methods for Xapian::RSet
 
 RSet::RSet() : internal(new RSet::Internal)
@@ -309,6 +315,13 @@ MSet::get_max_attained() const
     return internal->max_attained;
 }
 
+bool
+MSet::timed_out() const
+{
+    Assert(internal.get() != 0);
+    return internal->timed_out;
+}
+
 Xapian::doccount
 MSet::size() const
 {
@@ -598,6 +611,19 @@ MSetIterator::get_collapse_key() const
     return mset.internal->items[index].collapse_key;
 }
 
+std::string
+MSetIterator::get_cursor() const
+{
+    Assert(mset.internal.get());
+    AssertRel(index,<,mset.internal->items.size());
+    const Xapian::Internal::MSetItem & item = mset.internal->items[index];
+    string result;
+    pack_uint(result, item.did);
+    result += serialise_double(item.wt);
+    result += item.sort_key;
+    return result;
+}
+
 Xapian::doccount
 MSetIterator::get_collapse_count() const
 {
@@ -625,7 +651,8 @@ Enquire::Internal::Internal(const Database &db_, ErrorHandler * errorhandler_)
   : db(db_), query(), collapse_key(Xapian::BAD_VALUENO), collapse_max(0),
     order(Enquire::ASCENDING), percent_cutoff(0), weight_cutoff(0),
     sort_key(Xapian::BAD_VALUENO), sort_by(REL), sort_value_forward(true),
-    sorter(0), errorhandler(errorhandler_), weight(0)
+    docids_in_rank_order(false), time_limit(0.0), sorter(0),
+    errorhandler(errorhandler_), weight(0), cursor(0, 0)
 {
     if (db.internal.empty()) {
 	throw InvalidArgumentError("Can't make an Enquire object from an uninitialised Database object.");
@@ -675,18 +702,24 @@ Enquire::Internal::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 	check_at_least = max(check_at_least, maxitems);
     }
 
+    // The time limit covers the whole match, including preparing it.
+    double end_time = RealTime::end_time(time_limit);
+
     Xapian::Weight::Internal stats;
     ::MultiMatch match(db, query, qlen, rset,
 		       collapse_max, collapse_key,
 		       percent_cutoff, weight_cutoff,
 		       order, sort_key, sort_by, sort_value_forward,
+		       docids_in_rank_order,
 		       errorhandler, stats, weight, spies,
 		       (sorter != NULL),
-		       (mdecider != NULL));
+		       (mdecider != NULL),
+		       (cursor.did != 0));
     // Run query and put results into supplied Xapian::MSet object.
     MSet retval;
     match.get_mset(first, maxitems, check_at_least, retval,
-		   stats, mdecider, sorter);
+		   stats, mdecider, sorter,
+		   cursor.did ? &cursor : NULL, end_time);
     if (first_orig != first && retval.internal.get()) {
 	retval.internal->firstitem = first_orig;
     }
@@ -702,6 +735,32 @@ Enquire::Internal::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
     return retval;
 }
 
+void
+Enquire::Internal::visit_matches(MatchVisitor & visitor) const
+{
+    LOGCALL_VOID(MATCH, "Enquire::Internal::visit_matches", Literal("visitor"));
+
+    // Check this before we construct the MultiMatch, as that sends the query
+    // to any remote databases and we'd leave the reply unread if we threw
+    // after that.
+    for (size_t i = 0; i != db.internal.size(); ++i) {
+	if (db.internal[i]->as_remotedatabase()) {
+	    throw Xapian::UnimplementedError("Enquire::visit_matches() not supported for the remote backend");
+	}
+    }
+
+    BoolWeight bool_weight;
+    vector<MatchSpy *> no_spies;
+    Xapian::Weight::Internal stats;
+    ::MultiMatch match(db, query, qlen, NULL,
+		       0, Xapian::BAD_VALUENO,
+		       0, 0,
+		       Enquire::ASCENDING, Xapian::BAD_VALUENO, REL, true, false,
+		       errorhandler, stats, &bool_weight, no_spies,
+		       false, false);
+    match.visit_matches(visitor, stats);
+}
+
 ESet
 Enquire::Internal::get_eset(Xapian::termcount maxitems,
                     const RSet & rset, int flags, double k,
@@ -747,58 +806,64 @@ Enquire::Internal::get_eset(Xapian::termcount maxitems,
     RETURN(eset);
 }
 
-class ByQueryIndexCmp {
- private:
-    typedef map<string, unsigned int> tmap_t;
-    const tmap_t &tmap;
- public:
-    ByQueryIndexCmp(const tmap_t &tmap_) : tmap(tmap_) {}
-    bool operator()(const string &left,
-		    const string &right) const {
-	tmap_t::const_iterator l, r;
-	l = tmap.find(left);
-	r = tmap.find(right);
-	Assert((l != tmap.end()) && (r != tmap.end()));
-
-	return l->second < r->second;
-    }
-};
-
 TermIterator
 Enquire::Internal::get_matching_terms(Xapian::docid did) const
 {
     if (query.empty())
 	return TermIterator();
 
-    // The ordered list of terms in the query.
-    TermIterator qt = query.get_terms_begin();
-
-    // copy the list of query terms into a map for faster access.
-    // FIXME: a hash would be faster than a map, if this becomes
-    // a problem.
-    map<string, unsigned int> tmap;
-    unsigned int index = 1;
-    for ( ; qt != query.get_terms_end(); ++qt) {
-	if (tmap.find(*qt) == tmap.end())
-	    tmap[*qt] = index++;
+    // The terms in the query, with the position each first occurs at.
+    vector<pair<Xapian::termpos, string> > terms;
+    query.internal->gather_terms(static_cast<void*>(&terms));
+    map<string, Xapian::termpos> tmap;
+    vector<pair<Xapian::termpos, string> >::const_iterator i;
+    for (i = terms.begin(); i != terms.end(); ++i) {
+	map<string, Xapian::termpos>::iterator t = tmap.find(i->second);
+	if (t == tmap.end()) {
+	    tmap.insert(make_pair(i->second, i->first));
+	} else if (i->first < t->second) {
+	    t->second = i->first;
+	}
     }
 
-    vector<string> matching_terms;
+    // OP_WILDCARD and OP_FUZZY subqueries, which are only expanded when the
+    // match runs, so we check each document term against them.
+    typedef Xapian::Internal::QueryExpansion QueryExpansion;
+    vector<pair<Xapian::termpos, const QueryExpansion *> > expansions;
+    query.internal->gather_expansions(static_cast<void*>(&expansions));
+
+    vector<pair<Xapian::termpos, string> > matching_terms;
 
     TermIterator docterms = db.termlist_begin(did);
     TermIterator docterms_end = db.termlist_end(did);
     while (docterms != docterms_end) {
 	string term = *docterms;
-        map<string, unsigned int>::iterator t = tmap.find(term);
-        if (t != tmap.end()) matching_terms.push_back(term);
+	bool found = false;
+	Xapian::termpos pos = 0;
+	map<string, Xapian::termpos>::const_iterator t = tmap.find(term);
+	if (t != tmap.end()) {
+	    found = true;
+	    pos = t->second;
+	}
+	vector<pair<Xapian::termpos, const QueryExpansion *> >::const_iterator e;
+	for (e = expansions.begin(); e != expansions.end(); ++e) {
+	    if ((!found || e->first < pos) && e->second->matches(term)) {
+		found = true;
+		pos = e->first;
+	    }
+	}
+	if (found) matching_terms.push_back(make_pair(pos, term));
 	docterms++;
     }
 
-    // sort the resulting list by query position.
-    sort(matching_terms.begin(), matching_terms.end(), ByQueryIndexCmp(tmap));
+    // Sort the resulting list by query position, as get_terms_begin() does.
+    sort(matching_terms.begin(), matching_terms.end());
 
-    return TermIterator(new VectorTermList(matching_terms.begin(),
-					   matching_terms.end()));
+    vector<string> v;
+    v.reserve(matching_terms.size());
+    for (i = matching_terms.begin(); i != matching_terms.end(); ++i)
+	v.push_back(i->second);
+    return TermIterator(new VectorTermList(v.begin(), v.end()));
 }
 
 TermIterator
@@ -940,12 +1005,45 @@ Enquire::set_collapse_key(Xapian::valueno collapse_key, Xapian::doccount collaps
     internal->collapse_max = collapse_max;
 }
 
+void
+Enquire::set_cursor(const string & cursor)
+{
+    LOGCALL_VOID(API, "Xapian::Enquire::set_cursor", cursor);
+    Xapian::Internal::MSetItem item(0, 0);
+    if (!cursor.empty()) {
+	const char * p = cursor.data();
+	const char * end = p + cursor.size();
+	if (!unpack_uint(&p, end, &item.did) || item.did == 0) {
+	    throw InvalidArgumentError("Bad cursor");
+	}
+	try {
+	    item.wt = unserialise_double(&p, end);
+	} catch (const SerialisationError &) {
+	    throw InvalidArgumentError("Bad cursor");
+	}
+	item.sort_key.assign(p, end - p);
+    }
+    swap(internal->cursor, item);
+}
+
 void
 Enquire::set_docid_order(Enquire::docid_order order)
 {
     internal->order = order;
 }
 
+void
+Enquire::set_docids_in_rank_order(bool ranked)
+{
+    internal->docids_in_rank_order = ranked;
+}
+
+void
+Enquire::set_time_limit(double time_limit)
+{
+    internal->time_limit = time_limit;
+}
+
 void
 Enquire::set_cutoff(int percent_cutoff, double weight_cutoff)
 {
@@ -1032,6 +1130,19 @@ Enquire::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
     }
 }
 
+void
+Enquire::visit_matches(MatchVisitor & visitor) const
+{
+    LOGCALL_VOID(API, "Xapian::Enquire::visit_matches", Literal("visitor"));
+
+    try {
+	internal->visit_matches(visitor);
+    } catch (Error & e) {
+	if (internal->errorhandler) (*internal->errorhandler)(e);
+	throw;
+    }
+}
+
 ESet
 Enquire::get_eset(Xapian::termcount maxitems, const RSet & rset, int flags,
 		  double k, const ExpandDecider * edecider) const
@@ -108,6 +108,13 @@ class MSetItem {
 	string get_description() const;
 };
 
+/// Swap two MSetItem objects without copying their string members.
+inline void
+swap(MSetItem & a, MSetItem & b)
+{
+    a.swap(b);
+}
+
 }
 
 /** Internals of enquire system.
@@ -147,6 +154,10 @@ class Enquire::Internal : public Xapian::Internal::intrusive_base {
 	sort_setting sort_by;
 	bool sort_value_forward;
 
+	bool docids_in_rank_order;
+
+	double time_limit;
+
 	KeyMaker * sorter;
 
 	/** The error handler, if set.  (0 if not set).
@@ -162,6 +173,12 @@ class Enquire::Internal : public Xapian::Internal::intrusive_base {
 
 	vector<MatchSpy *> spies;
 
+	/** The item from the cursor set by set_cursor().
+	 *
+	 *  If no cursor is set, this has docid 0.
+	 */
+	Xapian::Internal::MSetItem cursor;
+
 	Internal(const Xapian::Database &databases, ErrorHandler * errorhandler_);
 	~Internal();
 
@@ -180,6 +197,8 @@ class Enquire::Internal : public Xapian::Internal::intrusive_base {
 		      const RSet *omrset,
 		      const MatchDecider *mdecider) const;
 
+	void visit_matches(MatchVisitor & visitor) const;
+
 	ESet get_eset(Xapian::termcount maxitems, const RSet & omrset, int flags,
 		      double k, const ExpandDecider *edecider, double min_wt) const;
 
@@ -259,6 +278,9 @@ class MSet::Internal : public Xapian::Internal::intrusive_base {
 
 	double max_attained;
 
+	/// Was the match cut short by the time limit?
+	bool timed_out;
+
 	Internal()
 		: percent_factor(0),
 		  firstitem(0),
@@ -269,7 +291,8 @@ class MSet::Internal : public Xapian::Internal::intrusive_base {
 		  uncollapsed_estimated(0),
 		  uncollapsed_upper_bound(0),
 		  max_possible(0),
-		  max_attained(0) {}
+		  max_attained(0),
+		  timed_out(false) {}
 
 	/// Note: destroys parameter items.
 	Internal(Xapian::doccount firstitem_,
@@ -294,7 +317,8 @@ class MSet::Internal : public Xapian::Internal::intrusive_base {
 		  uncollapsed_estimated(uncollapsed_estimated_),
 		  uncollapsed_upper_bound(uncollapsed_upper_bound_),
 		  max_possible(max_possible_),
-		  max_attained(max_attained_) {
+		  max_attained(max_attained_),
+		  timed_out(false) {
 	    std::swap(items, items_);
 	}
 
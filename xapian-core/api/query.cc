@@ -86,6 +86,37 @@ Query::Query(op op_, Xapian::valueno slot,
     }
 }
 
+Query::Query(op op_, const std::string & pattern)
+{
+    if (op_ == OP_WILDCARD) {
+	internal = new Xapian::Internal::QueryWildcard(pattern, 0, 0);
+	return;
+    }
+    if (rare(op_ != OP_FUZZY))
+	throw Xapian::InvalidArgumentError("op must be OP_FUZZY or OP_WILDCARD");
+    internal = new Xapian::Internal::QueryFuzzy(pattern, 0, 2, 0, 0);
+}
+
+Query::Query(op op_, const std::string & pattern,
+	     Xapian::termcount max_expansion,
+	     unsigned max_edits,
+	     size_t fixed_prefix_len,
+	     Xapian::termpos pos)
+{
+    if (op_ == OP_WILDCARD) {
+	internal = new Xapian::Internal::QueryWildcard(pattern, max_expansion,
+						       pos);
+	return;
+    }
+    if (rare(op_ != OP_FUZZY))
+	throw Xapian::InvalidArgumentError("op must be OP_FUZZY or OP_WILDCARD");
+    if (rare(fixed_prefix_len > pattern.size()))
+	throw Xapian::InvalidArgumentError("fixed_prefix_len must not exceed the length of pattern");
+    internal = new Xapian::Internal::QueryFuzzy(pattern, max_expansion,
+						max_edits, fixed_prefix_len,
+						pos);
+}
+
 const TermIterator
 Query::get_terms_begin() const
 {
@@ -23,9 +23,12 @@
 
 #include "queryinternal.h"
 
+#include "xapian/error.h"
 #include "xapian/postingsource.h"
 #include "xapian/query.h"
+#include "xapian/unicode.h"
 
+#include "backends/fuzzyalltermslist.h"
 #include "matcher/const_database_wrapper.h"
 #include "leafpostlist.h"
 #include "matcher/andmaybepostlist.h"
@@ -34,6 +37,7 @@
 #include "matcher/exactphrasepostlist.h"
 #include "matcher/externalpostlist.h"
 #include "matcher/multiandpostlist.h"
+#include "matcher/multiorpostlist.h"
 #include "matcher/multixorpostlist.h"
 #include "matcher/orpostlist.h"
 #include "matcher/phrasepostlist.h"
@@ -45,8 +49,10 @@
 
 #include "autoptr.h"
 #include "debuglog.h"
+#include "editdistance.h"
 #include "omassert.h"
 #include "str.h"
+#include "stringutils.h"
 
 #include <algorithm>
 #include <list>
@@ -154,6 +160,15 @@ class OrContext : public Context {
     void select_elite_set(size_t set_size, size_t out_of);
 
     PostList * postlist(QueryOptimiser* qopt);
+
+    /** Combine the postlists using a single N-way OR.
+     *
+     *  This is better than the tree of OrPostList objects which postlist()
+     *  builds when there may be a very large number of postlists, and we
+     *  don't need OrPostList's handling of weights (e.g. because the result
+     *  is going to be combined as a synonym).
+     */
+    PostList * postlist_multi(QueryOptimiser* qopt);
 };
 
 void
@@ -215,6 +230,24 @@ OrContext::postlist(QueryOptimiser* qopt)
     }
 }
 
+PostList *
+OrContext::postlist_multi(QueryOptimiser* qopt)
+{
+    Assert(!pls.empty());
+
+    PostList * pl;
+    if (pls.size() == 1) {
+	pl = pls[0];
+    } else {
+	pl = new MultiOrPostList(pls.begin(), pls.end(),
+				 qopt->matcher, qopt->db_size);
+    }
+
+    // Empty pls so our destructor doesn't delete them all!
+    pls.clear();
+    return pl;
+}
+
 class XorContext : public Context {
   public:
     explicit XorContext(size_t reserve) : Context(reserve) { }
@@ -325,6 +358,11 @@ Query::Internal::gather_terms(void *) const
 {
 }
 
+void
+Query::Internal::gather_expansions(void *) const
+{
+}
+
 Xapian::termcount
 Query::Internal::get_length() const
 {
@@ -436,6 +474,32 @@ Query::Internal::unserialise(const char ** p, const char * end,
 	}
 	case 0: {
 	    switch (ch & 0x0f) {
+		case 0x0a: { // OP_WILDCARD
+		    size_t len = decode_length(p, end, true);
+		    string pattern(*p, len);
+		    *p += len;
+		    Xapian::termcount max_expansion = decode_length(p, end, false);
+		    Xapian::termpos pos = decode_length(p, end, false);
+		    return new Xapian::Internal::QueryWildcard(pattern,
+							       max_expansion,
+							       pos);
+		}
+		case 0x0b: { // OP_FUZZY
+		    size_t len = decode_length(p, end, true);
+		    string pattern(*p, len);
+		    *p += len;
+		    Xapian::termcount max_expansion = decode_length(p, end, false);
+		    unsigned max_edits = decode_length(p, end, false);
+		    size_t fixed_prefix_len = decode_length(p, end, false);
+		    if (fixed_prefix_len > pattern.size())
+			throw SerialisationError("Bad OP_FUZZY serialisation");
+		    Xapian::termpos pos = decode_length(p, end, false);
+		    return new Xapian::Internal::QueryFuzzy(pattern,
+							    max_expansion,
+							    max_edits,
+							    fixed_prefix_len,
+							    pos);
+		}
 		case 0x0c: { // PostingSource
 		    size_t len = decode_length(p, end, true);
 		    string name(*p, len);
@@ -735,6 +799,215 @@ QueryValueGE::get_description() const
     return desc;
 }
 
+void
+QueryExpansion::gather_expansions(void * void_expansions) const
+{
+    vector<pair<Xapian::termpos, const QueryExpansion *> > &expansions =
+	*static_cast<vector<pair<Xapian::termpos, const QueryExpansion *> >*>(void_expansions);
+    expansions.push_back(make_pair(pos, this));
+}
+
+PostingIterator::Internal *
+QueryWildcard::postlist(QueryOptimiser * qopt, double factor) const
+{
+    LOGCALL(QUERY, PostingIterator::Internal *, "QueryWildcard::postlist", qopt | factor);
+    // Like OP_SYNONYM, we count as a single subquery.
+    if (factor != 0.0)
+	qopt->inc_total_subqs();
+
+    // Open a postlist for each term as we find it, rather than building a
+    // list of the terms first.  The expanded terms weren't known when the
+    // statistics were gathered, so we open the postlists directly rather
+    // than via the QueryOptimiser (which would try to look up their
+    // statistics).
+    const Xapian::Database::Internal & db = qopt->db;
+    Xapian::doccount db_size = db.get_doccount();
+    OrContext ctx(0);
+    AutoPtr<TermList> t(db.open_allterms(pattern));
+    Xapian::termcount expansions = 0;
+    while (true) {
+	TermList * res = t->next();
+	if (res) t.reset(res);
+	if (t->at_end())
+	    break;
+	if (max_expansion && expansions == max_expansion) {
+	    string msg("Wildcard ");
+	    msg += pattern;
+	    msg += "* expands to more than ";
+	    msg += str(max_expansion);
+	    msg += " terms";
+	    throw Xapian::WildcardError(msg);
+	}
+	LeafPostList * pl = db.open_post_list(t->get_termname());
+	pl->set_expanded(db_size);
+	ctx.add_postlist(pl);
+	++expansions;
+    }
+
+    if (expansions == 0)
+	RETURN(new EmptyPostList);
+
+    PostList * pl = ctx.postlist_multi(qopt);
+    if (factor == 0.0) {
+	// If we have a factor of 0, we don't care about the weights, so
+	// we're just like a normal OR query.
+	RETURN(pl);
+    }
+
+    RETURN(qopt->make_synonym_postlist(pl, factor, true));
+}
+
+bool
+QueryWildcard::matches(const string & term) const
+{
+    return startswith(term, pattern);
+}
+
+void
+QueryWildcard::serialise(string & result) const
+{
+    result += '\x0a';
+    result += encode_length(pattern.size());
+    result += pattern;
+    result += encode_length(max_expansion);
+    result += encode_length(pos);
+}
+
+string
+QueryWildcard::get_description() const
+{
+    string desc = "WILDCARD ";
+    desc += pattern;
+    return desc;
+}
+
+/// Comparison functor which orders expanded terms by edit distance.
+struct CompareEditDistance {
+    bool operator()(const pair<unsigned, string> & a,
+		    const pair<unsigned, string> & b) const {
+	return a.first < b.first;
+    }
+};
+
+PostingIterator::Internal *
+QueryFuzzy::postlist(QueryOptimiser * qopt, double factor) const
+{
+    LOGCALL(QUERY, PostingIterator::Internal *, "QueryFuzzy::postlist", qopt | factor);
+    // Like OP_SYNONYM, we count as a single subquery.
+    if (factor != 0.0)
+	qopt->inc_total_subqs();
+
+    const Xapian::Database::Internal & db = qopt->db;
+    string prefix(pattern, 0, fixed_prefix_len);
+    FuzzyAllTermsList fuzzy(db.open_allterms(prefix), fixed_prefix_len,
+			    string(pattern, fixed_prefix_len), max_edits);
+
+    // If there's a limit on the expansion, we want the closest matching
+    // terms (and the first in sort order for those equally close).  We keep
+    // the candidates sorted by distance when we trim them, and once trimmed
+    // any further terms need to be strictly closer than the furthest we
+    // kept to be of interest.
+    vector<pair<unsigned, string> > terms;
+    unsigned reject_from = max_edits + 1;
+    fuzzy.next();
+    while (!fuzzy.at_end()) {
+	unsigned distance = fuzzy.get_edit_distance();
+	if (distance < reject_from) {
+	    terms.push_back(make_pair(distance, fuzzy.get_termname()));
+	    if (max_expansion && terms.size() >= max_expansion * 2) {
+		stable_sort(terms.begin(), terms.end(), CompareEditDistance());
+		terms.resize(max_expansion);
+		reject_from = terms.back().first;
+	    }
+	}
+	fuzzy.next();
+    }
+
+    if (terms.empty())
+	RETURN(new EmptyPostList);
+
+    if (max_expansion && terms.size() > max_expansion) {
+	stable_sort(terms.begin(), terms.end(), CompareEditDistance());
+	terms.resize(max_expansion);
+    }
+
+    // The expanded terms weren't known when the statistics were gathered,
+    // so we open the postlists directly rather than via the QueryOptimiser
+    // (which would try to look up their statistics).
+    Xapian::doccount db_size = db.get_doccount();
+    OrContext ctx(terms.size());
+    vector<pair<unsigned, string> >::const_iterator i;
+    for (i = terms.begin(); i != terms.end(); ++i) {
+	LeafPostList * pl = db.open_post_list(i->second);
+	pl->set_expanded(db_size);
+	ctx.add_postlist(pl);
+    }
+    PostList * pl = ctx.postlist_multi(qopt);
+    if (factor == 0.0) {
+	// If we have a factor of 0, we don't care about the weights, so
+	// we're just like a normal OR query.
+	RETURN(pl);
+    }
+
+    RETURN(qopt->make_synonym_postlist(pl, factor, true));
+}
+
+/// Append the Unicode characters of @a s from byte offset @a start to @a out.
+static void
+decode_utf8(const string & s, size_t start, vector<unsigned> & out)
+{
+    Xapian::Utf8Iterator u(s.data() + start, s.size() - start);
+    while (u != Xapian::Utf8Iterator()) {
+	out.push_back(*u);
+	++u;
+    }
+}
+
+bool
+QueryFuzzy::matches(const string & term) const
+{
+    // This mirrors the filtering FuzzyAllTermsList does, but ignores
+    // max_expansion, so may accept a few terms which postlist() would have
+    // trimmed.
+    if (!startswith(term, pattern.data(), fixed_prefix_len))
+	return false;
+    bool skip_prefixed = fixed_prefix_len == 0 &&
+			 (pattern.empty() || !C_isupper(pattern[0]));
+    if (skip_prefixed && !term.empty() && C_isupper(term[0]))
+	return false;
+    vector<unsigned> word, chars;
+    decode_utf8(pattern, fixed_prefix_len, word);
+    decode_utf8(term, fixed_prefix_len, chars);
+    if (word.empty() || chars.empty())
+	return word.size() + chars.size() <= max_edits;
+    int d = edit_distance_unsigned(&word[0], int(word.size()),
+				   &chars[0], int(chars.size()),
+				   int(max_edits));
+    return d <= int(max_edits);
+}
+
+void
+QueryFuzzy::serialise(string & result) const
+{
+    result += '\x0b';
+    result += encode_length(pattern.size());
+    result += pattern;
+    result += encode_length(max_expansion);
+    result += encode_length(max_edits);
+    result += encode_length(fixed_prefix_len);
+    result += encode_length(pos);
+}
+
+string
+QueryFuzzy::get_description() const
+{
+    string desc = "FUZZY ";
+    desc += str(max_edits);
+    desc += ' ';
+    desc += pattern;
+    return desc;
+}
+
 Xapian::termcount
 QueryBranch::get_length() const
 {
@@ -836,6 +1109,18 @@ QueryBranch::gather_terms(void * void_terms) const
     }
 }
 
+void
+QueryBranch::gather_expansions(void * void_expansions) const
+{
+    // Gather results from all subqueries.
+    QueryVector::const_iterator i;
+    for (i = subqueries.begin(); i != subqueries.end(); ++i) {
+	// MatchNothing subqueries should have been removed by done().
+	Assert((*i).internal.get());
+	(*i).internal->gather_expansions(void_expansions);
+    }
+}
+
 void
 QueryBranch::do_or_like(OrContext& ctx, QueryOptimiser * qopt, double factor,
 			Xapian::termcount elite_set_size, size_t first) const
@@ -925,6 +1210,12 @@ QueryScaleWeight::gather_terms(void * void_terms) const
     subquery.internal->gather_terms(void_terms);
 }
 
+void
+QueryScaleWeight::gather_expansions(void * void_expansions) const
+{
+    subquery.internal->gather_expansions(void_expansions);
+}
+
 void QueryTerm::serialise(string & result) const
 {
     size_t len = term.size();
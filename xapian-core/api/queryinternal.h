@@ -92,6 +92,8 @@ class QueryScaleWeight : public Query::Internal {
     std::string get_description() const;
 
     void gather_terms(void * void_terms) const;
+
+    void gather_expansions(void * void_expansions) const;
 };
 
 class QueryValueRange : public Query::Internal {
@@ -144,6 +146,68 @@ class QueryValueGE : public Query::Internal {
     std::string get_description() const;
 };
 
+/// Base class for queries which expand to the terms matching a pattern.
+class QueryExpansion : public Query::Internal {
+  protected:
+    std::string pattern;
+
+    Xapian::termcount max_expansion;
+
+    Xapian::termpos pos;
+
+    QueryExpansion(const std::string & pattern_,
+		   Xapian::termcount max_expansion_,
+		   Xapian::termpos pos_)
+	: pattern(pattern_), max_expansion(max_expansion_), pos(pos_) { }
+
+  public:
+    /// Check if @a term is one which this query could expand to.
+    virtual bool matches(const std::string & term) const = 0;
+
+    termcount get_length() const { return 1; }
+
+    void gather_expansions(void * void_expansions) const;
+};
+
+class QueryWildcard : public QueryExpansion {
+  public:
+    QueryWildcard(const std::string & pattern_,
+		  Xapian::termcount max_expansion_,
+		  Xapian::termpos pos_)
+	: QueryExpansion(pattern_, max_expansion_, pos_) { }
+
+    PostingIterator::Internal * postlist(QueryOptimiser *qopt, double factor) const;
+
+    bool matches(const std::string & term) const;
+
+    void serialise(std::string & result) const;
+
+    std::string get_description() const;
+};
+
+class QueryFuzzy : public QueryExpansion {
+    unsigned max_edits;
+
+    size_t fixed_prefix_len;
+
+  public:
+    QueryFuzzy(const std::string & pattern_,
+	       Xapian::termcount max_expansion_,
+	       unsigned max_edits_,
+	       size_t fixed_prefix_len_,
+	       Xapian::termpos pos_)
+	: QueryExpansion(pattern_, max_expansion_, pos_),
+	  max_edits(max_edits_), fixed_prefix_len(fixed_prefix_len_) { }
+
+    PostingIterator::Internal * postlist(QueryOptimiser *qopt, double factor) const;
+
+    bool matches(const std::string & term) const;
+
+    void serialise(std::string & result) const;
+
+    std::string get_description() const;
+};
+
 class QueryBranch : public Query::Internal {
     virtual Xapian::Query::op get_op() const = 0;
 
@@ -169,6 +233,8 @@ class QueryBranch : public Query::Internal {
 
     void gather_terms(void * void_terms) const;
 
+    void gather_expansions(void * void_expansions) const;
+
     virtual void add_subquery(const Xapian::Query & subquery) = 0;
 
     size_t num_subqueries() const { return subqueries.size(); }
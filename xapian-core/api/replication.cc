@@ -31,16 +31,21 @@
 #include "backends/database.h"
 #include "backends/databasereplicator.h"
 #include "debuglog.h"
+#include "fd.h"
 #include "filetests.h"
 #include "fileutils.h"
+#include "io_utils.h"
 #ifdef __WIN32__
 # include "msvc_posix_wrapper.h"
 #endif
 #include "omassert.h"
 #include "realtime.h"
 #include "net/remoteconnection.h"
+#include "pack.h"
+#include "replicate_utils.h"
 #include "replicationprotocol.h"
 #include "safeerrno.h"
+#include "safefcntl.h"
 #include "safesysstat.h"
 #include "safeunistd.h"
 #include "net/length.h"
@@ -49,6 +54,7 @@
 #include "autoptr.h"
 #include <cstdio> // For rename().
 #include <fstream>
+#include <map>
 #include <string>
 
 using namespace std;
@@ -84,6 +90,8 @@ DatabaseMaster::write_changesets_to_fd(int fd,
     // Extract the UUID from start_revision and compare it to the database.
     bool need_whole_db = false;
     string revision;
+    DBCopyState copy_state;
+    const DBCopyState * resume = NULL;
     if (start_revision.empty()) {
 	need_whole_db = true;
     } else {
@@ -96,10 +104,20 @@ DatabaseMaster::write_changesets_to_fd(int fd,
 	if (request_uuid != db_uuid) {
 	    need_whole_db = true;
 	}
-	revision.assign(ptr, end - ptr);
+	size_t revision_length = decode_length(&ptr, end, true);
+	revision.assign(ptr, revision_length);
+	ptr += revision_length;
+	// Anything left describes a copy of a database which the replica was
+	// interrupted part way through receiving.
+	if (ptr != end &&
+	    copy_state.unserialise(string(ptr, end - ptr)) &&
+	    copy_state.uuid == db_uuid) {
+	    resume = &copy_state;
+	}
     }
 
-    db.internal[0]->write_changesets_to_fd(fd, revision, need_whole_db, info);
+    db.internal[0]->write_changesets_to_fd(fd, revision, need_whole_db,
+					   resume, info);
 }
 
 string
@@ -197,6 +215,15 @@ class DatabaseReplica::Internal : public Xapian::Internal::intrusive_base {
 	return p;
     }
 
+    /** Get the path of the file recording the progress of a database copy.
+     *
+     *  This lives in the offline database directory while a copy is being
+     *  received, and is removed once the copy is complete.
+     */
+    string get_copy_state_path() const {
+	return get_replica_path(live_id ^ 1) + "/copystate";
+    }
+
   public:
     /// Open a new DatabaseReplica::Internal for the specified path.
     Internal(const string & path_);
@@ -300,6 +327,56 @@ DatabaseReplica::get_description() const
 
 // Methods of DatabaseReplica::Internal
 
+/// Read the progress of a partly received database copy.
+static bool
+read_copy_state(const string & state_path, DBCopyState & state)
+{
+#ifdef __WIN32__
+    FD fd(msvc_posix_open(state_path.c_str(), O_RDONLY|O_BINARY));
+#else
+    FD fd(open(state_path.c_str(), O_RDONLY|O_BINARY));
+#endif
+    if (fd == -1) return false;
+    off_t size = file_size(fd);
+    if (errno) return false;
+    string data(size_t(size), '\0');
+    if (size && io_read(fd, &data[0], size_t(size), 0) != size_t(size))
+	return false;
+    return state.unserialise(data);
+}
+
+/// Record the progress of a database copy.
+static void
+write_copy_state(const string & state_path, const DBCopyState & state)
+{
+    string tmp_path = state_path;
+    tmp_path += ".tmp";
+    {
+#ifdef __WIN32__
+	FD fd(msvc_posix_open(tmp_path.c_str(),
+			      O_WRONLY|O_CREAT|O_TRUNC|O_BINARY));
+#else
+	FD fd(open(tmp_path.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_BINARY, 0666));
+#endif
+	if (fd == -1) {
+	    throw Xapian::DatabaseError("Couldn't write '" + tmp_path + "'",
+					errno);
+	}
+	string data = state.serialise();
+	io_write(fd, data.data(), data.size());
+	io_sync(fd);
+    }
+#ifdef __WIN32__
+    int result = msvc_posix_rename(tmp_path.c_str(), state_path.c_str());
+#else
+    int result = rename(tmp_path.c_str(), state_path.c_str());
+#endif
+    if (result == -1) {
+	throw Xapian::DatabaseError("Couldn't update '" + state_path + "'",
+				    errno);
+    }
+}
+
 void
 DatabaseReplica::Internal::update_stub_database() const
 {
@@ -379,10 +456,35 @@ DatabaseReplica::Internal::get_revision_info() const
     string uuid = (live_db.internal[0])->get_uuid();
     string buf = encode_length(uuid.size());
     buf += uuid;
-    buf += (live_db.internal[0])->get_revision_info();
+    string revision = (live_db.internal[0])->get_revision_info();
+    buf += encode_length(revision.size());
+    buf += revision;
+
+    // If we were interrupted part way through receiving a copy of the
+    // database, tell the master how far we got so it can resume the copy.
+    DBCopyState copy_state;
+    if (read_copy_state(get_copy_state_path(), copy_state))
+	buf += copy_state.serialise();
     RETURN(buf);
 }
 
+/** Sync the data received for a file in a database copy, and record it.
+ *
+ *  @param fd		The file being written.
+ *  @param state_path	The path of the copy state file.
+ *  @param state	The copy state to update.
+ *  @param filename	The leafname of the file.
+ *  @param offset	How much of the file has been received and verified.
+ */
+static void
+record_copy_progress(int fd, const string & state_path, DBCopyState & state,
+		     const string & filename, off_t offset)
+{
+    io_sync(fd);
+    state.offsets[filename] = offset;
+    write_copy_state(state_path, state);
+}
+
 void
 DatabaseReplica::Internal::remove_offline_db()
 {
@@ -397,16 +499,7 @@ DatabaseReplica::Internal::apply_db_copy(double end_time)
     have_offline_db = true;
     last_live_changeset_time = 0;
     string offline_path = get_replica_path(live_id ^ 1);
-    // If there's already an offline database, discard it.  This happens if one
-    // copy of the database was sent, but further updates were needed before it
-    // could be made live, and the remote end was then unable to send those
-    // updates (probably due to not having changesets available, or the remote
-    // database being replaced by a new database).
-    removedir(offline_path);
-    if (mkdir(offline_path.c_str(), 0777)) {
-	throw Xapian::DatabaseError("Cannot make directory '" +
-				    offline_path + "'", errno);
-    }
+    string state_path = get_copy_state_path();
 
     {
 	string buf;
@@ -419,17 +512,46 @@ DatabaseReplica::Internal::apply_db_copy(double end_time)
 	offline_revision.assign(buf, ptr + uuid_length - buf.data(), buf.npos);
     }
 
+    // If the master is continuing a copy which we were interrupted part way
+    // through receiving, keep what we've already got.  Otherwise discard any
+    // existing offline database.  This happens if one copy of the database
+    // was sent, but further updates were needed before it could be made live,
+    // and the remote end was then unable to send those updates (probably due
+    // to not having changesets available, or the remote database being
+    // replaced by a new database).
+    DBCopyState state;
+    if (!read_copy_state(state_path, state) ||
+	state.uuid != offline_uuid || state.revision != offline_revision) {
+	removedir(offline_path);
+	if (mkdir(offline_path.c_str(), 0777)) {
+	    throw Xapian::DatabaseError("Cannot make directory '" +
+					offline_path + "'", errno);
+	}
+	state.uuid = offline_uuid;
+	state.revision = offline_revision;
+	state.offsets.clear();
+	write_copy_state(state_path, state);
+    }
+
     // Now, read the files for the database from the connection and create it.
     while (true) {
-	string filename;
+	string buf;
 	char type = conn->sniff_next_message_type(end_time);
 	if (type == REPL_REPLY_FAIL)
 	    return;
 	if (type == REPL_REPLY_DB_FOOTER)
 	    break;
 
-	type = conn->get_message(filename, end_time);
+	type = conn->get_message(buf, end_time);
 	check_message_type(type, REPL_REPLY_DB_FILENAME);
+	const char * ptr = buf.data();
+	const char * end = ptr + buf.size();
+	unsigned long long packed_offset;
+	if (!unpack_uint(&ptr, end, &packed_offset)) {
+	    throw NetworkError("Bad file offset in database copy");
+	}
+	off_t offset = off_t(packed_offset);
+	string filename(ptr, end - ptr);
 
 	// Check that the filename doesn't contain '..'.  No valid database
 	// file contains .., so we don't need to check that the .. is a path.
@@ -437,16 +559,70 @@ DatabaseReplica::Internal::apply_db_copy(double end_time)
 	    throw NetworkError("Filename in database contains '..'");
 	}
 
-	type = conn->sniff_next_message_type(end_time);
-	if (type == REPL_REPLY_FAIL)
-	    return;
+	// The master should only continue a file from a point we told it
+	// we'd got to.
+	map<string, off_t>::const_iterator i = state.offsets.find(filename);
+	if (offset != 0 && (i == state.offsets.end() || i->second < offset)) {
+	    throw NetworkError("Database copy resumed from an unexpected offset");
+	}
 
 	string filepath = offline_path + "/" + filename;
-	type = conn->receive_file(filepath, end_time);
-	check_message_type(type, REPL_REPLY_DB_FILEDATA);
+#ifdef __WIN32__
+	FD fd(msvc_posix_open(filepath.c_str(), O_WRONLY|O_CREAT|O_BINARY));
+#else
+	FD fd(open(filepath.c_str(), O_WRONLY|O_CREAT|O_BINARY, 0666));
+#endif
+	if (fd == -1) {
+	    throw Xapian::DatabaseError("Couldn't open file for writing: " +
+					filepath, errno);
+	}
+	// Discard anything after the point the master is continuing from.
+#ifdef __WIN32__
+	if (_chsize_s(fd, offset) != 0 ||
+#else
+	if (ftruncate(fd, offset) < 0 ||
+#endif
+	    lseek(fd, offset, SEEK_SET) < 0) {
+	    throw Xapian::DatabaseError("Couldn't truncate file: " + filepath,
+					errno);
+	}
+	if (i == state.offsets.end() || i->second != offset) {
+	    state.offsets[filename] = offset;
+	    write_copy_state(state_path, state);
+	}
+
+	// Data is synced to disk before we record that we have it, so that we
+	// can resume from there even after a crash.  Syncing and rewriting the
+	// state file for every chunk would be slow, so we only do so every
+	// DB_COPY_SYNC_SIZE bytes and at the end of the file.
+	//
+	// A checksum mismatch means the chunk was corrupted.  We can't ask for
+	// it again, so we abandon this copy and record how far we got, so that
+	// the master can continue from there next time.
+	off_t unsynced = 0;
+	while (conn->sniff_next_message_type(end_time) == REPL_REPLY_DB_FILEDATA) {
+	    conn->get_message(buf, end_time);
+	    if (!check_db_file_chunk(buf)) {
+		if (unsynced)
+		    record_copy_progress(fd, state_path, state, filename, offset);
+		throw NetworkError("Checksum mismatch in database copy of " +
+				   filename);
+	    }
+	    io_write(fd, buf.data(), buf.size());
+	    offset += buf.size();
+	    unsynced += buf.size();
+	    if (unsynced >= DB_COPY_SYNC_SIZE) {
+		record_copy_progress(fd, state_path, state, filename, offset);
+		unsynced = 0;
+	    }
+	}
+	if (unsynced)
+	    record_copy_progress(fd, state_path, state, filename, offset);
     }
     char type = conn->get_message(offline_needed_revision, end_time);
     check_message_type(type, REPL_REPLY_DB_FOOTER);
+    // The copy is complete, so there's nothing left to resume.
+    io_unlink(state_path);
     need_copy_next = false;
 }
 
@@ -523,7 +699,8 @@ DatabaseReplica::Internal::apply_next_changeset(ReplicationInfo * info,
 		RETURN(false);
 	    }
 	    case REPL_REPLY_DB_HEADER:
-		// Apply the copy - remove offline db in case of any error.
+		// Apply the copy - remove offline db in case of any error, unless
+		// the copy can be continued later.
 		try {
 		    apply_db_copy(0.0);
 		    if (info != NULL)
@@ -544,6 +721,16 @@ DatabaseReplica::Internal::apply_next_changeset(ReplicationInfo * info,
 			// corruption.
 			need_copy_next = true;
 		    }
+		} catch (const Xapian::NetworkError &) {
+		    // If the copy was interrupted, keep what we've received so
+		    // far so that the master can continue the copy next time -
+		    // it isn't a usable offline database yet though.
+		    if (file_exists(get_copy_state_path())) {
+			have_offline_db = false;
+		    } else {
+			remove_offline_db();
+		    }
+		    throw;
 		} catch (...) {
 		    remove_offline_db();
 		    throw;
@@ -558,6 +745,11 @@ DatabaseReplica::Internal::apply_next_changeset(ReplicationInfo * info,
 		    throw NetworkError("Needed a database copy next");
 		}
 		if (!have_offline_db) {
+		    // If we were part way through receiving a copy, the
+		    // master isn't continuing it, so discard it.
+		    if (file_exists(get_copy_state_path()))
+			remove_offline_db();
+
 		    // Close the live db.
 		    string replica_path(get_replica_path(live_id));
 		    live_db = WritableDatabase();
@@ -597,8 +789,17 @@ DatabaseReplica::Internal::apply_next_changeset(ReplicationInfo * info,
 		    AutoPtr<DatabaseReplicator> replicator(
 			    DatabaseReplicator::open(get_replica_path(live_id ^ 1)));
 
-		    offline_revision = replicator->
-			    apply_changeset_from_conn(*conn, 0.0, false);
+		    try {
+			offline_revision = replicator->
+				apply_changeset_from_conn(*conn, 0.0, false);
+		    } catch (const Xapian::DatabaseCorruptError &) {
+			// The copy didn't match the changeset closely enough
+			// to apply a delta to it.  This can happen if we get
+			// changesets for the live database in a later
+			// conversation, so discard the copy.
+			remove_offline_db();
+			throw;
+		    }
 
 		    if (info != NULL) {
 			++(info->changeset_count);
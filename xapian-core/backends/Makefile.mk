@@ -6,6 +6,7 @@ noinst_HEADERS +=\
 	backends/databasereplicator.h\
 	backends/document.h\
 	backends/flint_lock.h\
+	backends/fuzzyalltermslist.h\
 	backends/multivaluelist.h\
 	backends/positionlist.h\
 	backends/prefix_compressed_strings.h\
@@ -23,6 +24,7 @@ lib_src +=\
 	backends/database.cc\
 	backends/databasereplicator.cc\
 	backends/dbfactory.cc\
+	backends/fuzzyalltermslist.cc\
 	backends/slowvaluelist.cc\
 	backends/valuelist.cc
 
@@ -25,6 +25,7 @@
 
 #include <algorithm>
 #include <queue>
+#include <set>
 
 #include <cstdio>
 
@@ -33,6 +34,7 @@
 #include "brass_table.h"
 #include "brass_compact.h"
 #include "brass_cursor.h"
+#include "brass_spelling.h"
 #include "filetests.h"
 #include "internaltypes.h"
 #include "pack.h"
@@ -472,16 +474,288 @@ struct CursorGt {
     }
 };
 
+/// Approximate number of bytes of (variant, word) pairs to sort in memory.
+const size_t DELETION_BATCH_SIZE = 32 * 1024 * 1024;
+
+/// Maximum number of sorted runs to merge in one pass.
+const size_t DELETION_RUNS_PER_PASS = 32;
+
+/// Remove the files of a temporary table.
+static void
+unlink_temp_table(const string & path)
+{
+    unlink((path + "DB").c_str());
+    unlink((path + "baseA").c_str());
+    unlink((path + "baseB").c_str());
+}
+
+/** Sort (variant, word) pairs and add them to @a out as deletion index
+ *  entries.
+ *
+ *  @a entries is cleared.
+ */
+static void
+add_deletion_entries(BrassTable * out, vector<pair<string, string> > & entries)
+{
+    sort(entries.begin(), entries.end());
+
+    string tag;
+    vector<pair<string, string> >::const_iterator i = entries.begin();
+    while (i != entries.end()) {
+	const string & variant = i->first;
+	tag.resize(0);
+	PrefixCompressedStringWriter wr(tag);
+	vector<pair<string, string> >::const_iterator j = i;
+	do {
+	    wr.append(j->second);
+	} while (++j != entries.end() && j->first == variant);
+	out->add("D" + variant, tag);
+	i = j;
+    }
+    entries.clear();
+}
+
+/// Write @a entries as a sorted run in a temporary table in @a tmpdir.
+static string
+write_deletion_run(const char * tmpdir, unsigned pass, size_t n,
+		   vector<pair<string, string> > & entries)
+{
+    string dest = tmpdir;
+    char buf[64];
+    sprintf(buf, "/tmpspell%u_%u.", pass, unsigned(n));
+    dest += buf;
+
+    BrassTable tmptab("spelling", dest, false);
+    // Use maximum blocksize for temporary tables.
+    tmptab.create_and_open(65536);
+    add_deletion_entries(&tmptab, entries);
+    tmptab.flush_db();
+    tmptab.commit(1);
+    return dest;
+}
+
+/** Generate the deletion index entries for the words in @a tables.
+ *
+ *  The words are taken in ascending order and their (variant, word) pairs
+ *  are collected in @a entries.  Whenever the batch gets large, it is sorted
+ *  and written out as a run in a temporary table, and the run's path is
+ *  appended to @a runs.  If any runs are written, the final batch is too;
+ *  otherwise it's left in @a entries.
+ */
+static void
+build_deletion_runs(const char * tmpdir, const vector<BrassTable *> & tables,
+		    unsigned max_deletions,
+		    vector<pair<string, string> > & entries,
+		    vector<string> & runs)
+{
+    priority_queue<BrassCursor *, vector<BrassCursor *>, CursorGt> pq;
+    vector<BrassTable *>::const_iterator t;
+    for (t = tables.begin(); t != tables.end(); ++t) {
+	BrassCursor * cur = new BrassCursor(*t);
+	cur->find_entry_ge("W");
+	if (!cur->after_end() && cur->current_key[0] == 'W') {
+	    pq.push(cur);
+	} else {
+	    delete cur;
+	}
+    }
+
+    size_t batch_size = 0;
+    string lastword;
+    while (!pq.empty()) {
+	BrassCursor * cur = pq.top();
+	pq.pop();
+	string word(cur->current_key, 1);
+	cur->next();
+	if (!cur->after_end() && cur->current_key[0] == 'W') {
+	    pq.push(cur);
+	} else {
+	    delete cur;
+	}
+	// Several inputs may have the same word.
+	if (word == lastword) continue;
+	lastword = word;
+
+	set<string> variants;
+	BrassSpellingTable::add_deletion_variants(word, max_deletions, variants);
+	set<string>::const_iterator v;
+	for (v = variants.begin(); v != variants.end(); ++v) {
+	    entries.push_back(make_pair(*v, word));
+	    batch_size += v->size() + word.size();
+	}
+	if (batch_size >= DELETION_BATCH_SIZE) {
+	    runs.push_back(write_deletion_run(tmpdir, 0, runs.size(), entries));
+	    batch_size = 0;
+	}
+    }
+
+    if (!runs.empty() && !entries.empty())
+	runs.push_back(write_deletion_run(tmpdir, 0, runs.size(), entries));
+}
+
+struct DeletionRunCursor : public MergeCursor {
+    /// Position of this run in the list of runs being merged.
+    size_t run;
+
+    DeletionRunCursor(BrassTable *in, size_t run_)
+	: MergeCursor(in), run(run_) { }
+};
+
+struct DeletionRunLt {
+    bool operator()(const DeletionRunCursor *a, const DeletionRunCursor *b) {
+	return a->run < b->run;
+    }
+};
+
+/** Merge sorted runs of deletion index entries into @a out.
+ *
+ *  Each word is in exactly one run and the runs were generated from the
+ *  words in ascending order, so a variant's word lists from the runs can
+ *  simply be concatenated in run order.
+ */
 static void
-merge_spellings(BrassTable * out,
+merge_deletion_runs(BrassTable * out,
+		    vector<string>::const_iterator b,
+		    vector<string>::const_iterator e)
+{
+    priority_queue<DeletionRunCursor *, vector<DeletionRunCursor *>,
+		   CursorGt> pq;
+    for (size_t run = 0; b != e; ++b, ++run) {
+	BrassTable *in = new BrassTable("spelling", *b, true);
+	in->open();
+	if (!in->empty()) {
+	    // The DeletionRunCursor takes ownership of BrassTable in and is
+	    // responsible for deleting it.
+	    pq.push(new DeletionRunCursor(in, run));
+	} else {
+	    delete in;
+	}
+    }
+
+    while (!pq.empty()) {
+	DeletionRunCursor * cur = pq.top();
+	pq.pop();
+
+	string key = cur->current_key;
+	if (pq.empty() || pq.top()->current_key > key) {
+	    // No need to merge the tags, just copy the tag value.
+	    bool compressed = cur->read_tag(true);
+	    out->add(key, cur->current_tag, compressed);
+	    if (cur->next()) {
+		pq.push(cur);
+	    } else {
+		delete cur;
+	    }
+	    continue;
+	}
+
+	vector<DeletionRunCursor *> vec;
+	while (true) {
+	    vec.push_back(cur);
+	    if (pq.empty() || pq.top()->current_key != key) break;
+	    cur = pq.top();
+	    pq.pop();
+	}
+	sort(vec.begin(), vec.end(), DeletionRunLt());
+
+	string tag;
+	PrefixCompressedStringWriter wr(tag);
+	vector<DeletionRunCursor *>::const_iterator i;
+	for (i = vec.begin(); i != vec.end(); ++i) {
+	    cur = *i;
+	    cur->read_tag();
+	    PrefixCompressedStringItor it(cur->current_tag);
+	    while (!it.at_end()) {
+		wr.append(*it);
+		++it;
+	    }
+	}
+	for (i = vec.begin(); i != vec.end(); ++i) {
+	    cur = *i;
+	    if (cur->next()) {
+		pq.push(cur);
+	    } else {
+		delete cur;
+	    }
+	}
+	out->add(key, tag);
+    }
+}
+
+/** Add a spelling deletion index to @a out.
+ *
+ *  The index is made from @a entries if @a runs is empty, and otherwise by
+ *  merging the sorted runs listed in @a runs (in several passes if there are
+ *  a lot of them).  The keys are added in ascending order.
+ */
+static void
+add_spelling_deletions(BrassTable * out, const char * tmpdir,
+		       unsigned max_deletions,
+		       vector<pair<string, string> > & entries,
+		       vector<string> runs)
+{
+    string tag;
+    pack_uint_last(tag, max_deletions);
+    out->add("D", tag);
+
+    if (runs.empty()) {
+	add_deletion_entries(out, entries);
+	return;
+    }
+
+    unsigned pass = 1;
+    while (runs.size() > DELETION_RUNS_PER_PASS) {
+	vector<string> runsout;
+	for (size_t i = 0, j; i < runs.size(); i = j) {
+	    j = min(i + DELETION_RUNS_PER_PASS, runs.size());
+
+	    string dest = tmpdir;
+	    char buf[64];
+	    sprintf(buf, "/tmpspell%u_%u.", pass, unsigned(runsout.size()));
+	    dest += buf;
+
+	    BrassTable tmptab("spelling", dest, false);
+	    // Use maximum blocksize for temporary tables.
+	    tmptab.create_and_open(65536);
+	    merge_deletion_runs(&tmptab, runs.begin() + i, runs.begin() + j);
+	    tmptab.flush_db();
+	    tmptab.commit(1);
+	    for (size_t k = i; k < j; ++k) unlink_temp_table(runs[k]);
+	    runsout.push_back(dest);
+	}
+	swap(runs, runsout);
+	++pass;
+    }
+    merge_deletion_runs(out, runs.begin(), runs.end());
+    for (size_t k = 0; k < runs.size(); ++k) unlink_temp_table(runs[k]);
+}
+
+static void
+merge_spellings(BrassTable * out, const char * tmpdir, unsigned deletions,
 		vector<string>::const_iterator b,
 		vector<string>::const_iterator e)
 {
     priority_queue<MergeCursor *, vector<MergeCursor *>, CursorGt> pq;
+    // If any input has a deletion index (or one was asked for), we build one
+    // for the output from scratch, using the largest number of deletions of
+    // any input.  The "D" key holds the maximum number of deletions indexed,
+    // and is absent if there's no deletion index.
+    unsigned max_deletions = deletions;
+    vector<BrassTable *> tables;
     for ( ; b != e; ++b) {
 	BrassTable *in = new BrassTable("spelling", *b, true, DONT_COMPRESS, true);
 	in->open();
 	if (!in->empty()) {
+	    string setting;
+	    if (in->get_exact_entry("D", setting)) {
+		unsigned n;
+		const char * p = setting.data();
+		if (!unpack_uint_last(&p, p + setting.size(), &n) || n == 0) {
+		    throw Xapian::DatabaseCorruptError("Bad spelling deletion index setting");
+		}
+		max_deletions = max(max_deletions, n);
+	    }
+	    tables.push_back(in);
 	    // The MergeCursor takes ownership of BrassTable in and is
 	    // responsible for deleting it.
 	    pq.push(new MergeCursor(in));
@@ -490,11 +764,39 @@ merge_spellings(BrassTable * out,
 	}
     }
 
+    // We need all the words to build the deletion index, and its "D" keys
+    // sort before the "W" keys which list the words, so generate the index
+    // entries first.
+    vector<pair<string, string> > entries;
+    vector<string> runs;
+    if (max_deletions)
+	build_deletion_runs(tmpdir, tables, max_deletions, entries, runs);
+    bool added_deletions = false;
+
     while (!pq.empty()) {
 	MergeCursor * cur = pq.top();
 	pq.pop();
 
 	string key = cur->current_key;
+	if (max_deletions && !added_deletions && key[0] > 'D') {
+	    add_spelling_deletions(out, tmpdir, max_deletions, entries, runs);
+	    added_deletions = true;
+	}
+	if (key[0] == 'D') {
+	    // Skip the input deletion indexes - we build a new one above.
+	    while (true) {
+		if (cur->next()) {
+		    pq.push(cur);
+		} else {
+		    delete cur;
+		}
+		if (pq.empty() || pq.top()->current_key != key) break;
+		cur = pq.top();
+		pq.pop();
+	    }
+	    continue;
+	}
+
 	if (pq.empty() || pq.top()->current_key > key) {
 	    // No need to merge the tags, just copy the (possibly compressed)
 	    // tag value.
@@ -584,6 +886,9 @@ merge_spellings(BrassTable * out,
 	}
 	out->add(key, tag);
     }
+
+    if (max_deletions && !added_deletions)
+	add_spelling_deletions(out, tmpdir, max_deletions, entries, runs);
 }
 
 static void
@@ -779,7 +1084,7 @@ compact_brass(Xapian::Compactor & compactor,
 	      const char * destdir, const vector<string> & sources,
 	      const vector<Xapian::docid> & offset, size_t block_size,
 	      Xapian::Compactor::compaction_level compaction, bool multipass,
-	      Xapian::docid last_docid) {
+	      Xapian::docid last_docid, unsigned spelling_deletions) {
     enum table_type {
 	POSTLIST, RECORD, TERMLIST, POSITION, VALUE, SPELLING, SYNONYM
     };
@@ -891,7 +1196,8 @@ compact_brass(Xapian::Compactor & compactor,
 		}
 		break;
 	    case SPELLING:
-		merge_spellings(&out, inputs.begin(), inputs.end());
+		merge_spellings(&out, destdir, spelling_deletions,
+				inputs.begin(), inputs.end());
 		break;
 	    case SYNONYM:
 		merge_synonyms(&out, inputs.begin(), inputs.end());
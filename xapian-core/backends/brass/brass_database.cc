@@ -48,10 +48,13 @@
 #include "brass_values.h"
 #include "debuglog.h"
 #include "fd.h"
+#include "filetests.h"
 #include "io_utils.h"
 #include "pack.h"
 #include "net/remoteconnection.h"
+#include "noreturn.h"
 #include "api/replication.h"
+#include "replicate_utils.h"
 #include "replicationprotocol.h"
 #include "net/length.h"
 #include "str.h"
@@ -69,6 +72,8 @@
 #include <algorithm>
 #include "autoptr.h"
 #include <string>
+#include <utility>
+#include <vector>
 
 using namespace std;
 using namespace Xapian;
@@ -103,20 +108,25 @@ const int MAX_OPEN_RETRIES = 100;
 BrassDatabase::BrassDatabase(const string &brass_dir, int action,
 			     unsigned int block_size)
 	: db_dir(brass_dir),
-	  readonly(action == XAPIAN_DB_READONLY),
+	  readonly((action & XAPIAN_DB_ACTION_MASK) == XAPIAN_DB_READONLY),
 	  version_file(db_dir),
 	  postlist_table(db_dir, readonly),
 	  position_table(db_dir, readonly),
 	  termlist_table(db_dir, readonly),
 	  value_manager(&postlist_table, &termlist_table),
 	  synonym_table(db_dir, readonly),
-	  spelling_table(db_dir, readonly),
+	  spelling_table(db_dir, readonly,
+			 (action & XAPIAN_DB_SPELLING_DELETIONS_MASK) /
+			 Xapian::DB_SPELLING_DELETIONS_1),
 	  record_table(db_dir, readonly),
 	  lock(db_dir),
 	  max_changesets(0)
 {
     LOGCALL_CTOR(DB, "BrassDatabase", brass_dir | action | block_size);
 
+    // Any other flags have been handled above.
+    action &= XAPIAN_DB_ACTION_MASK;
+
     if (action == XAPIAN_DB_READONLY) {
 	open_tables_consistent();
 	return;
@@ -536,16 +546,19 @@ BrassDatabase::get_database_write_lock(bool creating)
 }
 
 void
-BrassDatabase::send_whole_database(RemoteConnection & conn, double end_time)
+BrassDatabase::send_whole_database(RemoteConnection & conn,
+				   brass_revision_number_t revision,
+				   const DBCopyState * resume,
+				   double end_time)
 {
-    LOGCALL_VOID(DB, "BrassDatabase::send_whole_database", conn | end_time);
+    LOGCALL_VOID(DB, "BrassDatabase::send_whole_database", conn | revision | resume | end_time);
 
-    // Send the current revision number in the header.
+    // Send the revision number which the copy starts from in the header.
     string buf;
     string uuid = get_uuid();
     buf += encode_length(uuid.size());
     buf += uuid;
-    pack_uint(buf, get_revision_number());
+    pack_uint(buf, revision);
     conn.send_message(REPL_REPLY_DB_HEADER, buf, end_time);
 
     // Send all the tables.  The tables which we want to be cached best after
@@ -569,19 +582,213 @@ BrassDatabase::send_whole_database(RemoteConnection & conn, double end_time)
 	FD fd(open(filepath.c_str(), O_RDONLY));
 #endif
 	if (fd > 0) {
-	    conn.send_message(REPL_REPLY_DB_FILENAME, leaf, end_time);
-	    conn.send_file(REPL_REPLY_DB_FILEDATA, fd, end_time);
+	    // Only the tables themselves are resumed - the base files are
+	    // small and get rewritten in place.
+	    off_t offset = 0;
+	    if (resume && endswith(leaf, ".DB")) {
+		map<string, off_t>::const_iterator i;
+		i = resume->offsets.find(leaf);
+		if (i != resume->offsets.end())
+		    offset = i->second;
+	    }
+	    send_db_file(conn, leaf, fd, offset, end_time);
+	}
+    }
+}
+
+/** Find which parts of a brass changeset file to send to a replica.
+ *
+ *  A block compressed using a block from the previous revision as a preset
+ *  dictionary is followed in the changeset file by a version which doesn't
+ *  need that block.  We only send one of the two.
+ */
+class ChangesetRangeFinder {
+    /// The changeset file.
+    int fd;
+
+    /// The path of the changeset file, for error messages.
+    const string & path;
+
+    /// Data read from the file, starting from offset buf_offset.
+    string buf;
+
+    /// The offset in the file of the start of buf.
+    off_t buf_offset;
+
+    /// The current position in buf.
+    size_t pos;
+
+    /// Ensure at least @a n bytes are buffered, unless the file ends first.
+    void fill(size_t n) {
+	if (buf.size() - pos >= n) return;
+	buf.erase(0, pos);
+	buf_offset += pos;
+	pos = 0;
+	if (lseek(fd, buf_offset + buf.size(), SEEK_SET) < 0)
+	    throw Xapian::DatabaseError("Couldn't seek in changeset " + path,
+					errno);
+	size_t old_size = buf.size();
+	buf.resize(max(n, size_t(REASONABLE_CHANGESET_SIZE)));
+	buf.resize(old_size + io_read(fd, &buf[old_size],
+				      buf.size() - old_size, 0));
+    }
+
+    XAPIAN_NORETURN(void throw_invalid() const);
+
+    unsigned char get_byte() {
+	fill(1);
+	if (pos == buf.size()) throw_invalid();
+	return static_cast<unsigned char>(buf[pos++]);
+    }
+
+    template<typename T> void get_uint(T * result) {
+	// An encoded integer takes at most a few bytes.
+	fill(16);
+	const char * p = buf.data() + pos;
+	if (!unpack_uint(&p, buf.data() + buf.size(), result))
+	    throw_invalid();
+	pos = p - buf.data();
+    }
+
+    void skip(off_t n) {
+	if (off_t(buf.size() - pos) >= n) {
+	    pos += n;
+	    return;
+	}
+	buf_offset += pos + n;
+	buf.resize(0);
+	pos = 0;
+    }
+
+    void skip_string() {
+	size_t len;
+	get_uint(&len);
+	skip(len);
+    }
+
+    off_t get_offset() const { return buf_offset + pos; }
+
+  public:
+    ChangesetRangeFinder(int fd_, const string & path_)
+	: fd(fd_), path(path_), buf_offset(0), pos(0) { }
+
+    /** Find the parts of the changeset to send.
+     *
+     *  @param deltas	Send blocks as deltas where possible.  If false,
+     *			the replica doesn't need the blocks which would be
+     *			used as the bases for deltas.
+     *  @param ranges	Set to the (offset, length) of each part to send.
+     */
+    void find(bool deltas, vector<pair<off_t, off_t> > & ranges);
+};
+
+void
+ChangesetRangeFinder::throw_invalid() const
+{
+    throw Xapian::DatabaseError("Invalid changeset at " + path);
+}
+
+void
+ChangesetRangeFinder::find(bool deltas, vector<pair<off_t, off_t> > & ranges)
+{
+    ranges.clear();
+    // The start of the part we're currently going to send.
+    off_t start = 0;
+
+    // The header has already been checked by get_changeset_revisions().
+    skip(CONST_STRLEN(CHANGES_MAGIC_STRING));
+    unsigned int changes_version;
+    get_uint(&changes_version);
+    brass_revision_number_t rev;
+    get_uint(&rev);
+    get_uint(&rev);
+    (void)get_byte();
+
+    while (true) {
+	unsigned char chunk_type = get_byte();
+	if (chunk_type == 0)
+	    break;
+	skip_string();
+	if (chunk_type == 1) {
+	    // A base file.
+	    (void)get_byte();
+	    skip_string();
+	    continue;
+	}
+	if (chunk_type != 2)
+	    throw_invalid();
+
+	// A list of blocks.
+	unsigned int blocksize;
+	get_uint(&blocksize);
+	while (true) {
+	    uint4 block_number;
+	    get_uint(&block_number);
+	    if (block_number == 0)
+		break;
+	    off_t block_start = get_offset();
+	    uint4 base_block_number;
+	    get_uint(&base_block_number);
+	    unsigned int compressed_block_size;
+	    if (base_block_number != 0) {
+		uint4 base_checksum;
+		get_uint(&base_checksum);
+		get_uint(&compressed_block_size);
+		skip(compressed_block_size);
+		off_t full_start = get_offset();
+		get_uint(&base_block_number);
+		if (base_block_number != 0)
+		    throw_invalid();
+		get_uint(&compressed_block_size);
+		skip(compressed_block_size ? compressed_block_size : blocksize);
+		if (deltas) {
+		    ranges.push_back(make_pair(start, full_start - start));
+		    start = get_offset();
+		} else {
+		    ranges.push_back(make_pair(start, block_start - start));
+		    start = full_start;
+		}
+	    } else {
+		get_uint(&compressed_block_size);
+		skip(compressed_block_size ? compressed_block_size : blocksize);
+	    }
 	}
     }
+    // The revision the database must reach before it can be made live.
+    get_uint(&rev);
+    ranges.push_back(make_pair(start, get_offset() - start));
+}
+
+bool
+BrassDatabase::have_changesets(brass_revision_number_t from,
+			      brass_revision_number_t to) const
+{
+    while (from < to) {
+	string changes_name = db_dir + "/changes" + str(from);
+	if (!file_exists(changes_name))
+	    return false;
+	brass_revision_number_t startrev, endrev;
+	try {
+	    get_changeset_revisions(changes_name, &startrev, &endrev);
+	} catch (const Xapian::DatabaseError &) {
+	    // The changeset may have been removed since we checked.
+	    return false;
+	}
+	if (startrev != from || endrev <= startrev)
+	    return false;
+	from = endrev;
+    }
+    return true;
 }
 
 void
 BrassDatabase::write_changesets_to_fd(int fd,
 				      const string & revision,
 				      bool need_whole_db,
+				      const DBCopyState * resume,
 				      ReplicationInfo * info)
 {
-    LOGCALL_VOID(DB, "BrassDatabase::write_changesets_to_fd", fd | revision | need_whole_db | info);
+    LOGCALL_VOID(DB, "BrassDatabase::write_changesets_to_fd", fd | revision | need_whole_db | resume | info);
 
     int whole_db_copies_left = MAX_DB_COPIES_PER_CONVERSATION;
     brass_revision_number_t start_rev_num = 0;
@@ -620,7 +827,28 @@ BrassDatabase::write_changesets_to_fd(int fd,
 	    start_rev_num = get_revision_number();
 	    start_uuid = get_uuid();
 
-	    send_whole_database(conn, 0.0);
+	    // If the replica was interrupted part way through receiving a copy
+	    // of this database, we can continue that copy provided we still
+	    // have all the changesets since the revision it started from.  Any
+	    // blocks which have changed since the replica received them will
+	    // then be updated by those changesets, just as for blocks which
+	    // change while a copy is being sent.
+	    const DBCopyState * copy_resume = NULL;
+	    if (resume) {
+		brass_revision_number_t resume_rev_num;
+		const char * p = resume->revision.data();
+		const char * p_end = p + resume->revision.size();
+		if (unpack_uint(&p, p_end, &resume_rev_num) && p == p_end &&
+		    resume_rev_num <= start_rev_num &&
+		    have_changesets(resume_rev_num, start_rev_num)) {
+		    start_rev_num = resume_rev_num;
+		    copy_resume = resume;
+		}
+		// Any further copies in this conversation start afresh.
+		resume = NULL;
+	    }
+
+	    send_whole_database(conn, start_rev_num, copy_resume, 0.0);
 	    if (info != NULL)
 		++(info->fullcopy_count);
 
@@ -687,7 +915,14 @@ BrassDatabase::write_changesets_to_fd(int fd,
 		    throw Xapian::DatabaseError("Changeset start revision is not less than end revision");
 		}
 
-		conn.send_file(REPL_REPLY_CHANGESET, fd_changes, 0.0);
+		// If we've just sent a copy of the database, the replica won't
+		// have the right base blocks for deltas until it has caught
+		// up to the revision the copy needs.
+		vector<pair<off_t, off_t> > ranges;
+		ChangesetRangeFinder finder(fd_changes, changes_name);
+		finder.find(changeset_end_rev_num > needed_rev_num, ranges);
+		conn.send_file(REPL_REPLY_CHANGESET, string(), fd_changes,
+			       ranges, 0.0);
 		start_rev_num = changeset_end_rev_num;
 		if (info != NULL) {
 		    ++(info->changeset_count);
@@ -958,9 +1193,11 @@ BrassDatabase::open_allterms(const string & prefix) const
 }
 
 TermList *
-BrassDatabase::open_spelling_termlist(const string & word) const
+BrassDatabase::open_spelling_termlist(const string & word,
+				      unsigned max_edit_distance,
+				      bool & exhaustive) const
 {
-    return spelling_table.open_termlist(word);
+    return spelling_table.open_termlist(word, max_edit_distance, exhaustive);
 }
 
 TermList *
@@ -170,9 +170,9 @@ BrassDatabaseReplicator::process_changeset_chunk_blocks(const string & tablename
 
     string db_path = db_dir + "/" + tablename + ".DB";
 #ifdef __WIN32__
-    int fd = msvc_posix_open(db_path.c_str(), O_WRONLY | O_BINARY);
+    int fd = msvc_posix_open(db_path.c_str(), O_RDWR | O_BINARY);
 #else
-    int fd = ::open(db_path.c_str(), O_WRONLY | O_BINARY, 0666);
+    int fd = ::open(db_path.c_str(), O_RDWR | O_BINARY, 0666);
 #endif
     if (fd == -1) {
 	if (file_exists(db_path)) {
@@ -181,9 +181,9 @@ BrassDatabaseReplicator::process_changeset_chunk_blocks(const string & tablename
 	    throw DatabaseError(msg, errno);
 	}
 #ifdef __WIN32__
-	fd = msvc_posix_open(db_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_BINARY);
+	fd = msvc_posix_open(db_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY);
 #else
-	fd = ::open(db_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666);
+	fd = ::open(db_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0666);
 #endif
 	if (fd == -1) {
 	    string msg = "Failed to create and open ";
@@ -194,6 +194,7 @@ BrassDatabaseReplicator::process_changeset_chunk_blocks(const string & tablename
     {
 	FD closer(fd);
 	unsigned char *out = new unsigned char[changeset_blocksize];
+	string base_buf;
 	CompressionStream comp_stream = CompressionStream(Z_DEFAULT_STRATEGY);
 
 	while (true) {
@@ -211,6 +212,13 @@ BrassDatabaseReplicator::process_changeset_chunk_blocks(const string & tablename
 	    conn.get_message_chunk(buf, REASONABLE_CHANGESET_SIZE, end_time);
 	    ptr = buf.data();
 	    end = ptr + buf.size();
+	    uint4 base_block_number;
+	    if (!unpack_uint(&ptr, end, &base_block_number))
+		throw NetworkError("Invalid base block number in changeset");
+	    uint4 base_checksum = 0;
+	    if (base_block_number != 0 &&
+		!unpack_uint(&ptr, end, &base_checksum))
+		throw NetworkError("Invalid base block checksum in changeset");
 	    unsigned int compressed_block_size;
 	    if(!unpack_uint(&ptr, end, &compressed_block_size))
 		throw NetworkError("Invalid v2 changeset");
@@ -218,9 +226,38 @@ BrassDatabaseReplicator::process_changeset_chunk_blocks(const string & tablename
 
 	    const char * block_ptr;
 	    if (compressed_block_size > 0) {
+		comp_stream.lazy_alloc_inflate_zstream();
+		if (base_block_number != 0) {
+		    // The block was compressed using a block from the old
+		    // revision as a preset dictionary.  The changeset never
+		    // writes to blocks which were in use in the old revision,
+		    // so the base block can't have been overwritten by an
+		    // earlier block in this changeset.
+		    --base_block_number;
+		    base_buf.resize(changeset_blocksize);
+		    char * base_ptr = &base_buf[0];
+		    if (lseek(fd, off_t(changeset_blocksize) * base_block_number,
+			      SEEK_SET) == -1) {
+			string msg = "Failed to seek to block ";
+			msg += str(base_block_number);
+			throw DatabaseError(msg, errno);
+		    }
+		    const Bytef * dict = reinterpret_cast<const Bytef *>(base_ptr);
+		    if (io_read(fd, base_ptr, changeset_blocksize, 0) !=
+			    changeset_blocksize ||
+			adler32(0, dict, changeset_blocksize) != base_checksum) {
+			// The master only sends deltas once a copy has
+			// reached a consistent revision, so this shouldn't
+			// happen unless the database has been changed.
+			throw DatabaseCorruptError("Base block for delta in "
+						   "changeset doesn't match");
+		    }
+		    if (inflateSetDictionary(comp_stream.inflate_zstream, dict,
+					     changeset_blocksize) != Z_OK)
+			throw NetworkError("Bad compressed replication changeset");
+		}
 
 		conn.get_message_chunk(buf, changeset_blocksize, end_time);
-		comp_stream.lazy_alloc_inflate_zstream();
 		comp_stream.inflate_zstream->next_in = (Bytef*)const_cast<char *>(buf.data());
 		comp_stream.inflate_zstream->avail_in = compressed_block_size;
 		comp_stream.inflate_zstream->next_out = out;
@@ -23,8 +23,10 @@
 #include "brass_inverter.h"
 
 #include "brass_postlist.h"
+#include "stringutils.h"
 
 #include <map>
+#include <set>
 #include <string>
 
 using namespace std;
@@ -39,22 +41,26 @@ Inverter::flush_doclengths(BrassPostListTable & table)
 void
 Inverter::flush_post_list(BrassPostListTable & table, const string & term)
 {
-    map<string, PostingChanges>::iterator i;
+    unordered_map<string, PostingChanges>::iterator i;
     i = postlist_changes.find(term);
     if (i == postlist_changes.end()) return;
 
     // Flush buffered changes for just this term's postlist.
     table.merge_changes(term, i->second);
+    sorted_terms.erase(&i->first);
     postlist_changes.erase(i);
 }
 
 void
 Inverter::flush_all_post_lists(BrassPostListTable & table)
 {
-    map<string, PostingChanges>::const_iterator i;
-    for (i = postlist_changes.begin(); i != postlist_changes.end(); ++i) {
-	table.merge_changes(i->first, i->second);
+    // Merge the changes in term order, so the postlist table is updated
+    // sequentially.
+    set<const string *, StringPtrLess>::const_iterator i;
+    for (i = sorted_terms.begin(); i != sorted_terms.end(); ++i) {
+	table.merge_changes(**i, postlist_changes.find(**i)->second);
     }
+    sorted_terms.clear();
     postlist_changes.clear();
 }
 
@@ -64,17 +70,20 @@ Inverter::flush_post_lists(BrassPostListTable & table, const string & pfx)
     if (pfx.empty())
 	return flush_all_post_lists(table);
 
-    map<string, PostingChanges>::iterator i, begin, end;
-    begin = postlist_changes.lower_bound(pfx);
-    end = postlist_changes.upper_bound(pfx);
-
-    for (i = begin; i != end; ++i) {
-	table.merge_changes(i->first, i->second);
+    set<const string *, StringPtrLess>::iterator begin, end;
+    begin = sorted_terms.lower_bound(&pfx);
+    for (end = begin; end != sorted_terms.end(); ++end) {
+	if (!startswith(**end, pfx)) break;
+	unordered_map<string, PostingChanges>::iterator j;
+	j = postlist_changes.find(**end);
+	table.merge_changes(j->first, j->second);
+	postlist_changes.erase(j);
     }
 
-    // Erase all the entries in one go, as that's:
-    //  O(log(postlist_changes.size()) + O(number of elements removed)
-    postlist_changes.erase(begin, end);
+    // The strings the entries point to have gone, but erasing a range of
+    // a set doesn't need to compare them.  This is:
+    //  O(log(sorted_terms.size()) + O(number of elements removed)
+    sorted_terms.erase(begin, end);
 }
 
 void
@@ -24,10 +24,12 @@
 #include "xapian/types.h"
 
 #include <map>
+#include <set>
 #include <string>
 
 #include "omassert.h"
 #include "str.h"
+#include "unordered_map.h"
 #include "xapian/error.h"
 
 class BrassPostListTable;
@@ -79,8 +81,14 @@ class Inverter {
 	void add_posting(Xapian::docid did, Xapian::termcount wdf) {
 	    ++tf_delta;
 	    cf_delta += wdf;
-	    // Add did to term's postlist
-	    pl_changes[did] = wdf;
+	    // Add did to term's postlist.  When adding documents in bulk, did
+	    // will be after any docid we already have, and appending with a
+	    // hint is amortised constant time.
+	    if (pl_changes.empty() || pl_changes.rbegin()->first < did) {
+		pl_changes.insert(pl_changes.end(), std::make_pair(did, wdf));
+	    } else {
+		pl_changes[did] = wdf;
+	    }
 	}
 
 	/// Remove a posting.
@@ -105,8 +113,34 @@ class Inverter {
 	Xapian::termcount_diff get_cfdelta() const { return cf_delta; }
     };
 
-    /// Buffered changes to postlists.
-    std::map<std::string, PostingChanges> postlist_changes;
+    /** Buffered changes to postlists.
+     *
+     *  This is looked up for every posting added, so we use a hash table.
+     */
+    std::unordered_map<std::string, PostingChanges> postlist_changes;
+
+    /// Compare the strings which two pointers point to.
+    struct StringPtrLess {
+	bool operator()(const std::string * a, const std::string * b) const {
+	    return *a < *b;
+	}
+    };
+
+    /** The terms in postlist_changes, in ascending order.
+     *
+     *  This points to the keys in postlist_changes, and allows the changes
+     *  to be flushed in term order, and those for a prefix to be found
+     *  without scanning them all.  It's only updated when a term is first
+     *  buffered, not for every posting.
+     */
+    std::set<const std::string *, StringPtrLess> sorted_terms;
+
+    /// Add an entry for @a term to postlist_changes.
+    void add_term(const std::string & term, const PostingChanges & changes) {
+	std::unordered_map<std::string, PostingChanges>::iterator i;
+	i = postlist_changes.insert(std::make_pair(term, changes)).first;
+	sorted_terms.insert(&i->first);
+    }
 
   public:
     /// Buffered changes to document lengths.
@@ -115,11 +149,10 @@ class Inverter {
   public:
     void add_posting(Xapian::docid did, const std::string & term,
 		     Xapian::doccount wdf) {
-	std::map<std::string, PostingChanges>::iterator i;
+	std::unordered_map<std::string, PostingChanges>::iterator i;
 	i = postlist_changes.find(term);
 	if (i == postlist_changes.end()) {
-	    postlist_changes.insert(
-		std::make_pair(term, PostingChanges(did, wdf)));
+	    add_term(term, PostingChanges(did, wdf));
 	} else {
 	    i->second.add_posting(did, wdf);
 	}
@@ -127,11 +160,10 @@ class Inverter {
 
     void remove_posting(Xapian::docid did, const std::string & term,
 			Xapian::doccount wdf) {
-	std::map<std::string, PostingChanges>::iterator i;
+	std::unordered_map<std::string, PostingChanges>::iterator i;
 	i = postlist_changes.find(term);
 	if (i == postlist_changes.end()) {
-	    postlist_changes.insert(
-		std::make_pair(term, PostingChanges(did, wdf, false)));
+	    add_term(term, PostingChanges(did, wdf, false));
 	} else {
 	    i->second.remove_posting(did, wdf);
 	}
@@ -140,11 +172,10 @@ class Inverter {
     void update_posting(Xapian::docid did, const std::string & term,
 			Xapian::termcount old_wdf,
 			Xapian::termcount new_wdf) {
-	std::map<std::string, PostingChanges>::iterator i;
+	std::unordered_map<std::string, PostingChanges>::iterator i;
 	i = postlist_changes.find(term);
 	if (i == postlist_changes.end()) {
-	    postlist_changes.insert(
-		std::make_pair(term, PostingChanges(did, old_wdf, new_wdf)));
+	    add_term(term, PostingChanges(did, old_wdf, new_wdf));
 	} else {
 	    i->second.update_posting(did, old_wdf, new_wdf);
 	}
@@ -152,12 +183,18 @@ class Inverter {
 
     void clear() {
 	doclen_changes.clear();
+	sorted_terms.clear();
 	postlist_changes.clear();
     }
 
     void set_doclength(Xapian::docid did, Xapian::termcount doclen, bool add) {
 	if (add) {
 	    Assert(doclen_changes.find(did) == doclen_changes.end() || doclen_changes[did] == DELETED_POSTING);
+	    if (doclen_changes.empty() || doclen_changes.rbegin()->first < did) {
+		doclen_changes.insert(doclen_changes.end(),
+				      std::make_pair(did, doclen));
+		return;
+	    }
 	}
 	doclen_changes[did] = doclen;
     }
@@ -194,7 +231,7 @@ class Inverter {
     void flush(BrassPostListTable & table);
 
     Xapian::termcount_diff get_tfdelta(const std::string & term) const {
-	std::map<std::string, PostingChanges>::const_iterator i;
+	std::unordered_map<std::string, PostingChanges>::const_iterator i;
 	i = postlist_changes.find(term);
 	if (i == postlist_changes.end())
 	    return 0;
@@ -202,7 +239,7 @@ class Inverter {
     }
 
     Xapian::termcount_diff get_cfdelta(const std::string & term) const {
-	std::map<std::string, PostingChanges>::const_iterator i;
+	std::unordered_map<std::string, PostingChanges>::const_iterator i;
 	i = postlist_changes.find(term);
 	if (i == postlist_changes.end())
 	    return 0;
@@ -29,7 +29,8 @@
 // The current version of changeset files.
 // 1  - initial implementation
 // 2  - compressed changesets
-#define CHANGES_VERSION 2u
+// 3  - blocks can be sent as a delta against a block from the old revision
+#define CHANGES_VERSION 3u
 
 // Must be big enough to ensure that the start of the changeset (up to the new
 // revision number) will fit in this much space.
@@ -1,7 +1,7 @@
 /** @file brass_spelling.cc
  * @brief Spelling correction data for a brass database.
  */
-/* Copyright (C) 2004,2005,2006,2007,2008,2009,2010,2011 Olly Betts
+/* Copyright (C) 2004,2005,2006,2007,2008,2009,2010,2011,2012 Olly Betts
  *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -31,6 +31,8 @@
 
 #include "../prefix_compressed_strings.h"
 
+#include <xapian/unicode.h>
+
 #include <algorithm>
 #include <map>
 #include <queue>
@@ -41,58 +43,111 @@
 using namespace Brass;
 using namespace std;
 
+/// Add the variants of @a word with between 1 and @a n characters deleted.
+static void
+add_variants(const string & word, unsigned n, set<string> & variants)
+{
+    Xapian::Utf8Iterator i(word);
+    while (i != Xapian::Utf8Iterator()) {
+	size_t start = i.raw() - word.data();
+	++i;
+	size_t end = i.raw() - word.data();
+	if (start == 0 && end == word.size()) return;
+	string variant(word, 0, start);
+	variant.append(word, end, string::npos);
+	// Every route to a variant deletes the same number of characters, so
+	// if we've seen it before we've already added its variants too.
+	if (variants.insert(variant).second && n > 1)
+	    add_variants(variant, n - 1, variants);
+    }
+}
+
+/** Toggle whether @a word is in @a words.
+ *
+ *  The commonest case is that we're adding lots of words, so try insert
+ *  first and if that reports that the word already exists, remove it.
+ */
+static void
+toggle(set<string> & words, const string & word)
+{
+    pair<set<string>::iterator, bool> res = words.insert(word);
+    if (!res.second) {
+	// word is already in the set, so remove it.
+	words.erase(res.first);
+    }
+}
+
 void
-BrassSpellingTable::merge_changes()
+BrassSpellingTable::merge_termlist_changes(const string & key,
+					   const set<string> & changes)
 {
-    map<fragment, set<string> >::const_iterator i;
-    for (i = termlist_deltas.begin(); i != termlist_deltas.end(); ++i) {
-	string key = i->first;
-	const set<string> & changes = i->second;
-
-	set<string>::const_iterator d = changes.begin();
-	if (d == changes.end()) continue;
-
-	string updated;
-	string current;
-	PrefixCompressedStringWriter out(updated);
-	if (get_exact_entry(key, current)) {
-	    PrefixCompressedStringItor in(current);
-	    updated.reserve(current.size()); // FIXME plus some?
-	    while (!in.at_end() && d != changes.end()) {
-		const string & word = *in;
-		Assert(d != changes.end());
-		int cmp = word.compare(*d);
-		if (cmp < 0) {
-		    out.append(word);
-		    ++in;
-		} else if (cmp > 0) {
-		    out.append(*d);
-		    ++d;
-		} else {
-		    // If an existing entry is in the changes list, that means
-		    // we should remove it.
-		    ++in;
-		    ++d;
-		}
-	    }
-	    if (!in.at_end()) {
-		// FIXME : easy to optimise this to a fix-up and substring copy.
-		while (!in.at_end()) {
-		    out.append(*in++);
-		}
+    set<string>::const_iterator d = changes.begin();
+    if (d == changes.end()) return;
+
+    string updated;
+    string current;
+    PrefixCompressedStringWriter out(updated);
+    if (get_exact_entry(key, current)) {
+	PrefixCompressedStringItor in(current);
+	updated.reserve(current.size()); // FIXME plus some?
+	while (!in.at_end() && d != changes.end()) {
+	    const string & word = *in;
+	    Assert(d != changes.end());
+	    int cmp = word.compare(*d);
+	    if (cmp < 0) {
+		out.append(word);
+		++in;
+	    } else if (cmp > 0) {
+		out.append(*d);
+		++d;
+	    } else {
+		// If an existing entry is in the changes list, that means
+		// we should remove it.
+		++in;
+		++d;
 	    }
 	}
-	while (d != changes.end()) {
-	    out.append(*d++);
-	}
-	if (!updated.empty()) {
-	    add(key, updated);
-	} else {
-	    del(key);
+	if (!in.at_end()) {
+	    // FIXME : easy to optimise this to a fix-up and substring copy.
+	    while (!in.at_end()) {
+		out.append(*in++);
+	    }
 	}
     }
+    while (d != changes.end()) {
+	out.append(*d++);
+    }
+    if (!updated.empty()) {
+	add(key, updated);
+    } else {
+	del(key);
+    }
+}
+
+void
+BrassSpellingTable::merge_changes()
+{
+    if (new_max_deletions) {
+	string tag;
+	pack_uint_last(tag, new_max_deletions);
+	add("D", tag);
+	max_deletions_cache = new_max_deletions;
+	max_deletions_cache_valid = true;
+	new_max_deletions = 0;
+    }
+
+    map<fragment, set<string> >::const_iterator i;
+    for (i = termlist_deltas.begin(); i != termlist_deltas.end(); ++i) {
+	merge_termlist_changes(i->first, i->second);
+    }
     termlist_deltas.clear();
 
+    map<string, set<string> >::const_iterator k;
+    for (k = deletion_deltas.begin(); k != deletion_deltas.end(); ++k) {
+	merge_termlist_changes(k->first, k->second);
+    }
+    deletion_deltas.clear();
+
     map<string, Xapian::termcount>::const_iterator j;
     for (j = wordfreq_changes.begin(); j != wordfreq_changes.end(); ++j) {
 	string key = "W" + j->first;
@@ -114,12 +169,19 @@ BrassSpellingTable::toggle_fragment(fragment frag, const string & word)
     if (i == termlist_deltas.end()) {
 	i = termlist_deltas.insert(make_pair(frag, set<string>())).first;
     }
-    // The commonest case is that we're adding lots of words, so try insert
-    // first and if that reports that the word already exists, remove it.
-    pair<set<string>::iterator, bool> res = i->second.insert(word);
-    if (!res.second) {
-	// word is already in the set, so remove it.
-	i->second.erase(res.first);
+    toggle(i->second, word);
+}
+
+void
+BrassSpellingTable::toggle_deletions(const string & word,
+				     unsigned max_deletions)
+{
+    set<string> variants;
+    add_deletion_variants(word, max_deletions, variants);
+
+    set<string>::const_iterator v;
+    for (v = variants.begin(); v != variants.end(); ++v) {
+	toggle(deletion_deltas["D" + *v], word);
     }
 }
 
@@ -154,6 +216,13 @@ BrassSpellingTable::add_word(const string & word, Xapian::termcount freqinc)
 	wordfreq_changes[word] = freqinc;
     }
 
+    if (deletions_for_new_table && !new_max_deletions &&
+	termlist_deltas.empty() && empty()) {
+	// This is the first word added to the table, and we've been asked to
+	// build a deletion index.
+	new_max_deletions = deletions_for_new_table;
+    }
+
     // Add trigrams for word.
     toggle_word(word);
 }
@@ -244,6 +313,9 @@ BrassSpellingTable::toggle_word(const string & word)
 		toggle_fragment(buf, word);
 	}
     }
+
+    unsigned max_deletions = get_max_deletions();
+    if (max_deletions) toggle_deletions(word, max_deletions);
 }
 
 struct TermListGreaterApproxSize {
@@ -253,7 +325,9 @@ struct TermListGreaterApproxSize {
 };
 
 TermList *
-BrassSpellingTable::open_termlist(const string & word)
+BrassSpellingTable::open_termlist(const string & word,
+				  unsigned max_edit_distance,
+				  bool & exhaustive)
 {
     // This should have been handled by Database::get_spelling_suggestion().
     AssertRel(word.size(),>,1);
@@ -267,73 +341,88 @@ BrassSpellingTable::open_termlist(const string & word)
     priority_queue<TermList*, vector<TermList*>, TermListGreaterApproxSize> pq;
     try {
 	string data;
-	fragment buf;
+	unsigned max_deletions = get_max_deletions();
+	exhaustive = (max_deletions && max_edit_distance <= max_deletions);
+	if (exhaustive) {
+	    // Any word within max_edit_distance edits of word has a variant
+	    // with at most max_edit_distance deletions in common with it, so
+	    // we only need to look up word's variants.
+	    set<string> variants;
+	    add_deletion_variants(word, max_edit_distance, variants);
+	    set<string>::const_iterator v;
+	    for (v = variants.begin(); v != variants.end(); ++v) {
+		if (get_exact_entry("D" + *v, data))
+		    pq.push(new BrassSpellingTermList(data));
+	    }
+	} else {
+	    fragment buf;
 
-	// Head:
-	buf[0] = 'H';
-	buf[1] = word[0];
-	buf[2] = word[1];
-	if (get_exact_entry(string(buf), data))
-	    pq.push(new BrassSpellingTermList(data));
-
-	// Tail:
-	buf[0] = 'T';
-	buf[1] = word[word.size() - 2];
-	buf[2] = word[word.size() - 1];
-	if (get_exact_entry(string(buf), data))
-	    pq.push(new BrassSpellingTermList(data));
-
-	if (word.size() <= 4) {
-	    // We also generate 'bookends' for two, three, and four character
-	    // terms so we can handle transposition of the middle two
-	    // characters of a four character word, substitution or deletion of
-	    // the middle character of a three character word, or insertion in
-	    // the middle of a two character word.
-	    buf[0] = 'B';
+	    // Head:
+	    buf[0] = 'H';
 	    buf[1] = word[0];
-	    buf[3] = '\0';
+	    buf[2] = word[1];
 	    if (get_exact_entry(string(buf), data))
 		pq.push(new BrassSpellingTermList(data));
-	}
-	if (word.size() > 2) {
-	    // Middles:
-	    buf[0] = 'M';
-	    for (size_t start = 0; start <= word.size() - 3; ++start) {
-		memcpy(buf.data + 1, word.data() + start, 3);
+
+	    // Tail:
+	    buf[0] = 'T';
+	    buf[1] = word[word.size() - 2];
+	    buf[2] = word[word.size() - 1];
+	    if (get_exact_entry(string(buf), data))
+		pq.push(new BrassSpellingTermList(data));
+
+	    if (word.size() <= 4) {
+		// We also generate 'bookends' for two, three, and four
+		// character terms so we can handle transposition of the middle
+		// two characters of a four character word, substitution or
+		// deletion of the middle character of a three character word,
+		// or insertion in the middle of a two character word.
+		buf[0] = 'B';
+		buf[1] = word[0];
+		buf[3] = '\0';
 		if (get_exact_entry(string(buf), data))
 		    pq.push(new BrassSpellingTermList(data));
 	    }
+	    if (word.size() > 2) {
+		// Middles:
+		buf[0] = 'M';
+		for (size_t start = 0; start <= word.size() - 3; ++start) {
+		    memcpy(buf.data + 1, word.data() + start, 3);
+		    if (get_exact_entry(string(buf), data))
+			pq.push(new BrassSpellingTermList(data));
+		}
 
-	    if (word.size() == 3) {
-		// For three letter words, we generate the two "single
-		// transposition" forms too, so that we can produce good
-		// spelling suggestions.
-		// ABC -> BAC
+		if (word.size() == 3) {
+		    // For three letter words, we generate the two "single
+		    // transposition" forms too, so that we can produce good
+		    // spelling suggestions.
+		    // ABC -> BAC
+		    buf[1] = word[1];
+		    buf[2] = word[0];
+		    if (get_exact_entry(string(buf), data))
+			pq.push(new BrassSpellingTermList(data));
+		    // ABC -> ACB
+		    buf[1] = word[0];
+		    buf[2] = word[2];
+		    buf[3] = word[1];
+		    if (get_exact_entry(string(buf), data))
+			pq.push(new BrassSpellingTermList(data));
+		}
+	    } else {
+		Assert(word.size() == 2);
+		// For two letter words, we generate H and T terms for the
+		// transposed form so that we can produce good spelling
+		// suggestions.
+		// AB -> BA
+		buf[0] = 'H';
 		buf[1] = word[1];
 		buf[2] = word[0];
 		if (get_exact_entry(string(buf), data))
 		    pq.push(new BrassSpellingTermList(data));
-		// ABC -> ACB
-		buf[1] = word[0];
-		buf[2] = word[2];
-		buf[3] = word[1];
+		buf[0] = 'T';
 		if (get_exact_entry(string(buf), data))
 		    pq.push(new BrassSpellingTermList(data));
 	    }
-	} else {
-	    Assert(word.size() == 2);
-	    // For two letter words, we generate H and T terms for the
-	    // transposed form so that we can produce good spelling
-	    // suggestions.
-	    // AB -> BA
-	    buf[0] = 'H';
-	    buf[1] = word[1];
-	    buf[2] = word[0];
-	    if (get_exact_entry(string(buf), data))
-		pq.push(new BrassSpellingTermList(data));
-	    buf[0] = 'T';
-	    if (get_exact_entry(string(buf), data))
-		pq.push(new BrassSpellingTermList(data));
 	}
 
 	if (pq.empty()) return NULL;
@@ -393,6 +482,35 @@ BrassSpellingTable::get_word_frequency(const string & word) const
     return 0;
 }
 
+unsigned
+BrassSpellingTable::get_max_deletions() const
+{
+    if (new_max_deletions) return new_max_deletions;
+    if (max_deletions_cache_valid) return max_deletions_cache;
+
+    string data;
+    unsigned max_deletions = 0;
+    if (get_exact_entry("D", data)) {
+	const char *p = data.data();
+	if (!unpack_uint_last(&p, p + data.size(), &max_deletions) ||
+	    max_deletions == 0) {
+	    throw Xapian::DatabaseCorruptError("Bad spelling deletion index setting");
+	}
+    }
+    max_deletions_cache = max_deletions;
+    max_deletions_cache_valid = true;
+    return max_deletions;
+}
+
+void
+BrassSpellingTable::add_deletion_variants(const string & word, unsigned n,
+					  set<string> & variants)
+{
+    // The word itself is stored as a variant with no deletions.
+    variants.insert(word);
+    add_variants(word, n, variants);
+}
+
 ///////////////////////////////////////////////////////////////////////////
 
 Xapian::termcount
@@ -59,6 +59,10 @@ struct fragment {
 class BrassSpellingTable : public BrassLazyTable {
     void toggle_word(const std::string & word);
     void toggle_fragment(Brass::fragment frag, const std::string & word);
+    void toggle_deletions(const std::string & word, unsigned max_deletions);
+
+    void merge_termlist_changes(const std::string & key,
+				const std::set<std::string> & changes);
 
     std::map<std::string, Xapian::termcount> wordfreq_changes;
 
@@ -72,6 +76,29 @@ class BrassSpellingTable : public BrassLazyTable {
      */
     std::map<Brass::fragment, std::set<std::string> > termlist_deltas;
 
+    /** Changes to make to the deletion index.
+     *
+     *  The keys are "D" followed by a deletion variant, and the changes are
+     *  xor-ed with the list on disk in the same way as termlist_deltas.
+     */
+    std::map<std::string, std::set<std::string> > deletion_deltas;
+
+    /** Maximum number of deletions to index, if not yet written to disk.
+     *
+     *  This is non-zero if we've just decided to build a deletion index for
+     *  a new spelling table.
+     */
+    unsigned new_max_deletions;
+
+    /// Number of deletions to index if the table is new (0 for no index).
+    unsigned deletions_for_new_table;
+
+    /// The maximum number of deletions in the table's deletion index.
+    mutable unsigned max_deletions_cache;
+
+    /// Is max_deletions_cache valid?
+    mutable bool max_deletions_cache_valid;
+
   public:
     /** Create a new BrassSpellingTable object.
      *
@@ -80,10 +107,16 @@ class BrassSpellingTable : public BrassLazyTable {
      *
      *  @param dbdir		The directory the brass database is stored in.
      *  @param readonly		true if we're opening read-only, else false.
+     *  @param deletions	Maximum number of deletions to build a deletion
+     *				index for if the spelling table is new (0 means
+     *				don't build one).
      */
-    BrassSpellingTable(const std::string & dbdir, bool readonly)
+    BrassSpellingTable(const std::string & dbdir, bool readonly,
+		       unsigned deletions = 0)
 	: BrassLazyTable("spelling", dbdir + "/spelling.", readonly,
-			 Z_DEFAULT_STRATEGY) { }
+			 Z_DEFAULT_STRATEGY),
+	  new_max_deletions(0), deletions_for_new_table(deletions),
+	  max_deletions_cache(0), max_deletions_cache_valid(false) { }
 
     // Merge in batched-up changes.
     void merge_changes();
@@ -91,10 +124,32 @@ class BrassSpellingTable : public BrassLazyTable {
     void add_word(const std::string & word, Xapian::termcount freqinc);
     void remove_word(const std::string & word, Xapian::termcount freqdec);
 
-    TermList * open_termlist(const std::string & word);
+    /** Open a list of candidate corrections for @a word.
+     *
+     *  If the table has a deletion index covering @a max_edit_distance then
+     *  that is used and @a exhaustive is set to true, otherwise candidates
+     *  are found using trigrams and @a exhaustive is set to false.
+     */
+    TermList * open_termlist(const std::string & word,
+			     unsigned max_edit_distance,
+			     bool & exhaustive);
 
     Xapian::doccount get_word_frequency(const std::string & word) const;
 
+    /** Return the maximum number of deletions in the deletion index.
+     *
+     *  Returns 0 if this table doesn't have a deletion index.
+     */
+    unsigned get_max_deletions() const;
+
+    /** Add @a word and its variants with up to @a n characters deleted.
+     *
+     *  Characters are Unicode characters, not bytes.  Variants which would
+     *  be empty aren't added.
+     */
+    static void add_deletion_variants(const std::string & word, unsigned n,
+				      std::set<std::string> & variants);
+
     /** Override methods of BrassTable.
      *
      *  NB: these aren't virtual, but we always call them on the subclass in
@@ -115,14 +170,27 @@ class BrassSpellingTable : public BrassLazyTable {
 	// Discard batched-up changes.
 	wordfreq_changes.clear();
 	termlist_deltas.clear();
+	deletion_deltas.clear();
+	new_max_deletions = 0;
+	max_deletions_cache_valid = false;
 
 	BrassTable::cancel();
     }
 
+    bool open(brass_revision_number_t revision) {
+	max_deletions_cache_valid = false;
+	return BrassTable::open(revision);
+    }
+
+    void create_and_open(unsigned int blocksize) {
+	max_deletions_cache_valid = false;
+	BrassLazyTable::create_and_open(blocksize);
+    }
+
     // @}
 };
 
-/** The list of words containing a particular trigram. */
+/** The list of words containing a particular trigram or deletion variant. */
 class BrassSpellingTermList : public TermList {
     /// The encoded data.
     std::string data;
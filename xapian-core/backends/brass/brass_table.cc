@@ -424,8 +424,10 @@ BrassTable::alter()
 	}
 	Assert(REVISION(p) < latest_revision_number + 1);
 	base.free_block(n);
+	uint4 old_n = n;
 	n = base.next_free_block();
 	C[j].n = n;
+	delta_base[n] = old_n;
 	SET_REVISION(p, latest_revision_number + 1);
 
 	if (j == level) return;
@@ -736,6 +738,12 @@ BrassTable::add_item(Item_wr kt_, int j)
 
 	uint4 split_n = C[j].n;
 	C[j].n = base.next_free_block();
+	{
+	    // Both halves started out as the same block, so either makes
+	    // a good delta base.
+	    map<uint4, uint4>::const_iterator i = delta_base.find(split_n);
+	    if (i != delta_base.end()) delta_base[C[j].n] = i->second;
+	}
 
 	memcpy(split_p, p, block_size);  // replicate the whole block in split_p
 	SET_DIR_END(split_p, m);
@@ -1650,6 +1658,7 @@ void BrassTable::close(bool permanent) {
 	(void)::close(handle);
 	handle = -1;
     }
+    delta_base.clear();
 
     if (permanent) {
 	handle = -2;
@@ -1732,6 +1741,7 @@ BrassTable::commit(brass_revision_number_t revision, int changes_fd,
 	root = C[level].n;
 
 	Btree_modified = false;
+	delta_base.clear();
 
 	for (int i = 0; i < BTREE_CURSOR_LEVELS; ++i) {
 	    C[i].n = BLK_UNUSED;
@@ -1811,47 +1821,73 @@ BrassTable::write_changed_blocks(int changes_fd, bool compressed)
     // write them to the file descriptor.
     uint4 n = 0;
     byte * p = new byte[block_size];
+    byte * q = NULL;
     try {
+	q = new byte[block_size];
 	base.calculate_last_block();
 	while (base.find_changed_block(&n)) {
 	    buf.resize(0);
 	    pack_uint(buf, n + 1);
-	    // Write the block number to the file
-	    io_write(changes_fd, buf.data(), buf.size());
 
 	    // Read block n.
 	    read_block(n, p);
 
 	    // Write block n to the file.
+	    string full;
 	    if (compressed) {
 		comp_stream.lazy_alloc_deflate_zstream();
 		comp_stream.compress(p, block_size);
 		if (comp_stream.zerr == Z_STREAM_END) {
-		    buf.resize(0);
-		    pack_uint(buf, comp_stream.deflate_zstream->total_out);
-		    io_write(changes_fd, buf.data(), buf.size());
-		    io_write(changes_fd, reinterpret_cast<const char *>(comp_stream.out),
-			     comp_stream.deflate_zstream->total_out);
-		} else {
-		    // The deflate failed, try to write data uncompressed
-		    buf.resize(0);
-		    pack_uint(buf, 0u);
-		    io_write(changes_fd, buf.data(), buf.size());
-		    io_write(changes_fd, reinterpret_cast<const char *>(p), block_size);
+		    pack_uint(full, comp_stream.deflate_zstream->total_out);
+		    full.append(reinterpret_cast<const char *>(comp_stream.out),
+				comp_stream.deflate_zstream->total_out);
 		}
 	    }
-	    else {
-		buf.resize(0);
-		pack_uint(buf, 0u);
-		io_write(changes_fd, buf.data(), buf.size());
-		io_write(changes_fd, reinterpret_cast<const char *>(p), block_size);
+	    if (full.empty()) {
+		// The deflate failed (or we're not compressing), so write
+		// the data uncompressed.
+		pack_uint(full, 0u);
+		full.append(reinterpret_cast<const char *>(p), block_size);
 	    }
+
+	    // If block n replaced a block from the previous revision, a replica
+	    // at that revision already has that block, so also compress block
+	    // n using it as a preset dictionary - the parts of block n which
+	    // haven't changed then compress to very little.  The checksum of
+	    // the base block lets the replica check it has the right one.
+	    //
+	    // A replica which is still catching up after a database copy may
+	    // not have the right base block, so the master needs to be able
+	    // to send the whole block instead, and we write that too.
+	    map<uint4, uint4>::const_iterator i = delta_base.find(n);
+	    if (compressed && i != delta_base.end() &&
+		!base.block_free_at_start(i->second)) {
+		read_block(i->second, q);
+		comp_stream.lazy_alloc_deflate_zstream();
+		if (deflateSetDictionary(comp_stream.deflate_zstream,
+					 q, block_size) == Z_OK) {
+		    comp_stream.compress(p, block_size);
+		    if (comp_stream.zerr == Z_STREAM_END &&
+			comp_stream.deflate_zstream->total_out < full.size()) {
+			pack_uint(buf, i->second + 1);
+			pack_uint(buf, uint4(adler32(0, q, block_size)));
+			pack_uint(buf, comp_stream.deflate_zstream->total_out);
+			buf.append(reinterpret_cast<const char *>(comp_stream.out),
+				   comp_stream.deflate_zstream->total_out);
+		    }
+		}
+	    }
+	    pack_uint(buf, 0u);
+	    buf += full;
+	    io_write(changes_fd, buf.data(), buf.size());
 	    ++n;
 	}
 	delete[] p;
 	p = 0;
+	delete[] q;
     } catch (...) {
 	delete[] p;
+	delete[] q;
 	throw;
     }
     buf.resize(0);
@@ -1893,6 +1929,7 @@ BrassTable::cancel()
     latest_revision_number = revision_number; // FIXME: we can end up reusing a revision if we opened a btree at an older revision, start to modify it, then cancel...
 
     Btree_modified = false;
+    delta_base.clear();
 
     for (int j = 0; j <= level; j++) {
 	C[j].n = BLK_UNUSED;
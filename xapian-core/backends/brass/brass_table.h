@@ -39,6 +39,7 @@
 #include "common/compression_stream.h"
 
 #include <algorithm>
+#include <map>
 #include <string>
 
 #define DONT_COMPRESS -1
@@ -773,6 +774,14 @@ class BrassTable {
 
 	CompressionStream comp_stream;
 
+	/** Map from blocks written in this revision to the block they replace.
+	 *
+	 *  The replaced block is still in use in the last committed revision,
+	 *  so any replica at that revision has an identical copy of it, which
+	 *  write_changed_blocks() uses as the base for a delta.
+	 */
+	std::map<uint4, uint4> delta_base;
+
 	/// If true, don't create the table until it's needed.
 	bool lazy;
 
@@ -50,6 +50,7 @@
 #include "chert_values.h"
 #include "debuglog.h"
 #include "fd.h"
+#include "filetests.h"
 #include "io_utils.h"
 #include "pack.h"
 #include "net/remoteconnection.h"
@@ -106,7 +107,7 @@ const int MAX_OPEN_RETRIES = 100;
 ChertDatabase::ChertDatabase(const string &chert_dir, int action,
 			     unsigned int block_size)
 	: db_dir(chert_dir),
-	  readonly(action == XAPIAN_DB_READONLY),
+	  readonly((action & XAPIAN_DB_ACTION_MASK) == XAPIAN_DB_READONLY),
 	  version_file(db_dir),
 	  postlist_table(db_dir, readonly),
 	  position_table(db_dir, readonly),
@@ -120,6 +121,9 @@ ChertDatabase::ChertDatabase(const string &chert_dir, int action,
 {
     LOGCALL_CTOR(DB, "ChertDatabase", chert_dir | action | block_size);
 
+    // Ignore any flags - chert doesn't support any of them.
+    action &= XAPIAN_DB_ACTION_MASK;
+
     if (action == XAPIAN_DB_READONLY) {
 	open_tables_consistent();
 	return;
@@ -516,16 +520,19 @@ ChertDatabase::get_database_write_lock(bool creating)
 }
 
 void
-ChertDatabase::send_whole_database(RemoteConnection & conn, double end_time)
+ChertDatabase::send_whole_database(RemoteConnection & conn,
+				   chert_revision_number_t revision,
+				   const DBCopyState * resume,
+				   double end_time)
 {
-    LOGCALL_VOID(DB, "ChertDatabase::send_whole_database", conn | end_time);
+    LOGCALL_VOID(DB, "ChertDatabase::send_whole_database", conn | revision | resume | end_time);
 
-    // Send the current revision number in the header.
+    // Send the revision number which the copy starts from in the header.
     string buf;
     string uuid = get_uuid();
     buf += encode_length(uuid.size());
     buf += uuid;
-    pack_uint(buf, get_revision_number());
+    pack_uint(buf, revision);
     conn.send_message(REPL_REPLY_DB_HEADER, buf, end_time);
 
     // Send all the tables.  The tables which we want to be cached best after
@@ -549,19 +556,50 @@ ChertDatabase::send_whole_database(RemoteConnection & conn, double end_time)
 	FD fd(open(filepath.c_str(), O_RDONLY));
 #endif
 	if (fd > 0) {
-	    conn.send_message(REPL_REPLY_DB_FILENAME, leaf, end_time);
-	    conn.send_file(REPL_REPLY_DB_FILEDATA, fd, end_time);
+	    // Only the tables themselves are resumed - the base files are
+	    // small and get rewritten in place.
+	    off_t offset = 0;
+	    if (resume && endswith(leaf, ".DB")) {
+		map<string, off_t>::const_iterator i;
+		i = resume->offsets.find(leaf);
+		if (i != resume->offsets.end())
+		    offset = i->second;
+	    }
+	    send_db_file(conn, leaf, fd, offset, end_time);
+	}
+    }
+}
+
+bool
+ChertDatabase::have_changesets(chert_revision_number_t from,
+			      chert_revision_number_t to) const
+{
+    while (from < to) {
+	string changes_name = db_dir + "/changes" + str(from);
+	if (!file_exists(changes_name))
+	    return false;
+	chert_revision_number_t startrev, endrev;
+	try {
+	    get_changeset_revisions(changes_name, &startrev, &endrev);
+	} catch (const Xapian::DatabaseError &) {
+	    // The changeset may have been removed since we checked.
+	    return false;
 	}
+	if (startrev != from || endrev <= startrev)
+	    return false;
+	from = endrev;
     }
+    return true;
 }
 
 void
 ChertDatabase::write_changesets_to_fd(int fd,
 				      const string & revision,
 				      bool need_whole_db,
+				      const DBCopyState * resume,
 				      ReplicationInfo * info)
 {
-    LOGCALL_VOID(DB, "ChertDatabase::write_changesets_to_fd", fd | revision | need_whole_db | info);
+    LOGCALL_VOID(DB, "ChertDatabase::write_changesets_to_fd", fd | revision | need_whole_db | resume | info);
 
     int whole_db_copies_left = MAX_DB_COPIES_PER_CONVERSATION;
     chert_revision_number_t start_rev_num = 0;
@@ -600,7 +638,28 @@ ChertDatabase::write_changesets_to_fd(int fd,
 	    start_rev_num = get_revision_number();
 	    start_uuid = get_uuid();
 
-	    send_whole_database(conn, 0.0);
+	    // If the replica was interrupted part way through receiving a copy
+	    // of this database, we can continue that copy provided we still
+	    // have all the changesets since the revision it started from.  Any
+	    // blocks which have changed since the replica received them will
+	    // then be updated by those changesets, just as for blocks which
+	    // change while a copy is being sent.
+	    const DBCopyState * copy_resume = NULL;
+	    if (resume) {
+		chert_revision_number_t resume_rev_num;
+		const char * p = resume->revision.data();
+		const char * p_end = p + resume->revision.size();
+		if (unpack_uint(&p, p_end, &resume_rev_num) && p == p_end &&
+		    resume_rev_num <= start_rev_num &&
+		    have_changesets(resume_rev_num, start_rev_num)) {
+		    start_rev_num = resume_rev_num;
+		    copy_resume = resume;
+		}
+		// Any further copies in this conversation start afresh.
+		resume = NULL;
+	    }
+
+	    send_whole_database(conn, start_rev_num, copy_resume, 0.0);
 	    if (info != NULL)
 		++(info->fullcopy_count);
 
@@ -938,8 +997,10 @@ ChertDatabase::open_allterms(const string & prefix) const
 }
 
 TermList *
-ChertDatabase::open_spelling_termlist(const string & word) const
+ChertDatabase::open_spelling_termlist(const string & word, unsigned,
+				      bool & exhaustive) const
 {
+    exhaustive = false;
     return spelling_table.open_termlist(word);
 }
 
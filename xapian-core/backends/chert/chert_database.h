@@ -213,14 +213,30 @@ class ChertDatabase : public Xapian::Database::Internal {
 	void cancel();
 
 	/** Send a set of messages which transfer the whole database.
-	 */
-	void send_whole_database(RemoteConnection & conn, double end_time);
+	 *
+	 *  @param conn		The connection to send the database over.
+	 *  @param revision	The revision to report the copy as starting
+	 *			from.
+	 *  @param resume	If non-NULL, an interrupted copy to continue -
+	 *			the data the replica already has for each table
+	 *			isn't sent again.
+	 *  @param end_time	The time to timeout at (0.0 for no timeout).
+	 */
+	void send_whole_database(RemoteConnection & conn,
+				 chert_revision_number_t revision,
+				 const DBCopyState * resume,
+				 double end_time);
 
 	/** Get the revision stored in a changeset.
 	 */
 	void get_changeset_revisions(const string & path,
 				     chert_revision_number_t * startrev,
 				     chert_revision_number_t * endrev) const;
+
+	/** Check we have changesets to take a database from revision @a from
+	 *  to revision @a to.
+	 */
+	bool have_changesets(chert_revision_number_t from, chert_revision_number_t to) const;
     public:
 	/** Create and open a chert database.
 	 *
@@ -277,7 +293,9 @@ class ChertDatabase : public Xapian::Database::Internal {
 	TermList * open_term_list(Xapian::docid did) const;
 	TermList * open_allterms(const string & prefix) const;
 
-	TermList * open_spelling_termlist(const string & word) const;
+	TermList * open_spelling_termlist(const string & word,
+					  unsigned max_edit_distance,
+					  bool & exhaustive) const;
 	TermList * open_spelling_wordlist() const;
 	Xapian::doccount get_spelling_frequency(const string & word) const;
 
@@ -289,6 +307,7 @@ class ChertDatabase : public Xapian::Database::Internal {
 	void write_changesets_to_fd(int fd,
 				    const string & start_revision,
 				    bool need_whole_db,
+				    const DBCopyState * resume,
 				    Xapian::ReplicationInfo * info);
 	string get_revision_info() const;
 	string get_uuid() const;
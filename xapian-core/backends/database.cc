@@ -225,7 +225,8 @@ Database::Internal::open_value_list(Xapian::valueno slot) const
 }
 
 TermList *
-Database::Internal::open_spelling_termlist(const string &) const
+Database::Internal::open_spelling_termlist(const string &, unsigned,
+					   bool &) const
 {
     // Only implemented for some database backends - others will just not
     // suggest spelling corrections (or not contribute to them in a multiple
@@ -343,7 +344,8 @@ Database::Internal::collect_document(Xapian::docid did) const
 }
 
 void
-Database::Internal::write_changesets_to_fd(int, const string &, bool, ReplicationInfo *)
+Database::Internal::write_changesets_to_fd(int, const string &, bool,
+					   const DBCopyState *, ReplicationInfo *)
 {
     throw Xapian::UnimplementedError("This backend doesn't provide changesets");
 }
@@ -39,6 +39,7 @@
 
 using namespace std;
 
+class DBCopyState;
 class LeafPostList;
 class RemoteDatabase;
 
@@ -49,6 +50,12 @@ typedef Xapian::ValueIterator::Internal ValueList;
 // Used by brass and chert.
 const int XAPIAN_DB_READONLY = 0;
 
+/// Mask for the action in the flags passed when opening a database.
+const int XAPIAN_DB_ACTION_MASK = 0x0f;
+
+/// Mask for the DB_SPELLING_DELETIONS_* setting in those flags.
+const int XAPIAN_DB_SPELLING_DELETIONS_MASK = 0x30;
+
 namespace Xapian {
 
 struct ReplicationInfo;
@@ -296,13 +303,27 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
 	virtual Xapian::Document::Internal *
 	open_document(Xapian::docid did, bool lazy) const = 0;
 
-	/** Create a termlist tree from trigrams of @a word.
+	/** Create a termlist tree of candidate corrections for @a word.
+	 *
+	 *  The candidates are found from trigrams of @a word, or from a
+	 *  deletion index if the backend has one which can find all words
+	 *  within @a max_edit_distance edits.
 	 *
 	 *  You can assume word.size() > 1.
 	 *
-	 *  If there are no trigrams, returns NULL.
+	 *  @param[out] exhaustive	Set to true if the candidates include
+	 *				every word within @a max_edit_distance
+	 *				edits, in which case the wdf isn't a
+	 *				trigram score so mustn't be used to
+	 *				filter them.  The caller should
+	 *				initialise this to false.
+	 *
+	 *  If there are no candidates, returns NULL.
 	 */
-	virtual TermList * open_spelling_termlist(const string & word) const;
+	virtual TermList *
+	open_spelling_termlist(const string & word,
+			       unsigned max_edit_distance,
+			       bool & exhaustive) const;
 
 	/** Return a termlist which returns the words which are spelling
 	 *  correction targets.
@@ -482,10 +503,16 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
 	 *
 	 *  This call may reopen the database, leaving it pointing to a more
 	 *  recent version of the database.
+	 *
+	 *  If @a resume is non-NULL, it describes an interrupted copy of this
+	 *  database which the replica has partly received.  If a whole
+	 *  database copy is needed, the backend may continue that copy rather
+	 *  than starting a new one.
 	 */
 	virtual void write_changesets_to_fd(int fd,
 					    const std::string & start_revision,
 					    bool need_whole_db,
+					    const DBCopyState * resume,
 					    Xapian::ReplicationInfo * info);
 
 	/// Get a string describing the current revision of the database.
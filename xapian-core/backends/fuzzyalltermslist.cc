@@ -0,0 +1,283 @@
+/** @file fuzzyalltermslist.cc
+ * @brief Iterate the terms within an edit distance of a word.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "fuzzyalltermslist.h"
+
+#include "xapian/unicode.h"
+
+#include "debuglog.h"
+#include "omassert.h"
+#include "stringutils.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+FuzzyAllTermsList::FuzzyAllTermsList(TermList * real_, size_t prefix_len_,
+				     const string & word_,
+				     unsigned max_edits_)
+    : real(real_), prefix_len(prefix_len_), max_edits(max_edits_),
+      skip_prefixed(prefix_len_ == 0 &&
+		    (word_.empty() || !C_isupper(word_[0]))),
+      rows_valid(0), distance(0), finished(false)
+{
+    Xapian::Utf8Iterator u(word_);
+    while (u != Xapian::Utf8Iterator()) {
+	word.push_back(*u);
+	++u;
+    }
+
+    // Row 0 is the distance from the empty string to each prefix of the word.
+    rows.resize(word.size() + 1);
+    for (size_t j = 0; j <= word.size(); ++j) {
+	rows[j] = unsigned(min(j, size_t(max_edits + 1)));
+    }
+}
+
+FuzzyAllTermsList::~FuzzyAllTermsList()
+{
+    delete real;
+}
+
+bool
+FuzzyAllTermsList::calc_row(size_t i, unsigned ch, unsigned * out) const
+{
+    const size_t row_size = word.size() + 1;
+    const unsigned limit = max_edits + 1;
+    const unsigned * prev = &rows[(i - 1) * row_size];
+    const unsigned * prev2 = (i > 1) ? prev - row_size : NULL;
+    unsigned prev_ch = (i > 1) ? chars[i - 2] : 0;
+
+    out[0] = unsigned(min(i, size_t(limit)));
+    bool alive = (out[0] <= max_edits);
+    for (size_t j = 1; j < row_size; ++j) {
+	unsigned w = word[j - 1];
+	unsigned best = prev[j - 1] + (ch != w);
+	if (prev[j] + 1 < best) best = prev[j] + 1;
+	if (out[j - 1] + 1 < best) best = out[j - 1] + 1;
+	if (prev2 && j > 1 && ch == word[j - 2] && prev_ch == w &&
+	    prev2[j - 2] + 1 < best) {
+	    // Adjacent transposition.
+	    best = prev2[j - 2] + 1;
+	}
+	if (best > limit) best = limit;
+	out[j] = best;
+	if (best <= max_edits) alive = true;
+    }
+    return alive;
+}
+
+bool
+FuzzyAllTermsList::next_candidate(const string & term, size_t dead,
+				  string & target) const
+{
+    const size_t row_size = word.size() + 1;
+    vector<unsigned> row(row_size);
+    // Once a row has no entries within max_edits, no extension of that
+    // prefix can match (an adjacent transposition can't rescue it either,
+    // since the preceding row would then have had an entry within reach), so
+    // we look for the smallest character greater than the one which killed
+    // the row which leaves it alive.  If there isn't one, we back up a
+    // character and repeat.
+    for (size_t level = dead + 1; level > 0; --level) {
+	size_t idx = level - 1;
+	unsigned ch = chars[idx];
+
+	// If the character isn't encoded as valid UTF-8, the encoding of
+	// the character we want to skip to might not sort after it.
+	char buf[4];
+	unsigned len = Xapian::Unicode::to_utf8(ch, buf);
+	if (len != offsets[idx + 1] - offsets[idx] ||
+	    memcmp(buf, term.data() + prefix_len + offsets[idx], len) != 0) {
+	    target.resize(0);
+	    return true;
+	}
+
+	const unsigned * prev = &rows[idx * row_size];
+	unsigned prev_min = *min_element(prev, prev + row_size);
+	unsigned next_ch = 0;
+	if (level <= max_edits || prev_min < max_edits) {
+	    // Any character will do.
+	    if (ch < 0x10ffff) next_ch = ch + 1;
+	} else {
+	    // Only a character in the word can help.
+	    for (size_t j = 0; j != word.size(); ++j) {
+		unsigned w = word[j];
+		if (w > ch && (next_ch == 0 || w < next_ch) &&
+		    calc_row(level, w, &row[0])) {
+		    next_ch = w;
+		}
+	    }
+	}
+
+	if (next_ch) {
+	    target.assign(term, 0, prefix_len + offsets[idx]);
+	    Xapian::Unicode::append_utf8(target, next_ch);
+	    return true;
+	}
+    }
+    return false;
+}
+
+void
+FuzzyAllTermsList::walk()
+{
+    const size_t row_size = word.size() + 1;
+    while (!real->at_end()) {
+	string term = real->get_termname();
+	AssertRel(term.size(),>=,prefix_len);
+	if (skip_prefixed && !term.empty() && C_isupper(term[0])) {
+	    // Jump past all the terms starting with a capital letter.
+	    TermList * ret = real->skip_to(string(1, 'Z' + 1));
+	    if (ret) {
+		delete real;
+		real = ret;
+	    }
+	    continue;
+	}
+
+	// Decode the term, noting how many leading characters it shares with
+	// the previous one, since the rows for those are still valid.
+	const char * start = term.data() + prefix_len;
+	Xapian::Utf8Iterator u(start, term.size() - prefix_len);
+	offsets.resize(0);
+	size_t n = 0;
+	while (u != Xapian::Utf8Iterator()) {
+	    offsets.push_back(u.raw() - start);
+	    unsigned ch = *u;
+	    if (n < chars.size()) {
+		if (chars[n] != ch) {
+		    chars[n] = ch;
+		    if (rows_valid > n) rows_valid = n;
+		}
+	    } else {
+		chars.push_back(ch);
+	    }
+	    ++n;
+	    ++u;
+	}
+	offsets.push_back(term.size() - prefix_len);
+	if (n < chars.size()) {
+	    chars.resize(n);
+	    if (rows_valid > n) rows_valid = n;
+	}
+	if (rows.size() < (n + 1) * row_size) rows.resize((n + 1) * row_size);
+
+	size_t i = rows_valid;
+	bool dead = false;
+	while (i < n) {
+	    ++i;
+	    if (!calc_row(i, chars[i - 1], &rows[i * row_size])) {
+		dead = true;
+		break;
+	    }
+	    rows_valid = i;
+	}
+
+	TermList * ret;
+	if (!dead) {
+	    unsigned d = rows[n * row_size + word.size()];
+	    if (d <= max_edits) {
+		distance = d;
+		return;
+	    }
+	    ret = real->next();
+	} else {
+	    string target;
+	    if (!next_candidate(term, i - 1, target)) {
+		finished = true;
+		return;
+	    }
+	    if (target.empty()) {
+		ret = real->next();
+	    } else {
+		ret = real->skip_to(target);
+	    }
+	}
+	if (ret) {
+	    delete real;
+	    real = ret;
+	}
+    }
+}
+
+string
+FuzzyAllTermsList::get_termname() const
+{
+    LOGCALL(DB, string, "FuzzyAllTermsList::get_termname", NO_ARGS);
+    Assert(!at_end());
+    RETURN(real->get_termname());
+}
+
+Xapian::doccount
+FuzzyAllTermsList::get_termfreq() const
+{
+    LOGCALL(DB, Xapian::doccount, "FuzzyAllTermsList::get_termfreq", NO_ARGS);
+    Assert(!at_end());
+    RETURN(real->get_termfreq());
+}
+
+Xapian::termcount
+FuzzyAllTermsList::get_collection_freq() const
+{
+    LOGCALL(DB, Xapian::termcount, "FuzzyAllTermsList::get_collection_freq", NO_ARGS);
+    Assert(!at_end());
+    RETURN(real->get_collection_freq());
+}
+
+TermList *
+FuzzyAllTermsList::next()
+{
+    LOGCALL(DB, TermList *, "FuzzyAllTermsList::next", NO_ARGS);
+    // Not at_end(), since that may not be called before the first next().
+    Assert(!finished);
+    TermList * ret = real->next();
+    if (ret) {
+	delete real;
+	real = ret;
+    }
+    walk();
+    RETURN(NULL);
+}
+
+TermList *
+FuzzyAllTermsList::skip_to(const string &term)
+{
+    LOGCALL(DB, TermList *, "FuzzyAllTermsList::skip_to", term);
+    // Not at_end(), since that may not be called before the first next().
+    Assert(!finished);
+    TermList * ret = real->skip_to(term);
+    if (ret) {
+	delete real;
+	real = ret;
+    }
+    walk();
+    RETURN(NULL);
+}
+
+bool
+FuzzyAllTermsList::at_end() const
+{
+    LOGCALL(DB, bool, "FuzzyAllTermsList::at_end", NO_ARGS);
+    RETURN(finished || real->at_end());
+}
@@ -0,0 +1,159 @@
+/** @file fuzzyalltermslist.h
+ * @brief Iterate the terms within an edit distance of a word.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_FUZZYALLTERMSLIST_H
+#define XAPIAN_INCLUDED_FUZZYALLTERMSLIST_H
+
+#include "backends/alltermslist.h"
+
+#include <string>
+#include <vector>
+
+/** Iterate the terms within an edit distance of a word.
+ *
+ *  This wraps an AllTermsList and filters it through a Levenshtein automaton
+ *  (using the same edit distance as spelling correction, so an adjacent
+ *  transposition counts as one edit).  The automaton state is a row of the
+ *  edit distance matrix for each character of the current term, and rows are
+ *  reused for characters shared with the previous term.  When a character
+ *  leaves no way to get within the distance, we use skip_to() to jump past
+ *  every term which starts the same way, straight to the next character which
+ *  could still lead to a match, so only a small part of the term dictionary
+ *  is actually visited.
+ */
+class FuzzyAllTermsList : public AllTermsList {
+    /// Don't allow assignment.
+    void operator=(const FuzzyAllTermsList &);
+
+    /// Don't allow copying.
+    FuzzyAllTermsList(const FuzzyAllTermsList &);
+
+    /// The AllTermsList we're filtering.
+    TermList * real;
+
+    /// Length in bytes of the prefix all terms must start with.
+    size_t prefix_len;
+
+    /// The word to match after the prefix, as Unicode characters.
+    std::vector<unsigned> word;
+
+    /// The maximum edit distance to accept.
+    unsigned max_edits;
+
+    /** Skip terms starting with a capital letter?
+     *
+     *  By convention such terms have a prefix, so we skip them when there's
+     *  no fixed prefix unless the word starts with a capital letter too.
+     */
+    bool skip_prefixed;
+
+    /// The characters of the current term after the prefix.
+    std::vector<unsigned> chars;
+
+    /** Byte offset of each character of the current term after the prefix.
+     *
+     *  This has one more entry than @a chars, the last being the length of
+     *  the term after the prefix.
+     */
+    std::vector<size_t> offsets;
+
+    /** Rows of the edit distance matrix, each word.size() + 1 entries.
+     *
+     *  Row i is for the first i entries in @a chars.  Entries are capped at
+     *  max_edits + 1 as we don't care by how much a distance is exceeded.
+     */
+    std::vector<unsigned> rows;
+
+    /// The number of rows after the first which are up to date.
+    size_t rows_valid;
+
+    /// The edit distance of the current term.
+    unsigned distance;
+
+    /// True once no more terms can match.
+    bool finished;
+
+    /** Calculate row @a i of the edit distance matrix for character @a ch.
+     *
+     *  Rows 0 to i - 1 must be up to date.
+     *
+     *  @return	true if any entry in the row is within max_edits.
+     */
+    bool calc_row(size_t i, unsigned ch, unsigned * out) const;
+
+    /** Find the next term to skip to after the current term ended up dead.
+     *
+     *  @param term	The current term.
+     *  @param dead	Index in @a chars of the character which killed it.
+     *  @param[out] target	The term to skip to.
+     *
+     *  @return	false if no term after the current one can match.  If true
+     *		is returned with @a target empty, the term isn't valid UTF-8
+     *		so we can't safely work out where to skip to, and just need
+     *		to advance to the next term.
+     */
+    bool next_candidate(const std::string & term, size_t dead,
+			std::string & target) const;
+
+    /// Move forward to the next matching term, starting from the current one.
+    void walk();
+
+  public:
+    /** Constructor.
+     *
+     *  @param real_	The AllTermsList for all terms starting with the
+     *			prefix.  The newly constructed object takes ownership.
+     *  @param prefix_len_	The length of the prefix in bytes.
+     *  @param word_	The word to match after the prefix (in UTF-8).
+     *  @param max_edits_	The maximum edit distance to accept.
+     */
+    FuzzyAllTermsList(TermList * real_, size_t prefix_len_,
+		      const std::string & word_, unsigned max_edits_);
+
+    /// Destructor.
+    ~FuzzyAllTermsList();
+
+    /// Return the termname at the current position.
+    std::string get_termname() const;
+
+    /// Return the term frequency for the term at the current position.
+    Xapian::doccount get_termfreq() const;
+
+    /// Return the collection frequency for the term at the current position.
+    Xapian::termcount get_collection_freq() const;
+
+    /// Return the edit distance from the word for the current term.
+    unsigned get_edit_distance() const { return distance; }
+
+    /// Advance the current position to the next term in the termlist.
+    TermList *next();
+
+    /** Skip forward to the specified term.
+     *
+     *  If the specified term isn't in the list, position ourselves on the
+     *  first term after @a term (or at_end() if no terms after @a term exist).
+     */
+    TermList *skip_to(const std::string &term);
+
+    /// Return true if the current position is past the last term in this list.
+    bool at_end() const;
+};
+
+#endif // XAPIAN_INCLUDED_FUZZYALLTERMSLIST_H
@@ -42,6 +42,7 @@
 #include "stringutils.h" // For STRINGIZE().
 #include "weight/weightinternal.h"
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -61,10 +62,12 @@ throw_bad_message(const string & context)
 RemoteDatabase::RemoteDatabase(int fd, double timeout_,
 			       const string & context_, bool writable)
 	: link(fd, fd, context_),
+	  server_can_compress(false),
 	  context(context_),
 	  cached_stats_valid(),
 	  mru_valstats(),
 	  mru_slot(Xapian::BAD_VALUENO),
+	  abandoned_mset(false),
 	  timeout(timeout_)
 {
 #ifndef __WIN32__
@@ -264,7 +267,11 @@ bool
 RemoteDatabase::reopen()
 {
     mru_slot = Xapian::BAD_VALUENO;
-    return update_stats(MSG_REOPEN);
+    bool changed = update_stats(MSG_REOPEN);
+    // Don't return documents requested before the reopen from the old
+    // revision.
+    read_docs.clear();
+    return changed;
 }
 
 void
@@ -286,22 +293,149 @@ RemoteDatabase::open_document(Xapian::docid did, bool /*lazy*/) const
     Assert(did);
 
     send_message(MSG_DOCUMENT, encode_length(did));
-    string doc_data;
-    map<Xapian::valueno, string> values;
-    get_message(doc_data, REPLY_DOCDATA);
+    DocumentReply reply;
+    read_document_reply(reply);
+    if (!reply.error.empty())
+	unserialise_error(reply.error, "REMOTE:", context);
+
+    return new RemoteDocument(this, did, reply.data, reply.values);
+}
+
+/// Maximum number of documents to request in one MSG_DOCUMENTS message.
+static const size_t MAX_DOCUMENT_BATCH = 64;
+
+void
+RemoteDatabase::request_document(Xapian::docid did) const
+{
+    Assert(did);
+
+    if (read_docs.find(did) != read_docs.end() ||
+	find(unsent_docs.begin(), unsent_docs.end(), did) != unsent_docs.end() ||
+	find(pending_docs.begin(), pending_docs.end(), did) != pending_docs.end())
+	return;
+
+    unsent_docs.push_back(did);
+    if (unsent_docs.size() >= MAX_DOCUMENT_BATCH) send_document_requests();
+}
+
+Xapian::Document::Internal *
+RemoteDatabase::collect_document(Xapian::docid did) const
+{
+    map<Xapian::docid, DocumentReply>::iterator i = read_docs.find(did);
+    if (i == read_docs.end()) {
+	if (find(unsent_docs.begin(), unsent_docs.end(), did) !=
+	    unsent_docs.end()) {
+	    send_document_requests();
+	} else if (find(pending_docs.begin(), pending_docs.end(), did) ==
+		   pending_docs.end()) {
+	    // Not requested, so just fetch it now.
+	    return open_document(did, false);
+	}
+	// Read replies (keeping any for other documents) until we get the
+	// one we want.
+	do {
+	    read_pending_document();
+	    i = read_docs.find(did);
+	} while (i == read_docs.end());
+    }
+
+    DocumentReply reply;
+    swap(reply.data, i->second.data);
+    swap(reply.values, i->second.values);
+    swap(reply.error, i->second.error);
+    read_docs.erase(i);
+    if (!reply.error.empty())
+	unserialise_error(reply.error, "REMOTE:", context);
+
+    return new RemoteDocument(this, did, reply.data, reply.values);
+}
+
+void
+RemoteDatabase::send_document_requests() const
+{
+    if (unsent_docs.empty()) return;
+
+    discard_abandoned_mset();
+
+    // Only have one batch in flight at once, so that the server can't block
+    // writing replies to us while we're blocked writing requests to it.
+    while (!pending_docs.empty()) read_pending_document();
 
-    reply_type type;
     string message;
-    while ((type = get_message(message)) == REPLY_VALUE) {
+    vector<Xapian::docid>::const_iterator i;
+    for (i = unsent_docs.begin(); i != unsent_docs.end(); ++i) {
+	message += encode_length(*i);
+    }
+    double end_time = RealTime::end_time(timeout);
+    link.send_message(static_cast<unsigned char>(MSG_DOCUMENTS), message,
+		      end_time);
+    pending_docs.insert(pending_docs.end(),
+			unsent_docs.begin(), unsent_docs.end());
+    unsent_docs.clear();
+}
+
+void
+RemoteDatabase::discard_abandoned_mset() const
+{
+    if (!abandoned_mset) return;
+    abandoned_mset = false;
+    // The reply may be REPLY_RESULTS or REPLY_EXCEPTION - either way, nobody
+    // wants it now.
+    double end_time = RealTime::end_time(timeout);
+    string message;
+    (void)link.get_message(message, end_time);
+}
+
+void
+RemoteDatabase::read_pending_document() const
+{
+    Assert(!pending_docs.empty());
+    Xapian::docid did = pending_docs.front();
+    pending_docs.pop_front();
+    // Read into a local object so that we don't leave an empty entry in
+    // read_docs if reading the reply throws.
+    DocumentReply reply;
+    read_document_reply(reply);
+    DocumentReply & entry = read_docs[did];
+    swap(entry.data, reply.data);
+    swap(entry.values, reply.values);
+    swap(entry.error, reply.error);
+}
+
+void
+RemoteDatabase::read_document_reply(DocumentReply & reply) const
+{
+    double end_time = RealTime::end_time(timeout);
+    string message;
+    reply_type type =
+	static_cast<reply_type>(link.get_message(message, end_time));
+    if (type == REPLY_EXCEPTION) {
+	// An empty message means the server failed with an unknown exception
+	// and is closing the connection, so throw now.
+	if (message.empty())
+	    unserialise_error(message, "REMOTE:", context);
+	// Keep the exception to throw when the document is collected, as the
+	// reply may be for a different document to the one being collected.
+	swap(reply.error, message);
+	return;
+    }
+    if (type != REPLY_DOCDATA)
+	throw_bad_message(context);
+    swap(reply.data, message);
+
+    while (true) {
+	end_time = RealTime::end_time(timeout);
+	type = static_cast<reply_type>(link.get_message(message, end_time));
+	if (type != REPLY_VALUE) break;
 	const char * p = message.data();
 	const char * p_end = p + message.size();
 	Xapian::valueno slot = decode_length(&p, p_end, false);
-	values.insert(make_pair(slot, string(p, p_end)));
+	reply.values.insert(make_pair(slot, string(p, p_end)));
     }
+    if (type == REPLY_EXCEPTION)
+	unserialise_error(message, "REMOTE:", context);
     if (type != REPLY_DONE)
 	throw_bad_message(context);
-
-    return new RemoteDocument(this, did, doc_data, values);
 }
 
 bool
@@ -348,6 +482,10 @@ RemoteDatabase::update_stats(message_type msg_code) const
     }
     has_positional_info = (*p++ == '1');
     total_length = decode_length(&p, p_end, false);
+    if (p == p_end) {
+	throw Xapian::NetworkError("Bad stats update message received", context);
+    }
+    server_can_compress = (*p++ == '1');
     uuid.assign(p, p_end);
     cached_stats_valid = true;
     return true;
@@ -522,6 +660,12 @@ RemoteDatabase::get_message(string &result, reply_type required_type) const
 void
 RemoteDatabase::send_message(message_type type, const string &message) const
 {
+    // Read the replies to any documents requested but not yet collected,
+    // so they don't get mistaken for the reply to this message.  Documents
+    // requested but not yet sent can stay that way.
+    while (!pending_docs.empty()) read_pending_document();
+    discard_abandoned_mset();
+
     double end_time = RealTime::end_time(timeout);
     link.send_message(static_cast<unsigned char>(type), message, end_time);
 }
@@ -553,6 +697,7 @@ RemoteDatabase::set_query(const Xapian::Query& query,
 			 Xapian::valueno sort_key,
 			 Xapian::Enquire::Internal::sort_setting sort_by,
 			 bool sort_value_forward,
+			 bool docids_in_rank_order,
 			 int percent_cutoff, double weight_cutoff,
 			 const Xapian::Weight *wtscheme,
 			 const Xapian::RSet &omrset,
@@ -570,8 +715,11 @@ RemoteDatabase::set_query(const Xapian::Query& query,
     message += encode_length(sort_key);
     message += char('0' + sort_by);
     message += char('0' + sort_value_forward);
+    message += char('0' + docids_in_rank_order);
     message += char(percent_cutoff);
     message += serialise_double(weight_cutoff);
+    // Ask for compressed replies if the server supports them.
+    message += (server_can_compress ? '1' : '0');
 
     tmp = wtscheme->name();
     message += encode_length(tmp.size());
@@ -609,6 +757,7 @@ RemoteDatabase::get_remote_stats(bool nowait, Xapian::Weight::Internal &out)
 
     string message;
     get_message(message, REPLY_STATS);
+    if (server_can_compress) message = uncompress_message(message);
     out = unserialise_stats(message);
 
     return true;
@@ -618,11 +767,13 @@ void
 RemoteDatabase::send_global_stats(Xapian::doccount first,
 				  Xapian::doccount maxitems,
 				  Xapian::doccount check_at_least,
-				  const Xapian::Weight::Internal &stats)
+				  const Xapian::Weight::Internal &stats,
+				  double time_limit)
 {
     string message = encode_length(first);
     message += encode_length(maxitems);
     message += encode_length(check_at_least);
+    message += serialise_double(time_limit);
     message += serialise_stats(stats);
     send_message(MSG_GETMSET, message);
 }
@@ -633,6 +784,7 @@ RemoteDatabase::get_mset(Xapian::MSet &mset,
 {
     string message;
     get_message(message, REPLY_RESULTS);
+    if (server_can_compress) message = uncompress_message(message);
     const char * p = message.data();
     const char * p_end = p + message.size();
 
@@ -29,6 +29,9 @@
 #include "backends/valuestats.h"
 #include "xapian/weight.h"
 
+#include <deque>
+#include <map>
+
 namespace Xapian {
     class RSet;
 }
@@ -72,6 +75,9 @@ class RemoteDatabase : public Xapian::Database::Internal {
     /// The UUID of the remote database.
     mutable string uuid;
 
+    /// Can the server compress its replies to MSG_QUERY?
+    mutable bool server_can_compress;
+
     /// The context to return with any error messages
     string context;
 
@@ -86,6 +92,58 @@ class RemoteDatabase : public Xapian::Database::Internal {
      */
     mutable Xapian::valueno mru_slot;
 
+    /// A reply to MSG_DOCUMENT which has been read but not yet collected.
+    struct DocumentReply {
+	/// The document data.
+	string data;
+
+	/// The document values.
+	map<Xapian::valueno, string> values;
+
+	/// The serialised exception if the server sent one, else empty.
+	string error;
+    };
+
+    /** Docids passed to request_document() which we haven't sent yet.
+     *
+     *  These are sent together in a single MSG_DOCUMENTS message.
+     */
+    mutable vector<Xapian::docid> unsent_docs;
+
+    /** Docids sent in MSG_DOCUMENTS whose replies we haven't read.
+     *
+     *  These are in the order the requests were sent - the server handles
+     *  messages in the order they arrive, so the replies come back in this
+     *  order too, which allows several requests to be in flight at once on
+     *  the same connection.
+     */
+    mutable std::deque<Xapian::docid> pending_docs;
+
+    /// Replies read for requested documents which haven't been collected.
+    mutable map<Xapian::docid, DocumentReply> read_docs;
+
+    /** Is there an MSet reply which we've stopped waiting for?
+     *
+     *  The server still sends it, so it needs to be read and thrown away
+     *  before we read the reply to any later message.
+     */
+    mutable bool abandoned_mset;
+
+    /// Read and discard the MSet reply if abandon_mset() was called.
+    void discard_abandoned_mset() const;
+
+    /// Send the requests in @a unsent_docs to the server.
+    void send_document_requests() const;
+
+    /** Read the reply to the oldest request in @a pending_docs.
+     *
+     *  The reply is stored in @a read_docs for collect_document().
+     */
+    void read_pending_document() const;
+
+    /// Read the reply to MSG_DOCUMENT into @a reply.
+    void read_document_reply(DocumentReply & reply) const;
+
     bool update_stats(message_type msg_code = MSG_UPDATE) const;
 
   protected:
@@ -126,6 +184,21 @@ class RemoteDatabase : public Xapian::Database::Internal {
     /// Send a keep-alive message.
     void keep_alive();
 
+    /// Is there data from the server ready to read?
+    bool ready_to_read() const { return link.ready_to_read(); }
+
+    /** Get the file descriptor to wait on for data from the server.
+     *
+     *  @return	The file descriptor, or -1 if there's already data buffered.
+     */
+    int get_read_fd() const { return link.get_read_fd(); }
+
+    /// Get the timeout used in network communications, in seconds.
+    double get_timeout() const { return timeout; }
+
+    /// Get the context to return with any error messages.
+    const string & get_context() const { return context; }
+
     /** Set the query
      *
      * @param query			The query.
@@ -138,6 +211,7 @@ class RemoteDatabase : public Xapian::Database::Internal {
      * @param sort_key			The value number to sort on.
      * @param sort_by			Which order to apply sorts in.
      * @param sort_value_forward	Sort order for values.
+     * @param docids_in_rank_order	Are docids in rank order?
      * @param percent_cutoff		Percentage cutoff.
      * @param weight_cutoff		Weight cutoff.
      * @param wtscheme			Weighting scheme.
@@ -152,6 +226,7 @@ class RemoteDatabase : public Xapian::Database::Internal {
 		   Xapian::valueno sort_key,
 		   Xapian::Enquire::Internal::sort_setting sort_by,
 		   bool sort_value_forward,
+		   bool docids_in_rank_order,
 		   int percent_cutoff, double weight_cutoff,
 		   const Xapian::Weight *wtscheme,
 		   const Xapian::RSet &omrset,
@@ -163,16 +238,27 @@ class RemoteDatabase : public Xapian::Database::Internal {
      */
     bool get_remote_stats(bool nowait, Xapian::Weight::Internal &out);
 
-    /// Send the global stats to the remote server.
+    /** Send the global stats to the remote server.
+     *
+     *  @param time_limit	The time limit for the remote match in seconds
+     *				(0 for no limit).
+     */
     void send_global_stats(Xapian::doccount first,
 			   Xapian::doccount maxitems,
 			   Xapian::doccount check_at_least,
-			   const Xapian::Weight::Internal &stats);
+			   const Xapian::Weight::Internal &stats,
+			   double time_limit);
 
     /// Get the MSet from the remote server.
     void get_mset(Xapian::MSet &mset,
 		  const vector<Xapian::MatchSpy *> & matchspies);
 
+    /** Stop waiting for the MSet from the remote server.
+     *
+     *  The reply is discarded when it arrives.
+     */
+    void abandon_mset() { abandoned_mset = true; }
+
     /// Get remote metadata key list.
     TermList * open_metadata_keylist(const std::string & prefix) const;
 
@@ -198,6 +284,17 @@ class RemoteDatabase : public Xapian::Database::Internal {
     /// Get a remote document.
     Xapian::Document::Internal * open_document(Xapian::docid did, bool lazy) const;
 
+    /** Request a remote document without waiting for the reply.
+     *
+     *  Requested documents are sent to the server in a batch when the first
+     *  of them is collected, so fetching several documents only costs a
+     *  single round trip.
+     */
+    void request_document(Xapian::docid did) const;
+
+    /// Collect a document requested by request_document().
+    Xapian::Document::Internal * collect_document(Xapian::docid did) const;
+
     /// Get the document count.
     Xapian::doccount get_doccount() const;
 
@@ -37,6 +37,7 @@ using namespace std;
 #define OPT_HELP 1
 #define OPT_VERSION 2
 #define OPT_NO_RENUMBER 3
+#define OPT_SPELLING_DELETIONS 4
 
 static void show_usage() {
     cout << "Usage: "PROG_NAME" [OPTIONS] SOURCE_DATABASE... DESTINATION_DATABASE\n\n"
@@ -54,6 +55,9 @@ static void show_usage() {
 "                    unique ids from an external source).  Currently this\n"
 "                    option is only supported when merging databases if they\n"
 "                    have disjoint ranges of used document ids\n"
+"      --spelling-deletions=N\n"
+"                    Build a spelling deletion index covering N deletions\n"
+"                    (1, 2 or 3) even if no source database has one\n"
 "  --help            display this help and exit\n"
 "  --version         output version information and exit" << endl;
 }
@@ -110,6 +114,7 @@ main(int argc, char **argv)
 	{"multipass",	no_argument, 0, 'm'},
 	{"blocksize",	required_argument, 0, 'b'},
 	{"no-renumber", no_argument, 0, OPT_NO_RENUMBER},
+	{"spelling-deletions", required_argument, 0, OPT_SPELLING_DELETIONS},
 	{"quiet",	no_argument, 0, 'q'},
 	{"help",	no_argument, 0, OPT_HELP},
 	{"version",	no_argument, 0, OPT_VERSION},
@@ -150,6 +155,18 @@ main(int argc, char **argv)
 	    case OPT_NO_RENUMBER:
 		compactor.set_renumber(false);
 		break;
+	    case OPT_SPELLING_DELETIONS: {
+		char *p;
+		unsigned long deletions = strtoul(optarg, &p, 10);
+		if (*p || deletions < 1 || deletions > 3) {
+		    cerr << PROG_NAME": Bad value '" << optarg
+			 << "' passed for spelling-deletions, must be 1, 2 or 3"
+			 << endl;
+		    exit(1);
+		}
+		compactor.set_spelling_deletions(deletions);
+		break;
+	    }
 	    case 'q':
 		compactor.set_quiet(true);
 		break;
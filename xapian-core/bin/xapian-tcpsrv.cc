@@ -53,6 +53,8 @@ const int MSECS_ACTIVE_TIMEOUT_DEFAULT = 15000;
 
 #define OPT_HELP 1
 #define OPT_VERSION 2
+#define OPT_WORKERS 3
+#define OPT_REPLY_CACHE 4
 
 static const char * opts = "I:p:a:i:t:oqw";
 static const struct option long_opts[] = {
@@ -64,6 +66,8 @@ static const struct option long_opts[] = {
     {"one-shot",	no_argument,		0, 'o'},
     {"quiet",		no_argument,		0, 'q'},
     {"writable",	no_argument,		0, 'w'},
+    {"workers",		required_argument,	0, OPT_WORKERS},
+    {"reply-cache",	required_argument,	0, OPT_REPLY_CACHE},
     {"help",		no_argument,		0, OPT_HELP},
     {"version",		no_argument,		0, OPT_VERSION},
     {NULL, 0, 0, 0}
@@ -81,6 +85,13 @@ static void show_usage() {
 "  --one-shot              serve a single connection and exit\n"
 "  --quiet                 disable information messages to stdout\n"
 "  --writable              allow updates (only one database directory allowed)\n"
+"  --workers N             serve connections from a pool of N processes which\n"
+"                          keep the databases open between connections,\n"
+"                          instead of forking for each connection (not\n"
+"                          supported with --writable)\n"
+"  --reply-cache MB        cache up to MB megabytes of replies to queries in\n"
+"                          each worker process, so repeated queries don't\n"
+"                          need to be rerun (requires --workers)\n"
 "  --help                  display this help and exit\n"
 "  --version               output version information and exit" << endl;
 }
@@ -94,6 +105,8 @@ int main(int argc, char **argv) {
     bool one_shot = false;
     bool verbose = true;
     bool writable = false;
+    int workers = 0;
+    int reply_cache_mb = 0;
     bool syntax_error = false;
 
     int c;
@@ -130,6 +143,14 @@ int main(int argc, char **argv) {
 	    case 'w':
 		writable = true;
 		break;
+	    case OPT_WORKERS:
+		workers = atoi(optarg);
+		if (workers <= 0) syntax_error = true;
+		break;
+	    case OPT_REPLY_CACHE:
+		reply_cache_mb = atoi(optarg);
+		if (reply_cache_mb <= 0) syntax_error = true;
+		break;
 	    default:
 		syntax_error = true;
 	}
@@ -151,6 +172,18 @@ int main(int argc, char **argv) {
 	exit(1);
     }
 
+    if (writable && workers) {
+	cerr << "Error: '--workers' can't be used with '--writable'." << endl;
+	exit(1);
+    }
+
+    if (reply_cache_mb && (!workers || one_shot)) {
+	// Without worker processes, the cache would only last for a single
+	// connection.
+	cerr << "Error: '--reply-cache' can only be used with '--workers'." << endl;
+	exit(1);
+    }
+
     try {
 	vector<string> dbnames;
 	// Try to open the database(s) so we report problems now instead of
@@ -176,7 +209,8 @@ int main(int argc, char **argv) {
 	}
 
 	RemoteTcpServer server(dbnames, host, port, active_timeout,
-			       idle_timeout, writable, verbose);
+			       idle_timeout, writable, verbose,
+			       size_t(reply_cache_mb) << 20);
 
 	if (verbose)
 	    cout << "Listening..." << endl;
@@ -185,6 +219,8 @@ int main(int argc, char **argv) {
 
 	if (one_shot) {
 	    server.run_once();
+	} else if (workers) {
+	    server.run_workers(workers);
 	} else {
 	    server.run();
 	}
@@ -8,6 +8,7 @@ noinst_HEADERS +=\
 	common/filetests.h\
 	common/fileutils.h\
 	common/gnu_getopt.h\
+	common/heap.h\
 	common/internaltypes.h\
 	common/io_utils.h\
 	common/msvc_dirent.h\
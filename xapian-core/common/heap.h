@@ -0,0 +1,118 @@
+/** @file heap.h
+ * @brief Heap operations which use swap() to move elements.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_HEAP_H
+#define XAPIAN_INCLUDED_HEAP_H
+
+#include <algorithm> // For std::swap.
+#include <iterator>
+
+/** Heap operations which use swap() to move elements.
+ *
+ *  These maintain the same heap invariant as std::make_heap() and friends
+ *  (so the two can be mixed), but move elements with an unqualified swap()
+ *  call rather than by assignment.  For element types which hold strings
+ *  (such as MSetItem with a sort key) and provide an efficient swap(), this
+ *  avoids copying the string data every time an element moves in the heap.
+ */
+namespace Heap {
+
+/// Restore the heap property below position @a hole.
+template<typename I, typename C>
+void
+sift_down(I first, typename std::iterator_traits<I>::difference_type hole,
+	  typename std::iterator_traits<I>::difference_type len, C comp)
+{
+    using std::swap;
+    while (true) {
+	typename std::iterator_traits<I>::difference_type child = 2 * hole + 1;
+	if (child >= len) return;
+	if (child + 1 < len && comp(first[child], first[child + 1]))
+	    ++child;
+	if (!comp(first[hole], first[child])) return;
+	swap(first[hole], first[child]);
+	hole = child;
+    }
+}
+
+/// Turn the range [first, last) into a heap.
+template<typename I, typename C>
+void
+make(I first, I last, C comp)
+{
+    typename std::iterator_traits<I>::difference_type len = last - first;
+    if (len < 2) return;
+    for (typename std::iterator_traits<I>::difference_type parent =
+	     (len - 2) / 2; ; --parent) {
+	sift_down(first, parent, len, comp);
+	if (parent == 0) return;
+    }
+}
+
+/// Add the element at last - 1 to the heap [first, last - 1).
+template<typename I, typename C>
+void
+push(I first, I last, C comp)
+{
+    using std::swap;
+    typename std::iterator_traits<I>::difference_type hole = last - first - 1;
+    while (hole > 0) {
+	typename std::iterator_traits<I>::difference_type parent =
+	    (hole - 1) / 2;
+	if (!comp(first[parent], first[hole])) return;
+	swap(first[parent], first[hole]);
+	hole = parent;
+    }
+}
+
+/** Move the top of the heap [first, last) to last - 1.
+ *
+ *  The range [first, last - 1) is a heap afterwards.
+ */
+template<typename I, typename C>
+void
+pop(I first, I last, C comp)
+{
+    using std::swap;
+    typename std::iterator_traits<I>::difference_type len = last - first;
+    if (len < 2) return;
+    swap(first[0], first[len - 1]);
+    sift_down(first, 0, len - 1, comp);
+}
+
+/** Replace the top of the heap [first, last) with @a item.
+ *
+ *  The caller should only call this if the top element compares less than
+ *  @a item.  On return, @a item holds the element which was displaced
+ *  (which the caller will usually discard).
+ */
+template<typename I, typename T, typename C>
+void
+replace(I first, I last, T & item, C comp)
+{
+    using std::swap;
+    swap(*first, item);
+    sift_down(first, 0, last - first, comp);
+}
+
+}
+
+#endif // XAPIAN_INCLUDED_HEAP_H
@@ -46,7 +46,16 @@
 // 35: 1.1.5 Support for add_spelling() and remove_spelling().
 // 35.1: 1.2.4 Support for metadata_keys_begin().
 // 36: 1.3.0 REPLY_UPDATE and REPLY_GREETING merged, and more...
-#define XAPIAN_REMOTE_PROTOCOL_MAJOR_VERSION 36
+// 36.1: New MSG_DOCUMENTS to fetch several documents in one message.
+// 37: More compact stats and MSet serialisation; REPLY_UPDATE says if the
+//     server can compress replies, and MSG_QUERY asks for compressed
+//     REPLY_STATS and REPLY_RESULTS.
+// 38: MSG_GETMSET passes a time limit, and the serialised MSet says if the
+//     match was cut short by it.
+// 38.1: Support for OP_FUZZY in query serialisation.
+// 38.2: Support for OP_WILDCARD in query serialisation.
+// 39: MSG_QUERY passes the docids_in_rank_order setting.
+#define XAPIAN_REMOTE_PROTOCOL_MAJOR_VERSION 39
 #define XAPIAN_REMOTE_PROTOCOL_MINOR_VERSION 0
 
 /** Message types (client -> server).
@@ -84,6 +93,7 @@ enum message_type {
     MSG_GETMSET,		// Get MSet
     MSG_SHUTDOWN,		// Shutdown
     MSG_METADATAKEYLIST,	// Iterator for metadata keys
+    MSG_DOCUMENTS,		// Get several documents
     MSG_MAX
 };
 
@@ -25,7 +25,12 @@
 
 #include "xapian/error.h"
 
+#include "filetests.h"
 #include "io_utils.h"
+#include "pack.h"
+#include "replicationprotocol.h"
+#include "net/length.h"
+#include "net/remoteconnection.h"
 
 #ifdef __WIN32__
 # include "msvc_posix_wrapper.h"
@@ -37,7 +42,12 @@
 
 #include <sys/types.h>
 
+#include <algorithm>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include <zlib.h>
 
 using namespace std;
 
@@ -72,3 +82,85 @@ write_and_clear_changes(int changes_fd, string & buf, size_t bytes)
     }
     buf.erase(0, bytes);
 }
+
+string
+DBCopyState::serialise() const
+{
+    string result;
+    pack_string(result, uuid);
+    pack_string(result, revision);
+    map<string, off_t>::const_iterator i;
+    for (i = offsets.begin(); i != offsets.end(); ++i) {
+	pack_string(result, i->first);
+	pack_uint(result, static_cast<unsigned long long>(i->second));
+    }
+    return result;
+}
+
+bool
+DBCopyState::unserialise(const string & s)
+{
+    const char * p = s.data();
+    const char * end = p + s.size();
+    offsets.clear();
+    if (!unpack_string(&p, end, uuid) || !unpack_string(&p, end, revision))
+	return false;
+    while (p != end) {
+	string leaf;
+	unsigned long long offset;
+	if (!unpack_string(&p, end, leaf) || !unpack_uint(&p, end, &offset))
+	    return false;
+	offsets[leaf] = off_t(offset);
+    }
+    return true;
+}
+
+void
+send_db_file(RemoteConnection & conn, const string & leaf, int fd,
+	     off_t offset, double end_time)
+{
+    off_t size = file_size(fd);
+    if (errno)
+	throw Xapian::DatabaseError("Couldn't stat file to send: " + leaf,
+				    errno);
+    if (offset > size)
+	offset = 0;
+    if (lseek(fd, offset, SEEK_SET) < 0)
+	throw Xapian::DatabaseError("Couldn't seek in file to send: " + leaf,
+				    errno);
+
+    string buf;
+    pack_uint(buf, static_cast<unsigned long long>(offset));
+    buf += leaf;
+    conn.send_message(REPL_REPLY_DB_FILENAME, buf, end_time);
+
+    // We have to read each chunk to checksum it anyway, so we send it from
+    // the same buffer.  The file may be modified while we're sending it, but
+    // this way the checksum always covers exactly the bytes sent, so the
+    // replica only sees a mismatch if the data was corrupted.
+    while (offset < size) {
+	size_t n = size_t(min(size - offset, off_t(DB_COPY_CHUNK_SIZE)));
+	buf.resize(4 + n);
+	io_read(fd, &buf[4], n, n);
+	uLong crc = crc32(0L, reinterpret_cast<const Bytef *>(buf.data() + 4), n);
+	for (int i = 3; i >= 0; --i) {
+	    buf[i] = char(crc & 0xff);
+	    crc >>= 8;
+	}
+	conn.send_message(REPL_REPLY_DB_FILEDATA, buf, end_time);
+	offset += n;
+    }
+}
+
+bool
+check_db_file_chunk(string & chunk)
+{
+    if (chunk.size() < 4)
+	return false;
+    uLong crc = 0;
+    for (size_t i = 0; i != 4; ++i)
+	crc = (crc << 8) | static_cast<unsigned char>(chunk[i]);
+    chunk.erase(0, 4);
+    return crc == crc32(0L, reinterpret_cast<const Bytef *>(chunk.data()),
+			chunk.size());
+}
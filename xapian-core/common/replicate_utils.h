@@ -21,8 +21,13 @@
 #ifndef XAPIAN_INCLUDED_REPLICATE_UTILS_H
 #define XAPIAN_INCLUDED_REPLICATE_UTILS_H
 
+#include <map>
 #include <string>
 
+#include <sys/types.h>
+
+class RemoteConnection;
+
 /** Create a new changeset file, and return an open fd for writing to it.
  *
  *  Creates the changeset directory, if required.
@@ -53,4 +58,60 @@ create_changeset_file(const std::string & changeset_dir,
 void
 write_and_clear_changes(int changes_fd, std::string & buf, size_t bytes);
 
+/** The state of a partially received whole database copy.
+ *
+ *  The replica keeps this up to date as it receives a copy, and sends it to
+ *  the master so that an interrupted copy can be resumed rather than started
+ *  again from scratch.
+ */
+class DBCopyState {
+  public:
+    /// The UUID of the database being copied.
+    std::string uuid;
+
+    /// The revision of the database which the copy started from.
+    std::string revision;
+
+    /** How many bytes of each file have been received and verified.
+     *
+     *  Files which haven't been started yet aren't present.
+     */
+    std::map<std::string, off_t> offsets;
+
+    /// Serialise to a string.
+    std::string serialise() const;
+
+    /** Unserialise from a string.
+     *
+     *  @return	false if @a s isn't a valid serialisation.
+     */
+    bool unserialise(const std::string & s);
+};
+
+/** Send one file of a database as part of a whole database copy.
+ *
+ *  The file's data is sent in chunks of DB_COPY_CHUNK_SIZE bytes, each with a
+ *  checksum, so that the replica can verify each chunk as it arrives.
+ *
+ *  @param conn	The connection to send the file over.
+ *  @param leaf	The leafname of the file.
+ *  @param fd	The open file.
+ *  @param offset	Offset in the file to start from (if this is beyond the
+ *			end of the file, the whole file is sent).
+ *  @param end_time	The time to timeout at (0.0 for no timeout).
+ */
+void
+send_db_file(RemoteConnection & conn, const std::string & leaf, int fd,
+	     off_t offset, double end_time);
+
+/** Verify a chunk of file data received as part of a whole database copy.
+ *
+ *  @param chunk	The message data - on success, this is reduced to just
+ *			the file data.
+ *
+ *  @return	true if the checksum of the data is correct.
+ */
+bool
+check_db_file_chunk(std::string & chunk);
+
 #endif // XAPIAN_INCLUDED_REPLICATE_UTILS_H
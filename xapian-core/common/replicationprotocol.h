@@ -23,7 +23,8 @@
 
 // Versions:
 // 1: Initial support
-#define XAPIAN_REPLICATION_PROTOCOL_MAJOR_VERSION 1
+// 2: Whole DB copies are sent as checksummed chunks, and can be resumed
+#define XAPIAN_REPLICATION_PROTOCOL_MAJOR_VERSION 2
 #define XAPIAN_REPLICATION_PROTOCOL_MINOR_VERSION 0
 
 // Reply types (master -> slave)
@@ -31,8 +32,8 @@ enum replicate_reply_type {
     REPL_REPLY_END_OF_CHANGES,	// No more changes to transfer.
     REPL_REPLY_FAIL,		// Couldn't generate full set of changes.
     REPL_REPLY_DB_HEADER,	// The start of a whole DB copy.
-    REPL_REPLY_DB_FILENAME,	// The name of a file in a DB copy.
-    REPL_REPLY_DB_FILEDATA,	// Contents of a file in a DB copy.
+    REPL_REPLY_DB_FILENAME,	// The name of a file in a DB copy, and offset.
+    REPL_REPLY_DB_FILEDATA,	// A checksummed chunk of a file in a DB copy.
     REPL_REPLY_DB_FOOTER,	// End of a whole DB copy.
     REPL_REPLY_CHANGESET	// A changeset file is being sent.
 };
@@ -42,4 +43,13 @@ enum replicate_reply_type {
 // sent.
 #define MAX_DB_COPIES_PER_CONVERSATION 5
 
+// The size of the chunks which the files in a whole DB copy are sent in.  The
+// replica verifies each chunk.
+#define DB_COPY_CHUNK_SIZE (4 << 20)
+
+// How much of a file in a whole DB copy the replica receives between syncing
+// it to disk and recording its progress.  An interrupted copy is resumed from
+// the last point recorded.
+#define DB_COPY_SYNC_SIZE (64 << 20)
+
 #endif // XAPIAN_INCLUDED_REPLICATIONPROTOCOL_H
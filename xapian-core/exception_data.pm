@@ -190,6 +190,10 @@ errorclass(18, 'RangeError', 'RuntimeError', <<'DOC');
  */
 DOC
 
+errorclass(19, 'WildcardError', 'RuntimeError', <<'DOC');
+/** Indicates a wildcard expanded to more terms than its limit allows. */
+DOC
+
 sub for_each_nothrow {
     my $func = shift @_;
     my $class = '';
@@ -89,6 +89,23 @@ class XAPIAN_VISIBILITY_DEFAULT Compactor {
      */
     void set_compaction_level(compaction_level compaction);
 
+    /** Build a spelling deletion index in the output.
+     *
+     *  A brass output database gets a deletion index if any input has one,
+     *  using the largest number of deletions of any input.  This allows one
+     *  to be built for databases which don't have one - the
+     *  Xapian::DB_SPELLING_DELETIONS_* flags only take effect when the first
+     *  word is added to an empty spelling table.
+     *
+     *  @param deletions	Minimum number of deletions to index (1, 2 or 3).
+     *				The default is 0, which means only to build a
+     *				deletion index if an input has one.  Other
+     *				backends ignore this setting.
+     *
+     *  @exception Xapian::InvalidArgumentError if @a deletions is more than 3.
+     */
+    void set_spelling_deletions(unsigned deletions);
+
     /** Set where to write the output.
      *
      *  @param destdir	Output path.  This can be the same as an input if that
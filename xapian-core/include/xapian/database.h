@@ -548,6 +548,10 @@ class XAPIAN_VISIBILITY_DEFAULT WritableDatabase : public Database {
 	 *    none exists
 	 *  - Xapian::DB_OPEN open for read/write; fail if no db exists
 	 *
+	 *  This may be bitwise-or-ed with one of Xapian::DB_SPELLING_DELETIONS_1,
+	 *  Xapian::DB_SPELLING_DELETIONS_2 or Xapian::DB_SPELLING_DELETIONS_3
+	 *  to build a deletion index for spelling suggestions.
+	 *
 	 *  @exception Xapian::DatabaseCorruptError will be thrown if the
 	 *             database is in a corrupt state.
 	 *
@@ -969,6 +973,27 @@ const int DB_CREATE_OR_OVERWRITE = 3;
 /** Open for read/write; fail if no db exists. */
 const int DB_OPEN = 4;
 
+/** Build a spelling deletion index covering 1 deletion.
+ *
+ *  This can be bitwise-or-ed with the action when opening a brass database.
+ *  It takes effect when the first word is added to the database's spelling
+ *  data - after that, any deletion index is maintained (or not) regardless
+ *  of these flags, so a database with existing spelling data only gets a
+ *  deletion index by compacting it (see
+ *  Xapian::Compactor::set_spelling_deletions()).  Other backends ignore it.
+ */
+const int DB_SPELLING_DELETIONS_1 = 0x10;
+/** Build a spelling deletion index covering 2 deletions.
+ *
+ *  See DB_SPELLING_DELETIONS_1 for details.
+ */
+const int DB_SPELLING_DELETIONS_2 = 0x20;
+/** Build a spelling deletion index covering 3 deletions.
+ *
+ *  See DB_SPELLING_DELETIONS_1 for details.
+ */
+const int DB_SPELLING_DELETIONS_3 = 0x30;
+
 /** Show a short-format display of the B-tree contents.
  *
  *  For use with Xapian::Database::check().
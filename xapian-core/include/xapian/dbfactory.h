@@ -113,6 +113,8 @@ Database open(const std::string &dir);
  *					new database if none exists.
  *  - Xapian::DB_OPEN			open existing database, failing if none
  *					exists.
+ *			This may be bitwise-or-ed with one of the
+ *			Xapian::DB_SPELLING_DELETIONS_* flags.
  * @param block_size	the Btree blocksize to use (in bytes), which must be a
  *			power of two between 2048 and 65536 (inclusive).  The
  *			default (also used if an invalid value if passed) is
@@ -208,6 +208,19 @@ class XAPIAN_VISIBILITY_DEFAULT MSet {
 	 */
 	double get_max_attained() const;
 
+	/** Was the match cut short by the time limit?
+	 *
+	 *  If this returns true, then the match stopped before it had
+	 *  considered all the matching documents, or the results from one or
+	 *  more remote databases didn't arrive in time and were left out.  The
+	 *  items in the MSet are the best found before the time limit expired,
+	 *  and the bounds and estimate reflect that not all documents were
+	 *  considered.
+	 *
+	 *  See Xapian::Enquire::set_time_limit().
+	 */
+	bool timed_out() const;
+
 	/** The number of items in this MSet */
 	Xapian::doccount size() const;
 
@@ -356,6 +369,15 @@ class XAPIAN_VISIBILITY_DEFAULT MSetIterator {
 	 */
 	std::string get_collapse_key() const;
 
+	/** Get a cursor for the current position.
+	 *
+	 *  The returned string is an opaque token which can be passed to
+	 *  Enquire::set_cursor() to fetch the results which rank below this
+	 *  document, without the matcher having to keep track of all the
+	 *  results which rank above it.
+	 */
+	std::string get_cursor() const;
+
 	/** Get an estimate of the number of documents that have been collapsed
 	 *  into this one.
 	 *
@@ -648,6 +670,22 @@ class XAPIAN_VISIBILITY_DEFAULT MatchDecider {
 	virtual ~MatchDecider();
 };
 
+/** Base class for functors passed to Enquire::visit_matches().
+ */
+class XAPIAN_VISIBILITY_DEFAULT MatchVisitor {
+    public:
+	/** Visit a matching document.
+	 *
+	 *  @param doc	The matching document.  Its document ID is available
+	 *		from doc.get_docid(), and values can be read from it
+	 *		efficiently.
+	 */
+	virtual void operator()(const Xapian::Document &doc) = 0;
+
+	/// Destructor.
+	virtual ~MatchVisitor();
+};
+
 /** This class provides an interface to the information retrieval
  *  system for the purpose of searching.
  *
@@ -818,6 +856,60 @@ class XAPIAN_VISIBILITY_DEFAULT Enquire {
 	 */
 	void set_docid_order(docid_order order);
 
+	/** Specify whether documents are in rank order by document id.
+	 *
+	 *  If your database assigns document ids in descending order of a
+	 *  static rank (for example, a quality score, or a date if you want
+	 *  newest first), then setting this allows the matcher to stop as
+	 *  soon as it has found enough matches, rather than considering every
+	 *  matching document.
+	 *
+	 *  If the sort order is by value or key (e.g. set_sort_by_value())
+	 *  and ascending document id order is consistent with that sort
+	 *  order for matching documents, then the results are exact.  If the
+	 *  sort order is primarily by relevance, then the results are an
+	 *  approximation: the first @a checkatleast matching documents (in
+	 *  document id order) are ranked by relevance, and the rest are
+	 *  ignored.  In either case, the MSet's bounds and estimate reflect
+	 *  that not all matches were considered.
+	 *
+	 *  This is currently only used when searching a single database -
+	 *  in particular, it's ignored for multiple databases (which have
+	 *  their document ids interleaved).  For a remote database, the
+	 *  setting is passed to the server, which uses it if it is searching
+	 *  a single database.
+	 *
+	 *  It's also ignored if set_docid_order(Xapian::Enquire::DESCENDING)
+	 *  is in effect, since documents with higher document ids would then
+	 *  rank higher among documents which are otherwise tied.
+	 *
+	 *  @param ranked	true if document ids are in rank order
+	 *			(default false).
+	 */
+	void set_docids_in_rank_order(bool ranked);
+
+	/** Set a time limit for the match.
+	 *
+	 *  If the match hasn't finished once @a time_limit seconds have
+	 *  passed, it stops and returns the best results found so far, and
+	 *  Xapian::MSet::timed_out() reports that this happened.
+	 *
+	 *  For remote databases, the remaining time is passed to the server,
+	 *  which stops its own match early in the same way.  If a remote
+	 *  server's results still don't arrive in time, the match carries on
+	 *  without them.  If an ErrorHandler is set, it is called with a
+	 *  Xapian::NetworkTimeoutError for each remote database left out this
+	 *  way.
+	 *
+	 *  The time limit is only checked while looking for matches, so
+	 *  opening posting lists and fetching statistics at the start of the
+	 *  match may take longer.
+	 *
+	 *  @param time_limit	The time limit in seconds, or 0 for no time
+	 *			limit (the default).
+	 */
+	void set_time_limit(double time_limit);
+
 	/** Set the percentage and/or weight cutoffs.
 	 *
 	 * @param percent_cutoff Minimum percentage score for returned
@@ -935,6 +1027,49 @@ class XAPIAN_VISIBILITY_DEFAULT Enquire {
 	void set_sort_by_relevance_then_key(Xapian::KeyMaker * sorter,
 					    bool reverse);
 
+	/** Set a cursor to continue a previous match from.
+	 *
+	 *  Subsequent calls to get_mset() will only consider documents which
+	 *  rank below the document the cursor was obtained from, which
+	 *  allows results to be paged through efficiently - each call to
+	 *  get_mset() only needs to keep track of @a maxitems results, rather
+	 *  than @a first + @a maxitems as when paging using @a first.  For
+	 *  example, to export all the matches for a query:
+	 *
+	 *  @code
+	 *  Xapian::MSet mset = enquire.get_mset(0, 1000);
+	 *  while (!mset.empty()) {
+	 *      for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i)
+	 *          process(i);
+	 *      enquire.set_cursor(mset.back().get_cursor());
+	 *      mset = enquire.get_mset(0, 1000);
+	 *  }
+	 *  @endcode
+	 *
+	 *  Documents which don't rank below the cursor are treated as if
+	 *  rejected by a MatchDecider, so the match statistics (such as
+	 *  MSet::get_matches_estimated()) describe the documents after the
+	 *  cursor.  The query, sort order and docid order should be the same
+	 *  as when the cursor was obtained, and collapsing is only applied
+	 *  between documents after the cursor.  Documents which tie in the
+	 *  sort order are ordered by docid (as set by set_docid_order()), so
+	 *  each document is returned on exactly one page.
+	 *
+	 *  The weights of the documents before the cursor are still
+	 *  calculated, so MSet::get_max_attained() and the percentages are
+	 *  the same on each page as for a single MSet of all the results.
+	 *
+	 *  The remote backend doesn't currently support cursors.
+	 *
+	 *  @param cursor	A cursor returned by MSetIterator::get_cursor(),
+	 *			or an empty string to clear any cursor set
+	 *			(which is the default).
+	 *
+	 *  @exception Xapian::InvalidArgumentError will be thrown if the
+	 *	       cursor isn't valid.
+	 */
+	void set_cursor(const std::string & cursor);
+
 	/** Get (a portion of) the match set for the current query.
 	 *
 	 *  @param first     the first item in the result set to return.
@@ -984,6 +1119,24 @@ class XAPIAN_VISIBILITY_DEFAULT Enquire {
 	}
 	/** @} */
 
+	/** Visit every document which matches the current query.
+	 *
+	 *  This is intended for exporting all the matches for a query (for
+	 *  example, for analytics) - it's much more efficient than calling
+	 *  get_mset() with a large @a maxitems, as no weights are calculated
+	 *  and no MSet is built.  The query is run with boolean weighting
+	 *  semantics, and any sort order, collapsing, cutoffs, cursor and
+	 *  matchspies which are set are ignored.
+	 *
+	 *  Documents are passed to @a visitor in ascending order of document
+	 *  ID.
+	 *
+	 *  The remote backend doesn't currently support this method.
+	 *
+	 *  @param visitor	The functor to call for each matching document.
+	 */
+	void visit_matches(MatchVisitor & visitor) const;
+
 	static const int INCLUDE_QUERY_TERMS = 1;
 	static const int USE_EXACT_TERMFREQ = 2;
 
@@ -103,7 +103,42 @@ class XAPIAN_VISIBILITY_DEFAULT Query {
 	OP_ELITE_SET = 10,
 	OP_VALUE_GE = 11,
 	OP_VALUE_LE = 12,
-	OP_SYNONYM = 13
+	OP_SYNONYM = 13,
+
+	/** Match terms within an edit distance of a word.
+	 *
+	 *  The word is expanded to the terms in the database which are
+	 *  within the specified edit distance of it (using the same measure
+	 *  as spelling correction, so an adjacent transposition counts as a
+	 *  single edit), and these are combined with OP_SYNONYM.  The
+	 *  expansion is done when the search is run, separately for each
+	 *  database being searched, using a Levenshtein automaton to skip
+	 *  over the parts of the term dictionary which can't match.
+	 *
+	 *  For example, this matches "hello", "help", "helo", etc:
+	 *
+	 *  <pre>
+	 *  Xapian::Query query(Xapian::Query::OP_FUZZY, "helo");
+	 *  </pre>
+	 */
+	OP_FUZZY = 14,
+
+	/** Match terms starting with a prefix.
+	 *
+	 *  This is like an OP_SYNONYM over all the terms in the database
+	 *  which start with the prefix, but the terms are found when the
+	 *  search is run (separately for each database being searched), and
+	 *  their postlists are combined as they're found, so a short prefix
+	 *  which matches a large number of terms doesn't require building
+	 *  a huge Query object.
+	 *
+	 *  For example, this matches "wildcard", "wildcat", "wildcats", etc:
+	 *
+	 *  <pre>
+	 *  Xapian::Query query(Xapian::Query::OP_WILDCARD, "wildc");
+	 *  </pre>
+	 */
+	OP_WILDCARD = 15
     };
 
     /// Default constructor.
@@ -164,6 +199,57 @@ class XAPIAN_VISIBILITY_DEFAULT Query {
     Query(op op_, Xapian::valueno slot,
 	  const std::string & begin, const std::string & end);
 
+    /** Construct an OP_FUZZY or OP_WILDCARD query with default parameters.
+     *
+     *  The expansion isn't limited, and OP_FUZZY uses a maximum edit
+     *  distance of 2 with no fixed prefix.
+     *
+     *  @param op_		OP_FUZZY or OP_WILDCARD.
+     *  @param pattern	For OP_FUZZY, the word to match terms against.
+     *			For OP_WILDCARD, the prefix terms must start with.
+     */
+    Query(op op_, const std::string & pattern);
+
+    /** Construct an OP_FUZZY or OP_WILDCARD query.
+     *
+     *  There's deliberately no form taking just @a max_expansion, as
+     *  Query(OP_SCALE_WEIGHT, term, factor) would then be ambiguous.
+     *
+     *  @param op_		OP_FUZZY or OP_WILDCARD.
+     *  @param pattern	For OP_FUZZY, the word to match terms against.
+     *			For OP_WILDCARD, the prefix terms must start with.
+     *  @param max_expansion	The maximum number of terms to expand to in
+     *				each database searched (0 means no limit).
+     *				For OP_FUZZY, if more terms are within the
+     *				edit distance, those closest to @a pattern
+     *				are used.  For OP_WILDCARD,
+     *				Xapian::WildcardError is thrown when the
+     *				search is run if more terms match.  As the
+     *				limit applies to each database separately,
+     *				a search over several databases may expand
+     *				to more terms than this in total.
+     *  @param max_edits	The maximum edit distance for OP_FUZZY.
+     *				Ignored for OP_WILDCARD (pass 0).
+     *  @param fixed_prefix_len	The length in bytes of a prefix of
+     *				@a pattern which matching terms must start
+     *				with exactly for OP_FUZZY (default: 0).  This
+     *				is useful for term prefixes, and also makes
+     *				the expansion much cheaper.  If this is 0,
+     *				terms starting with a capital letter (which
+     *				by convention have a prefix) are only matched
+     *				if @a pattern also starts with one.  Ignored
+     *				for OP_WILDCARD.
+     *  @param pos	The position of the pattern in the query (default:
+     *			0, meaning no position).  As for a term, this
+     *			determines the order in which terms it expands
+     *			to are returned by Enquire::get_matching_terms_begin().
+     */
+    Query(op op_, const std::string & pattern,
+	  Xapian::termcount max_expansion,
+	  unsigned max_edits,
+	  size_t fixed_prefix_len = 0,
+	  Xapian::termpos pos = 0);
+
     template<typename I>
     Query(op op_, I begin, I end, Xapian::termcount window = 0)
     {
@@ -370,6 +456,9 @@ class Query::Internal : public Xapian::Internal::intrusive_base {
 
     // Pass argument as void* to avoid need to include <vector>.
     virtual void gather_terms(void * void_terms) const;
+
+    // Pass argument as void* to avoid need to include <vector>.
+    virtual void gather_expansions(void * void_expansions) const;
 };
 
 }
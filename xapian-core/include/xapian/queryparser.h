@@ -31,6 +31,7 @@
 
 #include <set>
 #include <string>
+#include <vector>
 
 namespace Xapian {
 
@@ -84,6 +85,86 @@ class XAPIAN_VISIBILITY_DEFAULT SimpleStopper : public Stopper {
     virtual std::string get_description() const;
 };
 
+/** Base class for splitting CJK text into words.
+ *
+ *  By default, CJK text is indexed and searched as overlapping n-grams (if
+ *  the environment variable XAPIAN_CJK_NGRAM is set).  If a CJKSegmenter is
+ *  set on the TermGenerator and QueryParser, runs of CJK characters are
+ *  split into words by it instead.
+ */
+class XAPIAN_VISIBILITY_DEFAULT CJKSegmenter {
+  public:
+    /** Split a run of CJK characters into words.
+     *
+     *  @param text	The CJK characters (in UTF-8).
+     *  @param words	Vector to append the words to, in order.  Any
+     *			characters which aren't in one of the words are
+     *			ignored.
+     */
+    virtual void operator()(const std::string & text,
+			    std::vector<std::string> & words) const = 0;
+
+    /// Class has virtual methods, so provide a virtual destructor.
+    virtual ~CJKSegmenter() { }
+
+    /// Return a string describing this object.
+    virtual std::string get_description() const;
+};
+
+/** Split CJK text into words using a dictionary.
+ *
+ *  Each run of CJK characters is split into the sequence of dictionary words
+ *  with the highest product of word frequencies.  Characters which aren't
+ *  part of any dictionary word are treated as words of one character, and
+ *  characters which aren't word characters (such as CJK punctuation) are
+ *  ignored.
+ */
+class XAPIAN_VISIBILITY_DEFAULT DictionaryCJKSegmenter : public CJKSegmenter {
+  public:
+    /// @private @internal Class representing the dictionary.
+    class Internal;
+    /// @private @internal Reference counted internals.
+    Xapian::Internal::intrusive_ptr<Internal> internal;
+
+    /// Copy constructor.
+    DictionaryCJKSegmenter(const DictionaryCJKSegmenter & o);
+
+    /// Assignment.
+    DictionaryCJKSegmenter & operator=(const DictionaryCJKSegmenter & o);
+
+    /// Construct with an empty dictionary.
+    DictionaryCJKSegmenter();
+
+    /** Construct with the dictionary in a file.
+     *
+     *  Each line of the file is a word, optionally followed by whitespace
+     *  and its frequency (which defaults to 1).  Anything after the
+     *  frequency is ignored, so dictionaries in the same format as used
+     *  by the jieba segmenter can be used directly.
+     *
+     *  @param filename	The file to read the dictionary from.
+     */
+    explicit DictionaryCJKSegmenter(const std::string & filename);
+
+    /// Destructor.
+    ~DictionaryCJKSegmenter();
+
+    /** Add a word to the dictionary.
+     *
+     *  If the word is already in the dictionary, @a freq is added to its
+     *  frequency.
+     *
+     *  @param word	The word to add (in UTF-8).
+     *  @param freq	The frequency of the word (default: 1).
+     */
+    void add_word(const std::string & word, Xapian::termcount freq = 1);
+
+    void operator()(const std::string & text,
+		    std::vector<std::string> & words) const;
+
+    std::string get_description() const;
+};
+
 /// Base class for value range processors.
 struct XAPIAN_VISIBILITY_DEFAULT ValueRangeProcessor {
     /// Destructor.
@@ -405,8 +486,12 @@ class XAPIAN_VISIBILITY_DEFAULT QueryParser {
 	 *  or in a phrase (either an explicitly quoted one, or one implicitly
 	 *  generated by hyphens or other punctuation).
 	 *
+	 *  This uses Xapian::Query::OP_WILDCARD, so the terms are only
+	 *  expanded when the search is run.
+	 *
 	 *  NB: You need to tell the QueryParser object which database to
-	 *  expand wildcards from by calling set_database.
+	 *  expand wildcards from by calling set_database.  This is used to
+	 *  drop wildcards which don't match any terms.
 	 */
 	FLAG_WILDCARD = 16,
 	/** Allow queries such as 'NOT apples'.
@@ -469,6 +554,32 @@ class XAPIAN_VISIBILITY_DEFAULT QueryParser {
 	 */
 	FLAG_AUTO_MULTIWORD_SYNONYMS = 1024,
 
+	/** Support fuzzy matching of terms.
+	 *
+	 *  A term followed by '~' matches terms within 2 edits of it, or
+	 *  within N edits if followed by '~N' where N is a single digit (e.g.
+	 *  <code>colour~</code> or <code>colour~1</code>).  This uses
+	 *  Xapian::Query::OP_FUZZY, so the expansion happens when the search
+	 *  is run, and the limit set by set_max_wildcard_expansion() applies
+	 *  to each database searched (keeping the closest terms rather than
+	 *  reporting an error).
+	 */
+	FLAG_FUZZY = 2048,
+
+	/** Use prefix terms for partial and wildcard terms.
+	 *
+	 *  If the text was indexed with
+	 *  TermGenerator::FLAG_PARTIAL_PREFIXES, this makes FLAG_PARTIAL and
+	 *  FLAG_WILDCARD look up the indexed prefix term instead of
+	 *  expanding to every term starting with the prefix, so each is a
+	 *  single postlist.  Prefixes with a length outside the range set
+	 *  by set_partial_prefix_lengths() are expanded as usual.
+	 *
+	 *  The limit set by set_max_wildcard_expansion() doesn't apply to
+	 *  prefix terms, since they don't need expanding.
+	 */
+	FLAG_PARTIAL_PREFIXES = 4096,
+
 	/** The default flags.
 	 *
 	 *  Used if you don't explicitly pass any to @a parse_query().
@@ -569,11 +680,40 @@ class XAPIAN_VISIBILITY_DEFAULT QueryParser {
      *
      *  Note: you must also set FLAG_WILDCARD for wildcard expansion to happen.
      *
+     *  This limit is also used for fuzzy terms (FLAG_FUZZY).
+     *
+     *  If a wildcard expands to more terms than the limit (counting the
+     *  terms for all the prefixes of a field together),
+     *  Xapian::QueryParserError is thrown by parse_query().  The terms are
+     *  checked against the database passed to set_database().
+     *
      *  @param limit	The maximum number of terms each wildcard in the query
      *			can expand to, or 0 for no limit (which is the default).
      */
     void set_max_wildcard_expansion(Xapian::termcount limit);
 
+    /** Set the lengths of prefix terms to use for FLAG_PARTIAL_PREFIXES.
+     *
+     *  These should match the lengths the TermGenerator was configured
+     *  with using TermGenerator::set_partial_prefix_lengths().
+     *
+     *  @param min_len	The shortest indexed prefix, in Unicode characters
+     *			(default 1).
+     *  @param max_len	The longest indexed prefix, in Unicode characters
+     *			(default 6).
+     */
+    void set_partial_prefix_lengths(unsigned min_len, unsigned max_len);
+
+    /** Set the CJKSegmenter to split CJK text into words.
+     *
+     *  This should match the segmenter used by the TermGenerator.
+     *
+     *  @param segmenter	The CJKSegmenter object to use (default NULL,
+     *				which means CJK text is split into n-grams if
+     *				XAPIAN_CJK_NGRAM is set in the environment).
+     */
+    void set_cjk_segmenter(const CJKSegmenter * segmenter = NULL);
+
     /** Parse a query.
      *
      *  @param query_string  A free-text query as entered by a user
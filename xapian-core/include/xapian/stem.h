@@ -41,6 +41,17 @@ struct XAPIAN_VISIBILITY_DEFAULT StemImplementation
 
     /// Return a string describing this object.
     virtual std::string get_description() const = 0;
+
+    /** Stem the specified word into @a result.
+     *
+     *  The default implementation just assigns the return value of
+     *  operator()(word) to @a result - subclasses can override this to
+     *  avoid creating a new string for each word stemmed.
+     *
+     *  @param word		The word to stem.
+     *  @param[out] result	The stem.
+     */
+    virtual void stem_word(const std::string & word, std::string & result);
 };
 
 /// Class representing a stemming algorithm.
@@ -122,6 +133,38 @@ class XAPIAN_VISIBILITY_DEFAULT Stem {
      */
     std::string operator()(const std::string &word) const;
 
+    /** Stem a word into a string supplied by the caller.
+     *
+     *  If you're stemming a lot of words, reusing the same @a result string
+     *  for each avoids allocating memory for every stem.
+     *
+     *  @param word		a word to stem.
+     *  @param[out] result	the stem (any previous contents are replaced).
+     */
+    void operator()(const std::string &word, std::string &result) const;
+
+    /** Set the size of the cache of recently stemmed words.
+     *
+     *  The frequency of words in natural language text is very skewed, so
+     *  when indexing or parsing queries the same words are stemmed over and
+     *  over again.  If a cache is enabled, stems are remembered and repeated
+     *  words are looked up rather than being stemmed again.  The cache has
+     *  @a size slots, and a word which isn't in the cache replaces the word
+     *  in the slot it maps to.
+     *
+     *  The cache is shared by copies of this object made after this call
+     *  (so calling this method before passing the Stem object to
+     *  TermGenerator::set_stemmer() or QueryParser::set_stemmer() means they
+     *  will use the cache).  Changing the size replaces the cache.
+     *
+     *  By default there's no cache.  This method has no effect on a Stem
+     *  object which doesn't change terms.
+     *
+     *  @param size	The maximum number of words to cache, or 0 to disable
+     *			caching.
+     */
+    void set_cache_size(unsigned size);
+
     /// Return a string describing this object.
     std::string get_description() const;
 
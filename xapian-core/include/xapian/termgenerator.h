@@ -30,6 +30,7 @@
 
 namespace Xapian {
 
+class CJKSegmenter;
 class Document;
 class Stem;
 class Stopper;
@@ -85,7 +86,23 @@ class XAPIAN_VISIBILITY_DEFAULT TermGenerator {
     /// Flags to OR together and pass to TermGenerator::set_flags().
     enum flags {
 	/// Index data required for spelling correction.
-	FLAG_SPELLING = 128 // Value matches QueryParser flag.
+	FLAG_SPELLING = 128, // Value matches QueryParser flag.
+
+	/** Index prefixes of each word for partial matching.
+	 *
+	 *  As well as the usual terms, each word is indexed (without
+	 *  positional information) as terms for its first N characters,
+	 *  for N within the range set by set_partial_prefix_lengths().
+	 *  These terms are '^' followed by the term prefix and then the
+	 *  characters - e.g. "hello" indexed with prefix "S" generates
+	 *  "^Sh", "^She", "^Shel", "^Shell" and "^Shello" by default.
+	 *
+	 *  QueryParser::FLAG_PARTIAL_PREFIXES makes use of these terms to
+	 *  handle partial and wildcard terms with a single postlist rather
+	 *  than expanding them to all the matching terms.  The cost is a
+	 *  larger index.
+	 */
+	FLAG_PARTIAL_PREFIXES = 4096 // Value matches QueryParser flag.
     };
 
     /// Stemming strategies, for use with set_stemming_strategy().
@@ -137,6 +154,29 @@ class XAPIAN_VISIBILITY_DEFAULT TermGenerator {
      */
     void set_max_word_length(unsigned max_word_length);
 
+    /** Set the lengths of prefixes to index for FLAG_PARTIAL_PREFIXES.
+     *
+     *  The QueryParser must be configured with the same lengths using
+     *  QueryParser::set_partial_prefix_lengths().
+     *
+     *  @param min_len	The shortest prefix to index, in Unicode characters
+     *			(default 1).
+     *  @param max_len	The longest prefix to index, in Unicode characters
+     *			(default 6).
+     */
+    void set_partial_prefix_lengths(unsigned min_len, unsigned max_len);
+
+    /** Set the CJKSegmenter to split CJK text into words.
+     *
+     *  Each word is indexed with positional information, like words in
+     *  other scripts.  The same segmenter should be used by the QueryParser.
+     *
+     *  @param segmenter	The CJKSegmenter object to use (default NULL,
+     *				which means CJK text is split into n-grams if
+     *				XAPIAN_CJK_NGRAM is set in the environment).
+     */
+    void set_cjk_segmenter(const Xapian::CJKSegmenter * segmenter = NULL);
+
     /** Index some text.
      *
      * @param itor	Utf8Iterator pointing to the text to index.
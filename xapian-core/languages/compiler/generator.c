@@ -616,10 +616,12 @@ static void generate_do(struct generator * g, struct node * p) {
 
 static void generate_next(struct generator * g, struct node * p) {
     if (g->options->utf8) {
+        /* Step over an ASCII character directly, and only call skip_utf8()
+         * for other characters. */
         if (p->mode == m_forward)
-            w(g, "~{int ret = skip_utf8(~zp, ~zc, 0, ~zl, 1");
+            w(g, "~{int ret = ~zc < ~zl && ~zp[~zc] < 0x80 ? ~zc + 1 : skip_utf8(~zp, ~zc, 0, ~zl, 1");
         else
-            w(g, "~{int ret = skip_utf8(~zp, ~zc, ~zlb, 0, -1");
+            w(g, "~{int ret = ~zc > ~zlb && ~zp[~zc - 1] < 0x80 ? ~zc - 1 : skip_utf8(~zp, ~zc, ~zlb, 0, -1");
         wp(g, ");~N"
               "~Mif (ret < 0) ~f~N"
               "~M~zc = ret;~C"
@@ -1007,6 +1009,28 @@ static void generate_grouping(struct generator * g, struct node * p, int complem
     g->V[0] = p->name;
     g->I[0] = q->smallest_ch;
     g->I[1] = q->largest_ch;
+    if (g->options->utf8) {
+        /* Check an ASCII character directly against the grouping table, and
+         * only call the function (which decodes UTF-8) for other characters.
+         */
+        g->I[2] = q->largest_ch - q->smallest_ch;
+        if (p->mode == m_forward) {
+            wp(g, "~Mif (~zc < ~zl && ~zp[~zc] < 0x80) {~C~+", p);
+            w(g, "~Mint ch = ~zp[~zc] - ~I0;~N");
+        } else {
+            wp(g, "~Mif (~zc > ~zlb && ~zp[~zc - 1] < 0x80) {~C~+", p);
+            w(g, "~Mint ch = ~zp[~zc - 1] - ~I0;~N");
+        }
+        if (complement) {
+            w(g, "~Mif (ch >= 0 && ch <= ~I2 && (~V0[ch >> 3] & (1 << (ch & 7)))) ");
+        } else {
+            w(g, "~Mif (ch < 0 || ch > ~I2 || !(~V0[ch >> 3] & (1 << (ch & 7)))) ");
+        }
+        wp(g, "~f~N"
+              "~M~i~N"
+              "~-~M} else if (~S1_grouping~S0~S2(~Z~V0, ~I0, ~I1, 0)) ~f~N", p);
+        return;
+    }
     wp(g, "~Mif (~S1_grouping~S0~S2(~Z~V0, ~I0, ~I1, 0)) ~f~C", p);
 }
 
@@ -1,7 +1,7 @@
 /** @file stem.cc
  *  @brief Implementation of Xapian::Stem API class.
  */
-/* Copyright (C) 2007,2008,2010,2011 Olly Betts
+/* Copyright (C) 2007,2008,2010,2011,2012 Olly Betts
  * Copyright (C) 2010 Evgeny Sizikov
  *
  * This program is free software; you can redistribute it and/or
@@ -28,13 +28,63 @@
 #include "steminternal.h"
 
 #include "allsnowballheaders.h"
+#include "unordered_map.h"
 
 #include <string>
+#include <utility>
+#include <vector>
 
 using namespace std;
 
 namespace Xapian {
 
+/** Wrapper which caches the stems returned by another StemImplementation.
+ *
+ *  The cache is direct-mapped - each word can only be stored in the slot its
+ *  hash value selects, and replaces whatever was there before.  So lookups
+ *  are cheap, and if there are more distinct words than slots then common
+ *  words still tend to stay cached rather than all the entries getting
+ *  evicted.
+ */
+class StemCache : public StemImplementation {
+    /// The stemmer to use for words which aren't in the cache.
+    Xapian::Internal::intrusive_ptr<StemImplementation> base;
+
+    /// Cache slots, each holding a word and its stem.
+    vector<pair<string, string> > slots;
+
+    /// Hash function used to pick the slot for a word.
+    std::hash<string> hasher;
+
+  public:
+    StemCache(StemImplementation * base_, unsigned size)
+	: base(base_), slots(size) { }
+
+    StemImplementation * get_base() const { return base.get(); }
+
+    string operator()(const string & word) {
+	string result;
+	stem_word(word, result);
+	return result;
+    }
+
+    void stem_word(const string & word, string & result) {
+	pair<string, string> & slot = slots[hasher(word) % slots.size()];
+	// An empty word is never passed in, so an empty slot never matches.
+	if (slot.first != word) {
+	    // Clear the word first in case stemming throws an exception.
+	    slot.first.resize(0);
+	    base->stem_word(word, slot.second);
+	    slot.first = word;
+	}
+	result = slot.second;
+    }
+
+    string get_description() const {
+	return base->get_description();
+    }
+};
+
 Stem::Stem(const Stem & o) : internal(o.internal) { }
 
 Stem &
@@ -210,6 +260,30 @@ Stem::operator()(const std::string &word) const
     return internal->operator()(word);
 }
 
+void
+Stem::operator()(const std::string &word, std::string &result) const
+{
+    if (!internal.get() || word.empty()) {
+	result = word;
+	return;
+    }
+    internal->stem_word(word, result);
+}
+
+void
+Stem::set_cache_size(unsigned size)
+{
+    if (!internal.get()) return;
+    StemImplementation * base = internal.get();
+    StemCache * cache = dynamic_cast<StemCache *>(base);
+    if (cache) base = cache->get_base();
+    if (size == 0) {
+	internal = base;
+    } else {
+	internal = new StemCache(base, size);
+    }
+}
+
 string
 Stem::get_description() const
 {
@@ -132,6 +132,12 @@ namespace Xapian {
 
 StemImplementation::~StemImplementation() { }
 
+void
+StemImplementation::stem_word(const string & word, string & result)
+{
+    result = operator()(word);
+}
+
 SnowballStemImplementation::~SnowballStemImplementation()
 {
     lose_s(p);
@@ -139,6 +145,14 @@ SnowballStemImplementation::~SnowballStemImplementation()
 
 string
 SnowballStemImplementation::operator()(const string & word)
+{
+    string result;
+    stem_word(word, result);
+    return result;
+}
+
+void
+SnowballStemImplementation::stem_word(const string & word, string & result)
 {
     const symbol * s = reinterpret_cast<const symbol *>(word.data());
     replace_s(0, l, word.size(), s);
@@ -147,7 +161,7 @@ SnowballStemImplementation::operator()(const string & word)
 	// FIXME: Is there a better choice of exception class?
 	throw Xapian::InternalError("stemming exception!");
     }
-    return string(reinterpret_cast<const char *>(p), l);
+    result.assign(reinterpret_cast<const char *>(p), l);
 }
 
 /* Code for character groupings: utf8 cases */
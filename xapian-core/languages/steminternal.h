@@ -135,6 +135,9 @@ class SnowballStemImplementation : public StemImplementation {
     /// Stem the specified word.
     virtual std::string operator()(const std::string & word);
 
+    /// Stem the specified word into result.
+    virtual void stem_word(const std::string & word, std::string & result);
+
     /// Virtual method implemented by the subclass to actually do the work.
     virtual int stem() = 0;
 };
@@ -22,20 +22,46 @@
 
 #include "collapser.h"
 
+#include "heap.h"
 #include "omassert.h"
 
 #include <algorithm>
 
 using namespace std;
 
+/// The smallest hash table we use.
+const size_t MIN_TABLE_SIZE = 16;
+
+/** The most collapse key values to size the hash table for initially.
+ *
+ *  Not every document will have a distinct collapse key value, so we don't
+ *  want to allocate a huge table up front based on the number of matches.
+ */
+const Xapian::doccount MAX_INITIAL_KEYS = 65536;
+
+/// Calculate the hash of a collapse key value (32-bit FNV-1a).
+static inline unsigned
+hash_key(const string & key)
+{
+    unsigned h = 2166136261u;
+    for (string::const_iterator i = key.begin(); i != key.end(); ++i) {
+	h ^= static_cast<unsigned char>(*i);
+	h *= 16777619u;
+    }
+    return h;
+}
+
 collapse_result
 CollapseData::add_item(const Xapian::Internal::MSetItem & item,
 		       Xapian::doccount collapse_max, const MSetCmp & mcmp,
 		       Xapian::Internal::MSetItem & old_item)
 {
     if (items.size() < collapse_max) {
-	items.push_back(item);
-	items.back().collapse_key = string();
+	// We don't need the collapse key in our copy of the item, so avoid
+	// copying it.
+	items.push_back(Xapian::Internal::MSetItem(item.wt, item.did));
+	items.back().sort_key = item.sort_key;
+	items.back().collapse_count = item.collapse_count;
 	return ADDED;
     }
 
@@ -45,7 +71,7 @@ CollapseData::add_item(const Xapian::Internal::MSetItem & item,
 	// Be lazy about calling make_heap - if we see <= collapse_max
 	// items with a particular collapse key, we never need to use
 	// the heap.
-	make_heap(items.begin(), items.end(), mcmp);
+	Heap::make(items.begin(), items.end(), mcmp);
     }
     ++collapse_count;
 
@@ -57,15 +83,59 @@ CollapseData::add_item(const Xapian::Internal::MSetItem & item,
 
     next_best_weight = items.front().wt;
 
-    items.push_back(item);
-    push_heap(items.begin(), items.end(), mcmp);
-    pop_heap(items.begin(), items.end(), mcmp);
-    swap(old_item, items.back());
-    items.pop_back();
+    // Item ranks above the lowest ranked item we're keeping, so replace
+    // that, returning it in old_item.
+    Xapian::Internal::MSetItem new_item(item.wt, item.did);
+    new_item.sort_key = item.sort_key;
+    new_item.collapse_count = item.collapse_count;
+    Heap::replace(items.begin(), items.end(), new_item, mcmp);
+    swap(old_item, new_item);
 
     return REPLACED;
 }
 
+Collapser::Collapser(Xapian::valueno slot_, Xapian::doccount collapse_max_,
+		     Xapian::doccount size_hint)
+    : entry_count(0), no_collapse_key(0), dups_ignored(0),
+      docs_considered(0), slot(slot_), collapse_max(collapse_max_),
+      old_item(0, 0)
+{
+    if (!collapse_max) return;
+    Xapian::doccount keys = min(size_hint, MAX_INITIAL_KEYS);
+    size_t size = MIN_TABLE_SIZE;
+    while (size < size_t(keys) * 2) size *= 2;
+    table.resize(size);
+}
+
+size_t
+Collapser::find_slot(const string & key, unsigned hash) const
+{
+    Assert(!table.empty());
+    size_t mask = table.size() - 1;
+    size_t i = hash & mask;
+    while (table[i].index) {
+	if (table[i].hash == hash && data[table[i].index - 1].get_key() == key)
+	    break;
+	i = (i + 1) & mask;
+    }
+    return i;
+}
+
+void
+Collapser::grow()
+{
+    vector<Slot> new_table(table.size() * 2);
+    size_t mask = new_table.size() - 1;
+    vector<Slot>::const_iterator s;
+    for (s = table.begin(); s != table.end(); ++s) {
+	if (!s->index) continue;
+	size_t i = s->hash & mask;
+	while (new_table[i].index) i = (i + 1) & mask;
+	new_table[i] = *s;
+    }
+    swap(table, new_table);
+}
+
 collapse_result
 Collapser::process(Xapian::Internal::MSetItem & item,
 		   PostList * postlist,
@@ -88,17 +158,21 @@ Collapser::process(Xapian::Internal::MSetItem & item,
 	return EMPTY;
     }
 
-    map<string, CollapseData>::iterator oldkey;
-    oldkey = table.find(item.collapse_key);
-    if (oldkey == table.end()) {
-	// We've not seen this collapse key before.
-	table.insert(make_pair(item.collapse_key, CollapseData(item)));
-	++entry_count;
-	return ADDED;
+    // If we've not seen this collapse key before, create an empty entry for
+    // it in the slot we found, to which add_item() will add item.  This
+    // means we only need to do a single lookup in the table.
+    unsigned hash = hash_key(item.collapse_key);
+    size_t i = find_slot(item.collapse_key, hash);
+    Xapian::doccount index = table[i].index;
+    if (!index) {
+	data.push_back(CollapseData(item.collapse_key));
+	index = data.size();
+	table[i].index = index;
+	table[i].hash = hash;
+	if (data.size() * 2 > table.size()) grow();
     }
-
+    CollapseData & collapse_data = data[index - 1];
     collapse_result res;
-    CollapseData & collapse_data = oldkey->second;
     res = collapse_data.add_item(item, collapse_max, mcmp, old_item);
     if (res == ADDED) {
 	++entry_count;
@@ -112,16 +186,17 @@ Xapian::doccount
 Collapser::get_collapse_count(const string & collapse_key, int percent_cutoff,
 			      double min_weight) const
 {
-    map<string, CollapseData>::const_iterator key = table.find(collapse_key);
+    size_t i = find_slot(collapse_key, hash_key(collapse_key));
     // If a collapse key is present in the MSet, it must be in our table.
-    Assert(key != table.end());
+    Assert(table[i].index);
+    const CollapseData & collapse_data = data[table[i].index - 1];
 
     if (!percent_cutoff) {
 	// The recorded collapse_count is correct.
-	return key->second.get_collapse_count();
+	return collapse_data.get_collapse_count();
     }
 
-    if (key->second.get_next_best_weight() < min_weight) {
+    if (collapse_data.get_next_best_weight() < min_weight) {
 	// We know for certain that all collapsed items would have failed the
 	// percentage cutoff, so collapse_count should be 0.
 	return 0;
@@ -147,10 +222,10 @@ Collapser::get_matches_lower_bound() const
     // many documents.
 #if 0
     Xapian::doccount max_kept = 0;
-    map<string, CollapseData>::const_iterator i;
-    for (i = table.begin(); i != table.end(); ++i) {
-	if (i->second.get_collapse_count() > max_kept) {
-	    max_kept = i->second.get_collapse_count();
+    deque<CollapseData>::const_iterator i;
+    for (i = data.begin(); i != data.end(); ++i) {
+	if (i->get_collapse_count() > max_kept) {
+	    max_kept = i->get_collapse_count();
 	    if (max_kept == collapse_max) {
 		return matches_lower_bound;
 	    }
@@ -26,7 +26,9 @@
 #include "api/omenquireinternal.h"
 #include "api/postlist.h"
 
-#include <map>
+#include <deque>
+#include <string>
+#include <vector>
 
 /// Enumeration reporting how a document was handled by the Collapser.
 typedef enum {
@@ -38,6 +40,9 @@ typedef enum {
 
 /// Class tracking information for a given value of the collapse key.
 class CollapseData {
+    /// The value of the collapse key.
+    std::string key;
+
     /** Currently kept MSet entries for this value of the collapse key.
      *
      *  If collapse_max > 1, then this is a min-heap once items.size()
@@ -56,11 +61,12 @@ class CollapseData {
     Xapian::doccount collapse_count;
 
   public:
-    /// Construct with the given MSetItem @a item.
-    CollapseData(const Xapian::Internal::MSetItem & item)
-	: items(1, item), next_best_weight(0), collapse_count(0) {
-	items[0].collapse_key = string();
-    }
+    /// Construct with no items.
+    explicit CollapseData(const std::string & key_)
+	: key(key_), next_best_weight(0), collapse_count(0) { }
+
+    /// The value of the collapse key.
+    const std::string & get_key() const { return key; }
 
     /** Handle a new MSetItem with this collapse key value.
      *
@@ -85,8 +91,34 @@ class CollapseData {
 
 /// The Collapser class tracks collapse keys and the documents they match.
 class Collapser {
-    /// Map from collapse key values to the items we're keeping for them.
-    std::map<std::string, CollapseData> table;
+    /** The items we're keeping for each collapse key value we've seen.
+     *
+     *  Each collapse key value is stored just once, here.  We use a deque
+     *  so that adding an entry never copies the existing ones.
+     */
+    std::deque<CollapseData> data;
+
+    /// An entry in the hash table.
+    struct Slot {
+	/// Index in @a data plus one, or 0 for an empty slot.
+	Xapian::doccount index;
+
+	/// Hash of the collapse key value.
+	unsigned hash;
+
+	Slot() : index(0), hash(0) { }
+    };
+
+    /** Open-addressing hash table mapping collapse key values to entries
+     *  in @a data.
+     *
+     *  We never need to iterate this in key order.  The size is always a
+     *  power of two, and we keep it at most half full, so linear probing
+     *  finds a key or an empty slot quickly.  The hashes are stored in the
+     *  slots so we rarely need to compare keys, and can grow the table
+     *  without hashing the keys again.
+     */
+    std::vector<Slot> table;
 
     /// How many items we're currently keeping in @a table.
     Xapian::doccount entry_count;
@@ -117,14 +149,32 @@ class Collapser {
     /** The maximum number of items to keep for each collapse key value. */
     Xapian::doccount collapse_max;
 
+    /** Find the hash table slot for collapse key value @a key.
+     *
+     *  @param key	The collapse key value.
+     *  @param hash	The hash of @a key.
+     *
+     *  @return The index of the slot holding @a key, or if it isn't in the
+     *		table, of the empty slot where it should be added.
+     */
+    size_t find_slot(const std::string & key, unsigned hash) const;
+
+    /// Double the size of the hash table.
+    void grow();
+
   public:
     /// Replaced item when REPLACED is returned by @a collapse().
     Xapian::Internal::MSetItem old_item;
 
-    Collapser(Xapian::valueno slot_, Xapian::doccount collapse_max_)
-	: entry_count(0), no_collapse_key(0), dups_ignored(0),
-	  docs_considered(0), slot(slot_), collapse_max(collapse_max_),
-	  old_item(0, 0) { }
+    /** Construct a Collapser.
+     *
+     *  @param slot_		The value slot to collapse on.
+     *  @param collapse_max_	Max no. of items for each collapse key value.
+     *  @param size_hint	How many documents we expect to see, which
+     *				is used to size the hash table.
+     */
+    Collapser(Xapian::valueno slot_, Xapian::doccount collapse_max_,
+	      Xapian::doccount size_hint = 0);
 
     /// Return true if collapsing is active for this match.
     operator bool() const { return collapse_max != 0; }
@@ -156,7 +206,7 @@ class Collapser {
 
     Xapian::doccount get_matches_lower_bound() const;
 
-    bool empty() const { return table.empty(); }
+    bool empty() const { return data.empty(); }
 };
 
 #endif // XAPIAN_INCLUDED_COLLAPSER_H
@@ -151,9 +151,12 @@ ConstDatabaseWrapper::open_document(Xapian::docid did, bool lazy) const
 }
 
 TermList *
-ConstDatabaseWrapper::open_spelling_termlist(const string & word) const
+ConstDatabaseWrapper::open_spelling_termlist(const string & word,
+					     unsigned max_edit_distance,
+					     bool & exhaustive) const
 {
-    return realdb->open_spelling_termlist(word);
+    return realdb->open_spelling_termlist(word, max_edit_distance,
+					  exhaustive);
 }
 
 TermList *
@@ -337,6 +340,7 @@ ConstDatabaseWrapper::replace_document(const string &,
 
 void
 ConstDatabaseWrapper::write_changesets_to_fd(int, const std::string &, bool,
+					     const DBCopyState *,
 					     Xapian::ReplicationInfo *)
 {
     nonconst_access();
@@ -68,7 +68,9 @@ class ConstDatabaseWrapper : public Xapian::Database::Internal {
 				      const string & tname) const;
     Xapian::Document::Internal *
 	open_document(Xapian::docid did, bool lazy) const;
-    TermList * open_spelling_termlist(const string & word) const;
+    TermList * open_spelling_termlist(const string & word,
+				      unsigned max_edit_distance,
+				      bool & exhaustive) const;
     TermList * open_spelling_wordlist() const;
     Xapian::doccount get_spelling_frequency(const string & word) const;
     TermList * open_synonym_termlist(const string & term) const;
@@ -101,7 +103,7 @@ class ConstDatabaseWrapper : public Xapian::Database::Internal {
     void replace_document(Xapian::docid, const Xapian::Document &);
     Xapian::docid replace_document(const string &, const Xapian::Document &);
     void write_changesets_to_fd(int, const std::string &, bool,
-				Xapian::ReplicationInfo *);
+				const DBCopyState *, Xapian::ReplicationInfo *);
     RemoteDatabase * as_remotedatabase();
 };
 
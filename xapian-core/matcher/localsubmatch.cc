@@ -101,9 +101,9 @@ LocalSubMatch::get_postlist_and_term_info(MultiMatch * matcher,
 
 PostList *
 LocalSubMatch::make_synonym_postlist(PostList * or_pl, MultiMatch * matcher,
-				     double factor)
+				     double factor, bool expanded)
 {
-    LOGCALL(MATCH, PostList *, "LocalSubMatch::make_synonym_postlist", or_pl | matcher | factor);
+    LOGCALL(MATCH, PostList *, "LocalSubMatch::make_synonym_postlist", or_pl | matcher | factor | expanded);
     LOGVALUE(MATCH, or_pl->get_termfreq_est());
     AutoPtr<SynonymPostList> res(new SynonymPostList(or_pl, matcher));
     AutoPtr<Xapian::Weight> wt(wt_factory->clone());
@@ -115,7 +115,21 @@ LocalSubMatch::make_synonym_postlist(PostList * or_pl, MultiMatch * matcher,
     // we need to catch the case where all the non-empty subdatabases have
     // failed, so we can't just push this right up to the start of get_mset().
     if (usual(stats->collection_size != 0)) {
-	freqs = or_pl->get_termfreq_est_using_stats(*stats);
+	if (expanded) {
+	    // The terms weren't in the query when the statistics were
+	    // gathered, so estimate from this subdatabase, scaled up to the
+	    // size of the whole collection.
+	    Xapian::doccount db_size = db->get_doccount();
+	    if (db_size) {
+		double scale = double(stats->collection_size) / db_size;
+		freqs.termfreq =
+		    Xapian::doccount(or_pl->get_termfreq_est() * scale + 0.5);
+		if (freqs.termfreq > stats->collection_size)
+		    freqs.termfreq = stats->collection_size;
+	    }
+	} else {
+	    freqs = or_pl->get_termfreq_est_using_stats(*stats);
+	}
     }
     wt->init_(*stats, qlen, factor, freqs.termfreq, freqs.reltermfreq);
 
@@ -92,9 +92,13 @@ class LocalSubMatch : public SubMatch {
 	Xapian::termcount * total_subqs_ptr);
 
     /** Convert a postlist into a synonym postlist.
+     *
+     *  @param expanded	true if @a or_pl is over terms found by expanding
+     *			the query against this subdatabase, so there are no
+     *			collection-wide statistics for them.
      */
     PostList * make_synonym_postlist(PostList * or_pl, MultiMatch * matcher,
-				     double factor);
+				     double factor, bool expanded = false);
 
     Xapian::Weight * make_wt(const std::string & term,
 			     Xapian::termcount wqf,
@@ -30,9 +30,11 @@
 #include "autoptr.h"
 #include "collapser.h"
 #include "debuglog.h"
+#include "heap.h"
 #include "submatch.h"
 #include "localsubmatch.h"
 #include "omassert.h"
+#include "realtime.h"
 #include "api/omenquireinternal.h"
 
 #include "api/emptypostlist.h"
@@ -116,6 +118,39 @@ split_rset_by_db(const Xapian::RSet * rset,
     Assert(subrsets.size() == number_of_subdbs);
 }
 
+#ifdef XAPIAN_HAS_REMOTE_BACKEND
+/** Wait until a reply is ready from one of the remote SubMatches.
+ *
+ *  @param leaves	The SubMatches.
+ *  @param is_remote	Which of @a leaves are remote.
+ *  @param done		Which of @a leaves we're no longer waiting for.
+ *  @param until	Don't wait beyond this time, or 0 for no limit.
+ *
+ *  @return true if a reply is ready, false if we waited for the remote
+ *	    timeout (or until @a until) without one arriving.
+ */
+static bool
+wait_for_remote_sub_match(const vector<intrusive_ptr<SubMatch> > & leaves,
+			  const vector<bool> & is_remote,
+			  const vector<bool> & done,
+			  double until = 0.0)
+{
+    vector<RemoteSubMatch *> waiting;
+    for (size_t leaf = 0; leaf < leaves.size(); ++leaf) {
+	if (done[leaf] || !is_remote[leaf] || !leaves[leaf].get()) continue;
+	waiting.push_back(static_cast<RemoteSubMatch*>(leaves[leaf].get()));
+    }
+    return RemoteSubMatch::wait_for_any(waiting, until);
+}
+
+/** How long to wait beyond the time limit for remote match results.
+ *
+ *  The remote servers stop their matches at the time limit, so this allows
+ *  time for the results to reach us.
+ */
+static const double REMOTE_RESULTS_GRACE = 0.05;
+#endif
+
 /** Prepare some SubMatches.
  *
  *  This calls the prepare_match() method on each SubMatch object, causing them
@@ -123,23 +158,27 @@ split_rset_by_db(const Xapian::RSet * rset,
  *
  *  This method is rather complicated in order to handle remote matches
  *  efficiently.  Instead of simply calling "prepare_match()" on each submatch
- *  and waiting for it to return, it first calls "prepare_match(true)" on each
+ *  and waiting for it to return, it calls "prepare_match(true)" on each
  *  submatch.  If any of these calls return false, indicating that the required
- *  information has not yet been received from the server, the method will try
- *  those which returned false again, passing "false" as a parameter to
- *  indicate that they should block until the information is ready.
+ *  information has not yet been received from the server, the method waits
+ *  until the information from any of those servers arrives, and then tries
+ *  those which returned false again.  If nothing arrives within the remote
+ *  timeout, it passes "false" as a parameter to indicate that they should
+ *  block until the information is ready (or report the timeout).
  *
  *  This should improve performance in the case of mixed local-and-remote
  *  searches - the local searchers will all fetch their statistics from disk
- *  without waiting for the remote searchers, so as soon as the remote searcher
- *  statistics arrive, we can move on to the next step.
+ *  without waiting for the remote searchers, and the statistics from each
+ *  remote searcher are handled as soon as they arrive, whatever order the
+ *  servers reply in.
  */
 static void
 prepare_sub_matches(vector<intrusive_ptr<SubMatch> > & leaves,
+		    const vector<bool> & is_remote,
 		    Xapian::ErrorHandler * errorhandler,
 		    Xapian::Weight::Internal & stats)
 {
-    LOGCALL_STATIC_VOID(MATCH, "prepare_sub_matches", leaves | errorhandler | stats);
+    LOGCALL_STATIC_VOID(MATCH, "prepare_sub_matches", leaves | is_remote | errorhandler | stats);
     // We use a vector<bool> to track which SubMatches we're already prepared.
     vector<bool> prepared;
     prepared.resize(leaves.size(), false);
@@ -165,9 +204,15 @@ prepare_sub_matches(vector<intrusive_ptr<SubMatch> > & leaves,
 		--unprepared;
 	    }
 	}
-	// Use blocking IO on subsequent passes, so that we don't go into
-	// a tight loop.
+	if (!unprepared) break;
+#ifdef XAPIAN_HAS_REMOTE_BACKEND
+	// Wait for the next reply to arrive, rather than going into a tight
+	// loop.  If none arrives, use blocking IO for the next pass.
+	nowait = wait_for_remote_sub_match(leaves, is_remote, prepared);
+#else
+	(void)is_remote;
 	nowait = false;
+#endif
     }
 }
 
@@ -211,22 +256,29 @@ MultiMatch::MultiMatch(const Xapian::Database &db_,
 		       Xapian::valueno sort_key_,
 		       Xapian::Enquire::Internal::sort_setting sort_by_,
 		       bool sort_value_forward_,
+		       bool docids_in_rank_order_,
 		       Xapian::ErrorHandler * errorhandler_,
 		       Xapian::Weight::Internal & stats,
 		       const Xapian::Weight * weight_,
 		       const vector<Xapian::MatchSpy *> & matchspies_,
-		       bool have_sorter, bool have_mdecider)
+		       bool have_sorter, bool have_mdecider,
+		       bool have_cursor)
 	: db(db_), query(query_),
 	  collapse_max(collapse_max_), collapse_key(collapse_key_),
 	  percent_cutoff(percent_cutoff_), weight_cutoff(weight_cutoff_),
 	  order(order_),
 	  sort_key(sort_key_), sort_by(sort_by_),
 	  sort_value_forward(sort_value_forward_),
+	  // If tied documents are ranked in descending docid order, the
+	  // documents we'd skip by stopping early can rank above those
+	  // we've seen.
+	  docids_in_rank_order(docids_in_rank_order_ &&
+			       order_ != Xapian::Enquire::DESCENDING),
 	  errorhandler(errorhandler_), weight(weight_),
 	  is_remote(db.internal.size()),
 	  matchspies(matchspies_)
 {
-    LOGCALL_CTOR(MATCH, "MultiMatch", db_ | query_ | qlen | omrset | collapse_max_ | collapse_key_ | percent_cutoff_ | weight_cutoff_ | int(order_) | sort_key_ | int(sort_by_) | sort_value_forward_ | errorhandler_ | stats | weight_ | matchspies_ | have_sorter | have_mdecider);
+    LOGCALL_CTOR(MATCH, "MultiMatch", db_ | query_ | qlen | omrset | collapse_max_ | collapse_key_ | percent_cutoff_ | weight_cutoff_ | int(order_) | sort_key_ | int(sort_by_) | sort_value_forward_ | docids_in_rank_order_ | errorhandler_ | stats | weight_ | matchspies_ | have_sorter | have_mdecider | have_cursor);
 
     if (query.empty()) return;
 
@@ -249,8 +301,12 @@ MultiMatch::MultiMatch(const Xapian::Database &db_,
 		if (have_mdecider) {
 		    throw Xapian::UnimplementedError("Xapian::MatchDecider not supported for the remote backend");
 		}
+		if (have_cursor) {
+		    throw Xapian::UnimplementedError("Enquire::set_cursor() not supported for the remote backend");
+		}
 		rem_db->set_query(query, qlen, collapse_max, collapse_key,
 				  order, sort_key, sort_by, sort_value_forward,
+				  docids_in_rank_order,
 				  percent_cutoff, weight_cutoff, weight,
 				  subrsets[i], matchspies);
 		bool decreasing_relevance =
@@ -264,6 +320,7 @@ MultiMatch::MultiMatch(const Xapian::Database &db_,
 	    // Avoid unused parameter warnings.
 	    (void)have_sorter;
 	    (void)have_mdecider;
+	    (void)have_cursor;
 	    smatch = new LocalSubMatch(subdb, query, qlen, subrsets[i], weight);
 #endif /* XAPIAN_HAS_REMOTE_BACKEND */
 	} catch (Xapian::Error & e) {
@@ -277,7 +334,7 @@ MultiMatch::MultiMatch(const Xapian::Database &db_,
     }
 
     stats.mark_wanted_terms(query);
-    prepare_sub_matches(leaves, errorhandler, stats);
+    prepare_sub_matches(leaves, is_remote, errorhandler, stats);
     stats.set_bounds_from_db(db);
 }
 
@@ -305,9 +362,11 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 		     Xapian::MSet & mset,
 		     const Xapian::Weight::Internal & stats,
 		     const Xapian::MatchDecider *mdecider,
-		     const Xapian::KeyMaker *sorter)
+		     const Xapian::KeyMaker *sorter,
+		     const Xapian::Internal::MSetItem *cursor,
+		     double end_time)
 {
-    LOGCALL_VOID(MATCH, "MultiMatch::get_mset", first | maxitems | check_at_least | Literal("mset") | stats | Literal("mdecider") | Literal("sorter"));
+    LOGCALL_VOID(MATCH, "MultiMatch::get_mset", first | maxitems | check_at_least | Literal("mset") | stats | Literal("mdecider") | Literal("sorter") | Literal("cursor") | end_time);
     AssertRel(check_at_least,>=,maxitems);
 
     if (query.empty()) {
@@ -319,12 +378,39 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
     Assert(!leaves.empty());
 
 #ifdef XAPIAN_HAS_REMOTE_BACKEND
+    // The time to give up waiting for remote match results.
+    double remote_end_time = 0.0;
+    if (end_time != 0.0) {
+	remote_end_time = end_time + REMOTE_RESULTS_GRACE;
+	for (size_t i = 0; i != leaves.size(); ++i) {
+	    if (is_remote[i] && leaves[i].get())
+		static_cast<RemoteSubMatch*>(leaves[i].get())->set_end_time(end_time);
+	}
+    }
+
     // If there's only one database and it's remote, we can just unserialise
     // its MSet and return that.
     if (leaves.size() == 1 && is_remote[0]) {
 	RemoteSubMatch * rem_match;
 	rem_match = static_cast<RemoteSubMatch*>(leaves[0].get());
 	rem_match->start_match(first, maxitems, check_at_least, stats);
+	if (remote_end_time != 0.0 &&
+	    !wait_for_remote_sub_match(leaves, is_remote,
+				       vector<bool>(1, false),
+				       remote_end_time) &&
+	    RealTime::now() >= remote_end_time) {
+	    rem_match->abandon_match();
+	    mset = Xapian::MSet(new Xapian::MSet::Internal());
+	    mset.internal->firstitem = first;
+	    mset.internal->timed_out = true;
+	    if (errorhandler) {
+		Xapian::NetworkTimeoutError e("Remote match results didn't "
+					      "arrive within the time limit",
+					      rem_match->get_context());
+		(*errorhandler)(e);
+	    }
+	    return;
+	}
 	rem_match->get_mset(mset);
 	return;
     }
@@ -361,35 +447,88 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
     // number of matching documents which is higher than the number of
     // documents it returns (because it wasn't asked for more documents).
     Xapian::doccount definite_matches_not_seen = 0;
-    for (size_t i = 0; i != leaves.size(); ++i) {
-	PostList *pl;
-	try {
-	    pl = leaves[i]->get_postlist_and_term_info(this,
-						       termfreqandwts_ptr,
-						       &total_subqs);
-	    if (termfreqandwts_ptr && !termfreqandwts.empty())
-		termfreqandwts_ptr = NULL;
-	    if (is_remote[i]) {
-		if (pl->get_termfreq_min() > first + maxitems) {
-		    LOGLINE(MATCH, "Found " <<
-				   pl->get_termfreq_min() - (first + maxitems)
-				   << " definite matches in remote submatch "
-				   "which aren't passed to local match");
-		    definite_matches_not_seen += pl->get_termfreq_min();
-		    definite_matches_not_seen -= first + maxitems;
+    // Set if the match is cut short by the time limit, either here or in a
+    // remote submatch.
+    bool timed_out = false;
+    // Handle the remote MSets in the order they arrive, rather than waiting
+    // for each server in turn.
+    postlists.resize(leaves.size(), NULL);
+    vector<bool> got_postlist(leaves.size(), false);
+    size_t remaining = leaves.size();
+    bool nowait = true;
+    while (remaining) {
+	for (size_t i = 0; i != leaves.size(); ++i) {
+	    if (got_postlist[i]) continue;
+#ifdef XAPIAN_HAS_REMOTE_BACKEND
+	    if (nowait && is_remote[i] && leaves[i].get() &&
+		!static_cast<RemoteSubMatch*>(leaves[i].get())->ready_to_read())
+		continue;
+#endif
+	    PostList *pl;
+	    try {
+		pl = leaves[i]->get_postlist_and_term_info(this,
+							   termfreqandwts_ptr,
+							   &total_subqs);
+		if (termfreqandwts_ptr && !termfreqandwts.empty())
+		    termfreqandwts_ptr = NULL;
+		if (is_remote[i]) {
+#ifdef XAPIAN_HAS_REMOTE_BACKEND
+		    RemoteSubMatch * rem_match;
+		    rem_match = static_cast<RemoteSubMatch*>(leaves[i].get());
+		    if (rem_match->get_timed_out()) timed_out = true;
+#endif
+		    if (pl->get_termfreq_min() > first + maxitems) {
+			LOGLINE(MATCH, "Found " <<
+				       pl->get_termfreq_min() - (first + maxitems)
+				       << " definite matches in remote submatch "
+				       "which aren't passed to local match");
+			definite_matches_not_seen += pl->get_termfreq_min();
+			definite_matches_not_seen -= first + maxitems;
+		    }
 		}
+	    } catch (Xapian::Error & e) {
+		if (!errorhandler) throw;
+		LOGLINE(EXCEPTION, "Calling error handler for "
+				   "get_term_info() on a SubMatch.");
+		(*errorhandler)(e);
+		// FIXME: check if *ALL* the remote servers have failed!
+		// Continue match without this sub-match.
+		leaves[i] = NULL;
+		pl = new EmptyPostList;
 	    }
-	} catch (Xapian::Error & e) {
-	    if (!errorhandler) throw;
-	    LOGLINE(EXCEPTION, "Calling error handler for "
-			       "get_term_info() on a SubMatch.");
-	    (*errorhandler)(e);
-	    // FIXME: check if *ALL* the remote servers have failed!
-	    // Continue match without this sub-match.
-	    leaves[i] = NULL;
-	    pl = new EmptyPostList;
+	    postlists[i] = pl;
+	    got_postlist[i] = true;
+	    --remaining;
 	}
-	postlists.push_back(pl);
+	if (!remaining) break;
+#ifdef XAPIAN_HAS_REMOTE_BACKEND
+	nowait = wait_for_remote_sub_match(leaves, is_remote, got_postlist,
+					   remote_end_time);
+	if (!nowait && remote_end_time != 0.0 &&
+	    RealTime::now() >= remote_end_time) {
+	    // Carry on without the remote matches which haven't replied in
+	    // time.  Only remote submatches can still be outstanding here.
+	    for (size_t i = 0; i != leaves.size(); ++i) {
+		if (got_postlist[i]) continue;
+		RemoteSubMatch * rem_match;
+		rem_match = static_cast<RemoteSubMatch*>(leaves[i].get());
+		rem_match->abandon_match();
+		Xapian::NetworkTimeoutError e("Remote match results didn't "
+					      "arrive within the time limit",
+					      rem_match->get_context());
+		leaves[i] = NULL;
+		postlists[i] = new EmptyPostList;
+		got_postlist[i] = true;
+		--remaining;
+		timed_out = true;
+		if (errorhandler) {
+		    LOGLINE(EXCEPTION, "Calling error handler for remote "
+				       "match which timed out.");
+		    (*errorhandler)(e);
+		}
+	    }
+	}
+#endif
     }
     Assert(!postlists.empty());
 
@@ -435,8 +574,8 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
     Xapian::doccount matches_lower_bound = 0;
     Xapian::doccount matches_estimated   = pl->get_termfreq_est();
 
-    if (mdecider == NULL) {
-	// If we have a match decider, the lower bound must be
+    if (mdecider == NULL && cursor == NULL) {
+	// If we have a match decider or a cursor, the lower bound must be
 	// set to 0 as we could discard all hits.  Otherwise set it to the
 	// minimum number of entries which the postlist could return.
 	matches_lower_bound = pl->get_termfreq_min();
@@ -477,6 +616,7 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 					   max_possible, greatest_wt, items,
 					   termfreqandwts,
 					   0));
+	mset.internal->timed_out = timed_out;
 	return;
     }
 
@@ -485,10 +625,15 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
     // Number of documents denied by the decider.
     Xapian::doccount decider_denied = 0;
 
+    // Number of documents compared against the cursor.
+    Xapian::doccount cursor_considered = 0;
+    // Number of documents skipped because they don't rank below the cursor.
+    Xapian::doccount cursor_skipped = 0;
+
     // Set max number of results that we want - this is used to decide
     // when to throw away unwanted items.
     Xapian::doccount max_msize = first + maxitems;
-    items.reserve(max_msize + 1);
+    items.reserve(max_msize);
 
     // Tracks the minimum item currently eligible for the MSet - we compare
     // candidate items against this.
@@ -504,7 +649,7 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
     percent_cutoff_factor -= DBL_EPSILON;
 
     // Object to handle collapsing.
-    Collapser collapser(collapse_key, collapse_max);
+    Collapser collapser(collapse_key, collapse_max, matches_estimated);
 
     /// Comparison functor for sorting MSet
     bool sort_forward = (order != Xapian::Enquire::DESCENDING);
@@ -525,9 +670,36 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
     // Is the mset a valid heap?
     bool is_heap = false;
 
+    // How many more candidates to consider before checking the time.
+    unsigned until_time_check = 0;
+
     while (true) {
 	bool pushback;
 
+	if (rare(end_time != 0.0) && until_time_check-- == 0) {
+	    // Reading the clock for every candidate would slow down the match
+	    // noticeably, so only check it every so often.
+	    until_time_check = 63;
+	    if (RealTime::now() >= end_time) {
+		LOGLINE(MATCH, "*** TERMINATING EARLY (time limit)");
+		timed_out = true;
+		break;
+	    }
+	}
+
+	if (rare(docids_in_rank_order)) {
+	    // Documents which we haven't seen yet can't rank higher than
+	    // those we have, so once the proto-mset is full and we've checked
+	    // enough documents, we're done.  In the multi database case,
+	    // MergePostList processes each database in turn so the docids
+	    // won't arrive in order.
+	    if (items.size() >= max_msize && docs_matched >= check_at_least &&
+		leaves.size() == 1) {
+		LOGLINE(MATCH, "*** TERMINATING EARLY (docids in rank order)");
+		break;
+	    }
+	}
+
 	if (rare(recalculate_w_max)) {
 	    if (min_weight > 0.0) {
 		if (rare(getorrecalc_maxweight(pl.get()) < min_weight)) {
@@ -583,7 +755,26 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 	    } else {
 		new_item.sort_key = vsdoc.get_value(sort_key);
 	    }
+	}
+
+	if (cursor) {
+	    // Skip documents which don't rank below the cursor - these were
+	    // returned by an earlier page of results.  If sort_by is VAL,
+	    // then new_item.wt won't yet be set, but that doesn't matter
+	    // since it's not used by the sort function.
+	    ++cursor_considered;
+	    if (!mcmp(*cursor, new_item)) {
+		LOGLINE(MATCH, "Skipping candidate which doesn't rank below the cursor");
+		++cursor_skipped;
+		// Still track the greatest weight so that percentages are
+		// consistent between pages.
+		if (!calculated_weight) wt = pl->get_weight();
+		if (wt > greatest_wt) goto new_greatest_weight;
+		continue;
+	    }
+	}
 
+	if (sort_by != REL) {
 	    // We're sorting by value (in part at least), so compare the item
 	    // against the lowest currently in the proto-mset.  If sort_by is
 	    // VAL, then new_item.wt won't yet be set, but that doesn't
@@ -591,7 +782,7 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 	    if (!mcmp(new_item, min_item)) {
 		if (mdecider == NULL && !collapser) {
 		    // Document was definitely suitable for mset - no more
-		    // processing needed.
+		    // processing needed (any cursor was checked above).
 		    LOGLINE(MATCH, "Making note of match item which sorts lower than min_item");
 		    ++docs_matched;
 		    if (!calculated_weight) wt = pl->get_weight();
@@ -689,7 +880,7 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 			    // elt is bigger, so we just swap down the tree).
 			    // FIXME: implement this, and clean up is_heap
 			    // handling
-			    *i = new_item;
+			    swap(*i, new_item);
 			    pushback = false;
 			    is_heap = false;
 			    break;
@@ -703,19 +894,20 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 	if (pushback) {
 	    ++docs_matched;
 	    if (items.size() >= max_msize) {
-		items.push_back(new_item);
 		if (!is_heap) {
 		    is_heap = true;
-		    make_heap(items.begin(), items.end(), mcmp);
-		} else {
-		    push_heap<vector<Xapian::Internal::MSetItem>::iterator,
-			      MSetCmp>(items.begin(), items.end(), mcmp);
+		    Heap::make(items.begin(), items.end(), mcmp);
+		    if (!items.empty()) min_item = items.front();
+		}
+		// The proto-mset is full, so the new item only goes in if it
+		// ranks above the current lowest ranking item, which it then
+		// replaces.  Heap::replace() moves items by swapping, so any
+		// sort keys or collapse keys aren't copied as the heap is
+		// reordered.
+		if (!items.empty() && mcmp(new_item, items.front())) {
+		    Heap::replace(items.begin(), items.end(), new_item, mcmp);
+		    min_item = items.front();
 		}
-		pop_heap<vector<Xapian::Internal::MSetItem>::iterator,
-			 MSetCmp>(items.begin(), items.end(), mcmp);
-		items.pop_back();
-
-		min_item = items.front();
 		if (sort_by == REL || sort_by == REL_VAL) {
 		    if (docs_matched >= check_at_least) {
 			if (sort_by == REL) {
@@ -743,7 +935,9 @@ MultiMatch::get_mset(Xapian::doccount first, Xapian::doccount maxitems,
 		    break;
 		}
 	    } else {
-		items.push_back(new_item);
+		// Swap new_item into place to avoid copying its keys.
+		items.push_back(Xapian::Internal::MSetItem(0, 0));
+		swap(items.back(), new_item);
 		is_heap = false;
 		if (sort_by == REL && items.size() == max_msize) {
 		    if (docs_matched >= check_at_least) {
@@ -788,12 +982,10 @@ new_greatest_weight:
 		    min_weight = w;
 		    if (!is_heap) {
 			is_heap = true;
-			make_heap<vector<Xapian::Internal::MSetItem>::iterator,
-				  MSetCmp>(items.begin(), items.end(), mcmp);
+			Heap::make(items.begin(), items.end(), mcmp);
 		    }
 		    while (!items.empty() && items.front().wt < min_weight) {
-			pop_heap<vector<Xapian::Internal::MSetItem>::iterator,
-				 MSetCmp>(items.begin(), items.end(), mcmp);
+			Heap::pop(items.begin(), items.end(), mcmp);
 			Assert(items.back().wt < min_weight);
 			items.pop_back();
 		    }
@@ -839,12 +1031,10 @@ new_greatest_weight:
 	    double min_wt = percent_cutoff_factor / percent_scale;
 	    if (!is_heap) {
 		is_heap = true;
-		make_heap<vector<Xapian::Internal::MSetItem>::iterator,
-			  MSetCmp>(items.begin(), items.end(), mcmp);
+		Heap::make(items.begin(), items.end(), mcmp);
 	    }
 	    while (!items.empty() && items.front().wt < min_wt) {
-		pop_heap<vector<Xapian::Internal::MSetItem>::iterator,
-			 MSetCmp>(items.begin(), items.end(), mcmp);
+		Heap::pop(items.begin(), items.end(), mcmp);
 		Assert(items.back().wt < min_wt);
 		items.pop_back();
 	    }
@@ -872,7 +1062,7 @@ new_greatest_weight:
     Xapian::doccount uncollapsed_lower_bound = matches_lower_bound;
     Xapian::doccount uncollapsed_upper_bound = matches_upper_bound;
     Xapian::doccount uncollapsed_estimated = matches_estimated;
-    if (items.size() < max_msize) {
+    if (items.size() < max_msize && !timed_out) {
 	// We have fewer items in the mset than we tried to get for it, so we
 	// must have all the matches in it.
 	LOGLINE(MATCH, "items.size() = " << items.size() <<
@@ -883,7 +1073,7 @@ new_greatest_weight:
 	    = items.size();
 	if (collapser && matches_lower_bound > uncollapsed_lower_bound)
 	    uncollapsed_lower_bound = matches_lower_bound;
-    } else if (!collapser && docs_matched < check_at_least) {
+    } else if (!collapser && docs_matched < check_at_least && !timed_out) {
 	// We have seen fewer matches than we checked for, so we must have seen
 	// all the matches.
 	LOGLINE(MATCH, "Setting bounds equal");
@@ -927,7 +1117,7 @@ new_greatest_weight:
 		    ", matches_upper_bound=" << matches_upper_bound);
 	}
 
-	if (mdecider) {
+	if (mdecider || cursor) {
 	    if (!percent_cutoff) {
 		if (!collapser) {
 		    // We're not collapsing or doing a percentage cutoff, so
@@ -946,12 +1136,21 @@ new_greatest_weight:
 		estimate_scale *= accept_rate;
 	    }
 
+	    // Similarly, documents skipped because of the cursor act as if
+	    // they were denied by a match decider.
+	    if (cursor_considered > 0) {
+		double accept = double(cursor_considered - cursor_skipped);
+		double accept_rate = accept / double(cursor_considered);
+		estimate_scale *= accept_rate;
+	    }
+
 	    // If a document is denied by a match decider, it is not possible
 	    // for it to found to be a duplicate, so it is safe to also reduce
 	    // the upper bound by the number of documents denied by a match
-	    // decider.
-	    matches_upper_bound -= decider_denied;
-	    if (collapser) uncollapsed_upper_bound -= decider_denied;
+	    // decider.  The same goes for documents skipped by the cursor.
+	    matches_upper_bound -= decider_denied + cursor_skipped;
+	    if (collapser)
+		uncollapsed_upper_bound -= decider_denied + cursor_skipped;
 	}
 
 	if (percent_cutoff) {
@@ -991,7 +1190,7 @@ new_greatest_weight:
 	       	matches_estimated = matches_lower_bound;
 	}
 
-	if (collapser || mdecider) {
+	if (collapser || mdecider || cursor) {
 	    LOGLINE(MATCH, "Clamping estimate between bounds: "
 		    "matches_lower_bound = " << matches_lower_bound <<
 		    ", matches_estimated = " << matches_estimated <<
@@ -1007,7 +1206,7 @@ new_greatest_weight:
 		matches_estimated = docs_matched;
 	}
 
-	if (collapser && !mdecider && !percent_cutoff) {
+	if (collapser && !mdecider && !cursor && !percent_cutoff) {
 	    AssertRel(docs_matched,<=,uncollapsed_upper_bound);
 	    if (docs_matched > uncollapsed_lower_bound)
 		uncollapsed_lower_bound = docs_matched;
@@ -1102,4 +1301,93 @@ new_greatest_weight:
 				       max_possible, greatest_wt, items,
 				       termfreqandwts,
 				       percent_scale));
+    mset.internal->timed_out = timed_out;
+}
+
+void
+MultiMatch::visit_matches(Xapian::MatchVisitor & visitor,
+			  const Xapian::Weight::Internal & stats)
+{
+    LOGCALL_VOID(MATCH, "MultiMatch::visit_matches", Literal("visitor") | stats);
+
+    if (query.empty()) return;
+
+    Assert(!leaves.empty());
+
+    // Enquire::Internal::visit_matches() has already rejected any remote
+    // databases.
+    size_t n_subdbs = leaves.size();
+
+    // For each sub-database we run its postlist tree separately, and merge
+    // the results by docid.  Each sub-database gets its own
+    // ValueStreamDocument so that the value streams only ever move forwards.
+    vector<PostList *> postlists(n_subdbs, static_cast<PostList *>(NULL));
+    vector<ValueStreamDocument *> vsdocs;
+    vector<Xapian::Document> docs;
+    vsdocs.reserve(n_subdbs);
+    docs.reserve(n_subdbs);
+    try {
+	Xapian::doccount doccount = db.get_doccount();
+	for (size_t i = 0; i != n_subdbs; ++i) {
+	    ValueStreamDocument * vsdoc = new ValueStreamDocument(db);
+	    docs.push_back(Xapian::Document(vsdoc));
+	    vsdocs.push_back(vsdoc);
+	    if (i) vsdoc->new_subdb(i);
+
+	    if (!leaves[i].get()) continue;
+	    PostList * pl;
+	    try {
+		Xapian::termcount total_subqs = 0;
+		leaves[i]->start_match(0, doccount, doccount, stats);
+		pl = leaves[i]->get_postlist_and_term_info(this, NULL,
+							   &total_subqs);
+	    } catch (Xapian::Error & e) {
+		if (!errorhandler) throw;
+		LOGLINE(EXCEPTION, "Calling error handler for "
+				   "get_term_info() on a SubMatch.");
+		(*errorhandler)(e);
+		// Continue match without this sub-match.
+		leaves[i] = NULL;
+		continue;
+	    }
+	    postlists[i] = pl;
+	    next_handling_prune(postlists[i], 0.0, this);
+	    if (postlists[i]->at_end()) {
+		delete postlists[i];
+		postlists[i] = NULL;
+	    }
+	}
+
+	while (true) {
+	    // Find the sub-database with the lowest current docid.  We expect
+	    // the number of sub-databases to be small, so a linear scan is
+	    // fine.
+	    size_t best = n_subdbs;
+	    Xapian::docid best_did = 0;
+	    for (size_t i = 0; i != n_subdbs; ++i) {
+		if (!postlists[i]) continue;
+		Xapian::docid did = (postlists[i]->get_docid() - 1) * n_subdbs
+				    + i + 1;
+		if (best == n_subdbs || did < best_did) {
+		    best = i;
+		    best_did = did;
+		}
+	    }
+	    if (best == n_subdbs) break;
+
+	    vsdocs[best]->set_document(best_did);
+	    visitor(docs[best]);
+
+	    next_handling_prune(postlists[best], 0.0, this);
+	    if (postlists[best]->at_end()) {
+		delete postlists[best];
+		postlists[best] = NULL;
+	    }
+	}
+    } catch (...) {
+	for (size_t i = 0; i != n_subdbs; ++i) {
+	    delete postlists[i];
+	}
+	throw;
+    }
 }
@@ -57,6 +57,12 @@ class MultiMatch
 
 	bool sort_value_forward;
 
+	/** Does ascending docid order match the order we're ranking in?
+	 *
+	 *  If true, we can stop once we've found enough matches.
+	 */
+	bool docids_in_rank_order;
+
 	/// ErrorHandler
 	Xapian::ErrorHandler * errorhandler;
 
@@ -93,12 +99,16 @@ class MultiMatch
 	 *  @param query     The query
 	 *  @param qlen      The query length
 	 *  @param omrset    The relevance set (or NULL for no RSet)
+	 *  @param docids_in_rank_order_ Should the match stop once it has
+	 *			enough matches?  See
+	 *			Enquire::set_docids_in_rank_order().
 	 *  @param errorhandler Errorhandler object
 	 *  @param stats     The stats object to add our stats to.
 	 *  @param wtscheme  Weighting scheme
 	 *  @param matchspies_ Any the MatchSpy objects in use.
 	 *  @param have_sorter Is there a sorter in use?
 	 *  @param have_mdecider Is there a Xapian::MatchDecider in use?
+	 *  @param have_cursor Is there a cursor in use?
 	 */
 	MultiMatch(const Xapian::Database &db_,
 		   const Xapian::Query & query,
@@ -112,15 +122,21 @@ class MultiMatch
 		   Xapian::valueno sort_key_,
 		   Xapian::Enquire::Internal::sort_setting sort_by_,
 		   bool sort_value_forward_,
+		   bool docids_in_rank_order_,
 		   Xapian::ErrorHandler * errorhandler,
 		   Xapian::Weight::Internal & stats,
 		   const Xapian::Weight *wtscheme,
 		   const vector<Xapian::MatchSpy *> & matchspies_,
-		   bool have_sorter, bool have_mdecider);
+		   bool have_sorter, bool have_mdecider,
+		   bool have_cursor = false);
 
 	/** Run the match and generate an MSet object.
 	 *
 	 *  @param sorter    Xapian::KeyMaker functor (or NULL for no KeyMaker)
+	 *  @param cursor    Only documents which rank below this item are
+	 *		     considered (or NULL for no cursor).
+	 *  @param end_time  Stop the match at this time (as returned by
+	 *		     RealTime::now()), or 0 for no time limit.
 	 */
 	void get_mset(Xapian::doccount first,
 		      Xapian::doccount maxitems,
@@ -128,7 +144,19 @@ class MultiMatch
 		      Xapian::MSet & mset,
 		      const Xapian::Weight::Internal & stats,
 		      const Xapian::MatchDecider * mdecider,
-		      const Xapian::KeyMaker * sorter);
+		      const Xapian::KeyMaker * sorter,
+		      const Xapian::Internal::MSetItem * cursor = NULL,
+		      double end_time = 0.0);
+
+	/** Pass every matching document to a visitor, in docid order.
+	 *
+	 *  No weights are calculated, so this should be used with BoolWeight.
+	 *
+	 *  @param visitor   The functor to call for each matching document.
+	 *  @param stats     The collated statistics.
+	 */
+	void visit_matches(Xapian::MatchVisitor & visitor,
+			   const Xapian::Weight::Internal & stats);
 
 	/** Called by postlists to indicate that they've rearranged themselves
 	 *  and the maxweight now possible is smaller.
@@ -0,0 +1,324 @@
+/** @file multiorpostlist.cc
+ * @brief N-way OR postlist using a heap
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "multiorpostlist.h"
+
+#include "debuglog.h"
+#include "multimatch.h"
+#include "omassert.h"
+
+using namespace std;
+
+MultiOrPostList::~MultiOrPostList()
+{
+    vector<SubPostList>::const_iterator i;
+    for (i = plist.begin(); i != plist.end(); ++i) {
+	delete i->pl;
+    }
+}
+
+void
+MultiOrPostList::sift_down(size_t i)
+{
+    const size_t n = plist.size();
+    if (i >= n) return;
+    SubPostList item = plist[i];
+    while (true) {
+	size_t child = 2 * i + 1;
+	if (child >= n) break;
+	if (child + 1 < n && plist[child + 1].did < plist[child].did)
+	    ++child;
+	if (item.did <= plist[child].did) break;
+	plist[i] = plist[child];
+	i = child;
+    }
+    plist[i] = item;
+}
+
+void
+MultiOrPostList::make_heap()
+{
+    for (size_t i = plist.size() / 2; i-- > 0; ) {
+	sift_down(i);
+    }
+}
+
+bool
+MultiOrPostList::handle_result(size_t i, PostList * res)
+{
+    SubPostList & sub = plist[i];
+    if (res) {
+	delete sub.pl;
+	sub.pl = res;
+	matcher->recalc_maxweight();
+    }
+    if (!sub.pl->at_end()) {
+	sub.did = sub.pl->get_docid();
+	return true;
+    }
+
+    // Recalculating the maxweight visits every sub-postlist, so only do so
+    // if it could actually change.
+    bool weighted = (sub.pl->get_maxweight() != 0.0);
+    delete sub.pl;
+    sub = plist.back();
+    plist.pop_back();
+    if (weighted)
+	matcher->recalc_maxweight();
+    return false;
+}
+
+PostList *
+MultiOrPostList::update_docid()
+{
+    if (plist.size() == 1) {
+	// Only one sub-postlist is left, so replace ourselves with it.
+	PostList * pl = plist[0].pl;
+	plist.clear();
+	did = 0;
+	return pl;
+    }
+    did = plist.empty() ? 0 : plist[0].did;
+    return NULL;
+}
+
+Xapian::doccount
+MultiOrPostList::get_termfreq_min() const
+{
+    // The sub-postlists could all overlap entirely, so the OR is only
+    // guaranteed to match as many documents as the largest of them.
+    Xapian::doccount result = 0;
+    vector<SubPostList>::const_iterator i;
+    for (i = plist.begin(); i != plist.end(); ++i) {
+	Xapian::doccount tf_min = i->pl->get_termfreq_min();
+	if (tf_min > result)
+	    result = tf_min;
+    }
+    return result;
+}
+
+Xapian::doccount
+MultiOrPostList::get_termfreq_max() const
+{
+    // Maximum is if all sub-postlists are disjoint.
+    Xapian::doccount result = 0;
+    vector<SubPostList>::const_iterator i;
+    for (i = plist.begin(); i != plist.end(); ++i) {
+	Xapian::doccount old_result = result;
+	result += i->pl->get_termfreq_max();
+	// Catch overflowing the type too.
+	if (result < old_result || result >= db_size)
+	    return db_size;
+    }
+    return result;
+}
+
+Xapian::doccount
+MultiOrPostList::get_termfreq_est() const
+{
+    if (rare(db_size == 0))
+	return 0;
+    // We calculate the estimate assuming independence:
+    // P(a or b or ...) = 1 - (1 - P(a)) . (1 - P(b)) ...
+    double scale = 1.0 / db_size;
+    double P_none = 1.0;
+    vector<SubPostList>::const_iterator i;
+    for (i = plist.begin(); i != plist.end(); ++i) {
+	P_none *= 1.0 - i->pl->get_termfreq_est() * scale;
+    }
+    return static_cast<Xapian::doccount>((1.0 - P_none) * db_size + 0.5);
+}
+
+TermFreqs
+MultiOrPostList::get_termfreq_est_using_stats(
+	const Xapian::Weight::Internal & stats) const
+{
+    LOGCALL(MATCH, TermFreqs, "MultiOrPostList::get_termfreq_est_using_stats", stats);
+    // Our caller should have ensured this.
+    Assert(stats.collection_size);
+    // We calculate the estimate assuming independence, as for
+    // get_termfreq_est().
+    double scale = 1.0 / stats.collection_size;
+    double P_none = 1.0;
+    double Pr_none = 1.0;
+    vector<SubPostList>::const_iterator i;
+    for (i = plist.begin(); i != plist.end(); ++i) {
+	TermFreqs freqs(i->pl->get_termfreq_est_using_stats(stats));
+	P_none *= 1.0 - freqs.termfreq * scale;
+	// If the rset is empty, the reltermfreq should be 0 anyway, so leave
+	// it alone.
+	if (stats.rset_size != 0)
+	    Pr_none *= 1.0 - double(freqs.reltermfreq) / stats.rset_size;
+    }
+    RETURN(TermFreqs(
+	Xapian::doccount((1.0 - P_none) * stats.collection_size + 0.5),
+	Xapian::doccount((1.0 - Pr_none) * stats.rset_size + 0.5)));
+}
+
+double
+MultiOrPostList::get_maxweight() const
+{
+    LOGCALL(MATCH, double, "MultiOrPostList::get_maxweight", NO_ARGS);
+    RETURN(max_total);
+}
+
+Xapian::docid
+MultiOrPostList::get_docid() const
+{
+    return did;
+}
+
+Xapian::termcount
+MultiOrPostList::get_doclength() const
+{
+    Assert(did);
+    AssertEq(plist[0].did, did);
+    return plist[0].pl->get_doclength();
+}
+
+double
+MultiOrPostList::get_weight_from(size_t i) const
+{
+    // The heap is ordered by docid, so if this entry isn't on the current
+    // docid, nor are any of the entries below it.
+    if (i >= plist.size() || plist[i].did != did)
+	return 0;
+    return plist[i].pl->get_weight() +
+	get_weight_from(2 * i + 1) + get_weight_from(2 * i + 2);
+}
+
+double
+MultiOrPostList::get_weight() const
+{
+    Assert(did);
+    return get_weight_from(0);
+}
+
+bool
+MultiOrPostList::at_end() const
+{
+    return plist.empty();
+}
+
+double
+MultiOrPostList::recalc_maxweight()
+{
+    LOGCALL(MATCH, double, "MultiOrPostList::recalc_maxweight", NO_ARGS);
+    max_total = 0.0;
+    vector<SubPostList>::iterator i;
+    for (i = plist.begin(); i != plist.end(); ++i) {
+	max_total += i->pl->recalc_maxweight();
+    }
+    RETURN(max_total);
+}
+
+PostList *
+MultiOrPostList::next(double w_min)
+{
+    LOGCALL(MATCH, PostList *, "MultiOrPostList::next", w_min);
+    (void)w_min;
+    if (did == 0) {
+	// We haven't started yet, so advance all the sub-postlists, then
+	// arrange them into a heap.
+	size_t i = 0;
+	while (i < plist.size()) {
+	    if (handle_result(i, plist[i].pl->next(0)))
+		++i;
+	}
+	make_heap();
+    } else {
+	while (!plist.empty() && plist[0].did == did) {
+	    handle_result(0, plist[0].pl->next(0));
+	    sift_down(0);
+	}
+    }
+    RETURN(update_docid());
+}
+
+PostList *
+MultiOrPostList::skip_to(Xapian::docid did_min, double w_min)
+{
+    LOGCALL(MATCH, PostList *, "MultiOrPostList::skip_to", did_min | w_min);
+    (void)w_min;
+    if (did == 0) {
+	// We haven't started yet, so skip all the sub-postlists, then
+	// arrange them into a heap.
+	size_t i = 0;
+	while (i < plist.size()) {
+	    if (handle_result(i, plist[i].pl->skip_to(did_min, 0)))
+		++i;
+	}
+	make_heap();
+    } else {
+	while (!plist.empty() && plist[0].did < did_min) {
+	    handle_result(0, plist[0].pl->skip_to(did_min, 0));
+	    sift_down(0);
+	}
+    }
+    RETURN(update_docid());
+}
+
+string
+MultiOrPostList::get_description() const
+{
+    string desc("(");
+    vector<SubPostList>::const_iterator i;
+    for (i = plist.begin(); i != plist.end(); ++i) {
+	if (i != plist.begin())
+	    desc += " OR ";
+	desc += i->pl->get_description();
+    }
+    desc += ')';
+    return desc;
+}
+
+Xapian::termcount
+MultiOrPostList::get_wdf_from(size_t i) const
+{
+    if (i >= plist.size() || plist[i].did != did)
+	return 0;
+    return plist[i].pl->get_wdf() +
+	get_wdf_from(2 * i + 1) + get_wdf_from(2 * i + 2);
+}
+
+Xapian::termcount
+MultiOrPostList::get_wdf() const
+{
+    Assert(did);
+    return get_wdf_from(0);
+}
+
+Xapian::termcount
+MultiOrPostList::count_matching_subqs_from(size_t i) const
+{
+    if (i >= plist.size() || plist[i].did != did)
+	return 0;
+    return plist[i].pl->count_matching_subqs() +
+	count_matching_subqs_from(2 * i + 1) +
+	count_matching_subqs_from(2 * i + 2);
+}
+
+Xapian::termcount
+MultiOrPostList::count_matching_subqs() const
+{
+    return count_matching_subqs_from(0);
+}
@@ -0,0 +1,161 @@
+/** @file multiorpostlist.h
+ * @brief N-way OR postlist using a heap
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_MULTIORPOSTLIST_H
+#define XAPIAN_INCLUDED_MULTIORPOSTLIST_H
+
+#include "api/postlist.h"
+
+#include <vector>
+
+class MultiMatch;
+
+/** N-way OR postlist using a heap.
+ *
+ *  The sub-postlists are kept in a binary heap ordered by their current
+ *  docid, so advancing costs O(log n) per sub-postlist moved, however many
+ *  sub-postlists there are.  This is used for expanded wildcards and similar,
+ *  which can produce tens of thousands of sub-postlists, where a tree of
+ *  OrPostList objects would be both slow and large.
+ *
+ *  Unlike OrPostList, this doesn't try to use the minimum weight to skip
+ *  documents, so it's intended for use when the sub-postlists aren't
+ *  weighted (e.g. below a SynonymPostList).
+ */
+class MultiOrPostList : public PostList {
+    /// Don't allow assignment.
+    void operator=(const MultiOrPostList &);
+
+    /// Don't allow copying.
+    MultiOrPostList(const MultiOrPostList &);
+
+    /// The current docid, or zero if we haven't started or are at_end.
+    Xapian::docid did;
+
+    /// A sub-postlist and its current docid.
+    struct SubPostList {
+	/// The docid @a pl is on (cached to avoid a virtual method call).
+	Xapian::docid did;
+
+	PostList * pl;
+
+	SubPostList(PostList * pl_) : did(0), pl(pl_) { }
+    };
+
+    /** The sub-postlists, as a binary heap ordered by current docid.
+     *
+     *  The children of the entry at index i are at 2i + 1 and 2i + 2.  Once
+     *  we've started, the entry at index 0 is always on the current docid.
+     */
+    std::vector<SubPostList> plist;
+
+    /// Total maximum weight the OR could possibly return.
+    double max_total;
+
+    /// The number of documents in the database.
+    Xapian::doccount db_size;
+
+    /// Pointer to the matcher object, so we can report pruning.
+    MultiMatch *matcher;
+
+    /// Restore the heap property below entry @a i.
+    void sift_down(size_t i);
+
+    /** Handle the result of calling next() or skip_to() on entry @a i.
+     *
+     *  Returns false if the entry has been removed because it reached its
+     *  end (in which case the entry at @a i is now the one which was last,
+     *  or @a i is past the end).
+     */
+    bool handle_result(size_t i, PostList * res);
+
+    /// Restore the heap property for the whole heap.
+    void make_heap();
+
+    /** Update the current docid after advancing.
+     *
+     *  If only one sub-postlist is left, it is returned so the caller can
+     *  replace us with it.
+     */
+    PostList * update_docid();
+
+    /// Sum get_wdf() over the matching entries in the heap from index @a i.
+    Xapian::termcount get_wdf_from(size_t i) const;
+
+    /// Sum get_weight() over the matching entries in the heap from index @a i.
+    double get_weight_from(size_t i) const;
+
+    /// Sum count_matching_subqs() over the matching entries from index @a i.
+    Xapian::termcount count_matching_subqs_from(size_t i) const;
+
+  public:
+    /** Construct from 2 random-access iterators to a container of PostList*,
+     *  a pointer to the matcher, and the document collection size.
+     */
+    template <class RandomItor>
+    MultiOrPostList(RandomItor pl_begin, RandomItor pl_end,
+		    MultiMatch * matcher_, Xapian::doccount db_size_)
+	: did(0), plist(pl_begin, pl_end), max_total(0),
+	  db_size(db_size_), matcher(matcher_)
+    {
+    }
+
+    ~MultiOrPostList();
+
+    Xapian::doccount get_termfreq_min() const;
+
+    Xapian::doccount get_termfreq_max() const;
+
+    Xapian::doccount get_termfreq_est() const;
+
+    TermFreqs get_termfreq_est_using_stats(
+	const Xapian::Weight::Internal & stats) const;
+
+    double get_maxweight() const;
+
+    Xapian::docid get_docid() const;
+
+    Xapian::termcount get_doclength() const;
+
+    double get_weight() const;
+
+    bool at_end() const;
+
+    double recalc_maxweight();
+
+    Internal *next(double w_min);
+
+    Internal *skip_to(Xapian::docid, double w_min);
+
+    std::string get_description() const;
+
+    /** get_wdf() for MultiOrPostlists returns the sum of the wdfs of the
+     *  sub postlists which match the current docid.
+     *
+     *  The wdf isn't really meaningful in many situations, but if the lists
+     *  are being combined as a synonym we want the sum of the wdfs, so we do
+     *  that in general.
+     */
+    Xapian::termcount get_wdf() const;
+
+    Xapian::termcount count_matching_subqs() const;
+};
+
+#endif // XAPIAN_INCLUDED_MULTIORPOSTLIST_H
@@ -77,8 +77,10 @@ class QueryOptimiser {
 	return localsubmatch.open_post_list(term, max_part);
     }
 
-    PostList * make_synonym_postlist(PostList * pl, double factor) {
-	return localsubmatch.make_synonym_postlist(pl, matcher, factor);
+    PostList * make_synonym_postlist(PostList * pl, double factor,
+				     bool expanded = false) {
+	return localsubmatch.make_synonym_postlist(pl, matcher, factor,
+						   expanded);
     }
 };
 
@@ -25,15 +25,22 @@
 
 #include "debuglog.h"
 #include "msetpostlist.h"
+#include "realtime.h"
 #include "backends/remote/remote-database.h"
+#include "net/remoteconnection.h"
 #include "weight/weightinternal.h"
 
+#include <algorithm>
+
 RemoteSubMatch::RemoteSubMatch(RemoteDatabase *db_,
 			       bool decreasing_relevance_,
 			       const vector<Xapian::MatchSpy *> & matchspies_)
 	: db(db_),
 	  decreasing_relevance(decreasing_relevance_),
-	  matchspies(matchspies_)
+	  percent_factor(0.0),
+	  timed_out(false),
+	  matchspies(matchspies_),
+	  end_time(0.0)
 {
     LOGCALL_CTOR(MATCH, "RemoteSubMatch", db_ | decreasing_relevance_ | matchspies_);
 }
@@ -49,6 +56,33 @@ RemoteSubMatch::prepare_match(bool nowait,
     RETURN(true);
 }
 
+bool
+RemoteSubMatch::wait_for_any(const vector<RemoteSubMatch *> & submatches,
+			     double until)
+{
+    LOGCALL_STATIC(MATCH, bool, "RemoteSubMatch::wait_for_any", submatches | until);
+    vector<int> fds;
+    fds.reserve(submatches.size());
+    double timeout = 0;
+    vector<RemoteSubMatch *>::const_iterator i;
+    for (i = submatches.begin(); i != submatches.end(); ++i) {
+	int fd = (*i)->db->get_read_fd();
+	// No need to wait if a reply is already buffered.
+	if (fd < 0) RETURN(true);
+	fds.push_back(fd);
+	timeout = max(timeout, (*i)->db->get_timeout());
+    }
+    if (fds.empty()) RETURN(true);
+
+    if (until != 0.0) {
+	double time_left = until - RealTime::now();
+	if (time_left <= 0.0) RETURN(false);
+	if (timeout == 0.0 || time_left < timeout) timeout = time_left;
+    }
+
+    RETURN(RemoteConnection::wait_for_any(fds, timeout));
+}
+
 void
 RemoteSubMatch::start_match(Xapian::doccount first,
 			    Xapian::doccount maxitems,
@@ -56,7 +90,14 @@ RemoteSubMatch::start_match(Xapian::doccount first,
 			    const Xapian::Weight::Internal & total_stats)
 {
     LOGCALL_VOID(MATCH, "RemoteSubMatch::start_match", first | maxitems | check_at_least | total_stats);
-    db->send_global_stats(first, maxitems, check_at_least, total_stats);
+    double time_limit = 0.0;
+    if (end_time != 0.0) {
+	// A time limit of 0 means no limit, so if we've already run out of
+	// time, ask the server to stop as soon as it can.
+	time_limit = max(end_time - RealTime::now(), 1e-6);
+    }
+    db->send_global_stats(first, maxitems, check_at_least, total_stats,
+			  time_limit);
 }
 
 PostList *
@@ -68,6 +109,7 @@ RemoteSubMatch::get_postlist_and_term_info(MultiMatch *,
     Xapian::MSet mset;
     db->get_mset(mset, matchspies);
     percent_factor = mset.internal->percent_factor;
+    timed_out = mset.internal->timed_out;
     if (termfreqandwts) *termfreqandwts = mset.internal->termfreqandwts;
     // For remote databases we report percent_factor rather than counting the
     // number of subqueries.
@@ -50,9 +50,15 @@ class RemoteSubMatch : public SubMatch {
     /// The factor to use to convert weights to percentages.
     double percent_factor;
 
+    /// Was the remote match cut short by the time limit?
+    bool timed_out;
+
     /// The matchspies to use.
     const vector<Xapian::MatchSpy *> & matchspies;
 
+    /// When the remote match should stop (0 for no time limit).
+    double end_time;
+
   public:
     /// Constructor.
     RemoteSubMatch(RemoteDatabase *db_,
@@ -62,6 +68,25 @@ class RemoteSubMatch : public SubMatch {
     /// Fetch and collate statistics.
     bool prepare_match(bool nowait, Xapian::Weight::Internal & total_stats);
 
+    /// Is the reply from the remote server ready to read?
+    bool ready_to_read() const { return db->ready_to_read(); }
+
+    /** Wait until the reply from at least one of several servers is ready.
+     *
+     *  @param submatches	The RemoteSubMatch objects to wait for.
+     *  @param until		Don't wait beyond this time (as returned by
+     *				RealTime::now()), or 0 for no limit.
+     *
+     *  @return	true if a reply is ready to read, or false if we waited for
+     *		the longest timeout of the remote databases (or until
+     *		@a until) without one arriving.
+     */
+    static bool wait_for_any(const vector<RemoteSubMatch *> & submatches,
+			     double until = 0.0);
+
+    /// Set when the remote match should stop (0 for no time limit).
+    void set_end_time(double end_time_) { end_time = end_time_; }
+
     /// Start the match.
     void start_match(Xapian::doccount first,
 		     Xapian::doccount maxitems,
@@ -77,8 +102,20 @@ class RemoteSubMatch : public SubMatch {
     /// Get percentage factor - only valid after get_postlist_and_term_info().
     double get_percent_factor() const { return percent_factor; }
 
+    /** Was the remote match cut short by the time limit?
+     *
+     *  Only valid after get_postlist_and_term_info().
+     */
+    bool get_timed_out() const { return timed_out; }
+
     /// Short-cut for single remote match.
     void get_mset(Xapian::MSet & mset) { db->get_mset(mset, matchspies); }
+
+    /// Stop waiting for the remote match results.
+    void abandon_match() { db->abandon_mset(); }
+
+    /// The context to return with any error messages.
+    const std::string & get_context() const { return db->get_context(); }
 };
 
 #endif /* XAPIAN_INCLUDED_REMOTESUBMATCH_H */
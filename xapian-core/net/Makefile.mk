@@ -5,6 +5,7 @@ noinst_HEADERS +=\
 	net/remoteserver.h\
 	net/remotetcpclient.h\
 	net/remotetcpserver.h\
+	net/replycache.h\
 	net/replicatetcpclient.h\
 	net/replicatetcpserver.h\
 	net/serialise.h\
@@ -23,6 +24,7 @@ lib_src +=\
 	net/remoteserver.cc\
 	net/remotetcpclient.cc\
 	net/remotetcpserver.cc\
+	net/replycache.cc\
 	net/replicatetcpclient.cc\
 	net/replicatetcpserver.cc\
 	net/serialise.cc\
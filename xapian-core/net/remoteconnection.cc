@@ -31,6 +31,7 @@
 
 #include <algorithm>
 #include <string>
+#include <vector>
 
 #include "debuglog.h"
 #include "fd.h"
@@ -41,6 +42,10 @@
 #include "length.h"
 #include "socket_utils.h"
 
+#ifdef HAVE_SYS_SENDFILE_H
+# include <sys/sendfile.h>
+#endif
+
 #ifdef __WIN32__
 # include "msvc_posix_wrapper.h"
 #endif
@@ -56,6 +61,21 @@ throw_database_closed()
     throw Xapian::DatabaseError("Database has been closed");
 }
 
+/** Write n bytes from block pointed to by p to file descriptor fd. */
+static void
+write_all(int fd, const char * p, size_t n)
+{
+    while (n) {
+	ssize_t c = write(fd, p, n);
+	if (c < 0) {
+	    if (errno == EINTR) continue;
+	    throw Xapian::NetworkError("Error writing to file", errno);
+	}
+	p += c;
+	n -= c;
+    }
+}
+
 #ifdef __WIN32__
 inline void
 update_overlapped_offset(WSAOVERLAPPED & overlapped, DWORD n)
@@ -152,38 +172,184 @@ RemoteConnection::read_at_least(size_t min_len, double end_time)
 	if (errno != EAGAIN)
 	    throw Xapian::NetworkError("read failed", context, errno);
 
-	Assert(end_time != 0.0);
-	while (true) {
-	    // Calculate how far in the future end_time is.
-	    double time_diff = end_time - RealTime::now();
-	    // Check if the timeout has expired.
-	    if (time_diff < 0) {
-		LOGLINE(REMOTE, "read: timeout has expired");
-		throw Xapian::NetworkTimeoutError("Timeout expired while trying to read", context);
-	    }
+	wait_for_input(end_time);
+    }
+#endif
+}
 
-	    // Use select to wait until there is data or the timeout is reached.
-	    fd_set fdset;
-	    FD_ZERO(&fdset);
-	    FD_SET(fdin, &fdset);
+#ifndef __WIN32__
+void
+RemoteConnection::wait_for_input(double end_time)
+{
+    LOGCALL_VOID(REMOTE, "RemoteConnection::wait_for_input", end_time);
 
-	    struct timeval tv;
-	    tv.tv_sec = long(time_diff);
-	    tv.tv_usec = long(fmod(time_diff, 1.0) * 1000000);
+    Assert(end_time != 0.0);
+    while (true) {
+	// Calculate how far in the future end_time is.
+	double time_diff = end_time - RealTime::now();
+	// Check if the timeout has expired.
+	if (time_diff < 0) {
+	    LOGLINE(REMOTE, "read: timeout has expired");
+	    throw Xapian::NetworkTimeoutError("Timeout expired while trying to read", context);
+	}
 
-	    int select_result = select(fdin + 1, &fdset, 0, &fdset, &tv);
-	    if (select_result > 0) break;
+	// Use select to wait until there is data or the timeout is reached.
+	fd_set fdset;
+	FD_ZERO(&fdset);
+	FD_SET(fdin, &fdset);
 
-	    if (select_result == 0)
-		throw Xapian::NetworkTimeoutError("Timeout expired while trying to read", context);
+	struct timeval tv;
+	tv.tv_sec = long(time_diff);
+	tv.tv_usec = long(fmod(time_diff, 1.0) * 1000000);
+
+	int select_result = select(fdin + 1, &fdset, 0, &fdset, &tv);
+	if (select_result > 0) return;
+
+	if (select_result == 0)
+	    throw Xapian::NetworkTimeoutError("Timeout expired while trying to read", context);
+
+	// EINTR means select was interrupted by a signal.
+	if (errno != EINTR)
+	    throw Xapian::NetworkError("select failed during read", context, errno);
+    }
+}
 
-	    // EINTR means select was interrupted by a signal.
-	    if (errno != EINTR)
-		throw Xapian::NetworkError("select failed during read", context, errno);
+void
+RemoteConnection::wait_for_output(double end_time)
+{
+    LOGCALL_VOID(REMOTE, "RemoteConnection::wait_for_output", end_time);
+
+    Assert(end_time != 0.0);
+    double time_diff = end_time - RealTime::now();
+    if (time_diff < 0) {
+	LOGLINE(REMOTE, "write: timeout has expired");
+	throw Xapian::NetworkTimeoutError("Timeout expired while trying to write", context);
+    }
+
+    // Use select to wait until there is space or the timeout is reached.
+    fd_set fdset;
+    FD_ZERO(&fdset);
+    FD_SET(fdout, &fdset);
+
+    struct timeval tv;
+    tv.tv_sec = long(time_diff);
+    tv.tv_usec = long(fmod(time_diff, 1.0) * 1000000);
+
+    int select_result = select(fdout + 1, 0, &fdset, &fdset, &tv);
+
+    if (select_result < 0) {
+	// EINTR means select was interrupted by a signal.  We could just
+	// retry the select, but it's easier to just let the caller retry the
+	// write.
+	if (errno == EINTR) return;
+	throw Xapian::NetworkError("select failed during write", context, errno);
+    }
+
+    if (select_result == 0)
+	throw Xapian::NetworkTimeoutError("Timeout expired while trying to write", context);
+}
+#endif
+
+#ifdef HAVE_SENDFILE
+bool
+RemoteConnection::sendfile_data(int fd, off_t & size, double end_time)
+{
+    LOGCALL(REMOTE, bool, "RemoteConnection::sendfile_data", fd | size | end_time);
+
+    while (size) {
+	// Linux won't transfer more than 2GB in a single call.
+	size_t chunk = size_t(min(size, off_t(1) << 30));
+	ssize_t n = sendfile(fdout, fd, NULL, chunk);
+	if (n > 0) {
+	    size -= n;
+	    continue;
+	}
+
+	if (n == 0)
+	    throw Xapian::NetworkError("File to send got shorter", context);
+
+	LOGLINE(REMOTE, "sendfile gave errno = " << strerror(errno));
+	if (errno == EINTR) continue;
+
+	if (errno == EINVAL || errno == ENOSYS) {
+	    // sendfile() can't be used with these fds.  The file position has
+	    // been advanced past any data which was sent, so the caller can
+	    // just carry on with read() and write().
+	    RETURN(false);
 	}
+
+	if (errno != EAGAIN)
+	    throw Xapian::NetworkError("write failed", context, errno);
+
+	wait_for_output(end_time);
     }
+    RETURN(true);
+}
 #endif
+
+#ifdef HAVE_SPLICE
+bool
+RemoteConnection::splice_to_file(int fd, size_t & len, double end_time)
+{
+    LOGCALL(REMOTE, bool, "RemoteConnection::splice_to_file", fd | len | end_time);
+
+    // splice() needs a pipe at one end, so we splice from fdin into a pipe
+    // and from there into the file - the data just moves between kernel
+    // buffers.
+    int fds[2];
+    if (pipe(fds) < 0) RETURN(false);
+    FD pipe_read(fds[0]), pipe_write(fds[1]);
+
+    // If there's no end_time, just use blocking I/O.
+    if (fcntl(fdin, F_SETFL, (end_time != 0.0) ? O_NONBLOCK : 0) < 0) {
+	throw Xapian::NetworkError("Failed to set fdin non-blocking-ness",
+				   context, errno);
+    }
+
+    while (len) {
+	// Don't ask for more than fits in a pipe buffer, since we empty the
+	// pipe after each call.
+	size_t chunk = min(len, size_t(16 * CHUNKSIZE));
+	ssize_t n = splice(fdin, NULL, pipe_write, NULL, chunk, SPLICE_F_MOVE);
+	if (n == 0)
+	    throw Xapian::NetworkError("Received EOF", context);
+	if (n < 0) {
+	    LOGLINE(REMOTE, "splice gave errno = " << strerror(errno));
+	    if (errno == EINTR) continue;
+	    if (errno == EINVAL || errno == ENOSYS) RETURN(false);
+	    if (errno != EAGAIN)
+		throw Xapian::NetworkError("read failed", context, errno);
+	    wait_for_input(end_time);
+	    continue;
+	}
+
+	len -= n;
+	while (n) {
+	    ssize_t c = splice(pipe_read, NULL, fd, NULL, n, SPLICE_F_MOVE);
+	    if (c < 0) {
+		if (errno == EINTR) continue;
+		if (errno != EINVAL && errno != ENOSYS)
+		    throw Xapian::NetworkError("Error writing to file", errno);
+		// The file can't be spliced to, so copy what's left in the
+		// pipe by hand and let the caller handle the rest.
+		char buf[CHUNKSIZE];
+		while (n) {
+		    c = read(pipe_read, buf, min(size_t(n), sizeof(buf)));
+		    if (c < 0) {
+			if (errno == EINTR) continue;
+			throw Xapian::NetworkError("read failed", errno);
+		    }
+		    write_all(fd, buf, c);
+		    n -= c;
+		}
+		RETURN(false);
+	    }
+	    n -= c;
+	}
+    }
+    RETURN(true);
 }
+#endif
 
 bool
 RemoteConnection::ready_to_read() const
@@ -199,15 +365,57 @@ RemoteConnection::ready_to_read() const
     FD_ZERO(&fdset);
     FD_SET(fdin, &fdset);
 
-    // Set a 0.1 second timeout to avoid a busy loop.
-    // FIXME: this would be much better done by exposing the fd so that the
-    // matcher can call select on all the fds involved...
+    // Just poll - callers which want to wait for data from one of several
+    // connections should use get_read_fd() and call select() themselves.
     struct timeval tv;
     tv.tv_sec = 0;
-    tv.tv_usec = 100000;
+    tv.tv_usec = 0;
     RETURN(select(fdin + 1, &fdset, 0, &fdset, &tv) > 0);
 }
 
+int
+RemoteConnection::get_read_fd() const
+{
+    if (fdin == -1)
+	throw_database_closed();
+
+    if (!buffer.empty()) return -1;
+
+    return fdin;
+}
+
+bool
+RemoteConnection::wait_for_any(const vector<int> & fds, double timeout)
+{
+    LOGCALL_STATIC(REMOTE, bool, "RemoteConnection::wait_for_any", fds | timeout);
+    fd_set fdset;
+    FD_ZERO(&fdset);
+    int max_fd = -1;
+    vector<int>::const_iterator i;
+    for (i = fds.begin(); i != fds.end(); ++i) {
+	int fd = *i;
+	// We can't select() on this fd, so let the caller fall back to
+	// blocking reads.
+	if (fd >= FD_SETSIZE) RETURN(false);
+	FD_SET(fd, &fdset);
+	max_fd = max(max_fd, fd);
+    }
+    if (max_fd < 0) RETURN(true);
+
+    struct timeval tv;
+    struct timeval * tv_ptr = NULL;
+    if (timeout != 0) {
+	tv.tv_sec = long(timeout);
+	tv.tv_usec = long((timeout - tv.tv_sec) * 1e6);
+	tv_ptr = &tv;
+    }
+    int r = select(max_fd + 1, &fdset, 0, 0, tv_ptr);
+    // If select() was interrupted by a signal, just let the caller poll
+    // again.
+    if (r < 0 && errno == EINTR) RETURN(true);
+    RETURN(r > 0);
+}
+
 void
 RemoteConnection::send_message(char type, const string &message,
 			       double end_time)
@@ -265,7 +473,6 @@ RemoteConnection::send_message(char type, const string &message,
 
     const string * str = &header;
 
-    fd_set fdset;
     size_t count = 0;
     while (true) {
 	// We've set write to non-blocking, so just try writing as there
@@ -288,34 +495,7 @@ RemoteConnection::send_message(char type, const string &message,
 	if (errno != EAGAIN)
 	    throw Xapian::NetworkError("write failed", context, errno);
 
-	// Use select to wait until there is space or the timeout is reached.
-	FD_ZERO(&fdset);
-	FD_SET(fdout, &fdset);
-
-	double time_diff = end_time - RealTime::now();
-	if (time_diff < 0) {
-	    LOGLINE(REMOTE, "write: timeout has expired");
-	    throw Xapian::NetworkTimeoutError("Timeout expired while trying to write", context);
-	}
-
-	struct timeval tv;
-	tv.tv_sec = long(time_diff);
-	tv.tv_usec = long(fmod(time_diff, 1.0) * 1000000);
-
-	int select_result = select(fdout + 1, 0, &fdset, &fdset, &tv);
-
-	if (select_result < 0) {
-	    if (errno == EINTR) {
-		// EINTR means select was interrupted by a signal.
-		// We could just retry the select, but it's easier to just
-		// retry the write.
-		continue;
-	    }
-	    throw Xapian::NetworkError("select failed during write", context, errno);
-	}
-
-	if (select_result == 0)
-	    throw Xapian::NetworkTimeoutError("Timeout expired while trying to write", context);
+	wait_for_output(end_time);
     }
 #endif
 }
@@ -330,17 +510,41 @@ RemoteConnection::send_file(char type, int fd, double end_time)
     off_t size = file_size(fd);
     if (errno)
 	throw Xapian::NetworkError("Couldn't stat file to send", errno);
-    // FIXME: Use sendfile() or similar if available?
+
+    send_file(type, string(), fd,
+	      vector<pair<off_t, off_t> >(1, make_pair(off_t(0), size)),
+	      end_time);
+}
+
+void
+RemoteConnection::send_file(char type, const string & prefix, int fd,
+			    const vector<pair<off_t, off_t> > & ranges,
+			    double end_time)
+{
+    LOGCALL_VOID(REMOTE, "RemoteConnection::send_file", type | prefix | fd | ranges.size() | end_time);
+    if (fdout == -1)
+	throw_database_closed();
+
+    off_t total = prefix.size();
+    vector<pair<off_t, off_t> >::const_iterator r;
+    for (r = ranges.begin(); r != ranges.end(); ++r)
+	total += r->second;
+    r = ranges.begin();
+    // The number of bytes left to send from the current range.
+    off_t size = 0;
 
     char buf[CHUNKSIZE];
     buf[0] = type;
     size_t c = 1;
     {
-	string enc_size = encode_length(size);
+	string enc_size = encode_length(total);
 	c += enc_size.size();
-	// An encoded length should be just a few bytes.
-	AssertRel(c, <=, sizeof(buf));
+	// An encoded length should be just a few bytes, and the prefix is
+	// only expected to be short.
+	AssertRel(c + prefix.size(), <=, sizeof(buf));
 	memcpy(buf + 1, enc_size.data(), enc_size.size());
+	memcpy(buf + c, prefix.data(), prefix.size());
+	c += prefix.size();
     }
 
 #ifdef __WIN32__
@@ -372,13 +576,22 @@ RemoteConnection::send_file(char type, int fd, double end_time)
 	update_overlapped_offset(overlapped, n);
 
 	if (count == c) {
-	    if (size == 0) return;
+	    while (size == 0) {
+		if (r == ranges.end()) return;
+		if (lseek(fd, r->first, SEEK_SET) < 0)
+		    throw Xapian::NetworkError("Couldn't seek in file to send",
+					       errno);
+		size = r->second;
+		++r;
+	    }
 
 	    ssize_t res;
 	    do {
-		res = read(fd, buf, sizeof(buf));
+		res = read(fd, buf, size_t(min(off_t(sizeof(buf)), size)));
 	    } while (res < 0 && errno == EINTR);
 	    if (res < 0) throw Xapian::NetworkError("read failed", errno);
+	    if (res == 0)
+		throw Xapian::NetworkError("File to send got shorter", context);
 	    c = size_t(res);
 
 	    size -= c;
@@ -392,8 +605,10 @@ RemoteConnection::send_file(char type, int fd, double end_time)
 				   context, errno);
     }
 
-    fd_set fdset;
     size_t count = 0;
+#ifdef HAVE_SENDFILE
+    bool use_sendfile = true;
+#endif
     while (true) {
 	// We've set write to non-blocking, so just try writing as there
 	// will usually be space.
@@ -402,13 +617,36 @@ RemoteConnection::send_file(char type, int fd, double end_time)
 	if (n >= 0) {
 	    count += n;
 	    if (count == c) {
-		if (size == 0) return;
+		while (true) {
+		    // Move on to the next range of the file to send.
+		    while (size == 0) {
+			if (r == ranges.end()) return;
+			if (lseek(fd, r->first, SEEK_SET) < 0) {
+			    throw Xapian::NetworkError("Couldn't seek in file "
+						       "to send", errno);
+			}
+			size = r->second;
+			++r;
+		    }
+#ifdef HAVE_SENDFILE
+		    if (use_sendfile) {
+			// Have the kernel copy the data straight to fdout.
+			if (sendfile_data(fd, size, end_time)) continue;
+			use_sendfile = false;
+		    }
+#endif
+		    break;
+		}
 
 		ssize_t res;
 		do {
-		    res = read(fd, buf, sizeof(buf));
+		    res = read(fd, buf, size_t(min(off_t(sizeof(buf)), size)));
 		} while (res < 0 && errno == EINTR);
 		if (res < 0) throw Xapian::NetworkError("read failed", errno);
+		if (res == 0) {
+		    throw Xapian::NetworkError("File to send got shorter",
+					       context);
+		}
 		c = size_t(res);
 
 		size -= c;
@@ -423,34 +661,7 @@ RemoteConnection::send_file(char type, int fd, double end_time)
 	if (errno != EAGAIN)
 	    throw Xapian::NetworkError("write failed", context, errno);
 
-	// Use select to wait until there is space or the timeout is reached.
-	FD_ZERO(&fdset);
-	FD_SET(fdout, &fdset);
-
-	double time_diff = end_time - RealTime::now();
-	if (time_diff < 0) {
-	    LOGLINE(REMOTE, "write: timeout has expired");
-	    throw Xapian::NetworkTimeoutError("Timeout expired while trying to write", context);
-	}
-
-	struct timeval tv;
-	tv.tv_sec = long(time_diff);
-	tv.tv_usec = long(fmod(time_diff, 1.0) * 1000000);
-
-	int select_result = select(fdout + 1, 0, &fdset, &fdset, &tv);
-
-	if (select_result < 0) {
-	    if (errno == EINTR) {
-		// EINTR means select was interrupted by a signal.
-		// We could just retry the select, but it's easier to just
-		// retry the write.
-		continue;
-	    }
-	    throw Xapian::NetworkError("select failed during write", context, errno);
-	}
-
-	if (select_result == 0)
-	    throw Xapian::NetworkTimeoutError("Timeout expired while trying to write", context);
+	wait_for_output(end_time);
     }
 #endif
 }
@@ -568,21 +779,6 @@ RemoteConnection::get_message_chunk(string &result, size_t at_least,
     RETURN(read_enough);
 }
 
-/** Write n bytes from block pointed to by p to file descriptor fd. */
-static void
-write_all(int fd, const char * p, size_t n)
-{
-    while (n) {
-	ssize_t c = write(fd, p, n);
-	if (c < 0) {
-	    if (errno == EINTR) continue;
-	    throw Xapian::NetworkError("Error writing to file", errno);
-	}
-	p += c;
-	n -= c;
-    }
-}
-
 char
 RemoteConnection::receive_file(const string &file, double end_time)
 {
@@ -627,6 +823,9 @@ RemoteConnection::receive_file(const string &file, double end_time)
     len -= remainlen;
     char type = buffer[0];
     buffer.erase(0, header_len + remainlen);
+#ifdef HAVE_SPLICE
+    if (len > 0 && splice_to_file(fd, len, end_time)) RETURN(type);
+#endif
     while (len > 0) {
 	read_at_least(min(len, size_t(CHUNKSIZE)), end_time);
 	remainlen = min(buffer.size(), len);
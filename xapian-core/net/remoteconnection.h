@@ -22,6 +22,10 @@
 #define XAPIAN_INCLUDED_REMOTECONNECTION_H
 
 #include <string>
+#include <utility>
+#include <vector>
+
+#include <xapian/visibility.h>
 
 #include "remoteprotocol.h"
 #include "safeunistd.h"
@@ -130,6 +134,62 @@ class RemoteConnection {
      */
     void read_at_least(size_t min_len, double end_time);
 
+#ifndef __WIN32__
+    /** Wait until fdin is readable.
+     *
+     *  @param end_time	If this time is reached, then a timeout
+     *			exception will be thrown.
+     */
+    void wait_for_input(double end_time);
+
+    /** Wait until fdout is writable.
+     *
+     *  This may return early if interrupted by a signal, so the caller
+     *  should just retry the write.
+     *
+     *  @param end_time	If this time is reached, then a timeout
+     *			exception will be thrown.
+     */
+    void wait_for_output(double end_time);
+#endif
+
+#ifdef HAVE_SENDFILE
+    /** Send data from a file to fdout without it passing through userspace.
+     *
+     *  @param fd	The file to send data from (from its current position).
+     *  @param size	The number of bytes to send - this is reduced by the
+     *			number of bytes actually sent.
+     *  @param end_time	If this time is reached, then a timeout
+     *			exception will be thrown.  If (end_time == 0.0),
+     *			then keep trying indefinitely.
+     *
+     *  @return		false if sendfile() isn't supported for these fds,
+     *			in which case the caller should send the remaining
+     *			@a size bytes some other way.
+     */
+    bool sendfile_data(int fd, off_t & size, double end_time);
+#endif
+
+#ifdef HAVE_SPLICE
+    /** Copy message data from fdin to a file without it passing through
+     *  userspace.
+     *
+     *  Data already in buffer must have been written to the file first.
+     *
+     *  @param fd	The file to write the data to.
+     *  @param len	The number of bytes to copy - this is reduced by the
+     *			number of bytes actually copied.
+     *  @param end_time	If this time is reached, then a timeout
+     *			exception will be thrown.  If (end_time == 0.0),
+     *			then keep trying indefinitely.
+     *
+     *  @return		false if splice() isn't supported for these fds,
+     *			in which case the caller should copy the remaining
+     *			@a len bytes some other way.
+     */
+    bool splice_to_file(int fd, size_t & len, double end_time);
+#endif
+
 #ifdef __WIN32__
     /** On Windows we use overlapped IO.  We share an overlapped structure
      *  for both reading and writing, as we know that we always wait for
@@ -166,6 +226,29 @@ class RemoteConnection {
      */
     bool ready_to_read() const;
 
+    /** Get the file descriptor to wait on for data to read.
+     *
+     *  @return		The file descriptor, or -1 if there's already data
+     *			buffered, so there's no need to wait.
+     */
+    int get_read_fd() const;
+
+    /** Wait until there's data to read on at least one of several fds.
+     *
+     *  @param fds	The file descriptors to wait on, as returned by
+     *			get_read_fd().
+     *  @param timeout	The longest time to wait (in seconds), or 0 to wait
+     *			indefinitely.
+     *
+     *  @return		true if there's data to read on at least one of
+     *			@a fds, or the wait was interrupted by a signal (so
+     *			the caller should just check again); false if
+     *			@a timeout passed without any data arriving, or
+     *			select() can't wait on one of @a fds.
+     */
+    XAPIAN_VISIBILITY_DEFAULT
+    static bool wait_for_any(const std::vector<int> & fds, double timeout);
+
     /** Check what the next message type is.
      *
      *  This must not be called after a call to get_message_chunked() until
@@ -272,6 +355,22 @@ class RemoteConnection {
      */
     void send_file(char type, int fd, double end_time);
 
+    /** Send parts of a file as a message, after some other data.
+     *
+     *  @param type		Message type code.
+     *  @param prefix		Data to send before the file data.
+     *  @param fd		File containing the rest of the message data.
+     *  @param ranges		The parts of @a fd to send, in order, as
+     *				(offset, length) pairs.
+     *  @param end_time		If this time is reached, then a timeout
+     *				exception will be thrown.  If
+     *				(end_time == 0.0) then the operation will
+     *				never timeout.
+     */
+    void send_file(char type, const std::string & prefix, int fd,
+		   const std::vector<std::pair<off_t, off_t> > & ranges,
+		   double end_time);
+
     /** Shutdown the connection.
      *
      *  @param wait	If true, wait for the remote end to close the
@@ -34,11 +34,13 @@
 #include <cstdlib>
 
 #include "autoptr.h"
+#include "backends/database.h"
 #include "length.h"
 #include "matcher/multimatch.h"
 #include "noreturn.h"
 #include "omassert.h"
 #include "realtime.h"
+#include "replycache.h"
 #include "serialise.h"
 #include "serialise-double.h"
 #include "str.h"
@@ -60,7 +62,8 @@ RemoteServer::RemoteServer(const std::vector<std::string> &dbpaths,
 			   bool writable_)
     : RemoteConnection(fdin_, fdout_, std::string()),
       db(NULL), wdb(NULL), writable(writable_),
-      active_timeout(active_timeout_), idle_timeout(idle_timeout_)
+      active_timeout(active_timeout_), idle_timeout(idle_timeout_),
+      reply_cache(NULL)
 {
     // Catch errors opening the database and propagate them to the client.
     try {
@@ -91,6 +94,24 @@ RemoteServer::RemoteServer(const std::vector<std::string> &dbpaths,
 	throw;
     }
 
+    start_conversation();
+}
+
+RemoteServer::RemoteServer(const Xapian::Database & db_,
+			   const std::string & context_,
+			   int fdin_, int fdout_,
+			   double active_timeout_, double idle_timeout_)
+    : RemoteConnection(fdin_, fdout_, context_),
+      db(new Xapian::Database(db_)), wdb(NULL), writable(false),
+      active_timeout(active_timeout_), idle_timeout(idle_timeout_),
+      reply_cache(NULL)
+{
+    start_conversation();
+}
+
+void
+RemoteServer::start_conversation()
+{
 #ifndef __WIN32__
     // It's simplest to just ignore SIGPIPE.  We'll still know if the
     // connection dies because we'll get EPIPE back from write().
@@ -108,6 +129,40 @@ RemoteServer::~RemoteServer()
     // wdb is either NULL or equal to db, so we shouldn't delete it too!
 }
 
+void
+RemoteServer::set_reply_cache(ReplyCache * cache)
+{
+    reply_cache = (cache && cache->enabled() && !wdb) ? cache : NULL;
+    update_reply_cache_revision();
+}
+
+void
+RemoteServer::update_reply_cache_revision()
+{
+    if (!reply_cache) return;
+
+    // Identify the revision by the UUID and revision of each database.  If
+    // any database can't tell us these, don't cache anything.
+    string revision;
+    try {
+	for (size_t i = 0; i != db->internal.size(); ++i) {
+	    const Xapian::Database::Internal * sub = db->internal[i].get();
+	    string uuid = sub->get_uuid();
+	    if (uuid.empty()) {
+		revision.resize(0);
+		break;
+	    }
+	    revision += uuid;
+	    string rev = sub->get_revision_info();
+	    revision += encode_length(rev.size());
+	    revision += rev;
+	}
+    } catch (const Xapian::UnimplementedError &) {
+	revision.resize(0);
+    }
+    reply_cache->set_revision(revision);
+}
+
 message_type
 RemoteServer::get_message(double timeout, string & result,
 			  message_type required_type)
@@ -182,6 +237,7 @@ RemoteServer::run()
 		0, // MSG_GETMSET - used during a conversation.
 		0, // MSG_SHUTDOWN - handled by get_message().
 		&RemoteServer::msg_openmetadatakeylist,
+		&RemoteServer::msg_documents,
 	    };
 
 	    string message;
@@ -314,6 +370,9 @@ RemoteServer::msg_writeaccess(const string & msg)
     wdb = new Xapian::WritableDatabase(context, Xapian::DB_OPEN);
     delete db;
     db = wdb;
+    // Changes aren't visible in the revision until committed, so stop
+    // caching.
+    reply_cache = NULL;
     msg_update(msg);
 }
 
@@ -324,6 +383,7 @@ RemoteServer::msg_reopen(const string & msg)
 	send_message(REPLY_DONE, string());
 	return;
     }
+    update_reply_cache_revision();
     msg_update(msg);
 }
 
@@ -346,6 +406,8 @@ RemoteServer::msg_update(const string &)
     totlen_t total_len = totlen_t(db->get_avlength() * db->get_doccount() + .5);
     message += encode_length(total_len);
     //message += encode_length(db->get_total_length());
+    // We can compress replies to MSG_QUERY if the client asks.
+    message += '1';
     string uuid = db->get_uuid();
     message += uuid;
     send_message(REPLY_UPDATE, message);
@@ -387,7 +449,7 @@ RemoteServer::msg_query(const string &message_in)
     Xapian::valueno collapse_key = Xapian::BAD_VALUENO;
     if (collapse_max) collapse_key = decode_length(&p, p_end, false);
 
-    if (p_end - p < 4 || *p < '0' || *p > '2') {
+    if (p_end - p < 5 || *p < '0' || *p > '2') {
 	throw Xapian::NetworkError("bad message (docid_order)");
     }
     Xapian::Enquire::docid_order order;
@@ -406,6 +468,11 @@ RemoteServer::msg_query(const string &message_in)
     }
     bool sort_value_forward(*p++ != '0');
 
+    if (*p < '0' || *p > '1') {
+	throw Xapian::NetworkError("bad message (docids_in_rank_order)");
+    }
+    bool docids_in_rank_order(*p++ != '0');
+
     int percent_cutoff = *p++;
     if (percent_cutoff < 0 || percent_cutoff > 100) {
 	throw Xapian::NetworkError("bad message (percent_cutoff)");
@@ -416,6 +483,11 @@ RemoteServer::msg_query(const string &message_in)
 	throw Xapian::NetworkError("bad message (weight_cutoff)");
     }
 
+    if (p == p_end || (*p != '0' && *p != '1')) {
+	throw Xapian::NetworkError("bad message (compress)");
+    }
+    bool compress = (*p++ == '1');
+
     // Unserialise the Weight object.
     len = decode_length(&p, p_end, true);
     string wtname(p, len);
@@ -456,15 +528,32 @@ RemoteServer::msg_query(const string &message_in)
 	p += len;
     }
 
-    Xapian::Weight::Internal local_stats;
-    MultiMatch match(*db, query, qlen, &rset, collapse_max, collapse_key,
-		     percent_cutoff, weight_cutoff, order,
-		     sort_key, sort_by, sort_value_forward, NULL,
-		     local_stats, wt.get(), matchspies.spies, false, false);
-
-    send_message(REPLY_STATS, serialise_stats(local_stats));
+    // If we have a cache, the key for the stats is the whole MSG_QUERY
+    // message, which identifies everything the stats depend on (the cache
+    // holds replies for a single database revision).
+    string key;
+    if (reply_cache) {
+	key = 'S';
+	key += message_in;
+    }
 
+    // We only need to set up the match if we don't have a cached reply.
+    Xapian::Weight::Internal local_stats;
+    AutoPtr<MultiMatch> match;
     string message;
+    if (!reply_cache || !reply_cache->get(key, message)) {
+	match.reset(new MultiMatch(*db, query, qlen, &rset,
+				   collapse_max, collapse_key,
+				   percent_cutoff, weight_cutoff, order,
+				   sort_key, sort_by, sort_value_forward,
+				   docids_in_rank_order, NULL, local_stats,
+				   wt.get(), matchspies.spies, false, false));
+	message = serialise_stats(local_stats);
+	if (compress) message = compress_message(message);
+	if (reply_cache) reply_cache->add(key, message);
+    }
+    send_message(REPLY_STATS, message);
+
     get_message(active_timeout, message, MSG_GETMSET);
     p = message.c_str();
     p_end = p + message.size();
@@ -475,12 +564,41 @@ RemoteServer::msg_query(const string &message_in)
     Xapian::termcount check_at_least = 0;
     check_at_least = decode_length(&p, p_end, false);
 
+    const char * p_time_limit = p;
+    double end_time = RealTime::end_time(unserialise_double(&p, p_end));
+
+    if (reply_cache) {
+	// The results depend on the MSG_GETMSET message too, apart from the
+	// time limit - we only cache results from matches which finished in
+	// time, and those are valid whatever the time limit.
+	key = 'R';
+	key += encode_length(message_in.size());
+	key += message_in;
+	key.append(message.data(), p_time_limit - message.data());
+	key.append(p, p_end - p);
+	string reply;
+	if (reply_cache->get(key, reply)) {
+	    send_message(REPLY_RESULTS, reply);
+	    return;
+	}
+    }
+
     message.erase(0, message.size() - (p_end - p));
     Xapian::Weight::Internal total_stats(unserialise_stats(message));
     total_stats.set_bounds_from_db(*db);
 
+    if (!match.get()) {
+	match.reset(new MultiMatch(*db, query, qlen, &rset,
+				   collapse_max, collapse_key,
+				   percent_cutoff, weight_cutoff, order,
+				   sort_key, sort_by, sort_value_forward,
+				   docids_in_rank_order, NULL, local_stats,
+				   wt.get(), matchspies.spies, false, false));
+    }
+
     Xapian::MSet mset;
-    match.get_mset(first, maxitems, check_at_least, mset, total_stats, 0, 0);
+    match->get_mset(first, maxitems, check_at_least, mset, total_stats, 0, 0,
+		    NULL, end_time);
 
     message.resize(0);
     vector<Xapian::MatchSpy *>::const_iterator i;
@@ -490,6 +608,8 @@ RemoteServer::msg_query(const string &message_in)
 	message += spy_results;
     }
     message += serialise_mset(mset);
+    if (compress) message = compress_message(message);
+    if (reply_cache && !mset.timed_out()) reply_cache->add(key, message);
     send_message(REPLY_RESULTS, message);
 }
 
@@ -500,6 +620,31 @@ RemoteServer::msg_document(const string &message)
     const char *p_end = p + message.size();
     Xapian::docid did = decode_length(&p, p_end, false);
 
+    send_document(did);
+}
+
+void
+RemoteServer::msg_documents(const string &message)
+{
+    const char *p = message.data();
+    const char *p_end = p + message.size();
+    while (p != p_end) {
+	Xapian::docid did = decode_length(&p, p_end, false);
+	try {
+	    send_document(did);
+	} catch (const Xapian::NetworkError &) {
+	    throw;
+	} catch (const Xapian::Error &e) {
+	    // The client expects a reply for each document, so report the
+	    // error for this one and carry on with the rest.
+	    send_message(REPLY_EXCEPTION, serialise_error(e));
+	}
+    }
+}
+
+void
+RemoteServer::send_document(Xapian::docid did)
+{
     Xapian::Document doc = db->get_document(did);
 
     send_message(REPLY_DOCDATA, doc.get_data());
@@ -32,6 +32,8 @@
 
 #include <string>
 
+class ReplyCache;
+
 /** Remote backend server base class. */
 class XAPIAN_VISIBILITY_DEFAULT RemoteServer : private RemoteConnection {
     /// Don't allow assignment.
@@ -69,6 +71,15 @@ class XAPIAN_VISIBILITY_DEFAULT RemoteServer : private RemoteConnection {
     /// The registry, which allows unserialisation of user subclasses.
     Xapian::Registry reg;
 
+    /// Cache of replies to MSG_QUERY and MSG_GETMSET, or NULL for none.
+    ReplyCache * reply_cache;
+
+    /// Tell @a reply_cache which revision of the database we're using.
+    void update_reply_cache_revision();
+
+    /// Ignore SIGPIPE and send the greeting message to the client.
+    void start_conversation();
+
     /// Accept a message from the client.
     message_type get_message(double timeout, std::string & result,
 			     message_type required_type = MSG_MAX);
@@ -89,6 +100,12 @@ class XAPIAN_VISIBILITY_DEFAULT RemoteServer : private RemoteConnection {
     // get document
     void msg_document(const std::string & message);
 
+    // get several documents
+    void msg_documents(const std::string & message);
+
+    /// Send the reply to MSG_DOCUMENT for document @a did.
+    void send_document(Xapian::docid did);
+
     // term exists?
     void msg_termexists(const std::string & message);
 
@@ -183,6 +200,29 @@ class XAPIAN_VISIBILITY_DEFAULT RemoteServer : private RemoteConnection {
 		 double idle_timeout_,
 		 bool writable = false);
 
+    /** Construct a read-only RemoteServer for an already open database.
+     *
+     *  This allows a server process which handles many connections to open
+     *  the databases just once.  The caller should reopen() @a db_ before
+     *  each connection if it wants the client to see the latest revision.
+     *
+     *  @param db_	The database to use.
+     *  @param context_	The context to report with errors (usually the
+     *			database paths).
+     *  @param fdin	The file descriptor to read from.
+     *  @param fdout	The file descriptor to write to (fdin and fdout may be
+     *			the same).
+     *  @param active_timeout_	Timeout for actions during a conversation
+     *			(specified in seconds).
+     *  @param idle_timeout_	Timeout while waiting for a new action from
+     *			the client (specified in seconds).
+     */
+    RemoteServer(const Xapian::Database & db_,
+		 const std::string & context_,
+		 int fdin, int fdout,
+		 double active_timeout_,
+		 double idle_timeout_);
+
     /// Destructor.
     ~RemoteServer();
 
@@ -198,6 +238,21 @@ class XAPIAN_VISIBILITY_DEFAULT RemoteServer : private RemoteConnection {
 
     /// Set the registry used for (un)serialisation.
     void set_registry(const Xapian::Registry & reg_) { reg = reg_; }
+
+    /** Set a cache to use for the replies to queries.
+     *
+     *  Replies to repeated queries are then sent from the cache rather
+     *  than running the match again.  The cache is only used while the
+     *  database is read-only, and is emptied when the database revision
+     *  changes.  It can be shared by successive RemoteServer objects.
+     *
+     *  Note that if the query uses a PostingSource subclass whose results
+     *  depend on anything other than the database, cached results may be
+     *  out of date.
+     *
+     *  @param cache	The cache to use, or NULL to not use a cache.
+     */
+    void set_reply_cache(ReplyCache * cache);
 };
 
 #endif // XAPIAN_INCLUDED_REMOTESERVER_H
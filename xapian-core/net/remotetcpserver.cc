@@ -36,20 +36,60 @@ using namespace std;
 RemoteTcpServer::RemoteTcpServer(const vector<std::string> &dbpaths_,
 				 const std::string & host, int port,
 				 double active_timeout_, double idle_timeout_,
-				 bool writable_, bool verbose_)
+				 bool writable_, bool verbose_,
+				 size_t reply_cache_size)
     : TcpServer(host, port, true, verbose_),
       dbpaths(dbpaths_), writable(writable_),
-      active_timeout(active_timeout_), idle_timeout(idle_timeout_)
+      active_timeout(active_timeout_), idle_timeout(idle_timeout_),
+      reply_cache(writable_ ? 0 : reply_cache_size)
 {
 }
 
+bool
+RemoteTcpServer::open_databases()
+{
+    try {
+	if (!db_context.empty()) {
+	    // Pick up any new revision since the last connection.
+	    db.reopen();
+	    return true;
+	}
+
+	Xapian::Database new_db;
+	string context;
+	vector<string>::const_iterator i;
+	for (i = dbpaths.begin(); i != dbpaths.end(); ++i) {
+	    new_db.add_database(Xapian::Database(*i));
+	    if (!context.empty()) context += ' ';
+	    context += *i;
+	}
+	db = new_db;
+	db_context = context;
+	return true;
+    } catch (const Xapian::Error &) {
+	db = Xapian::Database();
+	db_context.resize(0);
+	return false;
+    }
+}
+
 void
 RemoteTcpServer::handle_one_connection(int socket)
 {
     try {
-	RemoteServer sserv(dbpaths, socket, socket,
-			   active_timeout, idle_timeout, writable);
-	sserv.run();
+	if (persistent_handler && !writable && open_databases()) {
+	    RemoteServer sserv(db, db_context, socket, socket,
+			       active_timeout, idle_timeout);
+	    sserv.set_reply_cache(&reply_cache);
+	    sserv.run();
+	} else {
+	    // Don't use the reply cache here - we may be one of several
+	    // threads handling connections at once, and in a forked child
+	    // the cache would be discarded at the end of the connection.
+	    RemoteServer sserv(dbpaths, socket, socket,
+			       active_timeout, idle_timeout, writable);
+	    sserv.run();
+	}
     } catch (const Xapian::NetworkTimeoutError &e) {
 	if (verbose)
 	    cerr << "Connection timed out: " << e.get_description() << endl;
@@ -58,4 +98,11 @@ RemoteTcpServer::handle_one_connection(int socket)
     } catch (...) {
 	// ignore other exceptions
     }
+
+    if (verbose && persistent_handler && reply_cache.enabled()) {
+	cout << "Reply cache: " << reply_cache.get_hits() << " hits, "
+	     << reply_cache.get_misses() << " misses, "
+	     << reply_cache.get_entries() << " entries using "
+	     << reply_cache.get_size() << " bytes" << endl;
+    }
 }
@@ -21,6 +21,7 @@
 #ifndef XAPIAN_INCLUDED_REMOTETCPSERVER_H
 #define XAPIAN_INCLUDED_REMOTETCPSERVER_H
 
+#include "replycache.h"
 #include "tcpserver.h"
 
 #include <xapian/database.h>
@@ -55,6 +56,31 @@ class XAPIAN_VISIBILITY_DEFAULT RemoteTcpServer : public TcpServer {
     /** Timeout between operations (in seconds). */
     double idle_timeout;
 
+    /** The databases, kept open between connections.
+     *
+     *  Only used when persistent_handler is true and we're read-only.
+     */
+    Xapian::Database db;
+
+    /// The context to report with errors for @a db, or empty if not open.
+    std::string db_context;
+
+    /** Cache of replies to queries.
+     *
+     *  Only used when persistent_handler is true, so it persists between
+     *  connections and is never shared between threads.
+     */
+    ReplyCache reply_cache;
+
+    /** Open @a db, or reopen it if it is already open.
+     *
+     *  @return true if @a db is ready to use; false if there was an error,
+     *		in which case the caller should fall back to opening the
+     *		databases for just this connection, which will report the
+     *		error to the client.
+     */
+    bool open_databases();
+
     /** Accept a connection and return the filedescriptor for it. */
     int accept_connection();
 
@@ -72,11 +98,16 @@ class XAPIAN_VISIBILITY_DEFAULT RemoteTcpServer : public TcpServer {
      *	@param writable		Should we open the DB for writing?
      *	@param verbose		Should we produce output when connections are
      *				made or lost?
+     *	@param reply_cache_size	The maximum size in bytes of the cache of
+     *				replies to queries (default 0, which means
+     *				no cache).  Only used by run_workers(), and
+     *				not if @a writable is true.
      */
     RemoteTcpServer(const std::vector<std::string> &dbpaths_,
 		    const std::string &host, int port,
 		    double active_timeout, double idle_timeout,
-		    bool writable, bool verbose);
+		    bool writable, bool verbose,
+		    size_t reply_cache_size = 0);
 
     /** Handle a single connection on an already connected socket.
      *
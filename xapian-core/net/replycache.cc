@@ -0,0 +1,81 @@
+/** @file replycache.cc
+ * @brief LRU cache of serialised replies for RemoteServer.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "replycache.h"
+
+#include "omassert.h"
+
+using namespace std;
+
+void
+ReplyCache::set_revision(const string & revision_)
+{
+    if (revision_ == revision) return;
+    clear();
+    revision = revision_;
+}
+
+bool
+ReplyCache::get(const string & key, string & reply)
+{
+    if (revision.empty()) return false;
+    map<string, lru_list::iterator>::const_iterator i = index.find(key);
+    if (i == index.end()) {
+	++misses;
+	return false;
+    }
+    ++hits;
+    // Move the entry to the front of the list.
+    entries.splice(entries.begin(), entries, i->second);
+    reply = i->second->second;
+    return true;
+}
+
+void
+ReplyCache::add(const string & key, const string & reply)
+{
+    if (revision.empty()) return;
+    size_t entry_size = key.size() + reply.size();
+    if (entry_size > max_size) return;
+    if (index.find(key) != index.end()) return;
+
+    while (size + entry_size > max_size) {
+	Assert(!entries.empty());
+	const pair<string, string> & lru = entries.back();
+	size -= lru.first.size() + lru.second.size();
+	index.erase(lru.first);
+	entries.pop_back();
+    }
+
+    entries.push_front(make_pair(key, reply));
+    index.insert(make_pair(key, entries.begin()));
+    size += entry_size;
+}
+
+void
+ReplyCache::clear()
+{
+    entries.clear();
+    index.clear();
+    size = 0;
+}
@@ -0,0 +1,123 @@
+/** @file replycache.h
+ * @brief LRU cache of serialised replies for RemoteServer.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_REPLYCACHE_H
+#define XAPIAN_INCLUDED_REPLYCACHE_H
+
+#include "xapian/visibility.h"
+
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
+
+/** LRU cache of serialised replies for RemoteServer.
+ *
+ *  Head queries tend to be repeated many times, so RemoteServer can use this
+ *  to reuse the stats and results it sent for an identical earlier query
+ *  instead of running the match again.
+ *
+ *  The cache only holds replies for one revision of the database - when the
+ *  revision changes, the cache is emptied.
+ */
+class XAPIAN_VISIBILITY_DEFAULT ReplyCache {
+    /// Don't allow assignment.
+    void operator=(const ReplyCache &);
+
+    /// Don't allow copying.
+    ReplyCache(const ReplyCache &);
+
+    typedef std::list<std::pair<std::string, std::string> > lru_list;
+
+    /// The cached entries, most recently used first.
+    lru_list entries;
+
+    /// Index from key to the entry in @a entries.
+    std::map<std::string, lru_list::iterator> index;
+
+    /// The revision of the database which the cached replies are for.
+    std::string revision;
+
+    /// The maximum number of bytes of keys and replies to keep.
+    size_t max_size;
+
+    /// The number of bytes of keys and replies currently kept.
+    size_t size;
+
+    /// The number of lookups which found an entry.
+    unsigned long hits;
+
+    /// The number of lookups which didn't find an entry.
+    unsigned long misses;
+
+  public:
+    /** Construct a ReplyCache.
+     *
+     *  @param max_size_	The maximum number of bytes of keys and replies
+     *				to keep (0 to disable caching).
+     */
+    explicit ReplyCache(size_t max_size_)
+	: max_size(max_size_), size(0), hits(0), misses(0) { }
+
+    /// Is caching enabled?
+    bool enabled() const { return max_size != 0; }
+
+    /** Set the revision of the database which replies are for.
+     *
+     *  If @a revision_ differs from the current revision, any cached
+     *  replies are discarded.  An empty revision disables caching (until
+     *  the revision is next set), which should be used for databases which
+     *  can't report their revision.
+     */
+    void set_revision(const std::string & revision_);
+
+    /** Look up a cached reply.
+     *
+     *  @param key	The key to look up.
+     *  @param reply	Set to the reply if there is one.
+     *
+     *  @return	true if a reply was found.
+     */
+    bool get(const std::string & key, std::string & reply);
+
+    /** Add a reply to the cache.
+     *
+     *  The least recently used replies are discarded to make room.
+     */
+    void add(const std::string & key, const std::string & reply);
+
+    /// Discard all cached replies.
+    void clear();
+
+    /// The number of lookups which found an entry.
+    unsigned long get_hits() const { return hits; }
+
+    /// The number of lookups which didn't find an entry.
+    unsigned long get_misses() const { return misses; }
+
+    /// The number of bytes of keys and replies currently kept.
+    size_t get_size() const { return size; }
+
+    /// The number of replies currently kept.
+    size_t get_entries() const { return index.size(); }
+};
+
+#endif // XAPIAN_INCLUDED_REPLYCACHE_H
@@ -28,9 +28,11 @@
 
 #include "omassert.h"
 #include "api/omenquireinternal.h"
+#include "compression_stream.h"
 #include "length.h"
 #include "serialise.h"
 #include "serialise-double.h"
+#include "stringutils.h"
 #include "weight/weightinternal.h"
 
 #include <string>
@@ -90,6 +92,51 @@ unserialise_error(const string &serialised_error, const string &prefix,
     throw Xapian::InternalError("Unknown remote exception type", new_context);
 }
 
+/** Append @a term to @a result, reusing a prefix of the previous term.
+ *
+ *  We encode the length of the rest of the term and how many bytes to reuse
+ *  (up to 7) together, so that the common case costs the same single byte as
+ *  just encoding the length of the term, and then any excess reused bytes
+ *  separately.
+ *
+ *  @param result	The string to append to.
+ *  @param prev_term	The previous term appended (NULL for the first term),
+ *			updated to point to @a term.
+ *  @param term		The term to append.
+ */
+static void
+append_term(string & result, const string *& prev_term, const string & term)
+{
+    size_t reuse = prev_term ? common_prefix_length(*prev_term, term) : 0;
+    size_t len = term.size() - reuse;
+    if (reuse < 7) {
+	result += encode_length((len << 3) | reuse);
+    } else {
+	result += encode_length((len << 3) | 7);
+	result += encode_length(reuse - 7);
+    }
+    result.append(term, reuse, string::npos);
+    prev_term = &term;
+}
+
+/** Decode a term appended by append_term().
+ *
+ *  @param term	On entry, the previous term decoded; on exit, the new term.
+ */
+static void
+decode_term(const char ** p, const char * p_end, string & term)
+{
+    size_t code = decode_length(p, p_end, false);
+    size_t reuse = code & 7;
+    if (reuse == 7) reuse += decode_length(p, p_end, false);
+    size_t len = code >> 3;
+    if (reuse > term.size() || len > size_t(p_end - *p))
+	throw Xapian::NetworkError("Bad encoded term");
+    term.resize(reuse);
+    term.append(*p, len);
+    *p += len;
+}
+
 string
 serialise_stats(const Xapian::Weight::Internal &stats)
 {
@@ -100,10 +147,12 @@ serialise_stats(const Xapian::Weight::Internal &stats)
     result += encode_length(stats.rset_size);
 
     result += encode_length(stats.termfreqs.size());
+    // The terms are in sorted order, so we just send how many bytes of the
+    // previous term to reuse and then the rest of the term.
+    const string * prev_term = NULL;
     map<string, TermFreqs>::const_iterator i;
     for (i = stats.termfreqs.begin(); i != stats.termfreqs.end(); ++i) {
-	result += encode_length(i->first.size());
-	result += i->first;
+	append_term(result, prev_term, i->first);
 	result += encode_length(i->second.termfreq);
 	if (stats.rset_size != 0)
 	    result += encode_length(i->second.reltermfreq);
@@ -125,18 +174,15 @@ unserialise_stats(const string &s)
     stat.rset_size = decode_length(&p, p_end, false);
 
     size_t n = decode_length(&p, p_end, false);
+    string term;
     while (n--) {
-	size_t len = decode_length(&p, p_end, true);
-	string term(p, len);
-	p += len;
+	decode_term(&p, p_end, term);
 	Xapian::doccount termfreq(decode_length(&p, p_end, false));
-	if (stat.rset_size == 0) {
-	    stat.termfreqs.insert(make_pair(term, TermFreqs(termfreq, 0)));
-	} else {
-	    Xapian::doccount reltermfreq(decode_length(&p, p_end, false));
-	    stat.termfreqs.insert(make_pair(term,
-					    TermFreqs(termfreq, reltermfreq)));
-	}
+	Xapian::doccount reltermfreq = 0;
+	if (stat.rset_size != 0)
+	    reltermfreq = decode_length(&p, p_end, false);
+	stat.termfreqs.insert(stat.termfreqs.end(),
+			      make_pair(term, TermFreqs(termfreq, reltermfreq)));
     }
 
     return stat;
@@ -159,22 +205,37 @@ serialise_mset(const Xapian::MSet &mset)
 
     result += serialise_double(mset.internal->percent_factor);
 
+    // Only send the collapse key and count for each item if any item has
+    // them, which saves two bytes per item in the common case.
+    bool collapsed = false;
+    for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i) {
+	if (!i.get_collapse_key().empty() || i.get_collapse_count()) {
+	    collapsed = true;
+	    break;
+	}
+    }
+
+    // Bit 0 of the flags says if the collapse fields are sent, and bit 1 if
+    // the match was cut short by the time limit.
     result += encode_length(mset.size());
+    result += char('0' + (collapsed ? 1 : 0) + (mset.timed_out() ? 2 : 0));
     for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i) {
 	result += serialise_double(i.get_weight());
 	result += encode_length(*i);
-	result += encode_length(i.get_collapse_key().size());
-	result += i.get_collapse_key();
-	result += encode_length(i.get_collapse_count());
+	if (collapsed) {
+	    result += encode_length(i.get_collapse_key().size());
+	    result += i.get_collapse_key();
+	    result += encode_length(i.get_collapse_count());
+	}
     }
 
     const map<string, Xapian::MSet::Internal::TermFreqAndWeight> &termfreqandwts
 	= mset.internal->termfreqandwts;
 
+    const string * prev_term = NULL;
     map<string, Xapian::MSet::Internal::TermFreqAndWeight>::const_iterator j;
     for (j = termfreqandwts.begin(); j != termfreqandwts.end(); ++j) {
-	result += encode_length(j->first.size());
-	result += j->first;
+	append_term(result, prev_term, j->first);
 	result += encode_length(j->second.termfreq);
 	result += serialise_double(j->second.termweight);
     }
@@ -199,28 +260,36 @@ unserialise_mset(const char * p, const char * p_end)
 
     vector<Xapian::Internal::MSetItem> items;
     size_t msize = decode_length(&p, p_end, false);
+    if (p == p_end || *p < '0' || *p > '3')
+	throw Xapian::NetworkError("Bad serialised MSet");
+    int flags = *p++ - '0';
+    bool collapsed = (flags & 1);
+    items.reserve(msize);
     while (msize-- > 0) {
 	double wt = unserialise_double(&p, p_end);
 	Xapian::docid did = decode_length(&p, p_end, false);
-	size_t len = decode_length(&p, p_end, true);
-	string key(p, len);
-	p += len;
-	Xapian::doccount collapse_cnt = decode_length(&p, p_end, false);
+	string key;
+	Xapian::doccount collapse_cnt = 0;
+	if (collapsed) {
+	    size_t len = decode_length(&p, p_end, true);
+	    key.assign(p, len);
+	    p += len;
+	    collapse_cnt = decode_length(&p, p_end, false);
+	}
 	items.push_back(Xapian::Internal::MSetItem(wt, did, key, collapse_cnt));
     }
 
     map<string, Xapian::MSet::Internal::TermFreqAndWeight> terminfo;
+    string term;
     while (p != p_end) {
 	Xapian::MSet::Internal::TermFreqAndWeight tfaw;
-	size_t len = decode_length(&p, p_end, true);
-	string term(p, len);
-	p += len;
+	decode_term(&p, p_end, term);
 	tfaw.termfreq = decode_length(&p, p_end, false);
 	tfaw.termweight = unserialise_double(&p, p_end);
-	terminfo.insert(make_pair(term, tfaw));
+	terminfo.insert(terminfo.end(), make_pair(term, tfaw));
     }
 
-    return Xapian::MSet(new Xapian::MSet::Internal(
+    Xapian::MSet mset(new Xapian::MSet::Internal(
 				       firstitem,
 				       matches_upper_bound,
 				       matches_lower_bound,
@@ -230,6 +299,8 @@ unserialise_mset(const char * p, const char * p_end)
 				       uncollapsed_estimated,
 				       max_possible, max_attained,
 				       items, terminfo, percent_factor));
+    mset.internal->timed_out = (flags & 2);
+    return mset;
 }
 
 string
@@ -344,3 +415,60 @@ unserialise_document(const string &s)
     doc.set_data(string(p, p_end - p));
     return doc;
 }
+
+/// Don't try to compress messages smaller than this.
+static const size_t MIN_COMPRESS_SIZE = 256;
+
+string
+compress_message(const string &message)
+{
+    if (message.size() >= MIN_COMPRESS_SIZE) {
+	CompressionStream comp_stream;
+	comp_stream.lazy_alloc_deflate_zstream();
+	z_stream * zstream = comp_stream.deflate_zstream;
+	zstream->next_in = (Bytef *)const_cast<char *>(message.data());
+	zstream->avail_in = (uInt)message.size();
+
+	// Only allow the compressed version to be smaller than the original
+	// (including the byte flagging which it is).
+	string result(message.size(), '1');
+	zstream->next_out = reinterpret_cast<Bytef *>(&result[1]);
+	zstream->avail_out = (uInt)(message.size() - 1);
+	if (deflate(zstream, Z_FINISH) == Z_STREAM_END) {
+	    result.resize(1 + zstream->total_out);
+	    return result;
+	}
+    }
+    string result(1, '0');
+    result += message;
+    return result;
+}
+
+string
+uncompress_message(const string &s)
+{
+    if (s.empty() || (s[0] != '0' && s[0] != '1'))
+	throw Xapian::NetworkError("Bad compressed message");
+    if (s[0] == '0') return s.substr(1);
+
+    CompressionStream comp_stream;
+    comp_stream.lazy_alloc_inflate_zstream();
+    z_stream * zstream = comp_stream.inflate_zstream;
+    zstream->next_in = (Bytef*)const_cast<char *>(s.data() + 1);
+    zstream->avail_in = (uInt)(s.size() - 1);
+
+    string result;
+    int err;
+    do {
+	Bytef buf[8192];
+	zstream->next_out = buf;
+	zstream->avail_out = (uInt)sizeof(buf);
+	err = inflate(zstream, Z_SYNC_FLUSH);
+	if (err != Z_OK && err != Z_STREAM_END)
+	    throw Xapian::NetworkError("Bad compressed message");
+	result.append(reinterpret_cast<const char *>(buf),
+		      zstream->next_out - buf);
+    } while (err != Z_STREAM_END);
+
+    return result;
+}
@@ -127,4 +127,24 @@ std::string serialise_document(const Xapian::Document &doc);
  */
 Xapian::Document unserialise_document(const std::string &s);
 
+/** Compress a message, if that makes it smaller.
+ *
+ *  @param message	The message to compress.
+ *
+ *  @return		'1' followed by @a message compressed with zlib, or
+ *			'0' followed by @a message if it's too short to be
+ *			worth compressing or compression didn't help.
+ */
+XAPIAN_VISIBILITY_DEFAULT
+std::string compress_message(const std::string &message);
+
+/** Reverse the effect of compress_message().
+ *
+ *  @param s		The string returned by compress_message().
+ *
+ *  @return		The original message.
+ */
+XAPIAN_VISIBILITY_DEFAULT
+std::string uncompress_message(const std::string &s);
+
 #endif
@@ -30,6 +30,7 @@
 #include "safefcntl.h"
 
 #include "noreturn.h"
+#include "realtime.h"
 #include "remoteconnection.h"
 
 #ifdef __WIN32__
@@ -46,7 +47,9 @@
 # include <sys/wait.h>
 #endif
 
+#include <algorithm>
 #include <iostream>
+#include <map>
 
 #include <cstring>
 #include <cstdio> // For sprintf() on __WIN32__ or cygwin.
@@ -80,7 +83,7 @@ TcpServer::TcpServer(const std::string & host, int port, bool tcp_nodelay,
 					 , mutex
 #endif
 					 )),
-      verbose(verbose_)
+      verbose(verbose_), persistent_handler(false)
 {
 }
 
@@ -353,6 +356,120 @@ TcpServer::run()
     }
 }
 
+/// Initial delay (in seconds) after a worker fails to accept a connection.
+const double MIN_ACCEPT_BACKOFF = 0.01;
+
+/// Maximum delay (in seconds) after a worker fails to accept a connection.
+const double MAX_ACCEPT_BACKOFF = 5.0;
+
+/// Workers which exit sooner than this (in seconds) delay their replacement.
+const double MIN_WORKER_LIFETIME = 1.0;
+
+/// Initial delay (in seconds) before replacing a worker which exited early.
+const double MIN_RESPAWN_DELAY = 0.1;
+
+/// Maximum delay (in seconds) before replacing a worker which exited early.
+const double MAX_RESPAWN_DELAY = 10.0;
+
+void
+TcpServer::run_workers(unsigned n_workers)
+{
+    if (n_workers == 0) n_workers = 1;
+
+    // Only the parent handles SIGTERM specially - it passes the signal on to
+    // the workers.
+    signal(SIGTERM, on_SIGTERM);
+
+    // When each worker was started, so we can tell if workers are exiting
+    // straight away, in which case we back off rather than fork repeatedly.
+    map<pid_t, double> started;
+    double respawn_delay = 0.0;
+    while (true) {
+	if (respawn_delay > 0.0 && started.size() < n_workers)
+	    RealTime::sleep(RealTime::now() + respawn_delay);
+	while (started.size() < n_workers) {
+	    pid_t pid = fork();
+	    if (pid == 0) {
+		// Worker process.
+		signal(SIGTERM, SIG_DFL);
+		persistent_handler = true;
+		double backoff = 0.0;
+		while (true) {
+		    int connected_socket;
+		    try {
+			connected_socket = accept_connection();
+		    } catch (const Xapian::Error &e) {
+			// Probably a transient problem (such as running out of
+			// file descriptors), so report it and try again.  If it
+			// keeps happening, wait longer each time so we don't
+			// spin and flood stderr.
+			cerr << "Caught " << e.get_description() << endl;
+			if (backoff == 0.0) {
+			    backoff = MIN_ACCEPT_BACKOFF;
+			} else {
+			    backoff = min(backoff * 2, MAX_ACCEPT_BACKOFF);
+			}
+			RealTime::sleep(RealTime::now() + backoff);
+			continue;
+		    }
+		    backoff = 0.0;
+
+		    try {
+			handle_one_connection(connected_socket);
+		    } catch (const Xapian::Error &e) {
+			cerr << "Caught " << e.get_description() << endl;
+		    } catch (...) {
+			// We don't know what state we're in, so exit and let
+			// the parent start a fresh worker.
+			cerr << "Caught exception." << endl;
+			close(connected_socket);
+			exit(1);
+		    }
+		    // We handle connections one after another for the life of
+		    // the process, so we must close each one whatever happened
+		    // or we'll eventually run out of file descriptors.
+		    close(connected_socket);
+
+		    if (verbose) cout << "Closing connection." << endl;
+		}
+	    }
+
+	    // Parent process.
+
+	    if (pid < 0) {
+		if (started.empty())
+		    throw Xapian::NetworkError("fork failed", errno);
+		// Run with the workers we have and try again when one exits.
+		break;
+	    }
+	    started[pid] = RealTime::now();
+	}
+
+	// Wait for a worker to exit, then start a replacement for it.
+	int status;
+	pid_t pid = wait(&status);
+	if (pid > 0) {
+	    map<pid_t, double>::iterator i = started.find(pid);
+	    if (i == started.end()) continue;
+	    if (RealTime::now() - i->second < MIN_WORKER_LIFETIME) {
+		if (respawn_delay == 0.0) {
+		    respawn_delay = MIN_RESPAWN_DELAY;
+		} else {
+		    respawn_delay = min(respawn_delay * 2, MAX_RESPAWN_DELAY);
+		}
+		cerr << "Worker exited after less than " << MIN_WORKER_LIFETIME
+		     << " seconds - waiting " << respawn_delay
+		     << " seconds before starting another" << endl;
+	    } else {
+		respawn_delay = 0.0;
+	    }
+	    started.erase(i);
+	} else if (errno == ECHILD) {
+	    started.clear();
+	}
+    }
+}
+
 #elif defined __WIN32__
 
 // A threaded, Windows specific, implementation.
@@ -473,6 +590,14 @@ TcpServer::run()
     }
 }
 
+void
+TcpServer::run_workers(unsigned)
+{
+    // Connections are already handled by a thread each, and there's no way
+    // to share state between them safely, so just do the same as run().
+    run();
+}
+
 void
 TcpServer::run_once()
 {
@@ -73,6 +73,15 @@ class XAPIAN_VISIBILITY_DEFAULT TcpServer SOCKET_INITIALIZER_MIXIN {
     /** Should we produce output when connections are made or lost? */
     bool verbose;
 
+    /** Is handle_one_connection() called repeatedly in the same process?
+     *
+     *  This is true in the worker processes started by run_workers(), and
+     *  means that a subclass can keep expensive state (such as open
+     *  databases) from one connection to the next.  It is never true when
+     *  connections may be handled concurrently in the same process.
+     */
+    bool persistent_handler;
+
     /** Accept a connection and return the filedescriptor for it. */
     int accept_connection();
 
@@ -100,6 +109,23 @@ class XAPIAN_VISIBILITY_DEFAULT TcpServer SOCKET_INITIALIZER_MIXIN {
      */
     void run();
 
+    /** Accept connections and service requests indefinitely using a pool
+     *  of worker processes.
+     *
+     *  Rather than forking for each connection, @a n_workers processes are
+     *  started up front and each accepts and serves connections in turn,
+     *  so handle_one_connection() can reuse state between connections.
+     *  If a worker process exits, a replacement is started - if workers
+     *  keep exiting straight away, the replacements are started after an
+     *  increasing delay.  A worker which fails to accept connections also
+     *  waits for an increasing time before trying again.
+     *
+     *  On platforms without fork() this is the same as run().
+     *
+     *  @param n_workers	The number of worker processes to run.
+     */
+    void run_workers(unsigned n_workers);
+
     /** Accept a single connection, service requests on it, then stop.  */
     void run_once();
 
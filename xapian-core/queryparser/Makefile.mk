@@ -59,6 +59,7 @@ endif
 
 lib_src +=\
 	queryparser/cjk-tokenizer.cc\
+	queryparser/cjksegmenter.cc\
 	queryparser/queryparser.cc\
 	queryparser/queryparser_internal.cc\
 	queryparser/termgenerator.cc\
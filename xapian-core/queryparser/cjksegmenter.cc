@@ -0,0 +1,241 @@
+/** @file cjksegmenter.cc
+ * @brief Split CJK text into words using a dictionary.
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include <xapian/queryparser.h>
+
+#include <xapian/error.h>
+#include <xapian/unicode.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "str.h"
+
+using namespace std;
+
+namespace Xapian {
+
+// Default implementation in case the user hasn't implemented it.
+string
+CJKSegmenter::get_description() const
+{
+    return "Xapian::CJKSegmenter subclass";
+}
+
+/** The dictionary, stored as a trie keyed by Unicode character.
+ *
+ *  This lets us find all the dictionary words starting at a particular
+ *  position in the text in a single pass over the following characters.
+ */
+class DictionaryCJKSegmenter::Internal
+    : public Xapian::Internal::intrusive_base {
+    struct Node {
+	/// Frequency of the word ending at this node (0 if none does).
+	Xapian::termcount freq;
+
+	/// Children as (character, node index) pairs, sorted by character.
+	vector<pair<unsigned, size_t> > children;
+
+	Node() : freq(0) { }
+    };
+
+    /// The nodes of the trie - node 0 is the root.
+    deque<Node> nodes;
+
+    /// Sum of the frequencies of all the words.
+    double total_freq;
+
+    /// Number of words in the dictionary.
+    Xapian::termcount word_count;
+
+    /// Find child of node @a i for character @a ch, or 0 if there isn't one.
+    size_t find_child(size_t i, unsigned ch) const {
+	const vector<pair<unsigned, size_t> > & children = nodes[i].children;
+	vector<pair<unsigned, size_t> >::const_iterator c;
+	c = lower_bound(children.begin(), children.end(),
+			make_pair(ch, size_t(0)));
+	if (c == children.end() || c->first != ch) return 0;
+	return c->second;
+    }
+
+  public:
+    Internal() : nodes(1), total_freq(0), word_count(0) { }
+
+    void add_word(const string & word, Xapian::termcount freq);
+
+    void segment(const string & text, vector<string> & words) const;
+
+    Xapian::termcount get_word_count() const { return word_count; }
+};
+
+void
+DictionaryCJKSegmenter::Internal::add_word(const string & word,
+					   Xapian::termcount freq)
+{
+    if (word.empty() || freq == 0) return;
+    size_t i = 0;
+    for (Utf8Iterator u(word); u != Utf8Iterator(); ++u) {
+	unsigned ch = *u;
+	vector<pair<unsigned, size_t> > & children = nodes[i].children;
+	vector<pair<unsigned, size_t> >::iterator c;
+	c = lower_bound(children.begin(), children.end(),
+			make_pair(ch, size_t(0)));
+	if (c == children.end() || c->first != ch) {
+	    size_t child = nodes.size();
+	    children.insert(c, make_pair(ch, child));
+	    nodes.push_back(Node());
+	    i = child;
+	} else {
+	    i = c->second;
+	}
+    }
+    if (nodes[i].freq == 0) ++word_count;
+    nodes[i].freq += freq;
+    total_freq += freq;
+}
+
+void
+DictionaryCJKSegmenter::Internal::segment(const string & text,
+					  vector<string> & words) const
+{
+    vector<unsigned> chars;
+    vector<size_t> offsets;
+    for (Utf8Iterator u(text); u != Utf8Iterator(); ++u) {
+	chars.push_back(*u);
+	offsets.push_back(text.size() - u.left());
+    }
+    size_t n = chars.size();
+    offsets.push_back(text.size());
+
+    // Working back from the end of the text, find the best way to split
+    // the characters from each position onwards.  A word's score is the
+    // log of its probability, so the best split is the one with the highest
+    // total score.  Characters which aren't in the dictionary get the score
+    // of a word with frequency 1.
+    double log_total = log(max(total_freq, 1.0));
+    vector<double> best(n + 1);
+    vector<size_t> word_end(n + 1);
+    best[n] = 0.0;
+    for (size_t i = n; i-- > 0; ) {
+	if (!Unicode::is_wordchar(chars[i])) {
+	    best[i] = best[i + 1];
+	    word_end[i] = i + 1;
+	    continue;
+	}
+	double score = best[i + 1] - log_total;
+	size_t end = i + 1;
+	size_t node = 0;
+	for (size_t j = i; j != n; ++j) {
+	    node = find_child(node, chars[j]);
+	    if (node == 0) break;
+	    Xapian::termcount freq = nodes[node].freq;
+	    if (freq == 0) continue;
+	    double s = log(double(freq)) - log_total + best[j + 1];
+	    // Prefer longer words if the scores are equal.
+	    if (s >= score) {
+		score = s;
+		end = j + 1;
+	    }
+	}
+	best[i] = score;
+	word_end[i] = end;
+    }
+
+    size_t i = 0;
+    while (i != n) {
+	size_t end = word_end[i];
+	if (Unicode::is_wordchar(chars[i]))
+	    words.push_back(text.substr(offsets[i], offsets[end] - offsets[i]));
+	i = end;
+    }
+}
+
+DictionaryCJKSegmenter::DictionaryCJKSegmenter(const DictionaryCJKSegmenter & o)
+    : CJKSegmenter(), internal(o.internal) { }
+
+DictionaryCJKSegmenter &
+DictionaryCJKSegmenter::operator=(const DictionaryCJKSegmenter & o)
+{
+    internal = o.internal;
+    return *this;
+}
+
+DictionaryCJKSegmenter::DictionaryCJKSegmenter()
+    : internal(new DictionaryCJKSegmenter::Internal) { }
+
+DictionaryCJKSegmenter::DictionaryCJKSegmenter(const string & filename)
+    : internal(new DictionaryCJKSegmenter::Internal)
+{
+    ifstream in(filename.c_str());
+    if (!in) {
+	string msg = "Couldn't open dictionary file '";
+	msg += filename;
+	msg += '\'';
+	throw Xapian::InvalidArgumentError(msg, errno);
+    }
+    string line;
+    while (getline(in, line)) {
+	string::size_type word_end = line.find_first_of(" \t\r");
+	if (word_end == 0) continue;
+	Xapian::termcount freq = 1;
+	if (word_end != string::npos) {
+	    const char * p = line.c_str() + word_end;
+	    char * end;
+	    unsigned long v = strtoul(p, &end, 10);
+	    if (end != p) freq = v;
+	}
+	internal->add_word(line.substr(0, word_end), freq);
+    }
+}
+
+DictionaryCJKSegmenter::~DictionaryCJKSegmenter() { }
+
+void
+DictionaryCJKSegmenter::add_word(const string & word, Xapian::termcount freq)
+{
+    internal->add_word(word, freq);
+}
+
+void
+DictionaryCJKSegmenter::operator()(const string & text,
+				   vector<string> & words) const
+{
+    internal->segment(text, words);
+}
+
+string
+DictionaryCJKSegmenter::get_description() const
+{
+    string desc("Xapian::DictionaryCJKSegmenter(");
+    desc += str(internal->get_word_count());
+    desc += " words)";
+    return desc;
+}
+
+}
@@ -138,6 +138,19 @@ QueryParser::set_max_wildcard_expansion(Xapian::termcount max)
     internal->max_wildcard_expansion = max;
 }
 
+void
+QueryParser::set_partial_prefix_lengths(unsigned min_len, unsigned max_len)
+{
+    internal->partial_prefix_min = min_len;
+    internal->partial_prefix_max = max_len;
+}
+
+void
+QueryParser::set_cjk_segmenter(const CJKSegmenter * segmenter)
+{
+    internal->cjk_segmenter = segmenter;
+}
+
 Query
 QueryParser::parse_query(const string &query_string, unsigned flags,
 			 const string &default_prefix)
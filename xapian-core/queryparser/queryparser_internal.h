@@ -88,6 +88,12 @@ class QueryParser::Internal : public Xapian::Internal::intrusive_base {
 
     Xapian::termcount max_wildcard_expansion;
 
+    unsigned partial_prefix_min;
+
+    unsigned partial_prefix_max;
+
+    const CJKSegmenter * cjk_segmenter;
+
     void add_prefix(const string &field, const string &prefix,
 		    filter_type type);
 
@@ -100,7 +106,8 @@ class QueryParser::Internal : public Xapian::Internal::intrusive_base {
 
   public:
     Internal() : stem_action(STEM_SOME), stopper(NULL),
-	default_op(Query::OP_OR), errmsg(NULL), max_wildcard_expansion(0) { }
+	default_op(Query::OP_OR), errmsg(NULL), max_wildcard_expansion(0),
+	partial_prefix_min(1), partial_prefix_max(6), cjk_segmenter(NULL) { }
 
     Query parse_query(const string & query_string, unsigned int flags, const string & default_prefix);
 };
@@ -94,6 +94,19 @@ TermGenerator::set_max_word_length(unsigned max_word_length)
     internal->max_word_length = max_word_length;
 }
 
+void
+TermGenerator::set_partial_prefix_lengths(unsigned min_len, unsigned max_len)
+{
+    internal->partial_prefix_min = min_len;
+    internal->partial_prefix_max = max_len;
+}
+
+void
+TermGenerator::set_cjk_segmenter(const Xapian::CJKSegmenter * segmenter)
+{
+    internal->cjk_segmenter = segmenter;
+}
+
 void
 TermGenerator::index_text(const Xapian::Utf8Iterator & itor,
 			  Xapian::termcount weight,
@@ -30,6 +30,8 @@
 
 #include <limits>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "cjk-tokenizer.h"
 
@@ -42,11 +44,58 @@ U_isupper(unsigned ch) {
     return (ch < 128 && C_isupper((unsigned char)ch));
 }
 
+/** Check if an ASCII character is a word character.
+ *
+ *  This gives the same answers as the Unicode code path below, but uses
+ *  the character class tables from stringutils.h instead of looking up the
+ *  Unicode character properties.
+ *
+ *  @return The lower case form of @a ch if it's a word character, or 0 if
+ *	    it isn't.
+ */
+inline unsigned check_wordchar_ascii(unsigned char ch) {
+    if (C_isalnum(ch)) return static_cast<unsigned char>(C_tolower(ch));
+    if (ch == '_') return ch;
+    return 0;
+}
+
 inline unsigned check_wordchar(unsigned ch) {
+    if (ch < 128) return check_wordchar_ascii(ch);
     if (Unicode::is_wordchar(ch)) return Unicode::tolower(ch);
     return 0;
 }
 
+/** Advance @a itor to the next word character.
+ *
+ *  @return The lower case form of the word character, or 0 if the end of
+ *	    the text was reached.
+ */
+static unsigned
+skip_to_wordchar(Utf8Iterator & itor)
+{
+    while (itor != Utf8Iterator()) {
+	// Skip ASCII characters without decoding them.
+	const char * p = itor.raw();
+	const char * end = p + itor.left();
+	while (static_cast<unsigned char>(*p) < 128) {
+	    unsigned ch = check_wordchar_ascii(*p);
+	    if (ch) {
+		itor.assign(p, end - p);
+		return ch;
+	    }
+	    if (++p == end) {
+		itor = Utf8Iterator();
+		return 0;
+	    }
+	}
+	itor.assign(p, end - p);
+	unsigned ch = check_wordchar(*itor);
+	if (ch) return ch;
+	++itor;
+    }
+    return 0;
+}
+
 inline bool
 should_stem(const std::string & term)
 {
@@ -55,6 +104,8 @@ should_stem(const std::string & term)
 	(1 << Unicode::TITLECASE_LETTER) |
 	(1 << Unicode::MODIFIER_LETTER) |
 	(1 << Unicode::OTHER_LETTER);
+    unsigned char first = term[0];
+    if (first < 128) return C_isalpha(first);
     Utf8Iterator u(term);
     return ((SHOULD_STEM_MASK >> Unicode::get_category(*u)) & 1);
 }
@@ -103,6 +154,7 @@ inline unsigned check_infix_digit(unsigned ch) {
 
 inline bool
 is_digit(unsigned ch) {
+    if (ch < 128) return C_isdigit(ch);
     return (Unicode::get_category(ch) == Unicode::DECIMAL_DIGIT_NUMBER);
 }
 
@@ -112,6 +164,26 @@ inline unsigned check_suffix(unsigned ch) {
     return 0;
 }
 
+void
+TermGenerator::Internal::index_partial_prefixes(const string & term,
+						termcount wdf_inc,
+						const string & prefix)
+{
+    // The QueryParser looks for these with FLAG_PARTIAL_PREFIXES.
+    string ngram("^");
+    ngram += prefix;
+    size_t base_len = ngram.size();
+    unsigned len = 0;
+    Utf8Iterator i(term);
+    while (i != Utf8Iterator() && len < partial_prefix_max) {
+	++i;
+	if (++len < partial_prefix_min) continue;
+	ngram.resize(base_len);
+	ngram.append(term, 0, term.size() - i.left());
+	doc.add_term(ngram, wdf_inc);
+    }
+}
+
 // FIXME: add API for this:
 #define STOPWORDS_NONE 0
 #define STOPWORDS_IGNORE 1
@@ -121,21 +193,24 @@ void
 TermGenerator::Internal::index_text(Utf8Iterator itor, termcount wdf_inc,
 				    const string & prefix, bool with_positions)
 {
-    bool cjk_ngram = CJK::is_cjk_enabled();
+    bool cjk_ngram = cjk_segmenter || CJK::is_cjk_enabled();
 
     int stop_mode = STOPWORDS_INDEX_UNSTEMMED_ONLY;
 
     if (!stopper) stop_mode = STOPWORDS_NONE;
 
+    // Reused for each term to avoid allocating a new string for every stem.
+    string stem, stemmed;
+
+    // The tokens from each run of CJK characters, and whether each should
+    // get a position.
+    vector<string> cjk_words;
+    vector<pair<string, bool> > cjk_tokens;
+
     while (true) {
 	// Advance to the start of the next term.
-	unsigned ch;
-	while (true) {
-	    if (itor == Utf8Iterator()) return;
-	    ch = check_wordchar(*itor);
-	    if (ch) break;
-	    ++itor;
-	}
+	unsigned ch = skip_to_wordchar(itor);
+	if (!ch) return;
 
 	string term;
 	// Look for initials separated by '.' (e.g. P.T.O., U.N.C.L.E).
@@ -162,8 +237,26 @@ TermGenerator::Internal::index_text(Utf8Iterator itor, termcount wdf_inc,
 	while (true) {
 	    if (cjk_ngram && CJK::codepoint_is_cjk(*itor)) {
 		const string & cjk = CJK::get_cjk(itor);
-		for (CJKTokenIterator tk(cjk); tk != CJKTokenIterator(); ++tk) {
-		    const string & cjk_token = *tk;
+		cjk_tokens.clear();
+		if (cjk_segmenter) {
+		    // Index each word like a word in any other script.
+		    cjk_words.clear();
+		    (*cjk_segmenter)(cjk, cjk_words);
+		    vector<string>::const_iterator w;
+		    for (w = cjk_words.begin(); w != cjk_words.end(); ++w)
+			cjk_tokens.push_back(make_pair(*w, true));
+		} else {
+		    // Only single characters get positions.
+		    for (CJKTokenIterator tk(cjk); tk != CJKTokenIterator(); ++tk) {
+			// The length is only valid after dereferencing.
+			const string & cjk_token = *tk;
+			cjk_tokens.push_back(make_pair(cjk_token,
+						       tk.get_length() == 1));
+		    }
+		}
+		vector<pair<string, bool> >::const_iterator tk;
+		for (tk = cjk_tokens.begin(); tk != cjk_tokens.end(); ++tk) {
+		    const string & cjk_token = tk->first;
 		    if (cjk_token.size() > max_word_length) continue;
 
 		    if (stop_mode == STOPWORDS_IGNORE && (*stopper)(cjk_token))
@@ -171,7 +264,7 @@ TermGenerator::Internal::index_text(Utf8Iterator itor, termcount wdf_inc,
 
 		    if (strategy == TermGenerator::STEM_SOME ||
 			strategy == TermGenerator::STEM_NONE) {
-			if (with_positions && tk.get_length() == 1) {
+			if (with_positions && tk->second) {
 			    doc.add_posting(prefix + cjk_token, ++termpos, wdf_inc);
 			} else {
 			    doc.add_term(prefix + cjk_token, wdf_inc);
@@ -196,12 +289,13 @@ TermGenerator::Internal::index_text(Utf8Iterator itor, termcount wdf_inc,
 		    }
 
 		    // Add stemmed form without positional information.
-		    string stem;
+		    stem.resize(0);
 		    if (strategy != TermGenerator::STEM_ALL) {
 			stem += "Z";
 		    }
 		    stem += prefix;
-		    stem += stemmer(cjk_token);
+		    stemmer(cjk_token, stemmed);
+		    stem += stemmed;
 		    if (strategy != TermGenerator::STEM_SOME &&
 			with_positions) {
 			doc.add_posting(stem, ++termpos, wdf_inc);
@@ -209,15 +303,39 @@ TermGenerator::Internal::index_text(Utf8Iterator itor, termcount wdf_inc,
 			doc.add_term(stem, wdf_inc);
 		    }
 		}
-		while (true) {
-		    if (itor == Utf8Iterator()) return;
-		    ch = check_wordchar(*itor);
-		    if (ch) break;
-		    ++itor;
-		}
+		ch = skip_to_wordchar(itor);
+		if (!ch) return;
 	    }
 	    unsigned prevch;
 	    do {
+		if (ch < 128) {
+		    // Most text is largely ASCII, so handle a run of ASCII
+		    // characters by scanning the bytes directly, which avoids
+		    // decoding UTF-8 and looking up Unicode character
+		    // properties for each one.
+		    const char * p = itor.raw();
+		    const char * end = p + itor.left();
+		    do {
+			term += char(ch);
+			prevch = ch;
+			if (++p == end) {
+			    itor = Utf8Iterator();
+			    goto endofterm;
+			}
+			ch = static_cast<unsigned char>(*p);
+			if (ch >= 128) break;
+			ch = check_wordchar_ascii(ch);
+		    } while (ch);
+		    itor.assign(p, end - p);
+		    // Stop at an ASCII non-word character.
+		    if (ch == 0) break;
+		    // Otherwise we're at a non-ASCII character, so check it
+		    // the slow way.
+		    if (cjk_ngram && CJK::codepoint_is_cjk(*itor))
+			goto endofterm;
+		    ch = check_wordchar(*itor);
+		    continue;
+		}
 		Unicode::append_utf8(term, ch);
 		prevch = ch;
 		if (++itor == Utf8Iterator() ||
@@ -275,6 +393,8 @@ endofterm:
 	    }
 	}
 	if ((flags & FLAG_SPELLING) && prefix.empty()) db.add_spelling(term);
+	if (flags & FLAG_PARTIAL_PREFIXES)
+	    index_partial_prefixes(term, wdf_inc, prefix);
 
 	if (strategy == TermGenerator::STEM_NONE ||
 	    !stemmer.internal.get()) continue;
@@ -289,12 +409,13 @@ endofterm:
 	}
 
 	// Add stemmed form without positional information.
-	string stem;
+	stem.resize(0);
 	if (strategy != TermGenerator::STEM_ALL) {
 	    stem += "Z";
 	}
 	stem += prefix;
-	stem += stemmer(term);
+	stemmer(term, stemmed);
+	stem += stemmed;
 	if (strategy != TermGenerator::STEM_SOME &&
 	    with_positions) {
 	    doc.add_posting(stem, ++termpos, wdf_inc);
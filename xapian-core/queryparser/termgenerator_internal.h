@@ -29,6 +29,7 @@
 
 namespace Xapian {
 
+class CJKSegmenter;
 class Stopper;
 
 class TermGenerator::Internal : public Xapian::Internal::intrusive_base {
@@ -40,11 +41,20 @@ class TermGenerator::Internal : public Xapian::Internal::intrusive_base {
     termcount termpos;
     TermGenerator::flags flags;
     unsigned max_word_length;
+    unsigned partial_prefix_min;
+    unsigned partial_prefix_max;
+    const CJKSegmenter * cjk_segmenter;
     WritableDatabase db;
 
+    /// Index the prefixes of @a term for FLAG_PARTIAL_PREFIXES.
+    void index_partial_prefixes(const std::string & term,
+				termcount wdf_inc,
+				const std::string & prefix);
+
   public:
     Internal() : strategy(STEM_SOME), stopper(NULL), termpos(0),
-	flags(TermGenerator::flags(0)), max_word_length(64) { }
+	flags(TermGenerator::flags(0)), max_word_length(64),
+	partial_prefix_min(1), partial_prefix_max(6), cjk_segmenter(NULL) { }
     void index_text(Utf8Iterator itor,
 		    termcount weight,
 		    const std::string & prefix,
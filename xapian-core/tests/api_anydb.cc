@@ -1097,6 +1097,37 @@ DEFINE_TESTCASE(fetchdocs1, backend) {
     return true;
 }
 
+/// Check prefetched documents are right when interleaved with other calls.
+DEFINE_TESTCASE(fetchdocs2, backend) {
+    Xapian::Database db(get_database("apitest_simpledata"));
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("this"));
+
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST_REL(mset.size(), >, 3);
+
+    // Request the documents in one order, then make other calls before
+    // reading them in a different order.
+    mset.fetch(mset[2], mset[mset.size() - 1]);
+    mset.fetch(mset[0], mset[1]);
+    TEST_EQUAL(db.get_termfreq("this"), mset.get_matches_estimated());
+    Xapian::MSet mset2 = enquire.get_mset(0, 3);
+    mset2.fetch();
+    TEST_REL(db.get_doclength(*mset[0]), >, 0);
+
+    for (Xapian::MSetIterator i = mset.end(); i != mset.begin(); ) {
+	--i;
+	TEST_EQUAL(i.get_document().get_data(),
+		   db.get_document(*i).get_data());
+    }
+    for (Xapian::MSetIterator i = mset2.begin(); i != mset2.end(); ++i) {
+	TEST_EQUAL(i.get_document().get_data(),
+		   db.get_document(*i).get_data());
+    }
+
+    return true;
+}
+
 // test that searching for a term not in the database fails nicely
 DEFINE_TESTCASE(absentterm1, backend) {
     Xapian::Enquire enquire(get_database("apitest_simpledata"));
@@ -1983,6 +2014,34 @@ DEFINE_TESTCASE(checkatleast3, backend) {
     return true;
 }
 
+/// Test Enquire::set_time_limit() and MSet::timed_out().
+DEFINE_TESTCASE(timelimit1, backend) {
+    Xapian::Enquire enquire(get_database("etext"));
+    enquire.set_query(Xapian::Query("prussian")); // 60 matches.
+
+    // A tiny time limit will have passed by the time the match starts
+    // looking for matching documents, so it should stop straight away.
+    enquire.set_time_limit(1e-6);
+    Xapian::MSet mset1 = enquire.get_mset(0, 10);
+    TEST(mset1.timed_out());
+    TEST_REL(mset1.size(),<,10);
+    TEST_REL(mset1.get_matches_upper_bound(),>=,60);
+
+    // A generous time limit shouldn't change anything.
+    enquire.set_time_limit(3600);
+    Xapian::MSet mset2 = enquire.get_mset(0, 10);
+    TEST(!mset2.timed_out());
+    TEST_MSET_SIZE(mset2, 10);
+    TEST_EQUAL(mset2.get_matches_estimated(), 60);
+
+    enquire.set_time_limit(0);
+    Xapian::MSet mset3 = enquire.get_mset(0, 10);
+    TEST(!mset3.timed_out());
+    TEST(mset_range_is_same(mset2, 0, mset3, 0, 10));
+
+    return true;
+}
+
 // tests all document postlists
 DEFINE_TESTCASE(allpostlist1, backend) {
     Xapian::Database db(get_database("apitest_manydocs"));
@@ -2325,3 +2384,65 @@ DEFINE_TESTCASE(uuid1, backend && !multi) {
 
     return true;
 }
+
+class DocidCollector : public Xapian::MatchVisitor {
+  public:
+    vector<Xapian::docid> docids;
+
+    string values;
+
+    void operator()(const Xapian::Document & doc) {
+	docids.push_back(doc.get_docid());
+	values += doc.get_value(1);
+	values += '\n';
+    }
+};
+
+/// Check Enquire::visit_matches() visits the same documents as get_mset().
+DEFINE_TESTCASE(visitmatches1,backend && !remote) {
+    Xapian::Database db = get_database("apitest_simpledata");
+    Xapian::Enquire enquire(db);
+    enquire.set_weighting_scheme(Xapian::BoolWeight());
+
+    const char * queries[] = { "this", "word", "paragraph", "nosuchterm" };
+    for (size_t q = 0; q != sizeof(queries) / sizeof(queries[0]); ++q) {
+	enquire.set_query(Xapian::Query(Xapian::Query::OP_OR,
+					Xapian::Query(queries[q]),
+					Xapian::Query("simple")));
+	DocidCollector visitor;
+	enquire.visit_matches(visitor);
+
+	Xapian::MSet mset = enquire.get_mset(0, db.get_doccount());
+	TEST_EQUAL(visitor.docids.size(), mset.size());
+	string values;
+	Xapian::MSetIterator i = mset.begin();
+	for (size_t j = 0; j != visitor.docids.size(); ++j, ++i) {
+	    TEST_EQUAL(visitor.docids[j], *i);
+	    values += i.get_document().get_value(1);
+	    values += '\n';
+	}
+	TEST_EQUAL(visitor.values, values);
+    }
+
+    // An empty query matches nothing.
+    enquire.set_query(Xapian::Query());
+    DocidCollector visitor;
+    enquire.visit_matches(visitor);
+    TEST(visitor.docids.empty());
+
+    return true;
+}
+
+DEFINE_TESTCASE(visitmatchesremote1,remote) {
+    Xapian::Database db = get_database("apitest_simpledata");
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("word"));
+    DocidCollector visitor;
+    TEST_EXCEPTION(Xapian::UnimplementedError,
+		   enquire.visit_matches(visitor));
+    // Check the connection to the remote server is still usable.
+    TEST_EQUAL(db.get_document(1).get_data().substr(0, 4), "This");
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), 2);
+    return true;
+}
@@ -228,6 +228,48 @@ DEFINE_TESTCASE(matchdecider4, remote) {
     return true;
 }
 
+/// Check that the remote server's reply cache returns the right results.
+DEFINE_TESTCASE(replycache2, replycache) {
+    Xapian::Enquire enquire(get_database("etext"));
+    enquire.set_query(Xapian::Query("prussian")); // 60 matches.
+
+    Xapian::MSet mset1 = enquire.get_mset(0, 10);
+    TEST(!mset1.timed_out());
+    TEST_MSET_SIZE(mset1, 10);
+
+    // The same query again should get the same results from the cache.
+    Xapian::MSet mset2 = enquire.get_mset(0, 10);
+    TEST(mset_range_is_same(mset1, 0, mset2, 0, 10));
+    TEST_EQUAL(mset2.get_matches_estimated(), mset1.get_matches_estimated());
+
+    // The cached results are from a match which finished, so they should be
+    // returned even though a match with this time limit would time out.
+    enquire.set_time_limit(1e-6);
+    Xapian::MSet mset3 = enquire.get_mset(0, 10);
+    TEST(!mset3.timed_out());
+    TEST(mset_range_is_same(mset1, 0, mset3, 0, 10));
+
+    // A match which isn't in the cache still times out, and the partial
+    // results aren't cached.
+    Xapian::MSet mset4 = enquire.get_mset(5, 10);
+    TEST(mset4.timed_out());
+    enquire.set_time_limit(0);
+    Xapian::MSet mset5 = enquire.get_mset(5, 10);
+    TEST(!mset5.timed_out());
+    TEST(mset_range_is_same(mset1, 5, mset5, 0, 5));
+
+    // Different queries mustn't get each other's cached results.
+    enquire.set_query(Xapian::Query("king"));
+    Xapian::MSet mset6 = enquire.get_mset(0, 10);
+    TEST_NOT_EQUAL(mset6.get_matches_estimated(), 60);
+    TEST(!mset_range_is_same(mset1, 0, mset6, 0, 10));
+    enquire.set_query(Xapian::Query("prussian"));
+    Xapian::MSet mset7 = enquire.get_mset(0, 10);
+    TEST(mset_range_is_same(mset1, 0, mset7, 0, 10));
+
+    return true;
+}
+
 /** Check that replacing an unmodified document doesn't increase the automatic
  *  flush counter.  Regression test for bug fixed in 1.1.4/1.0.18.
  */
@@ -22,9 +22,12 @@
 
 #include "api_collapse.h"
 
+#include <cstdlib>
+
 #include <xapian.h>
 
 #include "apitest.h"
+#include "str.h"
 #include "testutils.h"
 
 using namespace std;
@@ -81,3 +84,39 @@ DEFINE_TESTCASE(collapsekey5,backend) {
 
     return true;
 }
+
+/// Test collapsing on more distinct values than the matcher expected.
+DEFINE_TESTCASE(collapsekey6,writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    for (Xapian::docid did = 1; did <= 400; ++did) {
+	Xapian::Document doc;
+	if (did % 2 == 0) {
+	    doc.add_term("a");
+	    doc.add_term("b");
+	    // 150 different values - "1" to "50" are on two documents.
+	    doc.add_value(0, str((did / 2) % 150));
+	}
+	db.add_document(doc);
+    }
+    db.commit();
+
+    Xapian::Enquire enquire(db);
+    // The estimate for this query assumes "a" and "b" are independent, so
+    // it's too low, and the collapser has to grow its table.
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_AND,
+				    Xapian::Query("a"), Xapian::Query("b")));
+    enquire.set_collapse_key(0);
+    Xapian::MSet mset = enquire.get_mset(0, 200);
+    TEST_EQUAL(mset.size(), 150);
+
+    map<string, Xapian::doccount> seen;
+    for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i) {
+	const string & key = i.get_collapse_key();
+	TEST_EQUAL(++seen[key], 1);
+	unsigned n = atoi(key.c_str());
+	TEST_EQUAL(i.get_collapse_count(), (n >= 1 && n <= 50) ? 1 : 0);
+    }
+    TEST_EQUAL(seen.size(), 150);
+
+    return true;
+}
@@ -25,6 +25,12 @@
 
 #include <xapian.h>
 
+#include <algorithm>
+#include <cstdlib>
+#include <set>
+#include <vector>
+
+#include "str.h"
 #include "testsuite.h"
 #include "testutils.h"
 
@@ -145,3 +151,358 @@ DEFINE_TESTCASE(nearsubqueries1, writable) {
 
     return true;
 }
+
+DEFINE_TESTCASE(fuzzy1, !backend) {
+    Xapian::Query q(Xapian::Query::OP_FUZZY, "helo");
+    TEST_STRINGS_EQUAL(q.get_description(), "Query(FUZZY 2 helo)");
+    q = Xapian::Query(Xapian::Query::OP_FUZZY, "XAhelo", 10, 1, 2, 3);
+    TEST_STRINGS_EQUAL(q.get_description(), "Query(FUZZY 1 XAhelo)");
+    // OP_FUZZY counts as a single term for the query length.
+    TEST_EQUAL(q.get_length(), 1);
+    TEST(q.get_terms_begin() == q.get_terms_end());
+
+    TEST_EXCEPTION(Xapian::InvalidArgumentError,
+	Xapian::Query bad(Xapian::Query::OP_OR, "helo"));
+    TEST_EXCEPTION(Xapian::InvalidArgumentError,
+	Xapian::Query bad(Xapian::Query::OP_FUZZY, "helo", 0, 2, 5));
+
+    // This used to be ambiguous with the OP_FUZZY constructor.
+    Xapian::Query scaled(Xapian::Query::OP_SCALE_WEIGHT, string("foo"), 2.0);
+    TEST_STRINGS_EQUAL(scaled.get_description(), "Query(2 * foo)");
+
+    // Check the parameters survive serialisation.
+    Xapian::Query q2 = Xapian::Query::unserialise(q.serialise());
+    TEST_STRINGS_EQUAL(q2.get_description(), q.get_description());
+    TEST_STRINGS_EQUAL(q2.serialise(), q.serialise());
+    return true;
+}
+
+static Xapian::MSet
+fuzzy_mset(Xapian::Database & db, const Xapian::Query & q)
+{
+    Xapian::Enquire enq(db);
+    enq.set_query(q);
+    return enq.get_mset(0, db.get_doccount());
+}
+
+/** Check two MSets match the same documents with proportional weights.
+ *
+ *  The terms a query expands to are weighted as an OP_SYNONYM of them, but
+ *  the term frequency of the synonym is estimated without the intermediate
+ *  rounding of the binary OR tree which OP_SYNONYM uses, so the idf part of
+ *  the weights can differ slightly.
+ */
+static void
+check_synonym_weights(const Xapian::MSet & mset1, const Xapian::MSet & mset2)
+{
+    TEST_EQUAL(mset1.size(), mset2.size());
+    for (Xapian::doccount i = 0; i != mset1.size(); ++i) {
+	TEST_EQUAL(*mset1[i], *mset2[i]);
+	TEST_EQUAL_DOUBLE(mset1[i].get_weight() * mset2[0].get_weight(),
+			  mset2[i].get_weight() * mset1[0].get_weight());
+    }
+}
+
+/// Feature test for OP_FUZZY.
+DEFINE_TESTCASE(fuzzy2, writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    const char * words[] = {
+	"hello", "help", "world", "helo", "hlelo", "yellow", "XAhelp", "he"
+    };
+    for (size_t i = 0; i != sizeof(words) / sizeof(words[0]); ++i) {
+	Xapian::Document doc;
+	doc.add_term(words[i]);
+	db.add_document(doc);
+    }
+    db.commit();
+
+    // Every document has a single term, so the weights are all equal and
+    // the matches are in docid order.
+    Xapian::Query q(Xapian::Query::OP_FUZZY, "helo");
+    mset_expect_order(fuzzy_mset(db, q), 1, 2, 4, 5, 8);
+    q = Xapian::Query(Xapian::Query::OP_FUZZY, "helo", 0, 1);
+    mset_expect_order(fuzzy_mset(db, q), 1, 2, 4, 5);
+    q = Xapian::Query(Xapian::Query::OP_FUZZY, "helo", 0, 0);
+    mset_expect_order(fuzzy_mset(db, q), 4);
+
+    // With a limit on the expansion, the closest terms are used, and those
+    // earliest in sort order if there are ties.
+    q = Xapian::Query(Xapian::Query::OP_FUZZY, "helo", 2, 2);
+    mset_expect_order(fuzzy_mset(db, q), 1, 4);
+
+    // A fixed prefix is only matched exactly.
+    q = Xapian::Query(Xapian::Query::OP_FUZZY, "XAhelo", 0, 2, 2);
+    mset_expect_order(fuzzy_mset(db, q), 7);
+
+    // No matching terms.
+    q = Xapian::Query(Xapian::Query::OP_FUZZY, "zzzzz", 0, 1);
+    TEST(fuzzy_mset(db, q).empty());
+
+    // The weights should be in line with OP_SYNONYM over the terms which are
+    // within the edit distance.
+    vector<Xapian::Query> subqs;
+    subqs.push_back(Xapian::Query("hello"));
+    subqs.push_back(Xapian::Query("help"));
+    subqs.push_back(Xapian::Query("helo"));
+    subqs.push_back(Xapian::Query("hlelo"));
+    Xapian::Query syn(Xapian::Query::OP_SYNONYM, subqs.begin(), subqs.end());
+    q = Xapian::Query(Xapian::Query::OP_FUZZY, "helo", 0, 1);
+    check_synonym_weights(fuzzy_mset(db, q), fuzzy_mset(db, syn));
+
+    // OP_FUZZY should also work inside OP_SYNONYM.
+    q = Xapian::Query(Xapian::Query::OP_SYNONYM, q,
+		      Xapian::Query(Xapian::Query::OP_FUZZY, "wrld", 0, 1));
+    mset_expect_order(fuzzy_mset(db, q), 1, 2, 3, 4, 5);
+
+    // Without a fixed prefix, terms starting with a capital letter (which
+    // have a prefix) are only matched if the word starts with one too.
+    Xapian::Document doc;
+    doc.add_term("Shelo");
+    db.add_document(doc);
+    db.commit();
+    q = Xapian::Query(Xapian::Query::OP_FUZZY, "helo", 0, 1);
+    mset_expect_order(fuzzy_mset(db, q), 1, 2, 4, 5);
+    q = Xapian::Query(Xapian::Query::OP_FUZZY, "Shelo", 0, 1);
+    mset_expect_order(fuzzy_mset(db, q), 4, 9);
+    return true;
+}
+
+static void
+make_fuzzy4_db(Xapian::WritableDatabase &db, const string & arg)
+{
+    // The first shard has 10 documents, 2 of which match, and the second
+    // has 5, 1 of which matches, so both have the same proportion.
+    int n = (arg == "a") ? 10 : 5;
+    for (int i = 0; i != n; ++i) {
+	Xapian::Document doc;
+	doc.add_term(i < n / 5 ? "hello" : "other");
+	db.add_document(doc);
+    }
+}
+
+/// Check terms OP_FUZZY expands to are weighted the same in every shard.
+DEFINE_TESTCASE(fuzzy4, generated) {
+    Xapian::Database db = get_database("fuzzy4_a", make_fuzzy4_db, "a");
+    db.add_database(get_database("fuzzy4_b", make_fuzzy4_db, "b"));
+    Xapian::Query q(Xapian::Query::OP_FUZZY, "helo", 0, 1);
+    Xapian::MSet mset = fuzzy_mset(db, q);
+    TEST_EQUAL(mset.size(), 3);
+    // The matching documents are identical, so should get the same weight
+    // whichever shard they're in.
+    TEST_EQUAL_DOUBLE(mset[0].get_weight(), mset[1].get_weight());
+    TEST_EQUAL_DOUBLE(mset[0].get_weight(), mset[2].get_weight());
+    // And the term frequency estimate is exact here, so the weights should
+    // match those for the term itself.
+    Xapian::MSet mset2 = fuzzy_mset(db, Xapian::Query("hello"));
+    TEST_EQUAL(mset2.size(), 3);
+    TEST_EQUAL_DOUBLE(mset[0].get_weight(), mset2[0].get_weight());
+    return true;
+}
+
+/// Calculate the edit distance between two UTF-8 strings.
+static unsigned
+osa_distance(const string & a, const string & b)
+{
+    vector<unsigned> x, y;
+    for (Xapian::Utf8Iterator i(a); i != Xapian::Utf8Iterator(); ++i)
+	x.push_back(*i);
+    for (Xapian::Utf8Iterator i(b); i != Xapian::Utf8Iterator(); ++i)
+	y.push_back(*i);
+    vector<vector<unsigned> > d(x.size() + 1, vector<unsigned>(y.size() + 1));
+    for (size_t i = 0; i <= x.size(); ++i) d[i][0] = i;
+    for (size_t j = 0; j <= y.size(); ++j) d[0][j] = j;
+    for (size_t i = 1; i <= x.size(); ++i) {
+	for (size_t j = 1; j <= y.size(); ++j) {
+	    unsigned v = d[i - 1][j - 1] + (x[i - 1] != y[j - 1]);
+	    v = min(v, d[i - 1][j] + 1);
+	    v = min(v, d[i][j - 1] + 1);
+	    if (i > 1 && j > 1 && x[i - 1] == y[j - 2] && x[i - 2] == y[j - 1])
+		v = min(v, d[i - 2][j - 2] + 1);
+	    d[i][j] = v;
+	}
+    }
+    return d[x.size()][y.size()];
+}
+
+/// Check OP_FUZZY against a brute force calculation.
+DEFINE_TESTCASE(fuzzy3, writable) {
+    static const char * const chars[] = { "a", "b", "c", "\xc3\xa9" };
+    Xapian::WritableDatabase db = get_writable_database();
+    srand(42);
+    vector<string> words;
+    for (int i = 0; i != 300; ++i) {
+	string word;
+	int len = 1 + rand() % 6;
+	while (len--) word += chars[rand() % 4];
+	words.push_back(word);
+	Xapian::Document doc;
+	doc.add_term(word);
+	doc.set_data(word);
+	db.add_document(doc);
+    }
+    db.commit();
+
+    for (int i = 0; i != 30; ++i) {
+	string pattern;
+	int len = 1 + rand() % 5;
+	while (len--) pattern += chars[rand() % 4];
+	for (unsigned k = 0; k <= 2; ++k) {
+	    Xapian::Enquire enq(db);
+	    enq.set_weighting_scheme(Xapian::BoolWeight());
+	    enq.set_query(Xapian::Query(Xapian::Query::OP_FUZZY, pattern, 0, k));
+	    Xapian::MSet mset = enq.get_mset(0, db.get_doccount());
+	    set<Xapian::docid> got;
+	    for (Xapian::MSetIterator m = mset.begin(); m != mset.end(); ++m)
+		got.insert(*m);
+	    set<Xapian::docid> want;
+	    for (size_t j = 0; j != words.size(); ++j) {
+		if (osa_distance(words[j], pattern) <= k)
+		    want.insert(Xapian::docid(j + 1));
+	    }
+	    tout << pattern << "~" << k << '\n';
+	    TEST(got == want);
+	}
+    }
+    return true;
+}
+
+DEFINE_TESTCASE(wildcard1, !backend) {
+    Xapian::Query q(Xapian::Query::OP_WILDCARD, "hel");
+    TEST_STRINGS_EQUAL(q.get_description(), "Query(WILDCARD hel)");
+    // OP_WILDCARD counts as a single term for the query length.
+    TEST_EQUAL(q.get_length(), 1);
+    TEST(q.get_terms_begin() == q.get_terms_end());
+
+    // Check the parameters survive serialisation.
+    q = Xapian::Query(Xapian::Query::OP_WILDCARD, "XAhel", 10, 0, 0, 3);
+    Xapian::Query q2 = Xapian::Query::unserialise(q.serialise());
+    TEST_STRINGS_EQUAL(q2.get_description(), q.get_description());
+    TEST_STRINGS_EQUAL(q2.serialise(), q.serialise());
+    return true;
+}
+
+/// Feature test for OP_WILDCARD.
+DEFINE_TESTCASE(wildcard2, writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    const char * words[] = {
+	"hello", "help help", "world", "helo hello", "he", "XAhelp", "helper"
+    };
+    for (size_t i = 0; i != sizeof(words) / sizeof(words[0]); ++i) {
+	Xapian::Document doc;
+	Xapian::termpos pos = 0;
+	string text(words[i]);
+	string::size_type j = 0;
+	while (j != string::npos) {
+	    string::size_type k = text.find(' ', j);
+	    doc.add_posting(text.substr(j, k - j), ++pos);
+	    j = (k == string::npos) ? k : k + 1;
+	}
+	db.add_document(doc);
+    }
+    db.commit();
+
+    Xapian::Query q(Xapian::Query::OP_WILDCARD, "hel");
+    mset_expect_order(fuzzy_mset(db, q), 2, 4, 1, 7);
+
+    // The weights should be in line with OP_SYNONYM over the terms which
+    // start with the prefix.
+    vector<Xapian::Query> subqs;
+    subqs.push_back(Xapian::Query("hello"));
+    subqs.push_back(Xapian::Query("helo"));
+    subqs.push_back(Xapian::Query("help"));
+    subqs.push_back(Xapian::Query("helper"));
+    Xapian::Query syn(Xapian::Query::OP_SYNONYM, subqs.begin(), subqs.end());
+    check_synonym_weights(fuzzy_mset(db, q), fuzzy_mset(db, syn));
+
+    // A single matching term, and no matching terms.
+    q = Xapian::Query(Xapian::Query::OP_WILDCARD, "wor");
+    mset_expect_order(fuzzy_mset(db, q), 3);
+    q = Xapian::Query(Xapian::Query::OP_WILDCARD, "zzz");
+    TEST(fuzzy_mset(db, q).empty());
+
+    // Check the limit on expansion, which is checked when the search runs.
+    q = Xapian::Query(Xapian::Query::OP_WILDCARD, "hel", 4, 0);
+    mset_expect_order(fuzzy_mset(db, q), 2, 4, 1, 7);
+    q = Xapian::Query(Xapian::Query::OP_WILDCARD, "hel", 3, 0);
+    TEST_EXCEPTION(Xapian::WildcardError, fuzzy_mset(db, q));
+
+    // Check OP_WILDCARD as part of a larger query, which will skip_to() it.
+    q = Xapian::Query(Xapian::Query::OP_AND,
+		      Xapian::Query(Xapian::Query::OP_WILDCARD, "hel"),
+		      Xapian::Query("hello"));
+    mset_expect_order(fuzzy_mset(db, q), 1, 4);
+    return true;
+}
+
+/// Check OP_WILDCARD matches OP_SYNONYM when it expands to a lot of terms.
+DEFINE_TESTCASE(wildcard3, writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    srand(42);
+    set<string> terms;
+    for (int i = 0; i != 200; ++i) {
+	Xapian::Document doc;
+	int n = 1 + rand() % 5;
+	while (n--) {
+	    string term("x");
+	    term += str(rand() % 300);
+	    doc.add_term(term, 1 + rand() % 3);
+	    terms.insert(term);
+	}
+	doc.add_term(i % 2 ? "odd" : "even");
+	db.add_document(doc);
+    }
+    db.commit();
+
+    vector<Xapian::Query> subqs;
+    for (set<string>::const_iterator t = terms.begin(); t != terms.end(); ++t)
+	subqs.push_back(Xapian::Query(*t));
+    Xapian::Query syn(Xapian::Query::OP_SYNONYM, subqs.begin(), subqs.end());
+    Xapian::Query q(Xapian::Query::OP_WILDCARD, "x");
+    for (int i = 0; i != 2; ++i) {
+	check_synonym_weights(fuzzy_mset(db, q), fuzzy_mset(db, syn));
+	// Filter by another term so that the union gets skipped through.
+	q = Xapian::Query(Xapian::Query::OP_FILTER, q, Xapian::Query("odd"));
+	syn = Xapian::Query(Xapian::Query::OP_FILTER, syn, Xapian::Query("odd"));
+    }
+    return true;
+}
+
+/// Check get_matching_terms() reports the terms OP_WILDCARD and OP_FUZZY match.
+DEFINE_TESTCASE(wildcard4, writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    Xapian::Document doc;
+    const char * words[] = {
+	"Zhello", "hello", "help", "world", "worlds", "yellow"
+    };
+    for (size_t i = 0; i != sizeof(words) / sizeof(words[0]); ++i) {
+	doc.add_term(words[i]);
+    }
+    db.add_document(doc);
+    db.commit();
+
+    // The terms should be in order of the position of what they matched in
+    // the query, and only reported once.
+    vector<Xapian::Query> subqs;
+    subqs.push_back(Xapian::Query(Xapian::Query::OP_WILDCARD, "wor",
+				  0, 0, 0, 3));
+    subqs.push_back(Xapian::Query("hello", 1, 1));
+    subqs.push_back(Xapian::Query(Xapian::Query::OP_FUZZY, "hepl",
+				  0, 1, 0, 2));
+    subqs.push_back(Xapian::Query(Xapian::Query::OP_WILDCARD, "hel",
+				  0, 0, 0, 4));
+    Xapian::Query q(Xapian::Query::OP_OR, subqs.begin(), subqs.end());
+    Xapian::Enquire enq(db);
+    enq.set_query(q);
+    Xapian::MSet mset = enq.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), 1);
+
+    string got;
+    Xapian::TermIterator t;
+    for (t = enq.get_matching_terms_begin(mset.begin());
+	 t != enq.get_matching_terms_end(mset.begin()); ++t) {
+	got += *t;
+	got += ' ';
+    }
+    TEST_STRINGS_EQUAL(got, "hello help world worlds ");
+    return true;
+}
@@ -35,6 +35,7 @@
 #include "safeerrno.h"
 #include "safefcntl.h"
 #include "safesysstat.h"
+#include "safesyswait.h"
 #include "safeunistd.h"
 #include "str.h"
 #include "testsuite.h"
@@ -43,6 +44,7 @@
 
 #include <sys/types.h>
 
+#include <cstdio>
 #include <cstdlib>
 #include <string>
 
@@ -133,6 +135,23 @@ truncated_copy(const string & srcpath, const string & destpath, off_t tocopy)
     return total_bytes;
 }
 
+// Flip the bits of one byte of a file.
+static void
+corrupt_byte(const string & path, off_t offset)
+{
+    FD fd(open(path.c_str(), O_RDWR));
+    if (fd == -1) {
+	FAIL_TEST("Open failed (when opening '" + path + "')");
+    }
+    char ch;
+    if (lseek(fd, offset, SEEK_SET) < 0 || do_read(fd, &ch, 1) != 1)
+	FAIL_TEST("Couldn't read byte to corrupt");
+    ch = ~ch;
+    if (lseek(fd, offset, SEEK_SET) < 0)
+	FAIL_TEST("Couldn't seek to byte to corrupt");
+    do_write(fd, &ch, 1);
+}
+
 // Replicate from the master to the replica.
 // Returns the number of changesets which were applied.
 static void
@@ -743,3 +762,319 @@ DEFINE_TESTCASE(replicate5, replicas) {
     rmtmpdir(tempdir);
     return true;
 }
+
+// Add, replace and delete some documents on the master and commit.
+static void
+change_master(Xapian::WritableDatabase & orig, int n)
+{
+    Xapian::Document doc;
+    doc.set_data("extra " + str(n));
+    doc.add_posting("term" + str(n), 1);
+    doc.add_posting("extra", 2);
+    orig.add_document(doc);
+    orig.replace_document(n * 10 + 1, doc);
+    orig.delete_document(n * 10 + 2);
+    orig.commit();
+}
+
+// Check whether a replica has a partially received database copy.
+static bool
+have_copy_state(const string & replicapath)
+{
+    return file_exists(replicapath + "/replica_0/copystate") ||
+	   file_exists(replicapath + "/replica_1/copystate");
+}
+
+// Test that an interrupted database copy is continued rather than restarted.
+DEFINE_TESTCASE(replicate6, replicas) {
+    UNSET_MAX_CHANGESETS_AFTERWARDS;
+    string tempdir = ".replicatmp";
+    mktmpdir(tempdir);
+    string masterpath = get_named_writable_database_path("master");
+
+    set_max_changesets(10);
+
+    Xapian::WritableDatabase orig(get_named_writable_database("master"));
+    Xapian::DatabaseMaster master(masterpath);
+    string replicapath = tempdir + "/replica";
+    Xapian::DatabaseReplica replica(replicapath);
+
+    // Add enough documents that each table spans quite a few blocks.
+    for (int i = 0; i < 300; ++i) {
+	Xapian::Document doc;
+	doc.set_data("document " + str(i));
+	for (int j = 0; j < 20; ++j) {
+	    doc.add_posting("term" + str((i * 7 + j) % 500), j + 1);
+	}
+	orig.add_document(doc);
+    }
+    orig.commit();
+
+    string changesetpath = tempdir + "/changeset";
+    get_changeset(changesetpath, master, replica, 0, 1, 1);
+    off_t full_size = get_file_size(changesetpath);
+
+    // A chunk which fails its checksum stops the copy, but the data before
+    // it is kept.
+    string brokenchangesetpath = tempdir + "/changeset_broken";
+    truncated_copy(changesetpath, brokenchangesetpath, full_size);
+    corrupt_byte(brokenchangesetpath, full_size / 2);
+    TEST_EXCEPTION(Xapian::NetworkError,
+		   apply_changeset(brokenchangesetpath, replica, 0, 1, 1));
+    TEST(have_copy_state(replicapath));
+
+    // Cut the copy off part way through the last table sent.
+    truncated_copy(changesetpath, brokenchangesetpath, full_size - 100);
+    TEST_EXCEPTION(Xapian::NetworkError,
+		   apply_changeset(brokenchangesetpath, replica, 0, 1, 1));
+    TEST(have_copy_state(replicapath));
+
+    // Modify the master several times, so that the continued copy needs
+    // changesets applied to bring it up to date, and blocks the replica
+    // already has get changed, freed and reused.
+    for (int n = 1; n <= 3; ++n)
+	change_master(orig, n);
+
+    // If any changeset since the copy started is missing, the copy can't be
+    // continued, so a fresh one is sent.
+    string changes2 = masterpath + "/changes2";
+    TEST(file_exists(changes2));
+    TEST(rename(changes2.c_str(), (changes2 + ".tmp").c_str()) == 0);
+    get_changeset(changesetpath, master, replica, 0, 1, 1);
+    TEST_REL(get_file_size(changesetpath), >, full_size * 3 / 4);
+    TEST(rename((changes2 + ".tmp").c_str(), changes2.c_str()) == 0);
+
+    // The data the replica already has shouldn't be sent again.  Cut this
+    // copy off too, part way through the first chunk of file data.
+    get_changeset(changesetpath, master, replica, 3, 1, 1);
+    off_t resumed_size = get_file_size(changesetpath);
+    tout << "Full copy " << full_size << " bytes, resumed copy "
+	 << resumed_size << " bytes\n";
+    TEST_REL(resumed_size, <, full_size * 3 / 4);
+    truncated_copy(changesetpath, brokenchangesetpath, 200);
+    TEST_EXCEPTION(Xapian::NetworkError,
+		   apply_changeset(brokenchangesetpath, replica, 0, 1, 1));
+    TEST(have_copy_state(replicapath));
+
+    for (int n = 4; n <= 5; ++n)
+	change_master(orig, n);
+
+    // The second continued copy needs all the changesets since the copy was
+    // started.
+    get_changeset(changesetpath, master, replica, 5, 1, 1);
+    apply_changeset(changesetpath, replica, 5, 1, 1);
+    TEST(!have_copy_state(replicapath));
+    check_equal_dbs(masterpath, replicapath);
+    {
+	Xapian::Database dbcopy(replicapath);
+	TEST_EQUAL(orig.get_uuid(), dbcopy.get_uuid());
+	TEST_EQUAL(dbcopy.get_doccount(), 300);
+	TEST_EQUAL(dbcopy.get_termfreq("extra"), 10);
+    }
+
+    // Once the copy is complete, there's nothing left to resume, so the
+    // next update should just be a changeset.
+    change_master(orig, 6);
+    TEST_EQUAL(replicate(master, replica, tempdir, 1, 0, 1), 2);
+    check_equal_dbs(masterpath, replicapath);
+
+    // Start receiving a copy of a different database, and cut it off.
+    string masterpath2 = get_named_writable_database_path("master2");
+    Xapian::WritableDatabase orig2(get_named_writable_database("master2"));
+    Xapian::Document doc;
+    doc.set_data("other");
+    doc.add_posting("other", 1);
+    orig2.add_document(doc);
+    orig2.commit();
+    Xapian::DatabaseMaster master2(masterpath2);
+    get_changeset(changesetpath, master2, replica, 0, 1, 1);
+    truncated_copy(changesetpath, brokenchangesetpath,
+		   get_file_size(changesetpath) - 10);
+    TEST_EXCEPTION(Xapian::NetworkError,
+		   apply_changeset(brokenchangesetpath, replica, 0, 1, 1));
+    TEST(have_copy_state(replicapath));
+
+    // Replicating from the original master again just sends a changeset, so
+    // the partial copy should be discarded.
+    change_master(orig, 7);
+    TEST_EQUAL(replicate(master, replica, tempdir, 1, 0, 1), 2);
+    TEST(!have_copy_state(replicapath));
+    check_equal_dbs(masterpath, replicapath);
+
+    // Need to close the replica before we remove the temporary directory on
+    // Windows.
+    replica.close();
+    rmtmpdir(tempdir);
+    return true;
+}
+
+// Check that changesets which send blocks as deltas apply correctly.
+DEFINE_TESTCASE(replicate7, replicas) {
+    UNSET_MAX_CHANGESETS_AFTERWARDS;
+    string tempdir = ".replicatmp";
+    mktmpdir(tempdir);
+    string masterpath = get_named_writable_database_path("master");
+
+    set_max_changesets(10);
+
+    Xapian::WritableDatabase orig(get_named_writable_database("master"));
+    Xapian::DatabaseMaster master(masterpath);
+    string replicapath = tempdir + "/replica";
+    Xapian::DatabaseReplica replica(replicapath);
+
+    for (int i = 0; i < 1000; ++i) {
+	Xapian::Document doc;
+	doc.set_data("document " + str(i));
+	for (int j = 0; j < 20; ++j) {
+	    doc.add_posting("term" + str((i * 7 + j) % 500), j + 1);
+	}
+	orig.add_document(doc);
+    }
+    orig.commit();
+    TEST_EQUAL(replicate(master, replica, tempdir, 0, 1, 1), 1);
+    check_equal_dbs(masterpath, replicapath);
+
+    // Add one posting to each of a lot of postlists, which modifies a lot of
+    // blocks slightly.
+    Xapian::Document doc;
+    for (int j = 0; j < 500; ++j) {
+	doc.add_term("term" + str(j));
+    }
+    orig.add_document(doc);
+    orig.commit();
+
+    string changesetpath = tempdir + "/changeset";
+    get_changeset(changesetpath, master, replica, 1, 0, 1);
+    off_t changeset_size = get_file_size(changesetpath);
+    tout << "Changeset size " << changeset_size << " bytes\n";
+    if (get_dbtype() == "brass") {
+	// The changeset file also holds each block compressed on its own, in
+	// case the replica is catching up after a copy, but those shouldn't
+	// have been sent.
+	off_t file_size = get_file_size(masterpath + "/changes1");
+	tout << "Changeset file size " << file_size << " bytes\n";
+	TEST_REL(changeset_size, <, file_size / 2);
+    }
+    apply_changeset(changesetpath, replica, 1, 0, 1);
+    check_equal_dbs(masterpath, replicapath);
+
+    // And several more changesets which build on each other.
+    for (int i = 0; i < 5; ++i) {
+	doc.add_term("extra" + str(i));
+	orig.replace_document(1001, doc);
+	orig.commit();
+    }
+    int count = replicate(master, replica, tempdir, 5, 0, 1);
+    TEST_EQUAL(count, 6);
+    check_equal_dbs(masterpath, replicapath);
+    {
+	Xapian::Database dbcopy(replicapath);
+	TEST_EQUAL(dbcopy.get_doccount(), 1001);
+	TEST_EQUAL(dbcopy.get_termfreq("extra4"), 1);
+    }
+
+    replica.close();
+    rmtmpdir(tempdir);
+    return true;
+}
+
+#ifdef HAVE_FORK
+// Check that a copy made while the master is being modified can be brought
+// up to date, even though blocks in the copy don't all come from the same
+// revision.
+DEFINE_TESTCASE(replicate8, replicas) {
+    UNSET_MAX_CHANGESETS_AFTERWARDS;
+    string tempdir = ".replicatmp";
+    mktmpdir(tempdir);
+    string masterpath = get_named_writable_database_path("master");
+
+    set_max_changesets(10);
+
+    Xapian::WritableDatabase orig(get_named_writable_database("master"));
+    string replicapath = tempdir + "/replica";
+    Xapian::DatabaseReplica replica(replicapath);
+
+    for (int i = 0; i < 1000; ++i) {
+	Xapian::Document doc;
+	doc.set_data("document " + str(i));
+	for (int j = 0; j < 20; ++j) {
+	    doc.add_posting("term" + str((i * 7 + j) % 500), j + 1);
+	}
+	orig.add_document(doc);
+    }
+    orig.commit();
+
+    // Have a child process send a copy down a pipe.  Once the pipe is full,
+    // the child has to wait for us to read from it, so the master is still
+    // being copied while we modify it.
+    int fds[2];
+    if (pipe(fds) < 0)
+	FAIL_TEST("Couldn't create pipe");
+    string revision_info = replica.get_revision_info();
+    pid_t child = fork();
+    if (child == 0) {
+	close(fds[0]);
+	int status = 0;
+	try {
+	    Xapian::DatabaseMaster master(masterpath);
+	    master.write_changesets_to_fd(fds[1], revision_info, NULL);
+	} catch (...) {
+	    status = 1;
+	}
+	_exit(status);
+    }
+    close(fds[1]);
+    FD fd_in(fds[0]);
+    if (child == -1)
+	FAIL_TEST("fork() failed");
+
+    // Wait until the copy has started.
+    char buf[4096];
+    string changesetpath = tempdir + "/changeset";
+    FD fd_out(open(changesetpath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666));
+    if (fd_out == -1)
+	FAIL_TEST("Open failed (when creating '" + changesetpath + "')");
+    size_t n = do_read(fd_in, buf, sizeof(buf));
+    do_write(fd_out, buf, n);
+
+    // Modify the master so that blocks are changed, freed and reused.
+    Xapian::Document doc;
+    for (int i = 1; i <= 5; ++i) {
+	for (Xapian::docid did = i; did <= 1000; did += 5) {
+	    doc.set_data("changed " + str(did));
+	    doc.add_term("changed" + str(i));
+	    orig.replace_document(did, doc);
+	}
+	orig.commit();
+    }
+
+    // Now let the copy finish.
+    while ((n = do_read(fd_in, buf, sizeof(buf))) != 0)
+	do_write(fd_out, buf, n);
+    int status;
+    while (waitpid(child, &status, 0) < 0) {
+	if (errno != EINTR) FAIL_TEST("waitpid() failed");
+    }
+    TEST(WIFEXITED(status));
+    TEST_EQUAL(WEXITSTATUS(status), 0);
+
+    apply_changeset(changesetpath, replica, 5, 1, 1);
+    check_equal_dbs(masterpath, replicapath);
+    {
+	Xapian::Database dbcopy(replicapath);
+	TEST_EQUAL(orig.get_uuid(), dbcopy.get_uuid());
+	TEST_EQUAL(dbcopy.get_termfreq("changed1"), 1000);
+    }
+
+    // The replica should now be able to take delta changesets.
+    orig.replace_document(1, doc);
+    orig.commit();
+    Xapian::DatabaseMaster master(masterpath);
+    TEST_EQUAL(replicate(master, replica, tempdir, 1, 0, 1), 2);
+    check_equal_dbs(masterpath, replicapath);
+
+    replica.close();
+    rmtmpdir(tempdir);
+    return true;
+}
+#endif
@@ -25,6 +25,7 @@
 #include <xapian.h>
 
 #include "apitest.h"
+#include "str.h"
 #include "testutils.h"
 
 using namespace std;
@@ -242,3 +243,197 @@ DEFINE_TESTCASE(sortfunctorremote1,remote) {
     );
     return true;
 }
+
+/// Check that paging through a value-sorted MSet gives consistent results.
+DEFINE_TESTCASE(sortpaging1,writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    for (int i = 0; i < 100; ++i) {
+	Xapian::Document doc;
+	doc.add_term("foo");
+	doc.add_value(0, str((i * 37) % 23));
+	db.add_document(doc);
+    }
+    db.commit();
+
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("foo"));
+    enquire.set_sort_by_value(0, true);
+    Xapian::MSet full = enquire.get_mset(0, 100);
+    TEST_EQUAL(full.size(), 100);
+
+    for (Xapian::doccount first = 0; first < 100; first += 7) {
+	Xapian::MSet page = enquire.get_mset(first, 7);
+	Xapian::MSetIterator i = page.begin();
+	Xapian::MSetIterator j = full[first];
+	while (i != page.end()) {
+	    TEST(j != full.end());
+	    TEST_EQUAL(*i, *j);
+	    ++i;
+	    ++j;
+	}
+    }
+
+    return true;
+}
+
+static void
+check_cursor_paging(Xapian::Enquire & enquire)
+{
+    enquire.set_cursor(string());
+    Xapian::MSet full = enquire.get_mset(0, 1000);
+    Xapian::MSetIterator j = full.begin();
+    Xapian::MSet page = enquire.get_mset(0, 7);
+    while (!page.empty()) {
+	// Weights of documents before the cursor still count, so percentages
+	// are the same on every page.
+	TEST_EQUAL_DOUBLE(page.get_max_attained(), full.get_max_attained());
+	for (Xapian::MSetIterator i = page.begin(); i != page.end(); ++i) {
+	    TEST(j != full.end());
+	    TEST_EQUAL(*i, *j);
+	    TEST_EQUAL(i.get_percent(), j.get_percent());
+	    ++j;
+	}
+	enquire.set_cursor(page.back().get_cursor());
+	page = enquire.get_mset(0, 7);
+    }
+    TEST(j == full.end());
+    enquire.set_cursor(string());
+}
+
+/// Check that paging using a cursor gives the same results as get_mset().
+DEFINE_TESTCASE(cursor1,backend && !remote) {
+    Xapian::Enquire enquire(get_database("apitest_simpledata"));
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_OR,
+				    Xapian::Query("this"),
+				    Xapian::Query("word")));
+    check_cursor_paging(enquire);
+
+    enquire.set_sort_by_value(1, true);
+    check_cursor_paging(enquire);
+
+    enquire.set_sort_by_value_then_relevance(1, false);
+    check_cursor_paging(enquire);
+
+    enquire.set_sort_by_relevance_then_value(1, true);
+    check_cursor_paging(enquire);
+
+    enquire.set_docid_order(Xapian::Enquire::DESCENDING);
+    enquire.set_sort_by_relevance();
+    check_cursor_paging(enquire);
+
+    // An invalid cursor should be rejected.
+    TEST_EXCEPTION(Xapian::InvalidArgumentError,
+		   enquire.set_cursor(string(1, '\0')));
+    TEST_EXCEPTION(Xapian::InvalidArgumentError,
+		   enquire.set_cursor("\x01"));
+
+    return true;
+}
+
+static void
+make_cursor2_db(Xapian::WritableDatabase &db, const string &)
+{
+    // Higher value, higher weight.
+    for (int i = 1; i <= 10; ++i) {
+	Xapian::Document doc;
+	doc.add_term("foo", i);
+	doc.add_term("pad", 20 - i);
+	doc.add_value(0, string(1, char('a' + i)));
+	db.add_document(doc);
+    }
+}
+
+/// Check percentages are the same on each page when sorting only by value.
+DEFINE_TESTCASE(cursor2,generated && !remote) {
+    Xapian::Enquire enquire(get_database("cursor2", make_cursor2_db));
+    enquire.set_query(Xapian::Query("foo"));
+    enquire.set_sort_by_value(0, true);
+    check_cursor_paging(enquire);
+
+    return true;
+}
+
+DEFINE_TESTCASE(cursorremote1,remote) {
+    Xapian::Enquire enquire(get_database("apitest_simpledata"));
+    enquire.set_query(Xapian::Query("word"));
+    Xapian::MSet mset;
+    enquire.set_cursor(string("\x01\x80\x40", 3));
+    TEST_EXCEPTION(Xapian::UnimplementedError,
+		   mset = enquire.get_mset(0, 10));
+    return true;
+}
+
+/// Test Enquire::set_docids_in_rank_order().
+DEFINE_TESTCASE(docidsinrankorder1,writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    for (int i = 0; i < 20; ++i) {
+	Xapian::Document doc;
+	// Later documents have a higher wdf, so rank higher by relevance.
+	doc.add_term("foo", i + 1);
+	doc.add_term("filler", 20 - i);
+	doc.add_value(0, Xapian::sortable_serialise(100 - i));
+	db.add_document(doc);
+    }
+    db.commit();
+
+    // The flag is only used for a single database.
+    bool stops_early = !startswith(get_dbtype(), "multi");
+
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("foo"));
+    enquire.set_sort_by_value(0, true);
+    Xapian::MSet full = enquire.get_mset(0, 20);
+
+    enquire.set_docids_in_rank_order(true);
+    Xapian::ValueCountMatchSpy spy(0);
+    enquire.add_matchspy(&spy);
+    Xapian::MSet mset = enquire.get_mset(0, 5);
+    enquire.clear_matchspies();
+    TEST(mset_range_is_same(mset, 0, full, 0, 5));
+    TEST_EQUAL(mset.get_matches_estimated(), 20);
+    // Check that the match stopped early.
+    TEST_EQUAL(spy.get_total(), stops_early ? 5 : 20);
+
+    // Paging should still give exact results.
+    mset = enquire.get_mset(5, 5);
+    TEST(mset_range_is_same(mset, 0, full, 5, 5));
+
+    // When sorting by relevance, the results are approximate - only the
+    // first checkatleast matches are considered.
+    enquire.set_sort_by_relevance();
+    mset = enquire.get_mset(0, 3, 5);
+    if (stops_early) {
+	mset_expect_order(mset, 5, 4, 3);
+    } else {
+	mset_expect_order(mset, 20, 19, 18);
+    }
+
+    return true;
+}
+
+/// Check set_docids_in_rank_order() is ignored for descending docid order.
+DEFINE_TESTCASE(docidsinrankorder2,writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    for (int i = 0; i < 20; ++i) {
+	Xapian::Document doc;
+	doc.add_term("foo");
+	doc.add_value(0, Xapian::sortable_serialise(i / 10));
+	db.add_document(doc);
+    }
+    db.commit();
+
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("foo"));
+    enquire.set_sort_by_value(0, false);
+    enquire.set_docid_order(Xapian::Enquire::DESCENDING);
+    enquire.set_docids_in_rank_order(true);
+    Xapian::ValueCountMatchSpy spy(0);
+    enquire.add_matchspy(&spy);
+    Xapian::MSet mset = enquire.get_mset(0, 3);
+    // Tied documents are in descending docid order, so stopping once we'd
+    // seen documents 1, 2 and 3 would give the wrong answer.
+    mset_expect_order(mset, 10, 9, 8);
+    TEST_EQUAL(spy.get_total(), 20);
+
+    return true;
+}
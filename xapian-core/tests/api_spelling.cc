@@ -1,7 +1,7 @@
 /** @file api_spelling.cc
  * @brief Test the spelling correction suggestion API.
  */
-/* Copyright (C) 2007,2008,2009,2010,2011 Olly Betts
+/* Copyright (C) 2007,2008,2009,2010,2011,2012 Olly Betts
  * Copyright (C) 2007 Lemur Consulting Ltd
  *
  * This program is free software; you can redistribute it and/or modify
@@ -31,6 +31,8 @@
 
 #include <string>
 
+#include "unixcmds.h"
+
 using namespace std;
 
 // Test add_spelling() and remove_spelling(), which remote dbs support.
@@ -314,3 +316,173 @@ DEFINE_TESTCASE(spell8, spelling) {
 
     return true;
 }
+
+/// Open a new brass database which builds a spelling deletion index.
+static Xapian::WritableDatabase
+get_deletions_database(const string & name, int deletions_flag)
+{
+    return Xapian::Brass::open(get_named_writable_database_path(name),
+			       Xapian::DB_CREATE_OR_OVERWRITE | deletions_flag);
+}
+
+/// Test spelling suggestions using a deletion index.
+DEFINE_TESTCASE(spell9, brass) {
+    Xapian::WritableDatabase db =
+	get_deletions_database("spell9", Xapian::DB_SPELLING_DELETIONS_2);
+    db.add_spelling("ab");
+    db.add_spelling("hello", 3);
+    db.add_spelling("cell", 2);
+    db.add_spelling("skinking", 2);
+    db.add_spelling("stinking", 1);
+    db.add_spelling("caf\xc3\xa9");
+    db.commit();
+
+    // Trigrams don't find substitutions in two character words, but the
+    // deletion index does.
+    TEST_EQUAL(db.get_spelling_suggestion("xb"), "ab");
+    TEST_EQUAL(db.get_spelling_suggestion("hellp"), "hello");
+    TEST_EQUAL(db.get_spelling_suggestion("hlelo"), "hello");
+    TEST_EQUAL(db.get_spelling_suggestion("hell"), "hello");
+    TEST_EQUAL(db.get_spelling_suggestion("hell", 1), "hello");
+    TEST_EQUAL(db.get_spelling_suggestion("cel"), "cell");
+    TEST_EQUAL(db.get_spelling_suggestion("hello"), "");
+    TEST_EQUAL(db.get_spelling_suggestion("zzzzz"), "");
+    // Deletions are of characters, not bytes.
+    TEST_EQUAL(db.get_spelling_suggestion("caf"), "caf\xc3\xa9");
+    TEST_EQUAL(db.get_spelling_suggestion("cafe"), "caf\xc3\xa9");
+    // Edit distances beyond the deletion index fall back to trigrams.
+    TEST_EQUAL(db.get_spelling_suggestion("scimkin", 3), "skinking");
+
+    // Check uncommitted changes are seen, and that removing a word removes
+    // it from the deletion index.
+    db.remove_spelling("hello", 3);
+    db.add_spelling("jello", 3);
+    TEST_EQUAL(db.get_spelling_suggestion("hellp"), "jello");
+    db.commit();
+    TEST_EQUAL(db.get_spelling_suggestion("hellp"), "jello");
+    db.remove_spelling("jello", 3);
+    db.commit();
+    TEST_EQUAL(db.get_spelling_suggestion("hellp"), "cell");
+    db.remove_spelling("cell", 2);
+    db.commit();
+    TEST_EQUAL(db.get_spelling_suggestion("hellp"), "");
+
+    // Once built, the deletion index is maintained whether or not the
+    // database is opened with the flag.
+    db.close();
+    db = Xapian::WritableDatabase(get_named_writable_database_path("spell9"),
+				  Xapian::DB_OPEN);
+    db.add_spelling("ba");
+    db.commit();
+    TEST_EQUAL(db.get_spelling_suggestion("bx"), "ba");
+
+    // But it's only built for a new spelling table.
+    {
+	Xapian::WritableDatabase db2 = get_named_writable_database("spell9b");
+	db2.add_spelling("hello");
+	db2.commit();
+    }
+    Xapian::WritableDatabase db2(get_named_writable_database_path("spell9b"),
+				 Xapian::DB_OPEN|Xapian::DB_SPELLING_DELETIONS_2);
+    db2.add_spelling("ab");
+    db2.commit();
+    TEST_EQUAL(db2.get_spelling_suggestion("xb"), "");
+    TEST_EQUAL(db2.get_spelling_suggestion("hellp"), "hello");
+
+    return true;
+}
+
+/// Test that compaction builds a deletion index if any input has one.
+DEFINE_TESTCASE(spell10, brass) {
+    Xapian::WritableDatabase a =
+	get_deletions_database("spell10a", Xapian::DB_SPELLING_DELETIONS_1);
+    a.add_spelling("ab");
+    a.add_spelling("hello");
+    a.commit();
+    Xapian::WritableDatabase b = get_named_writable_database("spell10b");
+    b.add_spelling("cd");
+    b.add_spelling("abc");
+    b.add_spelling("hello", 2);
+    b.commit();
+    Xapian::WritableDatabase c =
+	get_deletions_database("spell10c", Xapian::DB_SPELLING_DELETIONS_2);
+    c.add_spelling("mn");
+    c.commit();
+
+    string out = get_named_writable_database_path("spell10out");
+    rm_rf(out);
+    {
+	Xapian::Compactor compact;
+	compact.set_destdir(out);
+	compact.add_source(get_named_writable_database_path("spell10a"));
+	compact.add_source(get_named_writable_database_path("spell10b"));
+	compact.compact();
+    }
+    Xapian::Database db(out);
+    // Words from both inputs are in the deletion index.
+    TEST_EQUAL(db.get_spelling_suggestion("xb", 1), "ab");
+    TEST_EQUAL(db.get_spelling_suggestion("xd", 1), "cd");
+    Xapian::TermIterator t = db.spellings_begin();
+    t.skip_to("hello");
+    TEST(t != db.spellings_end());
+    TEST_EQUAL(*t, "hello");
+    TEST_EQUAL(t.get_termfreq(), 3);
+    // The index only covers one deletion, so trigrams are used for an edit
+    // distance of 2, and they can't find this correction.
+    TEST_EQUAL(db.get_spelling_suggestion("xyc"), "");
+
+    // With inputs with different settings, the output gets the largest.
+    rm_rf(out);
+    {
+	Xapian::Compactor compact;
+	compact.set_destdir(out);
+	compact.add_source(get_named_writable_database_path("spell10a"));
+	compact.add_source(get_named_writable_database_path("spell10b"));
+	compact.add_source(get_named_writable_database_path("spell10c"));
+	compact.compact();
+    }
+    db = Xapian::Database(out);
+    TEST_EQUAL(db.get_spelling_suggestion("xd"), "cd");
+    TEST_EQUAL(db.get_spelling_suggestion("xyc"), "abc");
+    TEST_EQUAL(db.get_spelling_suggestion("mx"), "mn");
+
+    // A deletion index can be asked for when no input has one.
+    rm_rf(out);
+    {
+	Xapian::Compactor compact;
+	compact.set_destdir(out);
+	compact.set_spelling_deletions(1);
+	compact.add_source(get_named_writable_database_path("spell10b"));
+	compact.compact();
+    }
+    db = Xapian::Database(out);
+    TEST_EQUAL(db.get_spelling_suggestion("xd", 1), "cd");
+    TEST_EQUAL(db.get_spelling_suggestion("hellp", 1), "hello");
+
+    Xapian::Compactor compact;
+    TEST_EXCEPTION(Xapian::InvalidArgumentError,
+		   compact.set_spelling_deletions(4));
+
+    return true;
+}
+
+/// Test combining databases with and without a deletion index.
+DEFINE_TESTCASE(spell11, brass) {
+    Xapian::WritableDatabase a =
+	get_deletions_database("spell11a", Xapian::DB_SPELLING_DELETIONS_1);
+    a.add_spelling("abcdefgx", 5);
+    a.commit();
+    Xapian::WritableDatabase b = get_named_writable_database("spell11b");
+    b.add_spelling("abcdefghi");
+    b.commit();
+
+    Xapian::Database db(get_named_writable_database_path("spell11a"));
+    db.add_database(Xapian::Database(get_named_writable_database_path("spell11b")));
+    // Both words are one edit away, and "abcdefgx" is more frequent.
+    // "abcdefghi" shares lots of trigrams with the misspelling, but that
+    // mustn't stop us considering "abcdefgx", which is found by the deletion
+    // index.
+    TEST_EQUAL(db.get_spelling_suggestion("abcdefgh", 1), "abcdefgx");
+
+    return true;
+}
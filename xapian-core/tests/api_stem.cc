@@ -75,3 +75,95 @@ DEFINE_TESTCASE(stemlangs2, !backend) {
     }
     return true;
 }
+
+class CountingStemImpl : public Xapian::StemImplementation {
+  public:
+    unsigned calls;
+
+    CountingStemImpl() : calls(0) { }
+
+    string operator()(const string & word) {
+	++calls;
+	return word.substr(0, 3);
+    }
+
+    string get_description() const {
+	return "CountingStem()";
+    }
+};
+
+/// Test stemming into a caller-supplied string.
+DEFINE_TESTCASE(stem3, !backend) {
+    Xapian::Stem st("english");
+    string result = "junk";
+    st("cows", result);
+    TEST_EQUAL(result, "cow");
+    st("", result);
+    TEST_EQUAL(result, "");
+    st("searching", result);
+    TEST_EQUAL(result, st("searching"));
+
+    Xapian::Stem st_none;
+    st_none("cows", result);
+    TEST_EQUAL(result, "cows");
+
+    Xapian::Stem st_user(new MyStemImpl);
+    st_user("food", result);
+    TEST_EQUAL(result, "foo");
+
+    return true;
+}
+
+/// Test the stemming cache.
+DEFINE_TESTCASE(stem4, !backend) {
+    CountingStemImpl * impl = new CountingStemImpl;
+    Xapian::Stem st(impl);
+    st.set_cache_size(1);
+    TEST_EQUAL(st.get_description(), "Xapian::Stem(CountingStem())");
+
+    TEST_EQUAL(st("food"), "foo");
+    TEST_EQUAL(st("food"), "foo");
+    TEST_EQUAL(impl->calls, 1);
+    string result;
+    st("food", result);
+    TEST_EQUAL(result, "foo");
+    TEST_EQUAL(impl->calls, 1);
+
+    // With only one slot, a different word should replace the cached one.
+    st("bard", result);
+    TEST_EQUAL(result, "bar");
+    TEST_EQUAL(impl->calls, 2);
+    TEST_EQUAL(st("food"), "foo");
+    TEST_EQUAL(impl->calls, 3);
+
+    // Copies share the cache.
+    Xapian::Stem copy(st);
+    TEST_EQUAL(copy("food"), "foo");
+    TEST_EQUAL(impl->calls, 3);
+
+    // Resizing shouldn't stack caches, and 0 should disable caching.
+    st.set_cache_size(10);
+    st.set_cache_size(0);
+    TEST_EQUAL(st("food"), "foo");
+    TEST_EQUAL(st("food"), "foo");
+    TEST_EQUAL(impl->calls, 5);
+
+    // Check a cached Snowball stemmer gives the same results.
+    Xapian::Stem english("english");
+    Xapian::Stem cached("english");
+    cached.set_cache_size(1000);
+    const char * words[] = {
+	"cows", "searching", "cows", "generously", "searching", "cows"
+    };
+    for (size_t i = 0; i != sizeof(words) / sizeof(words[0]); ++i) {
+	TEST_EQUAL(cached(words[i]), english(words[i]));
+    }
+    TEST_EQUAL(cached.get_description(), english.get_description());
+
+    // Setting a cache on the "none" stemmer should be harmless.
+    Xapian::Stem st_none;
+    st_none.set_cache_size(10);
+    TEST_EQUAL(st_none("cows"), "cows");
+
+    return true;
+}
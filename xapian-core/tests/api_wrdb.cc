@@ -1993,3 +1993,36 @@ DEFINE_TESTCASE(modifyvalues1, writable) {
 
     return true;
 }
+
+/// Check allterms with a prefix sees uncommitted changes.
+DEFINE_TESTCASE(allterms7, writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    Xapian::Document doc;
+    doc.add_term("Pone");
+    doc.add_term("Ptwo");
+    doc.add_term("Qone");
+    db.add_document(doc);
+    db.commit();
+    doc.add_term("Pthree");
+    db.add_document(doc);
+
+    Xapian::TermIterator t = db.allterms_begin("P");
+    TEST(t != db.allterms_end("P"));
+    TEST_EQUAL(*t, "Pone");
+    TEST_EQUAL(t.get_termfreq(), 2);
+    ++t;
+    TEST(t != db.allterms_end("P"));
+    TEST_EQUAL(*t, "Pthree");
+    TEST_EQUAL(t.get_termfreq(), 1);
+    ++t;
+    TEST(t != db.allterms_end("P"));
+    TEST_EQUAL(*t, "Ptwo");
+    TEST_EQUAL(t.get_termfreq(), 2);
+    ++t;
+    TEST(t == db.allterms_end("P"));
+
+    TEST_EQUAL(db.get_termfreq("Qone"), 2);
+    db.commit();
+    TEST_EQUAL(db.get_termfreq("Qone"), 2);
+    return true;
+}
@@ -50,6 +50,7 @@
 #include "noreturn.h"
 #include "str.h"
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -75,6 +76,8 @@ using namespace std;
 struct pid_fd {
     pid_t pid;
     int fd;
+    /// True if this is a --workers server, which needs to be killed.
+    bool persistent;
 };
 
 static pid_fd pid_to_fd[16];
@@ -103,7 +106,7 @@ on_SIGCHLD(int /*sig*/)
 }
 
 static int
-launch_xapian_tcpsrv(const string & args)
+launch_xapian_tcpsrv(const string & args, bool persistent)
 {
     int port = DEFAULT_PORT;
 
@@ -111,7 +114,9 @@ launch_xapian_tcpsrv(const string & args)
     // if xapian-tcpsrv doesn't start listening successfully.
     signal(SIGCHLD, SIG_DFL);
 try_next_port:
-    string cmd = XAPIAN_TCPSRV" --one-shot --interface "LOCALHOST" --port " + str(port) + " " + args;
+    string cmd = XAPIAN_TCPSRV;
+    if (!persistent) cmd += " --one-shot";
+    cmd += " --interface " LOCALHOST " --port " + str(port) + " " + args;
 #ifdef HAVE_VALGRIND
     if (RUNNING_ON_VALGRIND) cmd = "./runsrv " + cmd;
 #endif
@@ -126,6 +131,9 @@ try_next_port:
     if (child == 0) {
 	// Child process.
 	close(fds[0]);
+	// A persistent server gets its own process group, so that clean_up()
+	// can kill it along with its worker processes.
+	if (persistent) setpgid(0, 0);
 	// Connect stdout and stderr to the socket.
 	dup2(fds[1], 1);
 	dup2(fds[1], 2);
@@ -196,13 +204,23 @@ try_next_port:
 
     // Find a slot to track the pid->fd mapping in.  If we can't find a slot
     // it just means we'll leak the fd, so don't worry about that too much.
-    for (unsigned i = 0; i < sizeof(pid_to_fd) / sizeof(pid_fd); ++i) {
+    // But a persistent server would never exit, so we have to give up.
+    unsigned i;
+    for (i = 0; i < sizeof(pid_to_fd) / sizeof(pid_fd); ++i) {
 	if (pid_to_fd[i].pid == 0) {
 	    pid_to_fd[i].fd = tracked_fd;
 	    pid_to_fd[i].pid = child;
+	    pid_to_fd[i].persistent = persistent;
 	    break;
 	}
     }
+    if (persistent && i == sizeof(pid_to_fd) / sizeof(pid_fd)) {
+	kill(-child, SIGTERM);
+	int status;
+	while (waitpid(child, &status, 0) == -1 && errno == EINTR) { }
+	close(tracked_fd);
+	throw string("Too many persistent xapian-tcpsrv processes");
+    }
 
     // Set a signal handler to clean up the xapian-tcpsrv child process when it
     // finally exits.
@@ -236,8 +254,11 @@ static void win32_throw_error_string(const char * str)
 
 // This implementation uses the WIN32 API to start xapian-tcpsrv as a child
 // process and read its output using a pipe.
+//
+// We don't run the remotetcpworkers backend on __WIN32__, so a persistent
+// server is never requested.
 static int
-launch_xapian_tcpsrv(const string & args)
+launch_xapian_tcpsrv(const string & args, bool)
 {
     int port = DEFAULT_PORT;
 
@@ -320,6 +341,7 @@ BackendManagerRemoteTcp::~BackendManagerRemoteTcp() {
 std::string
 BackendManagerRemoteTcp::get_dbtype() const
 {
+    if (workers) return "remotetcpworkers_" + remote_type;
     return "remotetcp_" + remote_type;
 }
 
@@ -328,7 +350,25 @@ BackendManagerRemoteTcp::do_get_database(const vector<string> & files)
 {
     // Default to a long (5 minute) timeout so that tests won't fail just
     // because the host is slow or busy.
-    return BackendManagerRemoteTcp::get_remote_database(files, 300000);
+    if (!workers)
+	return BackendManagerRemoteTcp::get_remote_database(files, 300000);
+
+    // Reuse the server for these files if the test has already started one,
+    // so that worker processes handle several connections in turn.
+    string args = get_remote_database_args(files, 300000);
+    map<string, int>::const_iterator i = workers_ports.find(args);
+    int port;
+    if (i != workers_ports.end()) {
+	port = i->second;
+    } else {
+	// Enough workers that a test can hold several connections to the
+	// same server open at once.  Also enable the reply cache, so the
+	// testsuite checks that replies sent from it are correct.
+	port = launch_xapian_tcpsrv("--workers 4 --reply-cache 1 " + args,
+				    true);
+	workers_ports[args] = port;
+    }
+    return Xapian::Remote::open(LOCALHOST, port);
 }
 
 Xapian::WritableDatabase
@@ -336,7 +376,7 @@ BackendManagerRemoteTcp::get_writable_database(const string & name,
 					       const string & file)
 {
     string args = get_writable_database_args(name, file);
-    int port = launch_xapian_tcpsrv(args);
+    int port = launch_xapian_tcpsrv(args, false);
     return Xapian::Remote::open_writable(LOCALHOST, port);
 }
 
@@ -345,7 +385,7 @@ BackendManagerRemoteTcp::get_remote_database(const vector<string> & files,
 					     unsigned int timeout)
 {
     string args = get_remote_database_args(files, timeout);
-    int port = launch_xapian_tcpsrv(args);
+    int port = launch_xapian_tcpsrv(args, false);
     return Xapian::Remote::open(LOCALHOST, port);
 }
 
@@ -353,7 +393,7 @@ Xapian::Database
 BackendManagerRemoteTcp::get_writable_database_as_database()
 {
     string args = get_writable_database_as_database_args();
-    int port = launch_xapian_tcpsrv(args);
+    int port = launch_xapian_tcpsrv(args, false);
     return Xapian::Remote::open(LOCALHOST, port);
 }
 
@@ -361,18 +401,22 @@ Xapian::WritableDatabase
 BackendManagerRemoteTcp::get_writable_database_again()
 {
     string args = get_writable_database_again_args();
-    int port = launch_xapian_tcpsrv(args);
+    int port = launch_xapian_tcpsrv(args, false);
     return Xapian::Remote::open_writable(LOCALHOST, port);
 }
 
 void
 BackendManagerRemoteTcp::clean_up()
 {
+    workers_ports.clear();
 #ifdef HAVE_FORK
     signal(SIGCHLD, SIG_DFL);
     for (unsigned i = 0; i < sizeof(pid_to_fd) / sizeof(pid_fd); ++i) {
 	pid_t child = pid_to_fd[i].pid;
 	if (child) {
+	    // A persistent server won't exit by itself - xapian-tcpsrv passes
+	    // SIGTERM on to its worker processes.
+	    if (pid_to_fd[i].persistent) kill(-child, SIGTERM);
 	    int status;
 	    while (waitpid(child, &status, 0) == -1 && errno == EINTR) { }
 	    // Other possible error from waitpid is ECHILD, which it seems can
@@ -382,6 +426,7 @@ BackendManagerRemoteTcp::clean_up()
 	    int fd = pid_to_fd[i].fd;
 	    pid_to_fd[i].fd = 0;
 	    pid_to_fd[i].pid = 0;
+	    pid_to_fd[i].persistent = false;
 	    close(fd);
 	}
     }
@@ -25,6 +25,7 @@
 #include "backendmanager.h"
 #include "backendmanager_remote.h"
 
+#include <map>
 #include <string>
 
 /// BackendManager subclass for remotetcp databases.
@@ -38,12 +39,23 @@ class BackendManagerRemoteTcp : public BackendManagerRemote {
     /// The path of the last writable database used.
     std::string last_wdb_name;
 
+    /** Serve read-only databases from a pool of worker processes?
+     *
+     *  If true, xapian-tcpsrv is run with --workers and --reply-cache instead
+     *  of --one-shot.
+     */
+    bool workers;
+
+    /// The ports of --workers servers started by the current test.
+    std::map<std::string, int> workers_ports;
+
     /// Create a Xapian::Database object indexing multiple files.
     Xapian::Database do_get_database(const std::vector<std::string> & files);
 
   public:
-    BackendManagerRemoteTcp(const std::string & remote_type_)
-	: BackendManagerRemote(remote_type_) { }
+    BackendManagerRemoteTcp(const std::string & remote_type_,
+			    bool workers_ = false)
+	: BackendManagerRemote(remote_type_), workers(workers_) { }
 
     ~BackendManagerRemoteTcp();
 
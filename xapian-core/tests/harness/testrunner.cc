@@ -62,6 +62,8 @@ static BackendProperties backend_properties[] = {
     { "remotetcp_brass", "backend,remote,transactions,positional,valuestats,writable,metadata" },
     { "remoteprog_chert", "backend,remote,transactions,positional,valuestats,writable,metadata" },
     { "remotetcp_chert", "backend,remote,transactions,positional,valuestats,writable,metadata" },
+    { "remotetcpworkers_brass", "backend,remote,transactions,positional,valuestats,writable,metadata,"
+				"replycache" },
     { NULL, NULL }
 };
 
@@ -86,6 +88,7 @@ TestRunner::set_properties(const string & properties)
     inmemory = false;
     brass = false;
     chert = false;
+    replycache = false;
 
     // Read the properties specified in the string
     string::size_type pos = 0;
@@ -126,6 +129,8 @@ TestRunner::set_properties(const string & properties)
 	    brass = true;
 	else if (propname == "chert")
 	    chert = true;
+	else if (propname == "replycache")
+	    replycache = true;
 	else
 	    throw Xapian::InvalidArgumentError("Unknown property '" + propname + "' found in proplist");
 
@@ -244,6 +249,13 @@ TestRunner::run_tests(int argc, char ** argv)
 	    do_tests_for_backend(&m);
 	}
 #endif
+#if defined XAPIAN_HAS_BRASS_BACKEND && defined HAVE_FORK
+	{
+	    // Also test xapian-tcpsrv's --workers and --reply-cache modes.
+	    BackendManagerRemoteTcp m("brass", true);
+	    do_tests_for_backend(&m);
+	}
+#endif
 #endif
     } catch (const Xapian::Error &e) {
 	cerr << "\nTest harness failed with " << e.get_description() << endl;
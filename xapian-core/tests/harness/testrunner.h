@@ -114,6 +114,9 @@ class TestRunner {
     /// True if the backend is the flint backend.
     bool flint;
 
+    /// True if the remote server in use caches replies to queries.
+    bool replycache;
+
     /// Virtual destructor - needed for abstract class.
     virtual ~TestRunner();
 
@@ -29,6 +29,7 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 
 using namespace std;
 
@@ -38,9 +39,18 @@ using namespace std;
 
 #include "omassert.h"
 #include "pack.h"
+#include "realtime.h"
+#include "../net/remoteconnection.h"
+#include "../net/replycache.h"
 #include "../net/serialise.h"
 #include "str.h"
 
+#ifdef HAVE_SOCKETPAIR
+# include "safeunistd.h"
+# include <sys/types.h>
+# include <sys/socket.h>
+#endif
+
 class Test_Exception {
     public:
 	int value;
@@ -284,6 +294,143 @@ static bool test_serialiseerror1()
 
     return true;
 }
+
+// Check compress_message() and uncompress_message().
+static bool test_compressmessage1()
+{
+    const char * messages[] = {
+	"", "short", "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa", NULL
+    };
+    for (const char ** m = messages; *m; ++m) {
+	string msg(*m);
+	string compressed = compress_message(msg);
+	// Short messages shouldn't get compressed.
+	TEST_EQUAL(compressed[0], '0');
+	TEST_STRINGS_EQUAL(uncompress_message(compressed), msg);
+    }
+
+    string msg;
+    for (int i = 0; i < 1000; ++i) {
+	msg += str(i % 37);
+	msg += ' ';
+    }
+    string compressed = compress_message(msg);
+    TEST_EQUAL(compressed[0], '1');
+    TEST_REL(compressed.size(), <, msg.size());
+    TEST_STRINGS_EQUAL(uncompress_message(compressed), msg);
+
+    // Random-ish data shouldn't compress, so should get sent as is.
+    msg.resize(0);
+    unsigned x = 1;
+    for (int i = 0; i < 1000; ++i) {
+	x = x * 1103515245 + 12345;
+	msg += char(x >> 16);
+    }
+    compressed = compress_message(msg);
+    TEST_EQUAL(compressed[0], '0');
+    TEST_STRINGS_EQUAL(uncompress_message(compressed), msg);
+
+    TEST_EXCEPTION(Xapian::NetworkError, uncompress_message(string()));
+    TEST_EXCEPTION(Xapian::NetworkError, uncompress_message("1garbage"));
+
+    return true;
+}
+
+// Check ReplyCache discards the least recently used entries.
+static bool test_replycache1()
+{
+    // Room for three entries with 1 byte keys and 9 byte replies.
+    ReplyCache cache(30);
+    string reply;
+
+    // Nothing is cached until the revision is set.
+    cache.add("a", "123456789");
+    TEST(!cache.get("a", reply));
+    TEST_EQUAL(cache.get_entries(), 0);
+
+    cache.set_revision("1");
+    cache.add("a", "aaaaaaaaa");
+    cache.add("b", "bbbbbbbbb");
+    cache.add("c", "ccccccccc");
+    TEST_EQUAL(cache.get_entries(), 3);
+    TEST_EQUAL(cache.get_size(), 30);
+
+    // Using "a" should make "b" the least recently used.
+    TEST(cache.get("a", reply));
+    TEST_STRINGS_EQUAL(reply, "aaaaaaaaa");
+    cache.add("d", "ddddddddd");
+    TEST_EQUAL(cache.get_entries(), 3);
+    TEST(!cache.get("b", reply));
+    TEST(cache.get("c", reply));
+    TEST_STRINGS_EQUAL(reply, "ccccccccc");
+    TEST(cache.get("d", reply));
+    TEST(cache.get("a", reply));
+
+    // An entry bigger than the whole cache isn't added.
+    cache.add("e", string(30, 'e'));
+    TEST(!cache.get("e", reply));
+    TEST_EQUAL(cache.get_entries(), 3);
+
+    TEST_EQUAL(cache.get_hits(), 4);
+    TEST_EQUAL(cache.get_misses(), 2);
+
+    // Setting the same revision keeps the entries, but a new one discards
+    // them.
+    cache.set_revision("1");
+    TEST_EQUAL(cache.get_entries(), 3);
+    cache.set_revision("2");
+    TEST_EQUAL(cache.get_entries(), 0);
+    TEST_EQUAL(cache.get_size(), 0);
+    TEST(!cache.get("a", reply));
+
+    return true;
+}
+
+#ifdef HAVE_SOCKETPAIR
+// Check RemoteConnection::wait_for_any() notices data on any of its fds.
+static bool test_waitforany1()
+{
+    int a[2], b[2];
+    TEST_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, PF_UNSPEC, a), 0);
+    if (socketpair(AF_UNIX, SOCK_STREAM, PF_UNSPEC, b) < 0) {
+	close(a[0]);
+	close(a[1]);
+	FAIL_TEST("socketpair() failed");
+    }
+    vector<int> fds;
+    fds.push_back(a[0]);
+    fds.push_back(b[0]);
+
+    // Nothing has been sent, so we should wait for the timeout.
+    double start = RealTime::now();
+    bool ready = RemoteConnection::wait_for_any(fds, 0.1);
+    double elapsed = RealTime::now() - start;
+
+    // Data ready on one fd is enough, and we shouldn't need to wait for it
+    // even with no timeout.
+    bool written = (write(b[1], "x", 1) == 1);
+    bool ready_after_write = RemoteConnection::wait_for_any(fds, 0.1);
+    bool ready_no_timeout = RemoteConnection::wait_for_any(fds, 0);
+
+    // An fd which select() can't handle makes us give up straight away.
+    fds.push_back(FD_SETSIZE);
+    bool ready_bad_fd = RemoteConnection::wait_for_any(fds, 0);
+
+    close(a[0]);
+    close(a[1]);
+    close(b[0]);
+    close(b[1]);
+
+    TEST(!ready);
+    TEST_REL(elapsed,>=,0.09);
+    TEST(written);
+    TEST(ready_after_write);
+    TEST(ready_no_timeout);
+    TEST(!ready_bad_fd);
+
+    return true;
+}
+#endif
 #endif
 
 // By default Sun's C++ compiler doesn't call the destructor on a
@@ -402,6 +549,11 @@ static const test_desc tests[] = {
     {"tostring1",		test_tostring1},
 #ifdef XAPIAN_HAS_REMOTE_BACKEND
     {"serialiseerror1",		test_serialiseerror1},
+    {"compressmessage1",	test_compressmessage1},
+    {"replycache1",		test_replycache1},
+#ifdef HAVE_SOCKETPAIR
+    {"waitforany1",		test_waitforany1},
+#endif
 #endif
     {"static_assert1",		test_static_assert1},
     {"strbool1",		test_strbool1},
@@ -0,0 +1,115 @@
+/** @file perftest_spelling.cc
+ * @brief performance tests for spelling correction
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "perftest/perftest_spelling.h"
+
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+#include <xapian.h>
+
+#include "backendmanager.h"
+#include "perftest.h"
+#include "testrunner.h"
+#include "testsuite.h"
+#include "testutils.h"
+#include "str.h"
+
+using namespace std;
+
+/** Generate a random integer from 0 to "range" - 1.
+ */
+static unsigned int
+rand_int(unsigned int range)
+{
+    return (unsigned int)(range * (rand() / (RAND_MAX + 1.0)));
+}
+
+// Test the performance of finding spelling corrections.
+DEFINE_TESTCASE(spelling1, spelling) {
+    logger.testcase_begin("spelling1");
+
+    std::string dbname("spelling1");
+    Xapian::WritableDatabase dbw =
+	backendmanager->get_writable_database(dbname, "");
+
+    unsigned int vocabsize = 20000;
+    unsigned int runsize = 100;
+    unsigned int words = 100;
+    unsigned int seed = 42;
+
+    srand(seed);
+    vector<string> vocab;
+    vocab.reserve(vocabsize);
+    for (unsigned int i = 0; i != vocabsize; ++i) {
+	string word;
+	unsigned int len = 3 + rand_int(8);
+	while (len--) word += char('a' + rand_int(26));
+	dbw.add_spelling(word, 1 + rand_int(10));
+	vocab.push_back(word);
+    }
+    dbw.commit();
+
+    // Misspell words from the vocabulary with a random edit.
+    vector<string> misspelt;
+    misspelt.reserve(runsize * words);
+    for (unsigned int i = 0; i != runsize * words; ++i) {
+	string word = vocab[rand_int(vocabsize)];
+	size_t pos = rand_int(word.size() - 1);
+	switch (rand_int(4)) {
+	    case 0:
+		word.insert(pos, 1, char('a' + rand_int(26)));
+		break;
+	    case 1:
+		word.erase(pos, 1);
+		break;
+	    case 2:
+		word[pos] = char('a' + rand_int(26));
+		break;
+	    default:
+		swap(word[pos], word[pos + 1]);
+		break;
+	}
+	misspelt.push_back(word);
+    }
+
+    std::map<std::string, std::string> params;
+    params["vocabsize"] = str(vocabsize);
+    params["runsize"] = str(runsize);
+    params["seed"] = str(seed);
+    params["words"] = str(words);
+    logger.indexing_begin(dbname, params);
+
+    vector<string>::const_iterator w = misspelt.begin();
+    for (unsigned int i = 0; i != runsize; ++i) {
+	for (unsigned int j = 0; j != words; ++j) {
+	    (void)dbw.get_spelling_suggestion(*w++);
+	}
+	logger.indexing_add();
+    }
+    logger.indexing_end();
+
+    logger.testcase_end();
+    return true;
+}
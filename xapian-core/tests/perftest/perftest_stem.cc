@@ -0,0 +1,99 @@
+/** @file perftest_stem.cc
+ * @brief performance tests for stemmers
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "perftest/perftest_stem.h"
+
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+#include <xapian.h>
+
+#include "perftest.h"
+#include "testrunner.h"
+#include "testsuite.h"
+#include "testutils.h"
+#include "str.h"
+
+using namespace std;
+
+/** Generate a random integer from 0 to "range" - 1.
+ */
+static unsigned int
+rand_int(unsigned int range)
+{
+    return (unsigned int)(range * (rand() / (RAND_MAX + 1.0)));
+}
+
+// Test the performance of stemming ASCII words.
+DEFINE_TESTCASE(stem1, !backend) {
+    logger.testcase_begin("stem1");
+
+    static const char * const suffixes[] = {
+	"", "", "", "s", "es", "ed", "ing", "ly", "er", "ness", "ation", "ies",
+	"ment", "en", "ern", "ions", "ande"
+    };
+    const unsigned int n_suffixes = sizeof(suffixes) / sizeof(*suffixes);
+
+    unsigned int runsize = 1000;
+    unsigned int words = 1000;
+    unsigned int seed = 42;
+
+    srand(seed);
+    vector<string> vocab;
+    vocab.reserve(runsize * words);
+    for (unsigned int i = 0; i != runsize * words; ++i) {
+	string word;
+	unsigned int len = 2 + rand_int(8);
+	while (len--) word += "aeiouybcdfghklmnprstvwz"[rand_int(23)];
+	word += suffixes[rand_int(n_suffixes)];
+	vocab.push_back(word);
+    }
+
+    static const char * const languages[] = {
+	"english", "porter", "french", "german", "dutch", "spanish"
+    };
+    for (size_t l = 0; l != sizeof(languages) / sizeof(*languages); ++l) {
+	const string language(languages[l]);
+	std::map<std::string, std::string> params;
+	params["runsize"] = str(runsize);
+	params["seed"] = str(seed);
+	params["words"] = str(words);
+	params["language"] = language;
+	logger.indexing_begin("stem1_" + language, params);
+
+	Xapian::Stem stemmer(language);
+	string stem;
+	vector<string>::const_iterator w = vocab.begin();
+	for (unsigned int i = 0; i != runsize; ++i) {
+	    for (unsigned int j = 0; j != words; ++j) {
+		stemmer(*w++, stem);
+	    }
+	    logger.indexing_add();
+	}
+	logger.indexing_end();
+    }
+
+    logger.testcase_end();
+    return true;
+}
@@ -0,0 +1,162 @@
+/** @file perftest_termgen.cc
+ * @brief performance tests for TermGenerator
+ */
+/* Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "perftest/perftest_termgen.h"
+
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+#include <xapian.h>
+
+#include "perftest.h"
+#include "testrunner.h"
+#include "testsuite.h"
+#include "testutils.h"
+#include "str.h"
+
+using namespace std;
+
+/** Generate a random integer from 0 to "range" - 1.
+ */
+static unsigned int
+rand_int(unsigned int range)
+{
+    return (unsigned int)(range * (rand() / (RAND_MAX + 1.0)));
+}
+
+/** Generate some text, made up of "words" separated by spaces and
+ *  punctuation.
+ *
+ *  @param words	The number of words to generate.
+ *  @param vocab	The words to pick from.
+ */
+static string
+gen_text(unsigned int words, const vector<string> & vocab)
+{
+    static const char * const separators[] = {
+	" ", " ", " ", " ", " ", " ", ", ", ". ", "\n", " - ", "'s "
+    };
+    const unsigned int n_separators = sizeof(separators) / sizeof(*separators);
+    string result;
+    for (unsigned int i = 0; i != words; ++i) {
+	result += vocab[rand_int(vocab.size())];
+	result += separators[rand_int(n_separators)];
+    }
+    return result;
+}
+
+/** Time indexing text with a TermGenerator.
+ *
+ *  @param testcase	Name of the testcase (used for logging).
+ *  @param vocab	The words to make documents from.
+ *  @param stem		Whether to use a stemmer.
+ */
+static void
+time_termgen(const string & testcase, const vector<string> & vocab, bool stem)
+{
+    unsigned int runsize = 10000;
+    unsigned int words = 200;
+    unsigned int seed = 42;
+
+    srand(seed);
+    vector<string> texts;
+    texts.reserve(runsize);
+    for (unsigned int i = 0; i != runsize; ++i) {
+	texts.push_back(gen_text(words, vocab));
+    }
+
+    std::map<std::string, std::string> params;
+    params["runsize"] = str(runsize);
+    params["seed"] = str(seed);
+    params["words"] = str(words);
+    params["vocab"] = str(vocab.size());
+    params["stem"] = stem ? "english" : "none";
+    logger.indexing_begin(testcase, params);
+
+    Xapian::TermGenerator termgen;
+    if (stem) termgen.set_stemmer(Xapian::Stem("english"));
+    for (unsigned int i = 0; i != runsize; ++i) {
+	Xapian::Document doc;
+	termgen.set_document(doc);
+	termgen.index_text(texts[i]);
+	logger.indexing_add();
+    }
+    logger.indexing_end();
+}
+
+// Test the performance of indexing ASCII text.
+DEFINE_TESTCASE(termgen1, !backend) {
+    logger.testcase_begin("termgen1");
+
+    srand(1);
+    vector<string> vocab;
+    for (unsigned int i = 0; i != 5000; ++i) {
+	string word;
+	unsigned int len = 1 + rand_int(10);
+	// Capitalise some words.
+	word += char((rand_int(5) ? 'a' : 'A') + rand_int(26));
+	while (--len) word += char('a' + rand_int(26));
+	vocab.push_back(word);
+    }
+    vocab.push_back("AT&T");
+    vocab.push_back("C++");
+    vocab.push_back("U.N.C.L.E.");
+    vocab.push_back("3.14159");
+
+    time_termgen("termgen1", vocab, false);
+    time_termgen("termgen1_stem", vocab, true);
+
+    logger.testcase_end();
+    return true;
+}
+
+// Test the performance of indexing text with some non-ASCII characters.
+DEFINE_TESTCASE(termgen2, !backend) {
+    logger.testcase_begin("termgen2");
+
+    static const char * const accented[] = {
+	"\xc3\xa9", "\xc3\xa8", "\xc3\xbc", "\xc3\x9f", "\xc3\xb8", "\xc3\x85"
+    };
+    const unsigned int n_accented = sizeof(accented) / sizeof(*accented);
+
+    srand(1);
+    vector<string> vocab;
+    for (unsigned int i = 0; i != 5000; ++i) {
+	string word;
+	unsigned int len = 1 + rand_int(10);
+	while (len--) {
+	    if (rand_int(8) == 0) {
+		word += accented[rand_int(n_accented)];
+	    } else {
+		word += char('a' + rand_int(26));
+	    }
+	}
+	vocab.push_back(word);
+    }
+
+    time_termgen("termgen2", vocab, false);
+
+    logger.testcase_end();
+    return true;
+}
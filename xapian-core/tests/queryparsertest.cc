@@ -29,6 +29,7 @@
 
 #include <cmath>
 #include <iostream>
+#include <set>
 #include <string>
 #include <vector>
 #include "safesysstat.h" // For mkdir().
@@ -893,15 +894,15 @@ static bool test_qp_flag_wildcard1()
     Xapian::QueryParser qp;
     qp.set_database(db);
     Xapian::Query qobj = qp.parse_query("ab*", Xapian::QueryParser::FLAG_WILDCARD);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(abc@1)");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(WILDCARD ab)");
     qobj = qp.parse_query("muscle*", Xapian::QueryParser::FLAG_WILDCARD);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((muscle@1 SYNONYM musclebound@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(WILDCARD muscle)");
     qobj = qp.parse_query("meat*", Xapian::QueryParser::FLAG_WILDCARD);
     TEST_STRINGS_EQUAL(qobj.get_description(), "Query()");
     qobj = qp.parse_query("musc*", Xapian::QueryParser::FLAG_WILDCARD);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((muscat@1 SYNONYM muscle@1 SYNONYM musclebound@1 SYNONYM muscular@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(WILDCARD musc)");
     qobj = qp.parse_query("mutt*", Xapian::QueryParser::FLAG_WILDCARD);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(mutton@1)");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(WILDCARD mutt)");
     // Regression test (we weren't lowercasing terms before checking if they
     // were in the database or not):
     qobj = qp.parse_query("mUTTON++");
@@ -910,7 +911,7 @@ static bool test_qp_flag_wildcard1()
     unsigned flags = Xapian::QueryParser::FLAG_WILDCARD |
 		     Xapian::QueryParser::FLAG_LOVEHATE;
     qobj = qp.parse_query("+mai* main", flags);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((main@1 AND_MAYBE main@2))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD mai AND_MAYBE main@2))");
     // Regression test (if we had a +term which was a wildcard and wasn't
     // present, the query could still match documents).
     qobj = qp.parse_query("foo* main", flags);
@@ -973,7 +974,7 @@ static bool test_qp_flag_wildcard1()
     TEST_STRINGS_EQUAL(qobj.get_description(), "Query()");
     // Regression test for bug#484 fixed in 1.2.1 and 1.0.21.
     qobj = qp.parse_query("abc muscl* main", flags);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(((abc@1 AND (muscle@2 SYNONYM musclebound@2)) AND main@3))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(((abc@1 AND WILDCARD muscl) AND main@3))");
     return true;
 #endif
 }
@@ -995,9 +996,9 @@ static bool test_qp_flag_wildcard2()
     qp.add_prefix("author", "A");
     Xapian::Query qobj;
     qobj = qp.parse_query("author:h*", Xapian::QueryParser::FLAG_WILDCARD);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((Aheinlein@1 SYNONYM Ahuxley@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(WILDCARD Ah)");
     qobj = qp.parse_query("author:h* test", Xapian::QueryParser::FLAG_WILDCARD);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(((Aheinlein@1 SYNONYM Ahuxley@1) OR test@2))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD Ah OR test@2))");
     return true;
 #endif
 }
@@ -1065,6 +1066,73 @@ static bool test_qp_flag_wildcard3()
 #endif
 }
 
+// Test fuzzy matching of terms.
+static bool test_qp_flag_fuzzy1()
+{
+    static const test test_fuzzy_queries[] = {
+	{ "helo~", "FUZZY 2 helo" },
+	{ "helo~1", "FUZZY 1 helo" },
+	{ "helo~0 world", "(FUZZY 0 helo OR world@2)" },
+	{ "Helo~, world", "(FUZZY 2 helo OR world@2)" },
+	{ "author:helo~", "FUZZY 2 Ahelo" },
+	{ "(helo~ world)", "(FUZZY 2 helo OR world@2)" },
+	{ "helo~world", "(helo@1 OR world@2)" },
+	{ "helo~12", "(helo@1 OR 12@2)" },
+	{ "\"helo~ world\"", "(helo@1 PHRASE 2 world@2)" },
+	{ NULL, NULL }
+    };
+    Xapian::QueryParser qp;
+    qp.add_prefix("author", "A");
+    for (const test *p = test_fuzzy_queries; p->query; ++p) {
+	string expect, parsed;
+	if (p->expect)
+	    expect = p->expect;
+	else
+	    expect = "parse error";
+	try {
+	    Xapian::Query qobj = qp.parse_query(p->query,
+						Xapian::QueryParser::FLAG_FUZZY |
+						Xapian::QueryParser::FLAG_PHRASE);
+	    parsed = qobj.get_description();
+	    expect = string("Query(") + expect + ')';
+	} catch (const Xapian::QueryParserError &e) {
+	    parsed = e.get_msg();
+	} catch (const Xapian::Error &e) {
+	    parsed = e.get_description();
+	} catch (...) {
+	    parsed = "Unknown exception!";
+	}
+	tout << "Query: " << p->query << '\n';
+	TEST_STRINGS_EQUAL(parsed, expect);
+    }
+
+    // Without FLAG_FUZZY, '~' after a term is just ignored.
+    Xapian::Query qobj = qp.parse_query("helo~");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(helo@1)");
+
+#ifdef XAPIAN_HAS_INMEMORY_BACKEND
+    Xapian::WritableDatabase db(Xapian::InMemory::open());
+    Xapian::Document doc;
+    doc.add_term("hello");
+    db.add_document(doc);
+    Xapian::Enquire enq(db);
+    enq.set_query(qp.parse_query("helo~1", Xapian::QueryParser::FLAG_FUZZY));
+    TEST_EQUAL(enq.get_mset(0, 10).size(), 1);
+    enq.set_query(qp.parse_query("hel~1", Xapian::QueryParser::FLAG_FUZZY));
+    TEST_EQUAL(enq.get_mset(0, 10).size(), 0);
+
+    // A fuzzy term without a prefix shouldn't match terms with a prefix.
+    doc.clear_terms();
+    doc.add_term("Shello");
+    db.add_document(doc);
+    enq.set_query(qp.parse_query("hello~", Xapian::QueryParser::FLAG_FUZZY));
+    Xapian::MSet mset = enq.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), 1);
+    TEST_EQUAL(*mset.begin(), 1);
+#endif
+    return true;
+}
+
 // Test partial queries.
 static bool test_qp_flag_partial1()
 {
@@ -1105,76 +1173,76 @@ static bool test_qp_flag_partial1()
 
     // Check behaviour with unstemmed terms
     Xapian::Query qobj = qp.parse_query("a", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((abc@1 OR Za@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD a OR Za@1))");
     qobj = qp.parse_query("ab", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((abc@1 OR Zab@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD ab OR Zab@1))");
     qobj = qp.parse_query("muscle", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(((muscle@1 SYNONYM musclebound@1) OR Zmuscl@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD muscle OR Zmuscl@1))");
     qobj = qp.parse_query("meat", Xapian::QueryParser::FLAG_PARTIAL);
     TEST_STRINGS_EQUAL(qobj.get_description(), "Query(Zmeat@1)");
     qobj = qp.parse_query("musc", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(((muscat@1 SYNONYM muscle@1 SYNONYM musclebound@1 SYNONYM muscular@1) OR Zmusc@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD musc OR Zmusc@1))");
     qobj = qp.parse_query("mutt", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((mutton@1 OR Zmutt@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD mutt OR Zmutt@1))");
     qobj = qp.parse_query("abc musc", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((Zabc@1 OR ((muscat@2 SYNONYM muscle@2 SYNONYM musclebound@2 SYNONYM muscular@2) OR Zmusc@2)))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((Zabc@1 OR (WILDCARD musc OR Zmusc@2)))");
     qobj = qp.parse_query("a* mutt", Xapian::QueryParser::FLAG_PARTIAL | Xapian::QueryParser::FLAG_WILDCARD);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((abc@1 OR (mutton@2 OR Zmutt@2)))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD a OR (WILDCARD mutt OR Zmutt@2)))");
 
     // Check behaviour with stemmed terms, and stem strategy STEM_SOME.
     qobj = qp.parse_query("o", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(((out@1 SYNONYM outside@1) OR Zo@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD o OR Zo@1))");
     qobj = qp.parse_query("ou", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(((out@1 SYNONYM outside@1) OR Zou@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD ou OR Zou@1))");
     qobj = qp.parse_query("out", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(((out@1 SYNONYM outside@1) OR Zout@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD out OR Zout@1))");
     qobj = qp.parse_query("outs", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((outside@1 OR Zout@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD outs OR Zout@1))");
     qobj = qp.parse_query("outsi", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((outside@1 OR Zoutsi@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD outsi OR Zoutsi@1))");
     qobj = qp.parse_query("outsid", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((outside@1 OR Zoutsid@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD outsid OR Zoutsid@1))");
     qobj = qp.parse_query("outside", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((outside@1 OR Zoutsid@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD outside OR Zoutsid@1))");
 
     // Check behaviour with capitalised terms, and stem strategy STEM_SOME.
     qobj = qp.parse_query("Out", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(((out@1 SYNONYM outside@1) OR out@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD out OR out@1))");
     qobj = qp.parse_query("Outs", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((outside@1 OR outs@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD outs OR outs@1))");
     qobj = qp.parse_query("Outside", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((outside@1 OR outside@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD outside OR outside@1))");
     // FIXME: Used to be this, but we aren't currently doing this change:
     // TEST_STRINGS_EQUAL(qobj.get_description(), "Query(outside@1#2)");
 
     // And now with stemming strategy STEM_ALL.
     qp.set_stemming_strategy(Xapian::QueryParser::STEM_ALL);
     qobj = qp.parse_query("Out", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(((out@1 SYNONYM outside@1) OR out@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD out OR out@1))");
     qobj = qp.parse_query("Outs", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((outside@1 OR out@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD outs OR out@1))");
     qobj = qp.parse_query("Outside", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((outside@1 OR outsid@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD outside OR outsid@1))");
 
     // And now with stemming strategy STEM_ALL_Z.
     qp.set_stemming_strategy(Xapian::QueryParser::STEM_ALL_Z);
     qobj = qp.parse_query("Out", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(((out@1 SYNONYM outside@1) OR Zout@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD out OR Zout@1))");
     qobj = qp.parse_query("Outs", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((outside@1 OR Zout@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD outs OR Zout@1))");
     qobj = qp.parse_query("Outside", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((outside@1 OR Zoutsid@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD outside OR Zoutsid@1))");
 
     // Check handling of a case with a prefix.
     qp.set_stemming_strategy(Xapian::QueryParser::STEM_SOME);
     qobj = qp.parse_query("title:cow", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(((XTcowl@1 SYNONYM XTcows@1) OR ZXTcow@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD XTcow OR ZXTcow@1))");
     qobj = qp.parse_query("title:cows", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((XTcows@1 OR ZXTcow@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD XTcows OR ZXTcow@1))");
     qobj = qp.parse_query("title:Cow", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(((XTcowl@1 SYNONYM XTcows@1) OR XTcow@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD XTcow OR XTcow@1))");
     qobj = qp.parse_query("title:Cows", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((XTcows@1 OR XTcows@1))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((WILDCARD XTcows OR XTcows@1))");
     // FIXME: Used to be this, but we aren't currently doing this change:
     // TEST_STRINGS_EQUAL(qobj.get_description(), "Query(XTcows@1#2)");
 
@@ -1186,20 +1254,144 @@ static bool test_qp_flag_partial1()
 
     // Test handling of FLAG_PARTIAL when there's more than one prefix.
     qobj = qp.parse_query("double:part", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(((XONEpartial@1 SYNONYM XONEpartial2@1 SYNONYM XTWOpartial3@1 SYNONYM XTWOpartial4@1) OR (ZXONEpart@1 SYNONYM ZXTWOpart@1)))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(((WILDCARD XONEpart SYNONYM WILDCARD XTWOpart) OR (ZXONEpart@1 SYNONYM ZXTWOpart@1)))");
 
     // Test handling of FLAG_PARTIAL when there's more than one prefix, without
     // stemming.
     qp.set_stemming_strategy(Xapian::QueryParser::STEM_NONE);
     qobj = qp.parse_query("double:part", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(((XONEpartial@1 SYNONYM XONEpartial2@1 SYNONYM XTWOpartial3@1 SYNONYM XTWOpartial4@1) OR (XONEpart@1 SYNONYM XTWOpart@1)))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(((WILDCARD XONEpart SYNONYM WILDCARD XTWOpart) OR (XONEpart@1 SYNONYM XTWOpart@1)))");
     qobj = qp.parse_query("double:partial", Xapian::QueryParser::FLAG_PARTIAL);
-    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(((XONEpartial@1 SYNONYM XONEpartial2@1 SYNONYM XTWOpartial3@1 SYNONYM XTWOpartial4@1) OR (XONEpartial@1 SYNONYM XTWOpartial@1)))");
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(((WILDCARD XONEpartial SYNONYM WILDCARD XTWOpartial) OR (XONEpartial@1 SYNONYM XTWOpartial@1)))");
 
     return true;
 #endif
 }
 
+// Test partial and wildcard queries using indexed prefix terms.
+static bool test_qp_flag_partial_prefixes1()
+{
+#ifndef XAPIAN_HAS_INMEMORY_BACKEND
+    SKIP_TEST("Testcase requires the InMemory backend which is disabled");
+#else
+    Xapian::WritableDatabase db(Xapian::InMemory::open());
+    Xapian::TermGenerator termgen;
+    termgen.set_flags(Xapian::TermGenerator::FLAG_PARTIAL_PREFIXES);
+    const char * texts[] = {
+	"hello world", "help me", "helicopters", "shell", "the helicopter"
+    };
+    for (size_t i = 0; i != sizeof(texts) / sizeof(texts[0]); ++i) {
+	Xapian::Document doc;
+	termgen.set_document(doc);
+	termgen.index_text(texts[i]);
+	termgen.index_text("heinlein", 1, "A");
+	db.add_document(doc);
+    }
+
+    Xapian::QueryParser qp;
+    qp.set_database(db);
+    qp.add_prefix("author", "A");
+    unsigned partial = Xapian::QueryParser::FLAG_PARTIAL |
+		       Xapian::QueryParser::FLAG_PARTIAL_PREFIXES;
+    unsigned wildcard = Xapian::QueryParser::FLAG_WILDCARD |
+			Xapian::QueryParser::FLAG_PARTIAL_PREFIXES;
+    Xapian::Query qobj = qp.parse_query("hel", partial);
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((^hel@1 OR hel@1))");
+    qobj = qp.parse_query("world h", partial);
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query((world@1 OR (^h@2 OR h@2)))");
+    qobj = qp.parse_query("xyz", partial);
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(xyz@1)");
+    qobj = qp.parse_query("hel*", wildcard);
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(^hel@1)");
+    qobj = qp.parse_query("author:he*", wildcard);
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(^Ahe@1)");
+    qobj = qp.parse_query("xyz* world", wildcard);
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(world@2)");
+    // Prefixes longer than those indexed are expanded as usual.
+    qobj = qp.parse_query("helicopt*", wildcard);
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(WILDCARD helicopt)");
+
+    // The prefix terms should match the same documents as a wildcard.
+    Xapian::Enquire enq(db);
+    const char * words[] = { "h", "he", "hel", "heli", "s", "w" };
+    for (size_t i = 0; i != sizeof(words) / sizeof(words[0]); ++i) {
+	string q = words[i];
+	q += '*';
+	enq.set_query(qp.parse_query(q, wildcard));
+	Xapian::MSet mset1 = enq.get_mset(0, 10);
+	enq.set_query(qp.parse_query(q, Xapian::QueryParser::FLAG_WILDCARD));
+	Xapian::MSet mset2 = enq.get_mset(0, 10);
+	tout << q << '\n';
+	TEST_EQUAL(mset1.size(), mset2.size());
+	set<Xapian::docid> docs1, docs2;
+	for (Xapian::doccount j = 0; j != mset1.size(); ++j) {
+	    docs1.insert(*mset1[j]);
+	    docs2.insert(*mset2[j]);
+	}
+	TEST(docs1 == docs2);
+    }
+
+    // Check the lengths can be changed.
+    qp.set_partial_prefix_lengths(2, 3);
+    qobj = qp.parse_query("h*", wildcard);
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(WILDCARD h)");
+    qobj = qp.parse_query("hel*", wildcard);
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(^hel@1)");
+    qobj = qp.parse_query("hell*", wildcard);
+    TEST_STRINGS_EQUAL(qobj.get_description(), "Query(WILDCARD hell)");
+    return true;
+#endif
+}
+
+// Test splitting CJK text into words with a dictionary.
+static bool test_qp_cjk_segmenter1()
+{
+    Xapian::DictionaryCJKSegmenter segmenter;
+    segmenter.add_word("中华", 10);
+    segmenter.add_word("人民", 10);
+    segmenter.add_word("共和国", 10);
+    segmenter.add_word("中华人民共和国", 5);
+    segmenter.add_word("成立", 10);
+
+    Xapian::QueryParser qp;
+    qp.set_cjk_segmenter(&segmenter);
+    qp.add_prefix("title", "XT");
+    Xapian::Query qobj = qp.parse_query("中华人民共和国成立了");
+    TEST_STRINGS_EQUAL(qobj.get_description(),
+		       "Query((中华人民共和国@1 AND 成立@1 AND 了@1))");
+    qobj = qp.parse_query("title:人民 成立");
+    TEST_STRINGS_EQUAL(qobj.get_description(),
+		       "Query((XT人民@1 OR 成立@2))");
+    qobj = qp.parse_query("\"人民成立\"");
+    TEST_STRINGS_EQUAL(qobj.get_description(),
+		       "Query((人民@1 PHRASE 2 成立@1))");
+
+#ifdef XAPIAN_HAS_INMEMORY_BACKEND
+    // Check phrase searches work with the positions TermGenerator gives
+    // the words.
+    Xapian::WritableDatabase db(Xapian::InMemory::open());
+    Xapian::TermGenerator termgen;
+    termgen.set_cjk_segmenter(&segmenter);
+    const char * texts[] = { "中华人民共和国成立", "成立人民" };
+    for (size_t i = 0; i != sizeof(texts) / sizeof(texts[0]); ++i) {
+	Xapian::Document doc;
+	termgen.set_document(doc);
+	termgen.index_text(texts[i]);
+	db.add_document(doc);
+    }
+    Xapian::Enquire enq(db);
+    enq.set_query(qp.parse_query("\"中华人民共和国成立\""));
+    Xapian::MSet mset = enq.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), 1);
+    TEST_EQUAL(*mset[0], 1);
+    enq.set_query(qp.parse_query("成立人民"));
+    mset = enq.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), 1);
+    TEST_EQUAL(*mset[0], 2);
+#endif
+    return true;
+}
+
 static bool test_qp_flag_bool_any_case1()
 {
     using Xapian::QueryParser;
@@ -2597,26 +2789,26 @@ static bool test_qp_phrase1()
 
 static const test test_stopword_group_or_queries[] = {
     { "this is a test", "test@4" },
-    { "test*", "(test@1 SYNONYM testable@1 SYNONYM tester@1)" },
-    { "a test*", "(test@2 SYNONYM testable@2 SYNONYM tester@2)" },
-    { "is a test*", "(test@3 SYNONYM testable@3 SYNONYM tester@3)" },
-    { "this is a test*", "(test@4 SYNONYM testable@4 SYNONYM tester@4)" },
-    { "this is a us* test*", "(user@4 OR (test@5 SYNONYM testable@5 SYNONYM tester@5))" },
-    { "this is a user test*", "(user@4 OR (test@5 SYNONYM testable@5 SYNONYM tester@5))" },
+    { "test*", "WILDCARD test" },
+    { "a test*", "WILDCARD test" },
+    { "is a test*", "WILDCARD test" },
+    { "this is a test*", "WILDCARD test" },
+    { "this is a us* test*", "(WILDCARD us OR WILDCARD test)" },
+    { "this is a user test*", "(user@4 OR WILDCARD test)" },
     { NULL, NULL }
 };
 
 static const test test_stopword_group_and_queries[] = {
     { "this is a test", "test@4" },
-    { "test*", "(test@1 SYNONYM testable@1 SYNONYM tester@1)" },
-    { "a test*", "(test@2 SYNONYM testable@2 SYNONYM tester@2)" },
+    { "test*", "WILDCARD test" },
+    { "a test*", "WILDCARD test" },
     // Two stopwords + one wildcard failed in 1.0.16
-    { "is a test*", "(test@3 SYNONYM testable@3 SYNONYM tester@3)" },
+    { "is a test*", "WILDCARD test" },
     // Three stopwords + one wildcard failed in 1.0.16
-    { "this is a test*", "(test@4 SYNONYM testable@4 SYNONYM tester@4)" },
+    { "this is a test*", "WILDCARD test" },
     // Three stopwords + two wildcards failed in 1.0.16
-    { "this is a us* test*", "(user@4 AND (test@5 SYNONYM testable@5 SYNONYM tester@5))" },
-    { "this is a user test*", "(user@4 AND (test@5 SYNONYM testable@5 SYNONYM tester@5))" },
+    { "this is a us* test*", "(WILDCARD us AND WILDCARD test)" },
+    { "this is a user test*", "(user@4 AND WILDCARD test)" },
     { NULL, NULL }
 };
 
@@ -2751,7 +2943,10 @@ static const test_desc tests[] = {
     TESTCASE(qp_flag_wildcard1),
     TESTCASE(qp_flag_wildcard2),
     TESTCASE(qp_flag_wildcard3),
+    TESTCASE(qp_flag_fuzzy1),
     TESTCASE(qp_flag_partial1),
+    TESTCASE(qp_flag_partial_prefixes1),
+    TESTCASE(qp_cjk_segmenter1),
     TESTCASE(qp_flag_bool_any_case1),
     TESTCASE(qp_stopper1),
     TESTCASE(qp_flag_pure_not1),
@@ -162,6 +162,37 @@ test_stemdict()
     return true;
 }
 
+// Words which mix ASCII and non-ASCII letters, so the stemmer has to step
+// between single and multi-byte characters mid-word.
+static const struct { const char * lang, * word, * expect; } mixed_words[] = {
+    { "french", "caf\xc3\xa9", "caf" },
+    { "french", "\xc3\xa9l\xc3\xa8ve", "\xc3\xa9lev" },
+    { "french", "th\xc3\xa9\xc3\xa2tre", "th\xc3\xa9\xc3\xa2tr" },
+    { "french", "na\xc3\xafvet\xc3\xa9", "na\xc3\xafvet" },
+    { "german", "h\xc3\xa4user", "haus" },
+    { "german", "gr\xc3\xbc\xc3\x9f" "e", "gruss" },
+    { "german", "m\xc3\xbc\xc3\x9figg\xc3\xa4nger", "mussiggang" },
+    { "russian", "\xd0\xba\xd0\xbd\xd0\xb8\xd0\xb3\xd0\xb0\xd0\xbc\xd0\xb8", "\xd0\xba\xd0\xbd\xd0\xb8\xd0\xb3" },
+    { "spanish", "canci\xc3\xb3n", "cancion" },
+    { "spanish", "ni\xc3\xb1os", "ni\xc3\xb1" },
+    { "swedish", "\xc3\xa4pplena", "\xc3\xa4pplen" },
+    { NULL, NULL, NULL }
+};
+
+// Check stemming of words with non-ASCII letters next to ASCII ones.
+static bool
+test_stemmixed()
+{
+    bool found = false;
+    for (size_t i = 0; mixed_words[i].lang; ++i) {
+	if (language != mixed_words[i].lang) continue;
+	found = true;
+	TEST_EQUAL(stemmer(mixed_words[i].word), mixed_words[i].expect);
+    }
+    if (!found) SKIP_TEST("No mixed words for " + language);
+    return true;
+}
+
 // ##################################################################
 // # End of actual tests                                            #
 // ##################################################################
@@ -171,6 +202,7 @@ static const test_desc tests[] = {
     {"stemrandom",		test_stemrandom},
     {"stemjunk",		test_stemjunk},
     {"stemdict",		test_stemdict},
+    {"stemmixed",		test_stemmixed},
     {0, 0}
 };
 
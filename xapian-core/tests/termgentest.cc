@@ -23,8 +23,10 @@
 
 #include <xapian.h>
 
+#include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "str.h"
 #include "testsuite.h"
@@ -119,6 +121,12 @@ static const test test_simple[] = {
 
     { "", "fish+chips", "Zchip:1 Zfish:1 chips[2] fish[1]" },
 
+    // Word boundaries between ASCII and non-ASCII characters:
+    { "", "caf\xc3\xa9,na\xc3\xafve-test", "Zcaf\xc3\xa9:1 Zna\xc3\xafv:1 Ztest:1 caf\xc3\xa9[1] na\xc3\xafve[2] test[3]" },
+    { "", ".\xc3\xa9t\xc3\xa9 abc\xc3\xa9 \xc3\xa9" "abc", "Zabc\xc3\xa9:1 Z\xc3\xa9" "abc:1 Z\xc3\xa9t\xc3\xa9:1 abc\xc3\xa9[2] \xc3\xa9" "abc[3] \xc3\xa9t\xc3\xa9[1]" },
+    { "", "\xc3\xa9\xc3\xa9" "9 \xc3\xbc.\xc3\xa4! \xc2\xabh\xc3\xb6hle\xc2\xbb", "Zh\xc3\xb6hle:1 Z\xc3\xa4:1 Z\xc3\xa9\xc3\xa9" "9:1 Z\xc3\xbc:1 h\xc3\xb6hle[4] \xc3\xa4[3] \xc3\xa9\xc3\xa9" "9[1] \xc3\xbc[2]" },
+    { "", "Stra\xc3\x9f" "e\xe2\x80\x94H\xc3\xa4user\xc2\xa0" "caf\xc3\xa9s", "Zcaf\xc3\xa9:1 Zh\xc3\xa4user:1 Zstra\xc3\x9f" "e:1 caf\xc3\xa9s[3] h\xc3\xa4user[2] stra\xc3\x9f" "e[1]" },
+
     // Basic CJK tests:
     { "stem=", "久有归天", "久[1] 久有:1 天[4] 归[3] 归天:1 有[2] 有归:1" },
     { "", "극지라", "극[1] 극지:1 라[3] 지[2] 지라:1" },
@@ -826,12 +834,87 @@ static bool test_tg_max_word_length1()
     return true;
 }
 
+/// Test indexing of prefixes for partial matching.
+static bool test_tg_partial_prefixes1()
+{
+    Xapian::TermGenerator termgen;
+    termgen.set_flags(Xapian::TermGenerator::FLAG_PARTIAL_PREFIXES);
+
+    Xapian::Document doc;
+    termgen.set_document(doc);
+    termgen.index_text("Hello hel");
+    TEST_STRINGS_EQUAL(format_doc_termlist(doc),
+		       "^h:2 ^he:2 ^hel:2 ^hell:1 ^hello:1 hel[2] hello[1]");
+
+    // Check that prefixes are counted in characters, not bytes, and that
+    // the term prefix is used.
+    termgen.set_partial_prefix_lengths(2, 3);
+    doc = Xapian::Document();
+    termgen.set_document(doc);
+    termgen.index_text("\xc3\xa9t\xc3\xa9 a", 2, "S");
+    TEST_STRINGS_EQUAL(format_doc_termlist(doc),
+		       "Sa:2[2] S\xc3\xa9t\xc3\xa9:2[1] "
+		       "^S\xc3\xa9t:2 ^S\xc3\xa9t\xc3\xa9:2");
+
+    return true;
+}
+
+/// Test splitting CJK text into words with a dictionary.
+static bool test_tg_cjk_segmenter1()
+{
+    Xapian::DictionaryCJKSegmenter segmenter;
+    segmenter.add_word("中华", 10);
+    segmenter.add_word("人民", 10);
+    segmenter.add_word("共和国", 10);
+    segmenter.add_word("中华人民共和国", 5);
+    segmenter.add_word("成立", 10);
+    TEST_STRINGS_EQUAL(segmenter.get_description(),
+		       "Xapian::DictionaryCJKSegmenter(5 words)");
+
+    Xapian::TermGenerator termgen;
+    termgen.set_cjk_segmenter(&segmenter);
+    Xapian::Document doc;
+    termgen.set_document(doc);
+
+    // Characters not in the dictionary are single character words, and
+    // punctuation is ignored.
+    termgen.index_text("中华人民共和国成立了。 test");
+    TEST_STRINGS_EQUAL(format_doc_termlist(doc),
+		       "test[4] 中华人民共和国[1] 了[3] 成立[2]");
+
+    doc = Xapian::Document();
+    termgen.set_document(doc);
+    termgen.index_text("人民成立", 1, "XA");
+    TEST_STRINGS_EQUAL(format_doc_termlist(doc), "XA人民[1] XA成立[2]");
+
+    // Check the dictionary can be loaded from a file, with frequencies.
+    {
+	ofstream out(".cjkdict");
+	out << "中华 3\n人民共和国 2 n\n\n人民\n共和国 2\n";
+    }
+    Xapian::DictionaryCJKSegmenter from_file(".cjkdict");
+    TEST_STRINGS_EQUAL(from_file.get_description(),
+		       "Xapian::DictionaryCJKSegmenter(4 words)");
+    vector<string> words;
+    from_file("中华人民共和国", words);
+    TEST_EQUAL(words.size(), 2);
+    TEST_STRINGS_EQUAL(words[0], "中华");
+    TEST_STRINGS_EQUAL(words[1], "人民共和国");
+
+    TEST_EXCEPTION(Xapian::InvalidArgumentError,
+	Xapian::DictionaryCJKSegmenter bad(".cjkdict-nonexistent"));
+
+    return true;
+}
+
 /// Test cases for the TermGenerator.
 static const test_desc tests[] = {
     TESTCASE(termgen1),
     TESTCASE(tg_spell1),
     TESTCASE(tg_spell2),
     TESTCASE(tg_max_word_length1),
+    TESTCASE(tg_partial_prefixes1),
+    TESTCASE(tg_cjk_segmenter1),
     END_OF_TESTCASES
 };
 
@@ -22,6 +22,7 @@
 #include <config.h>
 
 #include <cfloat>
+#include <cstdlib>
 #include <iostream>
 
 #include "testsuite.h"
@@ -45,6 +46,7 @@ using namespace std;
     } while (0)
 
 // Code we're unit testing:
+#include "../api/editdistance.cc"
 #include "../common/fileutils.cc"
 #include "../common/serialise-double.cc"
 #include "../net/length.cc"
@@ -199,6 +201,46 @@ DEFINE_TESTCASE_(serialisedouble1) {
     return true;
 }
 
+// Check EditDistanceCalculator agrees with edit_distance_unsigned().
+DEFINE_TESTCASE_(editdistance1) {
+    static const unsigned hello[] = { 'h', 'e', 'l', 'l', 'o' };
+    static const unsigned hlelo[] = { 'h', 'l', 'e', 'l', 'o' };
+    static const unsigned jelo[] = { 'j', 'e', 'l', 'o' };
+    EditDistanceCalculator calc(hello, 5);
+    TEST_EQUAL(calc(hello, 5, 2), 0);
+    TEST_EQUAL(calc(hlelo, 5, 2), 1);
+    TEST_EQUAL(calc(jelo, 4, 2), 2);
+    TEST_EQUAL(calc(hello, 0, 5), 5);
+    TEST_REL(calc(jelo, 4, 1),>,1);
+
+    srand(42);
+    unsigned a[80], b[80];
+    for (int i = 0; i != 20000; ++i) {
+	// Mostly short sequences from a small alphabet, so there are plenty of
+	// matches and transpositions, but also some long enough to need the
+	// fallback, and some non-ASCII characters.
+	int max_len = (i % 10 == 0) ? 80 : 10;
+	unsigned base = (i % 3 == 0) ? 0x3b1 : 'a';
+	unsigned alphabet = 2 + i % 4;
+	int a_len = rand() % max_len;
+	for (int j = 0; j != a_len; ++j) a[j] = base + rand() % alphabet;
+	int b_len = rand() % max_len;
+	for (int j = 0; j != b_len; ++j) b[j] = base + rand() % alphabet;
+
+	int max_distance = rand() % 5;
+	int expect = edit_distance_unsigned(a, a_len, b, b_len, max_distance);
+	EditDistanceCalculator edcalc(a, a_len);
+	int result = edcalc(b, b_len, max_distance);
+	if (expect <= max_distance) {
+	    TEST_EQUAL(result, expect);
+	} else {
+	    TEST_REL(result,>,max_distance);
+	}
+    }
+
+    return true;
+}
+
 #ifdef XAPIAN_HAS_REMOTE_BACKEND
 // Check serialisation of lengths.
 static bool test_serialiselength1()
@@ -304,6 +346,7 @@ static const test_desc tests[] = {
     TESTCASE(class_exceptions_work1),
     TESTCASE(resolverelativepath1),
     TESTCASE(serialisedouble1),
+    TESTCASE(editdistance1),
 #ifdef XAPIAN_HAS_REMOTE_BACKEND
     TESTCASE(serialiselength1),
     TESTCASE(serialiselength2),
@@ -19,7 +19,8 @@ OBJS= \
              $(INTDIR)\replicatetcpclient.obj \
              $(INTDIR)\remotetcpclient.obj \
              $(INTDIR)\replicatetcpserver.obj \
-             $(INTDIR)\remotetcpserver.obj
+             $(INTDIR)\remotetcpserver.obj \
+             $(INTDIR)\replycache.obj
              
 SRCS= \
              $(INTDIR)\progclient.cc \
@@ -31,7 +32,8 @@ SRCS= \
              $(INTDIR)\replicatetcpclient.cc \
              $(INTDIR)\remotetcpclient.cc \
              $(INTDIR)\replicatetcpserver.cc \
-             $(INTDIR)\remotetcpserver.cc
+             $(INTDIR)\remotetcpserver.cc \
+             $(INTDIR)\replycache.cc
 
 CLEAN :
 	-@erase "$(OUTDIR)\libnet.lib"